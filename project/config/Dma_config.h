@@ -48,7 +48,7 @@ static constexpr const std::array<const Dma, Dma::__ENUM__SIZE + 1> Container =
                             DMA_MemoryInc_Enable, DMA_PeripheralDataSize_Byte,
                             DMA_MemoryDataSize_Byte, DMA_Mode_Normal,
                             DMA_Priority_High, DMA_M2M_Disable},
-          DMA_IT_TC, IRQn_Type::DMA1_Channel4_IRQn),
+          DMA_IT_TC | DMA_IT_HT, IRQn_Type::DMA1_Channel4_IRQn),
       Dma(Dma::USART1_TX,
           DMA1_Channel5_BASE,
           DMA_InitTypeDef { USART1_BASE + 0x28, 0, DMA_DIR_PeripheralDST, 0, DMA_PeripheralInc_Disable,
@@ -19,6 +19,9 @@
 #include "os_Task.h"
 #include "cpp_overrides.h"
 #include "trace.h"
+#ifdef MONITOR_STACKS
+#include "StackMonitor.h"
+#endif
 
 /* OS LAYER INCLUDES */
 #include "hal_Factory.h"
@@ -161,7 +164,7 @@ int main(void)
         //===================== APPS in Slave ==========================
     	[[gnu::unused]] auto slaveController = new app::SlaveController(
                                                         *balancer,
-                                                        *vBalancer,
+                                                        masterToSlaveDTO,
                                                         *g_motorCtrl,
                                                         *vMotor,
                                                         *battery,
@@ -183,9 +186,7 @@ int main(void)
                                                         *virtFetTemp,
                                                         *virtBatteryTemp,
                                                         dev::Factory<dev::Light>::get<interface::Light::HEADLIGHT>(),
-                                                        dev::Factory<dev::Light>::get<interface::Light::HEADLIGHT>(),
-                                                        *virtHeadLight,
-                                                        *virtHeadLight);
+                                                        dev::Factory<dev::Light>::get<interface::Light::HEADLIGHT>());
     }
     else {
         //===================== APPS in Master ==========================
@@ -194,6 +195,10 @@ int main(void)
         [[gnu::unused]] auto steering = new app::SteeringController(*balancer, *vBalancer, straingaugeSensor);
     }
 
+#ifdef MONITOR_STACKS
+    auto __attribute__((used)) stackMonitor = new os::StackMonitor();
+#endif
+
     os::Task::startScheduler();
 
     while (1) {}
@@ -19,6 +19,9 @@
 #include "os_Task.h"
 #include "cpp_overrides.h"
 #include "trace.h"
+#ifdef MONITOR_STACKS
+#include "StackMonitor.h"
+#endif
 
 /* OS LAYER INCLUDES */
 #include "hal_Factory.h"
@@ -92,6 +95,10 @@ int main(void)
 
      g_motorCtrl = new app::DRV8302MotorController( dev::Factory<dev::SensorBLDC>::get<dev::SensorBLDC::BLDC>(), mBattery, 200000, 80000);
 
+#ifdef MONITOR_STACKS
+    auto __attribute__((used)) stackMonitor = new os::StackMonitor();
+#endif
+
     os::Task::startScheduler();
 
     while (1) {}
@@ -161,7 +161,7 @@ int main(void)
         //===================== APPS in Slave ==========================
     	[[gnu::unused]] auto slaveController = new app::SlaveController(
                                                         *balancer,
-                                                        *vBalancer,
+                                                        masterToSlaveDTO,
                                                         *g_motorCtrl,
                                                         *vMotor,
                                                         *battery,
@@ -183,9 +183,7 @@ int main(void)
                                                         *virtFetTemp,
                                                         *virtBatteryTemp,
                                                         dev::Factory<dev::Light>::get<interface::Light::HEADLIGHT>(),
-                                                        dev::Factory<dev::Light>::get<interface::Light::HEADLIGHT>(),
-                                                        *virtHeadLight,
-                                                        *virtHeadLight);
+                                                        dev::Factory<dev::Light>::get<interface::Light::HEADLIGHT>());
     }
     else {
         //===================== APPS in Master ==========================
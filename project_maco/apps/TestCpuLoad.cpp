@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include "TestCpuLoad.h"
+#include "trace.h"
+
+#if defined (STM32F303xC) || defined (STM32F334x8) || defined (STM32F302x8) || defined (STM32F303xE)
+#include "stm32f30x.h"
+#endif
+#if defined (STM32F10X_LD) || defined (STM32F10X_LD_VL) || defined (STM32F10X_MD) || defined (STM32F10X_HD) || \
+    defined (STM32F10X_HD_VL) || defined (STM32F10X_XL) || defined (STM32F10X_CL)
+#include "stm32f10x.h"
+#endif
+
+#ifdef MEASURE_CPU_LOAD
+#include "CpuLoad.h"
+#endif
+
+static const int __attribute__((used)) g_DebugZones = ZONE_ERROR | ZONE_WARNING |
+                                                      ZONE_VERBOSE | ZONE_INFO;
+using os::TaskEndless;
+
+// Build once with and once without MEASURE_CPU_LOAD, the difference of the
+// cycles per context switch is the cost of the run time statistics.
+static constexpr size_t ROUNDS = 10000;
+
+static volatile xTaskHandle g_ping = nullptr;
+static volatile xTaskHandle g_pong = nullptr;
+
+#ifdef MEASURE_CPU_LOAD
+static os::CpuLoad g_cpuLoad;
+#endif
+
+// Each round trip are two context switches between tasks of the same priority
+static const TaskEndless pong("Pong", 256, os::Task::Priority::HIGH, [](const bool&){
+                              g_pong = os::ThisTask::getHandle();
+
+                              while (true) {
+                                  os::ThisTask::notifyTake(portMAX_DELAY);
+                                  os::Task::notifyGive(g_ping);
+                              }
+    });
+
+const TaskEndless app::contextSwitchTest("Ping", 1024, os::Task::Priority::HIGH, [](const bool&){
+                                         CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+                                         DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+                                         g_ping = os::ThisTask::getHandle();
+                                         while (g_pong == nullptr) {
+                                             os::ThisTask::yield();
+                                         }
+
+                                         while (true) {
+                                             const uint32_t start = DWT->CYCCNT;
+                                             for (size_t i = 0; i < ROUNDS; i++) {
+                                                 os::Task::notifyGive(g_pong);
+                                                 os::ThisTask::notifyTake(portMAX_DELAY);
+                                             }
+                                             const uint32_t cycles = DWT->CYCCNT - start;
+
+                                             Trace(ZONE_INFO, "%d cycles per context switch and notification\r\n",
+                                                   cycles / (2 * ROUNDS));
+#ifdef MEASURE_CPU_LOAD
+                                             Trace(ZONE_INFO, "CPU load:\r\n");
+                                             g_cpuLoad.dump([](const std::string_view line){
+            Trace(ZONE_INFO, "%.*s", static_cast<int>(line.length()), line.data());
+        });
+#endif
+                                             os::ThisTask::sleep(std::chrono::seconds(5));
+                                         }
+    });
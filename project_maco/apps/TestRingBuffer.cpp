@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include "TestRingBuffer.h"
+#include "os_RingBuffer.h"
+#include "os_StreamBuffer.h"
+#include "trace.h"
+
+#if defined (STM32F303xC) || defined (STM32F334x8) || defined (STM32F302x8) || defined (STM32F303xE)
+#include "stm32f30x.h"
+#endif
+#if defined (STM32F10X_LD) || defined (STM32F10X_LD_VL) || defined (STM32F10X_MD) || defined (STM32F10X_HD) || \
+    defined (STM32F10X_HD_VL) || defined (STM32F10X_XL) || defined (STM32F10X_CL)
+#include "stm32f10x.h"
+#endif
+
+static const int __attribute__((used)) g_DebugZones = ZONE_ERROR | ZONE_WARNING |
+                                                      ZONE_VERBOSE | ZONE_INFO;
+using os::TaskEndless;
+
+static constexpr size_t BYTES = 256;
+
+static os::StreamBuffer<uint8_t, BYTES> streamBuffer;
+static os::RingBuffer<uint8_t, BYTES> ringBuffer;
+
+struct Cycles {
+    uint32_t send;
+    uint32_t receive;
+};
+
+// Fills the buffer byte by byte like the receive interrupt and drains it byte by byte like the AT parser
+template<typename Send, typename Receive>
+static Cycles measure(Send send, Receive receive)
+{
+    Cycles cycles;
+    uint32_t start = DWT->CYCCNT;
+    for (size_t i = 0; i < BYTES; i++) {
+        send(static_cast<uint8_t>(i));
+    }
+    cycles.send = (DWT->CYCCNT - start) / BYTES;
+
+    start = DWT->CYCCNT;
+    for (size_t i = 0; i < BYTES; i++) {
+        receive();
+    }
+    cycles.receive = (DWT->CYCCNT - start) / BYTES;
+    return cycles;
+}
+
+const TaskEndless app::ringBufferTest("RingBuffer", 1024, os::Task::Priority::LOW, [](const bool&){
+                                      CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+                                      DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+                                      while (true) {
+                                          const Cycles stream = measure([](uint8_t data){
+            streamBuffer.sendFromISR(data);
+        }, []{
+            char data;
+            streamBuffer.receive(&data, 1, 0);
+        });
+
+                                          const Cycles ring = measure([](uint8_t data){
+            ringBuffer.sendFromISR(data);
+        }, []{
+            uint8_t data;
+            ringBuffer.receive(&data, 1, 0);
+        });
+
+                                          Trace(ZONE_INFO, "StreamBuffer: send %d receive %d cycles per byte\r\n",
+                                                stream.send, stream.receive);
+                                          Trace(ZONE_INFO, "RingBuffer:   send %d receive %d cycles per byte\r\n",
+                                                ring.send, ring.receive);
+                                          os::ThisTask::sleep(std::chrono::seconds(5));
+                                      }
+    });
@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include <malloc.h>
+#include "TestStaticAllocation.h"
+#include "Semaphore.h"
+#include "os_Queue.h"
+#include "os_StreamBuffer.h"
+#include "trace.h"
+
+#if defined (STM32F303xC) || defined (STM32F334x8) || defined (STM32F302x8) || defined (STM32F303xE)
+#include "stm32f30x.h"
+#endif
+#if defined (STM32F10X_LD) || defined (STM32F10X_LD_VL) || defined (STM32F10X_MD) || defined (STM32F10X_HD) || \
+    defined (STM32F10X_HD_VL) || defined (STM32F10X_XL) || defined (STM32F10X_CL)
+#include "stm32f10x.h"
+#endif
+
+static const int __attribute__((used)) g_DebugZones = ZONE_ERROR | ZONE_WARNING |
+                                                      ZONE_VERBOSE | ZONE_INFO;
+using os::TaskEndless;
+
+static constexpr size_t STACKSIZE = 256;
+
+static os::TaskStorage<STACKSIZE> taskStorage;
+static os::SemaphoreStorage semaphoreStorage;
+static os::QueueStorage<uint32_t, 16> queueStorage;
+static os::StreamBufferStorage<uint8_t, 64> streamBufferStorage;
+
+struct Measurement {
+    uint32_t cycles;
+    int heap;
+};
+
+// Cycles to create and delete the objects and the heap they take while they exist
+template<typename Function>
+static Measurement measure(Function function)
+{
+    Measurement result;
+    const int heapBefore = mallinfo().uordblks;
+    const uint32_t start = DWT->CYCCNT;
+    result.heap = function() - heapBefore;
+    result.cycles = DWT->CYCCNT - start;
+    return result;
+}
+
+// Creates the kernel objects once from the heap and once from the storage, needs FreeRTOS 9 or newer
+const TaskEndless app::staticAllocationTest("StaticAlloc", 1024, os::Task::Priority::LOW, [](const bool&){
+                                            CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+                                            DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+                                            while (true) {
+                                                const Measurement dynamic = measure([]{
+            os::Semaphore semaphore;
+            os::Queue<uint32_t, 16> queue;
+            os::StreamBuffer<uint8_t, 64> streamBuffer;
+            os::Task task("Dynamic", STACKSIZE, os::Task::Priority::VERY_LOW, [](const bool&){});
+            return mallinfo().uordblks;
+        });
+
+                                                const Measurement stat = measure([]{
+            os::Semaphore semaphore(semaphoreStorage);
+            os::Queue<uint32_t, 16> queue(queueStorage);
+            os::StreamBuffer<uint8_t, 64> streamBuffer(streamBufferStorage);
+            os::Task task("Static", taskStorage, os::Task::Priority::VERY_LOW, [](const bool&){});
+            return mallinfo().uordblks;
+        });
+
+                                                Trace(ZONE_INFO, "dynamic: %d cycles %d byte heap\r\n", dynamic.cycles, dynamic.heap);
+                                                Trace(ZONE_INFO, "static:  %d cycles %d byte heap\r\n", stat.cycles, stat.heap);
+                                                Trace(ZONE_INFO, "heap high water mark %d byte\r\n", mallinfo().arena);
+                                                os::ThisTask::sleep(std::chrono::seconds(5));
+                                            }
+    });
@@ -0,0 +1,24 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#ifndef SOURCES_PMD_FLASH_CONFIG_DESCRIPTION_H_
+#define SOURCES_PMD_FLASH_CONFIG_DESCRIPTION_H_
+
+enum Description {
+    CAN_RECORDER, __ENUM__SIZE
+};
+
+#else
+#ifndef SOURCES_PMD_FLASH_CONFIG_CONTAINER_H_
+#define SOURCES_PMD_FLASH_CONFIG_CONTAINER_H_
+
+// Has to match the RECORDER region of STM32F10x_HD_FLASH_RECORDER.ld
+static constexpr std::array<const Flash, Flash::__ENUM__SIZE> Container =
+{ {
+      Flash(Flash::CAN_RECORDER, 0x08060000, 128 * 1024)
+  } };
+
+#endif /* SOURCES_PMD_FLASH_CONFIG_CONTAINER_H_ */
+#endif /* SOURCES_PMD_FLASH_CONFIG_DESCRIPTION_H_ */
@@ -17,6 +17,9 @@
 #include "os_Task.h"
 #include "cpp_overrides.h"
 #include "trace.h"
+#ifdef MONITOR_STACKS
+#include "StackMonitor.h"
+#endif
 
 /* OS LAYER INCLUDES */
 #include "hal_Factory.h"
@@ -25,6 +28,9 @@
 #include "Dma.h"
 #include "UsartWithDma.h"
 #include "Spi.h"
+#ifdef RECORD_CAN
+#include "Flash.h"
+#endif
 
 /* DEV LAYER INLCUDES */
 
@@ -54,6 +60,9 @@ int main(void)
     hal::initFactory<hal::Factory<hal::Dma> >();
     hal::initFactory<hal::Factory<hal::UsartWithDma> >();
     hal::initFactory<hal::Factory<hal::Spi> >();
+#ifdef RECORD_CAN
+    hal::initFactory<hal::Factory<hal::Flash> >();
+#endif
 
     TraceInit();
     Trace(ZONE_INFO, "Version: %s \r\n", VERSION.c_str());
@@ -74,6 +83,10 @@ int main(void)
     auto demo = new app::DemoExecuter(*can);
     auto __attribute__((used)) mux = new app::CommandMultiplexer(controlsocket, datasocket, *can, *demo);
 
+#ifdef MONITOR_STACKS
+    auto __attribute__((used)) stackMonitor = new os::StackMonitor();
+#endif
+
     os::Task::startScheduler();
     Trace(ZONE_ERROR, "This shouldn't happen!\r\n");
     configASSERT(0);
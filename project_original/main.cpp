@@ -19,6 +19,9 @@
 #include "os_Task.h"
 #include "cpp_overrides.h"
 #include "trace.h"
+#ifdef MONITOR_STACKS
+#include "StackMonitor.h"
+#endif
 
 /* OS LAYER INCLUDES */
 #include "hal_Factory.h"
@@ -107,6 +110,10 @@ int main(void)
 
     g_motorCtrl = new app::DRV8302MotorController( dev::Factory<dev::SensorBLDC>::get<dev::SensorBLDC::BLDC>(), *mBattery, 3.5, 3);
 
+#ifdef MONITOR_STACKS
+    auto __attribute__((used)) stackMonitor = new os::StackMonitor();
+#endif
+
     os::Task::startScheduler();
 
     while (1) {}
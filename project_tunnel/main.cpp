@@ -19,6 +19,9 @@
 #include "os_Task.h"
 #include "cpp_overrides.h"
 #include "trace.h"
+#ifdef MONITOR_STACKS
+#include "StackMonitor.h"
+#endif
 
 /* OS LAYER INCLUDES */
 #include "hal_Factory.h"
@@ -71,6 +74,10 @@ int main(void)
                                          *can);
     }
 
+#ifdef MONITOR_STACKS
+    auto __attribute__((used)) stackMonitor = new os::StackMonitor();
+#endif
+
     os::Task::startScheduler();
 
     while (1) {}
@@ -4,6 +4,7 @@
  */
 
 #include "BatteryObserver.h"
+#include "os_Task.h"
 #include <cstdio>
 #include "trace.h"
 
@@ -16,25 +17,21 @@ const std::chrono::milliseconds BatteryObserver::energyRecordInterval = std::chr
 BatteryObserver::BatteryObserver(const dev::Battery&                  battery,
                                  const std::function<void(ErrorCode)> errorCallback) :
     os::DeepSleepModule(),
-    mEnergyRecordTask(
-                      "2BatteryObserver",
-                      BatteryObserver::STACKSIZE,
-                      os::Task::Priority::LOW,
-                      [this](
-                             const
-                             bool&
-                             join) {
-    energyRecordTaskFunction(
-                             join);
+    mEnergyRecordTimer("BatteryObserver",
+                       BatteryObserver::energyRecordInterval,
+                       os::Timer::Mode::PERIODIC,
+                       [this]() {
+    recordEnergy();
 }),
-    mErrorCallback(
-                   errorCallback),
-    mBattery(
-             battery) {}
+    mErrorCallback(errorCallback),
+    mBattery(battery)
+{
+    mEnergyRecordTimer.start();
+}
 
 void BatteryObserver::enterDeepSleep(void)
 {
-    mEnergyRecordTask.join();
+    mEnergyRecordTimer.stop(portMAX_DELAY);
     mEnteredDeepSleep = hal::Rtc::now();
 }
 
@@ -46,7 +43,7 @@ void BatteryObserver::exitDeepSleep(void)
     auto deepSleepEnergy = calculateEnergyConsumption(deepSleepTime, powerConsumptionDuringDeepSleep);
     decreaseEnergyLevel(deepSleepEnergy);
 
-    mEnergyRecordTask.start();
+    mEnergyRecordTimer.start(portMAX_DELAY);
 }
 
 float BatteryObserver::calculateEnergyConsumption(const std::chrono::milliseconds duration, const float power) const
@@ -73,27 +70,22 @@ void BatteryObserver::undervoltageDetection(void)
     }
 }
 
-void BatteryObserver::energyRecordTaskFunction(const bool& join)
+void BatteryObserver::recordEnergy(void)
 {
-    /* use do while here to manually trigger execution in unit test */
-    do {
-        overcurrentDetection();
-        undervoltageDetection();
+    overcurrentDetection();
+    undervoltageDetection();
 
-        auto ticksNow = os::Task::getTickCount();
-        auto intervalDuration = std::chrono::milliseconds(ticksNow - mLastRecordTimestamp);
-        mLastRecordTimestamp = ticksNow;
+    auto ticksNow = os::Task::getTickCount();
+    auto intervalDuration = std::chrono::milliseconds(ticksNow - mLastRecordTimestamp);
+    mLastRecordTimestamp = ticksNow;
 
-        auto measuredEnergy = calculateEnergyConsumption(intervalDuration, mBattery.getPower());
+    auto measuredEnergy = calculateEnergyConsumption(intervalDuration, mBattery.getPower());
 
-        if (measuredEnergy < 0) {
-            decreaseEnergyLevel(measuredEnergy);
-        } else {
-            increaseEnergyLevel(measuredEnergy);
-        }
-
-        os::ThisTask::sleep(BatteryObserver::energyRecordInterval);
-    } while (!join);
+    if (measuredEnergy < 0) {
+        decreaseEnergyLevel(measuredEnergy);
+    } else {
+        increaseEnergyLevel(measuredEnergy);
+    }
 }
 
 void BatteryObserver::decreaseEnergyLevel(const float energy)
@@ -7,7 +7,7 @@
 
 #include <functional>
 #include "Battery.h"
-#include "TaskInterruptable.h"
+#include "Timer.h"
 #include "Rtc.h"
 #include "DeepSleepInterface.h"
 
@@ -35,14 +35,14 @@ struct BatteryObserver final :
     float getMaxEnergy(void) const;
 
 #ifdef UNITTEST
-    void triggerTaskExecution(void) { this->energyRecordTaskFunction(true); }
+    void triggerTaskExecution(void) { this->recordEnergy(); }
 #endif
 private:
 
     virtual void enterDeepSleep(void) override;
     virtual void exitDeepSleep(void) override;
 
-    os::TaskInterruptable mEnergyRecordTask;
+    os::Timer mEnergyRecordTimer;
     const std::function<void(ErrorCode)> mErrorCallback;
     const dev::Battery& mBattery;
     float mEnergy = 0;
@@ -50,7 +50,6 @@ private:
     hal::Rtc::time_point mEnteredDeepSleep;
     uint32_t mLastRecordTimestamp = 0;
 
-    static constexpr const uint32_t STACKSIZE = 1024;
     static constexpr const float limitOvercurrent = 40.0;
     static constexpr const float limitUndervoltage = 5;
     static constexpr const float powerConsumptionDuringDeepSleep = -0.1;
@@ -60,7 +59,7 @@ private:
                                      const float) const;
     void overcurrentDetection(void);
     void undervoltageDetection(void);
-    void energyRecordTaskFunction(const bool&);
+    void recordEnergy(void);
     void decreaseEnergyLevel(const float);
     void increaseEnergyLevel(const float);
 };
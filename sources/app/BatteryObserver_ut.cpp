@@ -5,7 +5,7 @@
 
 #include "unittest.h"
 #include "BatteryObserver.h"
-#include "TaskInterruptable.h"
+#include "os_Task.h"
 #include <cmath>
 
 #define NUM_TEST_LOOPS 255
@@ -20,7 +20,7 @@ static uint32_t g_currentTickCount;
 static hal::Rtc::time_point g_systemTimeNow;
 static float g_currentVoltage;
 static float g_currentCurrent;
-static bool g_taskJoined, g_taskStarted;
+static bool g_timerStopped, g_timerStarted;
 
 //--------------------------MOCKING--------------------------
 
@@ -29,34 +29,24 @@ constexpr const std::array<const hal::Adc::Channel,
 constexpr const std::array<const hal::Adc,
                            hal::Adc::__ENUM__SIZE> hal::Factory<hal::Adc>::Container;
 
-// Task functions
-void os::TaskInterruptable::join(void)
+// Timer functions
+os::Timer::Timer(char const* name, const std::chrono::milliseconds period, const Mode mode,
+                 std::function<void(void)> function) {}
+
+os::Timer::~Timer(void) {}
+
+bool os::Timer::start(uint32_t ticksToWait) const
 {
-    g_taskJoined = true;
+    g_timerStarted = true;
+    return true;
 }
 
-void os::TaskInterruptable::start(void)
+bool os::Timer::stop(uint32_t ticksToWait) const
 {
-    g_taskStarted = true;
+    g_timerStopped = true;
+    return true;
 }
 
-os::TaskInterruptable::TaskInterruptable(char const* name, unsigned short stack, os::Task::Priority prio,
-                                         std::function<void(bool const&)> func) :
-    Task(name, stack, prio, func) {}
-
-os::TaskInterruptable::~TaskInterruptable(void) {}
-
-void os::TaskInterruptable::taskFunction(void) {}
-
-os::Task::Task(char const* name, unsigned short stack, os::Task::Priority prio,
-               std::function<void(bool const&)> func) {}
-
-os::Task::~Task(void) {}
-
-void os::Task::taskFunction(void) {}
-
-void os::ThisTask::sleep(const std::chrono::milliseconds ms) {}
-
 uint32_t os::Task::getTickCount(void)
 {
     return g_currentTickCount;
@@ -289,18 +279,18 @@ int ut_DeepSleep(void)
 
     // Load to 4 Wh
     g_systemTimeNow = hal::Rtc::from_time_t(0);
-    g_taskJoined = g_taskStarted = false;
+    g_timerStopped = g_timerStarted = false;
 
     os::DeepSleepController::enterGlobalDeepSleep();
 
-    CHECK(true == g_taskJoined);
+    CHECK(true == g_timerStopped);
 
     // sleep for 1 hour
     g_systemTimeNow = hal::Rtc::from_time_t(3600);
 
     os::DeepSleepController::exitGlobalDeepSleep();
 
-    CHECK(true == g_taskStarted);
+    CHECK(true == g_timerStarted);
     CHECK(4 == testee.getMaxEnergy());
     CHECK(std::fabs(3.9 - testee.getEnergy()) < std::numeric_limits<float>::epsilon());
 
@@ -44,10 +44,20 @@ void CanController::enterDeepSleep(void)
 {
     off();
     mTask.join();
+#ifdef RECORD_CAN
+    if (mRecorder) {
+        mRecorder->suspend();
+    }
+#endif
 }
 
 void CanController::exitDeepSleep(void)
 {
+#ifdef RECORD_CAN
+    if (mRecorder) {
+        mRecorder->resume();
+    }
+#endif
     mTask.start();
     on();
 }
@@ -60,7 +70,9 @@ void CanController::taskFunction(const bool& join)
                 const size_t length = ReceiveBuffer.receive(
                                                             mTempReceiveCallbackBuffer.data(),
                                                             mTempReceiveCallbackBuffer.size(), 100);
-                mReceiveCallback(std::string_view(mTempReceiveCallbackBuffer.data(), length));
+                const std::string_view data(mTempReceiveCallbackBuffer.data(), length);
+                observeReceivedData(data);
+                mReceiveCallback(data);
                 continue;
             }
         }
@@ -77,19 +89,43 @@ void CanController::taskFunction(const bool& join)
 void CanController::flashSecCoFirmware(void)
 {
     mWasFirmwareUpdateSuccessful = false;
-    mWasFirmwareUpdateSuccessful = flash(std::string_view(
-                                                          reinterpret_cast<char*>(&_binary_start),
-                                                          reinterpret_cast<char*>(&_binary_end) -
-                                                          reinterpret_cast<char*>(&_binary_start)),
-                                         0x8000000);
+    mWasFirmwareUpdateSuccessful = flashWithBaudRateFallback(std::string_view(
+                                                                              reinterpret_cast<char*>(&_binary_start),
+                                                                              reinterpret_cast<char*>(&_binary_end) -
+                                                                              reinterpret_cast<char*>(&_binary_start)),
+                                                             0x8000000);
 
     mIsPerformingFirmwareUpdate = false;
 }
 
+bool CanController::flashWithBaudRateFallback(std::string_view data, const size_t address)
+{
+    bool success = false;
+    mFlashDurationsPerBaudRate.fill(0);
+
+    for (mBootloaderBaudRateIndex = 0; mBootloaderBaudRateIndex < BOOTLOADER_BAUDRATES.size() && !success;
+         mBootloaderBaudRateIndex++)
+    {
+        const uint32_t startTick = os::Task::getTickCount();
+        success = flash(data, address);
+        mFlashDurationsPerBaudRate[mBootloaderBaudRateIndex] = (os::Task::getTickCount() - startTick) *
+                                                               portTICK_RATE_MS;
+
+        Trace(ZONE_INFO, "Flashing with %d baud %s after %d ms\r\n",
+              BOOTLOADER_BAUDRATES[mBootloaderBaudRateIndex],
+              success ? "succeeded" : "failed",
+              mFlashDurationsPerBaudRate[mBootloaderBaudRateIndex]);
+    }
+
+    mInterface.mUsart.restoreDefaultConfiguration();
+    return success;
+}
+
 bool CanController::connectToBootloader(void)
 {
+    mInterface.mUsart.setBaudRate(BOOTLOADER_BAUDRATES[mBootloaderBaudRateIndex]);
     ReceiveBuffer.reset();
-    Trace(ZONE_INFO, "Connecting to bootloader... ");
+    Trace(ZONE_INFO, "Connecting to bootloader with %d baud... ", BOOTLOADER_BAUDRATES[mBootloaderBaudRateIndex]);
     mInterface.send("\x7f");
     return receiveResponseFromBootloader();
 }
@@ -116,12 +152,12 @@ size_t CanController::sendToBootloaderWithChecksum(std::string_view data, uint8_
     return ret + 1;
 }
 
-bool CanController::receiveResponseFromBootloader(void)
+bool CanController::receiveResponseFromBootloader(uint32_t ticksToWait)
 {
     static constexpr const uint8_t ACK = 0x79;
 
     uint8_t uret;
-    if (!ReceiveBuffer.receive(uret, 100)) {
+    if (!ReceiveBuffer.receive(uret, ticksToWait)) {
         Trace(ZONE_INFO, "Nothing received... \r\n");
         return false;
     }
@@ -174,20 +210,61 @@ bool CanController::sendGoCommand(const uint32_t goAddress)
     return true;
 }
 
-bool CanController::flash(std::string_view data, const size_t address)
+bool CanController::erasePages(const PageSet& pages, const uint32_t address)
 {
-    Trace(ZONE_INFO, "Flash 0x%x bytes. \r\n", data.length());
+    if (pages.none()) {
+        return true;
+    }
 
-    if (!eraseChip()) {
-        return false;
+    static_assert(MAXCHUNKSIZE >= MAXPAGES + 1, "Erase request doesn't fit into buffer");
+
+    // The bootloader takes absolute page numbers
+    const size_t firstPage = (address - FLASH_START) / PAGESIZE;
+
+    size_t length = 0;
+    mTempReceiveCallbackBuffer[length++] = static_cast<char>(pages.count() - 1);
+    for (size_t page = 0; page < pages.size(); page++) {
+        if (pages.test(page)) {
+            mTempReceiveCallbackBuffer[length++] = static_cast<char>(firstPage + page);
+        }
     }
 
-    resetToBootloader();
+    Trace(ZONE_INFO, "Sending erase... ");
+    if (!sendCommandToBootloader("\x43")) { return false; }
 
-    if (!connectToBootloader()) {
-        return false;
+    Trace(ZONE_INFO, "Sending %u pages to erase... ", static_cast<unsigned int>(pages.count()));
+    sendToBootloaderWithChecksum(std::string_view(mTempReceiveCallbackBuffer.data(), length));
+
+    // A page erase takes up to 40 ms on the coprocessor
+    return receiveResponseFromBootloader(100 + pages.count() * 40);
+}
+
+bool CanController::readMemory(const uint32_t address, char* data, const size_t length)
+{
+    if (!sendCommandToBootloader("\x11")) { return false; }
+
+    auto src_be = swap(address);
+    sendToBootloaderWithChecksum(std::string_view(reinterpret_cast<const char*>(&src_be), 4));
+    if (!receiveResponseFromBootloader()) { return false; }
+
+    const char N = static_cast<char>(length - 1);
+    sendToBootloaderWithChecksum(std::string_view(&N, 1), 0xff);
+    if (!receiveResponseFromBootloader()) { return false; }
+
+    size_t bytesReceived = 0;
+    while (bytesReceived < length) {
+        const size_t ret = ReceiveBuffer.receive(data + bytesReceived, length - bytesReceived, 100);
+        if (!ret) {
+            Trace(ZONE_INFO, "Readback timeout... \r\n");
+            return false;
+        }
+        bytesReceived += ret;
     }
+    return true;
+}
 
+bool CanController::writeMemory(const uint32_t address, std::string_view data)
+{
     uint8_t N = 0;
     size_t dst = address;
     size_t src_idx = 0;
@@ -212,6 +289,87 @@ bool CanController::flash(std::string_view data, const size_t address)
         dst += N + 1;
         src_idx += N + 1;
     }
+    return true;
+}
+
+bool CanController::findChangedPages(std::string_view data, const uint32_t address, PageSet& changedPages)
+{
+    for (size_t page = 0; page * PAGESIZE < data.length(); page++) {
+        const auto content = data.substr(page * PAGESIZE, PAGESIZE);
+
+        // The bootloader offers no checksum command, so every page has to be read back
+        // anyway. Comparing chunk by chunk stops the readback at the first difference.
+        for (size_t offset = 0; offset < content.length(); offset += MAXCHUNKSIZE) {
+            const auto chunk = content.substr(offset, MAXCHUNKSIZE);
+
+            if (!readMemory(address + page * PAGESIZE + offset, mTempReceiveCallbackBuffer.data(), chunk.length())) {
+                return false;
+            }
+
+            if (std::memcmp(chunk.data(), mTempReceiveCallbackBuffer.data(), chunk.length()) != 0) {
+                changedPages.set(page);
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+bool CanController::flash(std::string_view data, const size_t address)
+{
+    Trace(ZONE_INFO, "Flash 0x%x bytes. \r\n", static_cast<unsigned int>(data.length()));
+
+    const size_t pageOffset = address - FLASH_START;
+    if ((address < FLASH_START) || (pageOffset % PAGESIZE != 0) ||
+        (pageOffset + data.length() > PAGESIZE * MAXPAGES))
+    {
+        return flashAll(data, address);
+    }
+
+    resetToBootloader();
+
+    if (!connectToBootloader()) {
+        return false;
+    }
+
+    PageSet changedPages;
+    if (!findChangedPages(data, address, changedPages)) {
+        Trace(ZONE_INFO, "Readback failed. Flash whole image. \r\n");
+        return flashAll(data, address);
+    }
+
+    Trace(ZONE_INFO, "%u pages changed. \r\n", static_cast<unsigned int>(changedPages.count()));
+
+    if (!erasePages(changedPages, address)) {
+        return false;
+    }
+
+    for (size_t page = 0; page < changedPages.size(); page++) {
+        if (changedPages.test(page)) {
+            if (!writeMemory(address + page * PAGESIZE, data.substr(page * PAGESIZE, PAGESIZE))) {
+                return false;
+            }
+        }
+    }
+
+    return sendGoCommand(address);
+}
+
+bool CanController::flashAll(std::string_view data, const size_t address)
+{
+    if (!eraseChip()) {
+        return false;
+    }
+
+    resetToBootloader();
+
+    if (!connectToBootloader()) {
+        return false;
+    }
+
+    if (!writeMemory(address, data)) {
+        return false;
+    }
 
     return sendGoCommand(address);
 }
@@ -268,11 +426,28 @@ size_t CanController::receive(uint8_t* message, size_t length, uint32_t ticksToW
     } else if (mReceiveCallback != nullptr) {
         Trace(ZONE_ERROR, "A receive callback is registered. Use that one to get data!\r\n ");
     } else {
-        return ReceiveBuffer.receive(reinterpret_cast<char*>(message), length, ticksToWait);
+        const size_t received = ReceiveBuffer.receive(reinterpret_cast<char*>(message), length, ticksToWait);
+        observeReceivedData(std::string_view(reinterpret_cast<char*>(message), received));
+        return received;
     }
     return 0;
 }
 
+void CanController::observeReceivedData(const std::string_view data)
+{
+    if (mIsStatisticsEnabled) {
+        mStatistics->parse(data, os::Task::getTickCount());
+    }
+#ifdef RECORD_CAN
+    if (mRecorder && mRecorder->isRecording()) {
+        mRecorder->record(data, os::Task::getTickCount());
+    }
+#endif
+    if (mDiagnosticCallback) {
+        mDiagnosticCallback(data);
+    }
+}
+
 void CanController::registerReceiveCallback(std::function<void(std::string_view)> f)
 {
     mReceiveCallback = f;
@@ -281,3 +456,77 @@ void CanController::unregisterReceiveCallback(void)
 {
     mReceiveCallback = nullptr;
 }
+
+void CanController::registerDiagnosticCallback(std::function<void(std::string_view)> f)
+{
+    mDiagnosticCallback = f;
+}
+
+void CanController::unregisterDiagnosticCallback(void)
+{
+    mDiagnosticCallback = nullptr;
+}
+
+void CanController::enableStatistics(void)
+{
+    // The table is kept after disabling, because the CanTask may still be inside parse()
+    if (!mStatistics) {
+        mStatistics = std::make_unique<CanStatistics<STATISTICSSIZE> >();
+    }
+    mIsStatisticsEnabled = true;
+}
+
+void CanController::disableStatistics(void)
+{
+    mIsStatisticsEnabled = false;
+}
+
+bool CanController::isStatisticsEnabled(void) const
+{
+    return mIsStatisticsEnabled;
+}
+
+void CanController::dumpStatistics(const std::function<void(std::string_view)>& send) const
+{
+    if (mStatistics) {
+        mStatistics->dump(send);
+    }
+}
+
+#ifdef RECORD_CAN
+app::CanRecorder& CanController::getRecorder(void)
+{
+    // Like the statistics, the recorder is kept once it was needed
+    if (!mRecorder) {
+        mRecorder = std::make_unique<CanRecorder>(*this,
+                                                  hal::Factory<hal::Flash>::get<hal::Flash::CAN_RECORDER>());
+    }
+    return *mRecorder;
+}
+
+bool CanController::startRecording(void)
+{
+    return getRecorder().start();
+}
+
+void CanController::stopRecording(void)
+{
+    if (mRecorder) {
+        mRecorder->stop();
+    }
+}
+
+bool CanController::replayRecording(void)
+{
+    return getRecorder().replay();
+}
+
+bool CanController::getRecorderStatus(CanRecorder::Status& status) const
+{
+    if (!mRecorder) {
+        return false;
+    }
+    status = mRecorder->getStatus();
+    return true;
+}
+#endif
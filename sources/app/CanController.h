@@ -10,8 +10,22 @@
 #include "os_StreamBuffer.h"
 #include "UsartWithDma.h"
 #include "Gpio.h"
+#include "CanStatistics.h"
+#ifdef RECORD_CAN
+#include "CanRecorder.h"
+#endif
 #include <string_view>
 #include <array>
+#include <bitset>
+#include <memory>
+
+#ifdef UNITTEST
+int ut_FlashUnchangedImage(void);
+int ut_FlashChangedPages(void);
+int ut_FlashChangedPagesAtOffset(void);
+int ut_FlashReadProtected(void);
+int ut_FlashBaudRateFallback(void);
+#endif
 
 namespace app
 {
@@ -27,6 +41,22 @@ class CanController final :
     static constexpr size_t BUFFERSIZE = 2048;
     static constexpr size_t MAXCHUNKSIZE = 256;
 
+    // Flash page size of the coprocessor. The standard erase command of the
+    // bootloader addresses pages with one byte, counted from FLASH_START, so only
+    // images which end below page MAXPAGES can be updated page by page. Others
+    // fall back to a global erase.
+    static constexpr uint32_t FLASH_START = 0x08000000;
+    static constexpr size_t PAGESIZE = 2048;
+    static constexpr size_t MAXPAGES = 255;
+    using PageSet = std::bitset<MAXPAGES>;
+
+    // The bootloader detects the baud rate from the sync byte. The ROM bootloader
+    // of the F1 supports up to 115200 baud (AN2606), so the list starts there.
+    // Rates are tried from fast to slow until a complete update succeeds.
+    static constexpr std::array<uint32_t, 4> BOOTLOADER_BAUDRATES = {{115200, 57600, 38400, 19200}};
+    size_t mBootloaderBaudRateIndex = 0;
+    std::array<uint32_t, BOOTLOADER_BAUDRATES.size()> mFlashDurationsPerBaudRate {};
+
     static os::StreamBuffer<uint8_t, BUFFERSIZE> ReceiveBuffer;
     std::array<char, MAXCHUNKSIZE> mTempReceiveCallbackBuffer;
 
@@ -37,21 +67,40 @@ class CanController final :
     const hal::Gpio& mUsartTxPin;
 
     std::function<void(std::string_view)> mReceiveCallback;
+    std::function<void(std::string_view)> mDiagnosticCallback;
+
+    static constexpr size_t STATISTICSSIZE = 64;
+    std::unique_ptr<CanStatistics<STATISTICSSIZE> > mStatistics;
+    bool mIsStatisticsEnabled = false;
+
+#ifdef RECORD_CAN
+    std::unique_ptr<CanRecorder> mRecorder;
+#endif
 
     bool mIsPerformingFirmwareUpdate = false;
     bool mWasFirmwareUpdateSuccessful = false;
 
     void taskFunction(const bool&);
+    void observeReceivedData(const std::string_view data);
     void flashSecCoFirmware(void);
-    bool flash(std::string_view data, size_t length);
+    bool flashWithBaudRateFallback(std::string_view data, size_t address);
+    bool flash(std::string_view data, size_t address);
+    bool flashAll(std::string_view data, size_t address);
     void resetToBootloader(void);
     bool connectToBootloader(void);
     bool sendCommandToBootloader(std::string_view cmd);
     uint32_t swap(const uint32_t);
-    bool receiveResponseFromBootloader(void);
+    bool receiveResponseFromBootloader(uint32_t ticksToWait = 100);
     size_t sendToBootloaderWithChecksum(std::string_view, uint8_t initvalue = 0);
     bool eraseChip(void);
+    bool erasePages(const PageSet& pages, const uint32_t address);
+    bool readMemory(const uint32_t address, char* data, const size_t length);
+    bool writeMemory(const uint32_t address, std::string_view data);
+    bool findChangedPages(std::string_view data, const uint32_t address, PageSet& changedPages);
     bool sendGoCommand(const uint32_t goAddress);
+#ifdef RECORD_CAN
+    CanRecorder& getRecorder(void);
+#endif
 
 public:
     CanController(const hal::UsartWithDma& interface,
@@ -78,6 +127,31 @@ public:
     void registerReceiveCallback(std::function<void(std::string_view)> );
     void unregisterReceiveCallback(void);
 
+    // Sees the received data in addition to the receive callback or the caller
+    // of receive(), e.g. for IsoTp. Data which nobody receives isn't seen.
+    void registerDiagnosticCallback(std::function<void(std::string_view)> );
+    void unregisterDiagnosticCallback(void);
+
+    void enableStatistics(void);
+    void disableStatistics(void);
+    bool isStatisticsEnabled(void) const;
+    void dumpStatistics(const std::function<void(std::string_view)>& send) const;
+
+#ifdef RECORD_CAN
+    bool startRecording(void);
+    void stopRecording(void);
+    bool replayRecording(void);
+    bool getRecorderStatus(CanRecorder::Status& status) const;
+#endif
+
     friend CanTunnel;
+
+#ifdef UNITTEST
+    friend int ::ut_FlashUnchangedImage(void);
+    friend int ::ut_FlashChangedPages(void);
+    friend int ::ut_FlashChangedPagesAtOffset(void);
+    friend int ::ut_FlashReadProtected(void);
+    friend int ::ut_FlashBaudRateFallback(void);
+#endif
 };
 }
@@ -0,0 +1,569 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include <array>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+#include "unittest.h"
+#include "CanController.h"
+
+//--------------------------BUFFERS--------------------------
+static constexpr size_t PAGESIZE = 2048;
+static constexpr size_t FLASHSIZE = 128 * PAGESIZE;
+static constexpr uint32_t FLASHBASE = 0x8000000;
+static constexpr uint8_t ACK = 0x79;
+static constexpr uint8_t NACK = 0x1f;
+
+static constexpr size_t DEFAULT_BAUDRATE = 115200;
+static constexpr size_t BITS_PER_BYTE = 11; // 8 data bits, even parity, start and stop bit
+static constexpr size_t PAGE_ERASE_TIME_US = 20000;
+static constexpr size_t MASS_ERASE_TIME_US = 40000;
+static constexpr size_t HALFWORD_PROGRAM_TIME_US = 52;
+
+uint64_t g_simulatedTimeUs;
+size_t g_baudRate = DEFAULT_BAUDRATE;
+
+std::array<std::deque<uint8_t>, 4> g_streamBuffers;
+int g_counterOfReturnedStreamBufferHandles = -1;
+
+struct BootloaderSimulation {
+    enum class State {
+        SYNC,
+        COMMAND,
+        READ_ADDRESS,
+        READ_COUNT,
+        WRITE_ADDRESS,
+        WRITE_DATA,
+        ERASE,
+        GO_ADDRESS,
+        RUNNING
+    };
+
+    std::vector<uint8_t> flash = std::vector<uint8_t>(FLASHSIZE, 0xff);
+    bool readProtected = false;
+    size_t maxSyncBaudRate = 115200;
+    size_t maxReliableBaudRate = 115200;
+
+    State state = State::SYNC;
+    std::vector<uint8_t> pending;
+    uint32_t address = 0;
+
+    size_t pagesErased = 0;
+    size_t massErases = 0;
+    size_t bytesWritten = 0;
+    size_t bytesRead = 0;
+
+    void reset(void)
+    {
+        state = State::SYNC;
+        pending.clear();
+    }
+
+    void respond(const uint8_t data)
+    {
+        g_simulatedTimeUs += BITS_PER_BYTE * 1000000 / g_baudRate;
+        app::CanController::CanControllerInterruptHandler(data);
+    }
+
+    bool checksumValid(void) const
+    {
+        uint8_t sum = 0;
+        for (const auto& b : pending) {
+            sum ^= b;
+        }
+        return sum == 0;
+    }
+
+    void finish(const bool success, const State next = State::COMMAND)
+    {
+        respond(success ? ACK : NACK);
+        pending.clear();
+        state = success ? next : State::COMMAND;
+    }
+
+    void receive(const uint8_t data)
+    {
+        g_simulatedTimeUs += BITS_PER_BYTE * 1000000 / g_baudRate;
+
+        if (g_baudRate > maxSyncBaudRate) {
+            // sync byte is not recognized, the bootloader stays silent
+            return;
+        }
+        const bool corrupted = (state != State::SYNC) && (g_baudRate > maxReliableBaudRate);
+        pending.push_back(corrupted ? data ^ 0x04 : data);
+
+        switch (state) {
+        case State::SYNC:
+            if (pending.back() == 0x7f) {
+                finish(true);
+            } else {
+                pending.clear();
+            }
+            break;
+
+        case State::COMMAND:
+            if (pending.size() < 2) { return; }
+            if ((pending[0] ^ pending[1]) != 0xff) {
+                finish(false);
+            } else if (pending[0] == 0x11) {
+                finish(!readProtected, State::READ_ADDRESS);
+            } else if (pending[0] == 0x31) {
+                finish(!readProtected, State::WRITE_ADDRESS);
+            } else if (pending[0] == 0x43) {
+                finish(!readProtected, State::ERASE);
+            } else if (pending[0] == 0x21) {
+                finish(true, State::GO_ADDRESS);
+            } else if (pending[0] == 0x92) {
+                readProtected = false;
+                std::fill(flash.begin(), flash.end(), 0xff);
+                massErases++;
+                g_simulatedTimeUs += MASS_ERASE_TIME_US;
+                respond(ACK);
+                finish(true, State::SYNC);
+            } else {
+                finish(false);
+            }
+            break;
+
+        case State::READ_ADDRESS:
+        case State::WRITE_ADDRESS:
+        case State::GO_ADDRESS:
+            if (pending.size() < 5) { return; }
+            address = (pending[0] << 24) | (pending[1] << 16) | (pending[2] << 8) | pending[3];
+            finish(checksumValid() && (address >= FLASHBASE) && (address < FLASHBASE + FLASHSIZE),
+                   state == State::READ_ADDRESS ? State::READ_COUNT :
+                   state == State::WRITE_ADDRESS ? State::WRITE_DATA : State::RUNNING);
+            break;
+
+        case State::READ_COUNT:
+            if (pending.size() < 2) { return; }
+            if ((pending[0] ^ pending[1]) != 0xff) {
+                finish(false);
+            } else {
+                const size_t length = pending[0] + 1;
+                finish(true);
+                for (size_t i = 0; i < length; i++) {
+                    respond(flash[address - FLASHBASE + i]);
+                }
+                bytesRead += length;
+            }
+            break;
+
+        case State::WRITE_DATA:
+            if (pending.size() < static_cast<size_t>(pending[0] + 3)) { return; }
+            if (checksumValid()) {
+                const size_t length = pending[0] + 1;
+                for (size_t i = 0; i < length; i++) {
+                    // flash cells can only be programmed from the erased state
+                    flash[address - FLASHBASE + i] &= pending[1 + i];
+                }
+                bytesWritten += length;
+                g_simulatedTimeUs += (length / 2) * HALFWORD_PROGRAM_TIME_US;
+            }
+            finish(checksumValid());
+            break;
+
+        case State::ERASE:
+            if (pending[0] == 0xff) {
+                if (pending.size() < 2) { return; }
+                std::fill(flash.begin(), flash.end(), 0xff);
+                massErases++;
+                g_simulatedTimeUs += MASS_ERASE_TIME_US;
+                finish(pending[1] == 0x00);
+            } else {
+                if (pending.size() < static_cast<size_t>(pending[0] + 3)) { return; }
+                if (checksumValid()) {
+                    for (size_t i = 0; i < static_cast<size_t>(pending[0] + 1); i++) {
+                        std::fill_n(flash.begin() + pending[1 + i] * PAGESIZE, PAGESIZE, 0xff);
+                        pagesErased++;
+                        g_simulatedTimeUs += PAGE_ERASE_TIME_US;
+                    }
+                }
+                finish(checksumValid());
+            }
+            break;
+
+        case State::RUNNING:
+            pending.clear();
+            break;
+        }
+    }
+};
+
+BootloaderSimulation g_bootloader;
+
+//--------------------------MOCKING--------------------------
+constexpr const std::array<const hal::Gpio, hal::Gpio::__ENUM__SIZE + 1> hal::Factory<hal::Gpio>::Container;
+constexpr const std::array<const hal::Usart, hal::Usart::__ENUM__SIZE + 1> hal::Factory<hal::Usart>::Container;
+constexpr const std::array<const hal::Dma, hal::Dma::__ENUM__SIZE + 1> hal::Factory<hal::Dma>::Container;
+constexpr const std::array<const hal::UsartWithDma,
+                           hal::Usart::__ENUM__SIZE> hal::Factory<hal::UsartWithDma>::Container;
+
+extern "C" {
+char _binary_start = 0;
+char _binary_end = 0;
+}
+
+void os::TaskInterruptable::join(void) {}
+
+void os::TaskInterruptable::start(void) {}
+
+os::TaskInterruptable::TaskInterruptable(char const* name, unsigned short stack, os::Task::Priority prio,
+                                         std::function<void(bool const&)> func) :
+    Task(name, stack, prio, func) {}
+
+os::TaskInterruptable::~TaskInterruptable(void) {}
+
+void os::TaskInterruptable::taskFunction(void) {}
+
+os::Task::Task(char const* name, unsigned short stack, os::Task::Priority prio,
+               std::function<void(bool const&)> func) {}
+
+os::Task::~Task(void) {}
+
+void os::Task::taskFunction(void) {}
+
+void os::ThisTask::sleep(const std::chrono::milliseconds ms)
+{
+    g_simulatedTimeUs += ms.count() * 1000;
+}
+
+void os::ThisTask::yield(void) {}
+
+void os::ThisTask::enterCriticalSection(void) {}
+
+void os::ThisTask::exitCriticalSection(void) {}
+
+QueueHandle_t xQueueGenericCreate(const UBaseType_t uxQueueLength,
+                                  const UBaseType_t uxItemSize,
+                                  const uint8_t     ucQueueType)
+{
+    return reinterpret_cast<QueueHandle_t>(1);
+}
+
+void vQueueDelete(QueueHandle_t xQueue) {}
+
+uint32_t os::Task::getTickCount(void)
+{
+    return g_simulatedTimeUs / 1000;
+}
+
+size_t hal::UsartWithDma::send(uint8_t const* const data, const size_t length, const uint32_t ticksToWait) const
+{
+    for (size_t i = 0; i < length; i++) {
+        g_bootloader.receive(data[i]);
+    }
+    return length;
+}
+
+size_t hal::UsartWithDma::send(std::string_view str, const uint32_t ticksToWait) const
+{
+    return send(reinterpret_cast<uint8_t const* const>(str.data()), str.length(), ticksToWait);
+}
+
+void hal::Usart::enableNonBlockingReceive(std::function<void(uint8_t)> callback) const {}
+
+void hal::Usart::setBaudRate(const size_t baudRate) const
+{
+    g_baudRate = baudRate;
+}
+
+void hal::Usart::restoreDefaultConfiguration(void) const
+{
+    g_baudRate = DEFAULT_BAUDRATE;
+}
+
+void hal::Gpio::operator=(const bool& state) const
+{
+    if ((this == &hal::Factory<hal::Gpio>::get<hal::Gpio::SECCO_PWR>()) && state) {
+        g_bootloader.reset();
+    }
+}
+
+void hal::Gpio::configureAsOutput(void) const {}
+
+void hal::Gpio::restoreDefaultConfiguration(void) const {}
+
+StreamBufferHandle_t xStreamBufferGenericCreate(size_t     xBufferSizeBytes,
+                                                size_t     xTriggerLevelBytes,
+                                                BaseType_t xIsMessageBuffer)
+{
+    g_counterOfReturnedStreamBufferHandles++;
+    return reinterpret_cast<StreamBufferHandle_t>(g_counterOfReturnedStreamBufferHandles);
+}
+
+void vStreamBufferDelete(StreamBufferHandle_t xStreamBuffer) {}
+
+size_t xStreamBufferSendFromISR(StreamBufferHandle_t xStreamBuffer,
+                                const void*          pvTxData,
+                                size_t               xDataLengthBytes,
+                                BaseType_t* const    pxHigherPriorityTaskWoken)
+{
+    auto& buffer = g_streamBuffers[reinterpret_cast<size_t>(xStreamBuffer)];
+    auto p = reinterpret_cast<const uint8_t*>(pvTxData);
+    buffer.insert(buffer.end(), p, p + xDataLengthBytes);
+    return xDataLengthBytes;
+}
+
+size_t xStreamBufferReceive(StreamBufferHandle_t xStreamBuffer,
+                            void*                pvRxData,
+                            size_t               xBufferLengthBytes,
+                            TickType_t           xTicksToWait)
+{
+    auto& buffer = g_streamBuffers[reinterpret_cast<size_t>(xStreamBuffer)];
+    auto p = reinterpret_cast<uint8_t*>(pvRxData);
+
+    size_t i;
+    for (i = 0; i < xBufferLengthBytes && !buffer.empty(); i++) {
+        *p++ = buffer.front();
+        buffer.pop_front();
+    }
+    if (i == 0) {
+        g_simulatedTimeUs += xTicksToWait * 1000;
+    }
+    return i;
+}
+
+size_t xStreamBufferBytesAvailable(StreamBufferHandle_t xStreamBuffer)
+{
+    return g_streamBuffers[reinterpret_cast<size_t>(xStreamBuffer)].size();
+}
+
+BaseType_t xStreamBufferReset(StreamBufferHandle_t xStreamBuffer)
+{
+    g_streamBuffers[reinterpret_cast<size_t>(xStreamBuffer)].clear();
+    return pdTRUE;
+}
+
+//-------------------------TESTCASES-------------------------
+
+static std::string createImage(const size_t length)
+{
+    std::string image(length, 0);
+    uint32_t x = 0x12345678;
+    for (auto& c : image) {
+        x = x * 1103515245 + 12345;
+        c = static_cast<char>(x >> 16);
+    }
+    return image;
+}
+
+static bool flashContains(const std::string& image, const size_t offset = 0)
+{
+    return 0 == std::memcmp(g_bootloader.flash.data() + offset, image.data(), image.length());
+}
+
+static app::CanController& getController(void)
+{
+    static app::CanController can(hal::Factory<hal::UsartWithDma>::get<hal::Usart::SECCO_COM>(),
+                                  hal::Factory<hal::Gpio>::get<hal::Gpio::SECCO_PWR>(),
+                                  hal::Factory<hal::Gpio>::getAlternateFunctionGpio<hal::Gpio::USART2_TX>());
+    return can;
+}
+
+static void printStatistics(const char* name, const std::string& image, const uint64_t fullUpdateUs)
+{
+    const size_t pages = (image.length() + PAGESIZE - 1) / PAGESIZE;
+    printf("%s: %6d baud, %3d of %3d pages skipped, %5d ms (full update %5d ms)\n",
+           name,
+           (int)g_baudRate,
+           (int)(pages - g_bootloader.pagesErased),
+           (int)pages,
+           (int)(g_simulatedTimeUs / 1000),
+           (int)(fullUpdateUs / 1000));
+}
+
+int ut_FlashUnchangedImage(void)
+{
+    TestCaseBegin();
+
+    const auto image = createImage(50 * PAGESIZE - 1000);
+    g_bootloader = BootloaderSimulation();
+    g_simulatedTimeUs = 0;
+    CHECK(getController().flashAll(image, FLASHBASE));
+    const auto fullUpdateUs = g_simulatedTimeUs;
+
+    g_bootloader = BootloaderSimulation();
+    std::copy(image.begin(), image.end(), g_bootloader.flash.begin());
+    g_simulatedTimeUs = 0;
+
+    CHECK(getController().flash(image, FLASHBASE));
+    CHECK(g_bootloader.state == BootloaderSimulation::State::RUNNING);
+    CHECK(g_bootloader.pagesErased == 0);
+    CHECK(g_bootloader.massErases == 0);
+    CHECK(g_bootloader.bytesWritten == 0);
+    CHECK(g_bootloader.bytesRead == image.length());
+    CHECK(flashContains(image));
+    CHECK(g_simulatedTimeUs < fullUpdateUs);
+
+    printStatistics(__FUNCTION__, image, fullUpdateUs);
+
+    TestCaseEnd();
+}
+
+int ut_FlashChangedPages(void)
+{
+    TestCaseBegin();
+
+    const auto oldImage = createImage(50 * PAGESIZE - 1000);
+    auto image = oldImage;
+    image[3 * PAGESIZE + 17] ^= 0x55;
+    image[17 * PAGESIZE] ^= 0x01;
+    image[image.length() - 1] ^= 0x80;
+
+    g_bootloader = BootloaderSimulation();
+    g_simulatedTimeUs = 0;
+    CHECK(getController().flashAll(image, FLASHBASE));
+    const auto fullUpdateUs = g_simulatedTimeUs;
+
+    g_bootloader = BootloaderSimulation();
+    std::copy(oldImage.begin(), oldImage.end(), g_bootloader.flash.begin());
+    g_simulatedTimeUs = 0;
+
+    CHECK(getController().flash(image, FLASHBASE));
+    CHECK(g_bootloader.state == BootloaderSimulation::State::RUNNING);
+    CHECK(g_bootloader.pagesErased == 3);
+    CHECK(g_bootloader.massErases == 0);
+    const size_t lastPageLength = image.length() % PAGESIZE;
+    CHECK(g_bootloader.bytesWritten == 2 * PAGESIZE + lastPageLength);
+    CHECK(flashContains(image));
+    CHECK(g_simulatedTimeUs < fullUpdateUs);
+
+    printStatistics(__FUNCTION__, image, fullUpdateUs);
+
+    TestCaseEnd();
+}
+
+int ut_FlashChangedPagesAtOffset(void)
+{
+    TestCaseBegin();
+
+    // The bootloader erases absolute page numbers, so a page relative to the image must not be erased
+    const size_t offset = 20 * PAGESIZE;
+    const auto oldImage = createImage(10 * PAGESIZE);
+    auto image = oldImage;
+    image[4 * PAGESIZE + 1] ^= 0x01;
+
+    g_bootloader = BootloaderSimulation();
+    std::fill_n(g_bootloader.flash.begin(), offset, 0x5a);
+    std::copy(oldImage.begin(), oldImage.end(), g_bootloader.flash.begin() + offset);
+    g_simulatedTimeUs = 0;
+
+    CHECK(getController().flash(image, FLASHBASE + offset));
+    CHECK(g_bootloader.state == BootloaderSimulation::State::RUNNING);
+    CHECK(g_bootloader.pagesErased == 1);
+    CHECK(g_bootloader.massErases == 0);
+    CHECK(flashContains(image, offset));
+    CHECK(flashContains(std::string(offset, 0x5a)));
+
+    TestCaseEnd();
+}
+
+int ut_FlashReadProtected(void)
+{
+    TestCaseBegin();
+
+    const auto image = createImage(10 * PAGESIZE);
+
+    g_bootloader = BootloaderSimulation();
+    g_bootloader.readProtected = true;
+    g_simulatedTimeUs = 0;
+
+    CHECK(getController().flash(image, FLASHBASE));
+    CHECK(g_bootloader.state == BootloaderSimulation::State::RUNNING);
+    CHECK(g_bootloader.readProtected == false);
+    CHECK(g_bootloader.massErases == 1);
+    CHECK(g_bootloader.bytesWritten == image.length());
+    CHECK(flashContains(image));
+
+    TestCaseEnd();
+}
+
+int ut_FlashBaudRateFallback(void)
+{
+    TestCaseBegin();
+
+    const auto image = createImage(50 * PAGESIZE - 1000);
+    auto& can = getController();
+
+    printf("%s: flash time per baud rate, no sync above 115200 baud\n", __FUNCTION__);
+    for (const size_t maxReliableBaudRate : {115200, 57600}) {
+        g_bootloader = BootloaderSimulation();
+        g_bootloader.maxReliableBaudRate = maxReliableBaudRate;
+        g_simulatedTimeUs = 0;
+
+        CHECK(can.flashWithBaudRateFallback(image, FLASHBASE));
+        CHECK(g_baudRate == DEFAULT_BAUDRATE);
+        CHECK(g_bootloader.state == BootloaderSimulation::State::RUNNING);
+        CHECK(flashContains(image));
+
+        // The first rate always syncs, slower rates are only tried after corrupted data
+        CHECK(can.mFlashDurationsPerBaudRate[0] > 0);
+        CHECK((can.mFlashDurationsPerBaudRate[1] > 0) == (maxReliableBaudRate < 115200));
+        CHECK(can.mFlashDurationsPerBaudRate[2] == 0);
+        CHECK(can.mFlashDurationsPerBaudRate[3] == 0);
+
+        printf("    data corrupted above %6d baud:", (int)maxReliableBaudRate);
+        for (size_t i = 0; i < can.BOOTLOADER_BAUDRATES.size(); i++) {
+            printf(" %6d baud %5d ms |",
+                   (int)can.BOOTLOADER_BAUDRATES[i],
+                   (int)can.mFlashDurationsPerBaudRate[i]);
+        }
+        printf("\n");
+    }
+
+    g_bootloader = BootloaderSimulation();
+    g_bootloader.maxSyncBaudRate = 0;
+    g_simulatedTimeUs = 0;
+
+    CHECK(can.flashWithBaudRateFallback(image, FLASHBASE) == false);
+    CHECK(g_baudRate == DEFAULT_BAUDRATE);
+
+    TestCaseEnd();
+}
+
+int ut_ReceiveWithDiagnosticCallback(void)
+{
+    TestCaseBegin();
+
+    static const std::string frame = "t12320102\r";
+    auto& can = getController();
+    std::string diagnosticData;
+    can.registerDiagnosticCallback([&](const std::string_view data){
+        diagnosticData.append(data);
+    });
+
+    // The diagnostic callback sees what receive() takes out of the buffer
+    for (const char c : frame) {
+        app::CanController::CanControllerInterruptHandler(c);
+    }
+    std::array<uint8_t, 32> message;
+    CHECK(can.receive(message.data(), message.size(), 0) == frame.length());
+    CHECK(std::string(reinterpret_cast<char*>(message.data()), frame.length()) == frame);
+    CHECK(diagnosticData == frame);
+
+    // A receive callback takes all data
+    can.registerReceiveCallback([](const std::string_view data){});
+    CHECK(can.receive(message.data(), message.size(), 0) == 0);
+
+    can.unregisterReceiveCallback();
+    can.unregisterDiagnosticCallback();
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_FlashUnchangedImage);
+    RunTest(true, ut_FlashChangedPages);
+    RunTest(true, ut_FlashChangedPagesAtOffset);
+    RunTest(true, ut_FlashReadProtected);
+    RunTest(true, ut_FlashBaudRateFallback);
+    RunTest(true, ut_ReceiveWithDiagnosticCallback);
+    UnitTestMainEnd();
+}
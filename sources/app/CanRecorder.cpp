@@ -0,0 +1,408 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include "CanRecorder.h"
+#include "CanController.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstring>
+
+using app::CanController;
+using app::CanRecorder;
+
+static const int __attribute__((unused)) g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_INFO;
+
+static inline uint8_t hexToNibble(const char c)
+{
+    return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+CanRecorder::CanRecorder(CanController& can, const hal::Flash& flash) :
+    mTask("CanRecorder",
+          CanRecorder::STACKSIZE,
+          os::Task::Priority::LOW,
+          [this](const bool& join)
+{
+    taskFunction(join);
+}),
+    mCan(can),
+    mFlash(flash),
+    mJobs()
+{}
+
+void CanRecorder::suspend(void)
+{
+    stop();
+    mTask.join();
+}
+
+void CanRecorder::resume(void)
+{
+    mTask.start();
+}
+
+void CanRecorder::record(std::string_view slcan, const uint32_t timestamp)
+{
+    if (mState != State::RECORDING) {
+        mLineLength = 0;
+        return;
+    }
+
+    // Frames are split over several chunks of the receive buffer of the CanController
+    for (const char c : slcan) {
+        if ((c == '\r') || (c == '\a')) {
+            if (mLineLength <= mLine.size()) {
+                parseSlcanFrame(std::string_view(mLine.data(), mLineLength), timestamp);
+            }
+            mLineLength = 0;
+        } else {
+            if (mLineLength < mLine.size()) {
+                mLine[mLineLength] = c;
+            }
+            mLineLength++;
+        }
+    }
+}
+
+void CanRecorder::parseSlcanFrame(std::string_view line, const uint32_t timestamp)
+{
+    std::array<uint8_t, MAXRECORDSIZE> record;
+    size_t idDigits;
+    uint8_t flags = RECORD_MARKER;
+
+    if (line.empty()) {
+        return;
+    }
+    switch (line[0]) {
+    case 'r':
+        flags |= RECORD_RTR;
+    // fall through
+    case 't':
+        idDigits = 3;
+        break;
+
+    case 'R':
+        flags |= RECORD_RTR;
+    // fall through
+    case 'T':
+        flags |= RECORD_EXTENDED;
+        idDigits = 8;
+        break;
+
+    default:
+        return;
+    }
+
+    if (line.length() < idDigits + 2) {
+        return;
+    }
+
+    uint32_t id = 0;
+    for (size_t i = 1; i <= idDigits; i++) {
+        id = (id << 4) | hexToNibble(line[i]);
+    }
+
+    const uint8_t dlc = hexToNibble(line[idDigits + 1]);
+    const size_t dataLength = (flags & RECORD_RTR) ? 0 : dlc;
+    if ((dlc > 8) || (line.length() < idDigits + 2 + dataLength * 2)) {
+        return;
+    }
+
+    const uint32_t delta = std::min<uint32_t>(timestamp - mLastTimestamp, 0xffff);
+    mLastTimestamp = timestamp;
+
+    size_t length = 0;
+    record[length++] = flags | dlc;
+    record[length++] = delta & 0xff;
+    record[length++] = delta >> 8;
+    for (size_t i = 0; i < ((flags & RECORD_EXTENDED) ? 4 : 2); i++) {
+        record[length++] = (id >> (i * 8)) & 0xff;
+    }
+    for (size_t i = 0; i < dataLength; i++) {
+        record[length++] = hexToNibble(line[idDigits + 2 + i * 2]) << 4 | hexToNibble(line[idDigits + 3 + i * 2]);
+    }
+    if (length & 1) {
+        record[length++] = 0xff;
+    }
+
+    append(record.data(), length);
+}
+
+void CanRecorder::append(uint8_t const* record, const size_t length)
+{
+    Request request {Job::FLUSH, 0, 0};
+    bool isFlushRequired = false;
+
+    // The recorder task takes the active buffer when the recording is stopped
+    os::ThisTask::enterCriticalSection();
+
+    if (mState == State::RECORDING) {
+        if (mFill + length > BUFFERSIZE) {
+            const size_t other = mActiveBuffer ^ 1;
+
+            if (mIsBufferPending[other]) {
+                mDroppedFrames++;
+                os::ThisTask::exitCriticalSection();
+                return;
+            }
+
+            request.buffer = static_cast<uint8_t>(mActiveBuffer);
+            request.length = static_cast<uint16_t>(mFill);
+            mIsBufferPending[mActiveBuffer] = true;
+            isFlushRequired = true;
+            mActiveBuffer = other;
+            mFill = 0;
+        }
+
+        std::memcpy(mBuffers[mActiveBuffer].data() + mFill, record, length);
+        mFill += length;
+        mFrames++;
+    }
+
+    os::ThisTask::exitCriticalSection();
+
+    // The CanTask has a higher priority than the tasks which stop a recording,
+    // so the flush is still queued in front of the STOP.
+    if (isFlushRequired) {
+        mJobs.sendBack(request, 0U);
+    }
+}
+
+bool CanRecorder::start(void)
+{
+    if ((mState == State::ERASING) || (mState == State::RECORDING) || (mState == State::REPLAYING)) {
+        Trace(ZONE_WARNING, "Recorder is busy\r\n");
+        return false;
+    }
+
+    Request request {Job::START, 0, 0};
+    mState = State::ERASING;
+    return mJobs.sendBack(request, 0U);
+}
+
+void CanRecorder::stop(void)
+{
+    if (mState == State::REPLAYING) {
+        mState = State::IDLE;
+    } else if ((mState == State::ERASING) || (mState == State::RECORDING)) {
+        Request request {Job::STOP, 0, 0};
+        mJobs.sendBack(request);
+    }
+}
+
+bool CanRecorder::replay(void)
+{
+    if (mState != State::IDLE && mState != State::FULL) {
+        Trace(ZONE_WARNING, "Recorder is busy\r\n");
+        return false;
+    }
+
+    Request request {Job::REPLAY, 0, 0};
+    mState = State::REPLAYING;
+    return mJobs.sendBack(request, 0U);
+}
+
+bool CanRecorder::isRecording(void) const
+{
+    return mState == State::RECORDING;
+}
+
+CanRecorder::Status CanRecorder::getStatus(void) const
+{
+    return Status {mState, mFrames, mDroppedFrames, static_cast<uint32_t>(mWriteOffset),
+                   static_cast<uint32_t>(mFlash.getSize())};
+}
+
+void CanRecorder::taskFunction(const bool& join)
+{
+    do {
+        Request request;
+        if (mJobs.receive(request, 100U)) {
+            handleJob(request, join);
+        }
+    } while (!join);
+}
+
+void CanRecorder::handleJob(const Request& request, const bool& join)
+{
+    switch (request.job) {
+    case Job::START:
+        erase();
+        break;
+
+    case Job::FLUSH:
+        write(request.buffer, request.length);
+        break;
+
+    case Job::STOP:
+        finish();
+        break;
+
+    case Job::REPLAY:
+        replayRecording(join);
+        break;
+    }
+}
+
+void CanRecorder::erase(void)
+{
+    const uint32_t startTick = os::Task::getTickCount();
+    std::array<uint8_t, 64> chunk;
+    size_t erasedPages = 0;
+
+    for (size_t page = 0; (page < mFlash.getSize()) && (mState == State::ERASING); page += hal::Flash::PAGESIZE) {
+        // Pages which are still blank from the last erase are skipped to save time and wear
+        bool isBlank = true;
+        for (size_t offset = 0; (offset < hal::Flash::PAGESIZE) && isBlank; offset += chunk.size()) {
+            mFlash.read(page + offset, chunk.data(), chunk.size());
+            isBlank = std::all_of(chunk.begin(), chunk.end(), [](const uint8_t b){
+                return b == 0xff;
+            });
+        }
+
+        if (!isBlank) {
+            if (!mFlash.erasePage(page)) {
+                mState = State::IDLE;
+                return;
+            }
+            erasedPages++;
+            // Lets the other tasks catch up with the time the CPU was stalled
+            os::ThisTask::sleep(std::chrono::milliseconds(1));
+        }
+    }
+
+    Trace(ZONE_INFO, "Erased %u pages in %u ms\r\n", static_cast<unsigned int>(erasedPages),
+          static_cast<unsigned int>(os::Task::getTickCount() - startTick));
+
+    os::ThisTask::enterCriticalSection();
+    mIsBufferPending[0] = false;
+    mIsBufferPending[1] = false;
+    mActiveBuffer = 0;
+    mFill = 0;
+    mWriteOffset = 0;
+    mFrames = 0;
+    mDroppedFrames = 0;
+    mLastTimestamp = os::Task::getTickCount();
+    if (mState == State::ERASING) {
+        mState = State::RECORDING;
+    }
+    os::ThisTask::exitCriticalSection();
+}
+
+void CanRecorder::write(const size_t buffer, const size_t length)
+{
+    // A record may be cut at the end of the region, replay ignores it
+    const size_t fitting = std::min(length, mFlash.getSize() - mWriteOffset);
+
+    if (fitting && !mFlash.program(mWriteOffset, reinterpret_cast<uint16_t const*>(mBuffers[buffer].data()),
+                                   fitting / sizeof(uint16_t)))
+    {
+        mState = State::IDLE;
+    }
+    mWriteOffset += fitting;
+    mIsBufferPending[buffer] = false;
+
+    if (fitting < length) {
+        Trace(ZONE_INFO, "Recorder full after %u frames\r\n", static_cast<unsigned int>(mFrames));
+        mState = State::FULL;
+    }
+}
+
+void CanRecorder::finish(void)
+{
+    os::ThisTask::enterCriticalSection();
+    const bool wasRecording = mState == State::RECORDING;
+    const size_t buffer = mActiveBuffer;
+    const size_t length = mFill;
+    if ((mState == State::ERASING) || (mState == State::RECORDING)) {
+        mState = State::IDLE;
+    }
+    mFill = 0;
+    os::ThisTask::exitCriticalSection();
+
+    // Flushes of the other buffer were queued earlier and are already done
+    if (wasRecording && length) {
+        write(buffer, length);
+    }
+    Trace(ZONE_INFO, "Recorded %u frames, %u byte, %u dropped\r\n", static_cast<unsigned int>(mFrames),
+          static_cast<unsigned int>(mWriteOffset), static_cast<unsigned int>(mDroppedFrames));
+}
+
+size_t CanRecorder::formatSlcanFrame(uint8_t const* record, char* line) const
+{
+    static constexpr char hex[] = "0123456789ABCDEF";
+    const uint8_t flags = record[0];
+    const bool isExtended = flags & RECORD_EXTENDED;
+    const bool isRemote = flags & RECORD_RTR;
+    const size_t idLength = isExtended ? 4 : 2;
+    const uint8_t dlc = flags & RECORD_DLC_MASK;
+
+    uint32_t id = 0;
+    for (size_t i = 0; i < idLength; i++) {
+        id |= record[3 + i] << (i * 8);
+    }
+
+    char* it = line;
+    *it++ = isExtended ? (isRemote ? 'R' : 'T') : (isRemote ? 'r' : 't');
+    for (int shift = isExtended ? 28 : 8; shift >= 0; shift -= 4) {
+        *it++ = hex[(id >> shift) & 0xf];
+    }
+    *it++ = hex[dlc];
+    for (size_t i = 0; !isRemote && (i < dlc); i++) {
+        const uint8_t byte = record[3 + idLength + i];
+        *it++ = hex[byte >> 4];
+        *it++ = hex[byte & 0xf];
+    }
+    *it++ = '\r';
+    return it - line;
+}
+
+void CanRecorder::replayRecording(const bool& join)
+{
+    std::array<uint8_t, MAXRECORDSIZE> record;
+    std::array<char, 1 + 8 + 1 + 8 * 2 + 1> line;
+    size_t offset = 0;
+    size_t frames = 0;
+
+    const uint32_t startTick = os::Task::getTickCount();
+    uint32_t wakeTick = startTick;
+    uint32_t deadline = startTick;
+
+    // The recording is replayed from flash, so it survives a reset
+    while ((mState == State::REPLAYING) && !join && (offset + 4 <= mFlash.getSize())) {
+        mFlash.read(offset, record.data(), 4);
+
+        const uint8_t flags = record[0];
+        if ((flags & RECORD_MARKER_MASK) != RECORD_MARKER) {
+            break;
+        }
+        const size_t dataLength = (flags & RECORD_RTR) ? 0 : (flags & RECORD_DLC_MASK);
+        size_t length = 3 + ((flags & RECORD_EXTENDED) ? 4 : 2) + dataLength;
+        length += length & 1;
+        if ((dataLength > 8) || (offset + length > mFlash.getSize())) {
+            break;
+        }
+        mFlash.read(offset + 4, record.data() + 4, length - 4);
+        offset += length;
+
+        // Frames are played against absolute deadlines, so the time spent in
+        // mCan.send doesn't add up.
+        deadline += record[1] | record[2] << 8;
+        if (deadline != wakeTick) {
+            os::ThisTask::sleepUntil(wakeTick, std::chrono::milliseconds(deadline - wakeTick));
+        }
+
+        const size_t lineLength = formatSlcanFrame(record.data(), line.data());
+        mCan.send(std::string_view(line.data(), lineLength), REPLAY_SEND_TIMEOUT);
+        frames++;
+    }
+
+    Trace(ZONE_INFO, "Replayed %u frames in %u ms\r\n", static_cast<unsigned int>(frames),
+          static_cast<unsigned int>(os::Task::getTickCount() - startTick));
+
+    if (mState == State::REPLAYING) {
+        mState = State::IDLE;
+    }
+}
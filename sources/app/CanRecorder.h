@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#pragma once
+
+#include <array>
+#include <string_view>
+#include "TaskInterruptable.h"
+#include "os_Queue.h"
+#include "Flash.h"
+
+#ifdef UNITTEST
+int ut_RecordAndReplay(void);
+int ut_RecordUntilFull(void);
+int ut_RecordThroughput(void);
+#endif
+
+namespace app
+{
+class CanController;
+
+/**
+ * Records the frames received from the CAN coprocessor into a flash region and
+ * replays them with their original timing.
+ *
+ * The receive path only appends records to one of two RAM buffers. A full
+ * buffer is handed to the recorder task, which programs it while the other one
+ * fills up. Frames which arrive while both buffers are full are dropped and
+ * counted. A page erase stalls the CPU, including the USART receive interrupt,
+ * for up to 40 ms. So the whole region is erased before the recording starts
+ * and never while it runs. The recording stops when the region is full.
+ *
+ * Records are aligned to half words:
+ *  flags (1 byte)      0b01 | RTR | extended ID | DLC (4 bit)
+ *  time (2 byte)       ms since the previous frame, saturated
+ *  ID (2 or 4 byte)
+ *  data (DLC byte)     none for remote frames
+ *  padding to an even length
+ * Multi byte fields are little endian. Erased flash ends the recording.
+ */
+class CanRecorder final
+{
+    static constexpr size_t STACKSIZE = 512;
+    static constexpr size_t BUFFERSIZE = 256;
+    static constexpr size_t MAXRECORDSIZE = 1 + 2 + 4 + 8 + 1;
+
+    static constexpr uint8_t RECORD_MARKER = 0x40;
+    static constexpr uint8_t RECORD_MARKER_MASK = 0xc0;
+    static constexpr uint8_t RECORD_RTR = 0x20;
+    static constexpr uint8_t RECORD_EXTENDED = 0x10;
+    static constexpr uint8_t RECORD_DLC_MASK = 0x0f;
+
+    static constexpr uint32_t EXTENDED_ID_FLAG = 0x80000000;
+    static constexpr uint32_t REPLAY_SEND_TIMEOUT = 100;
+
+public:
+    enum class State : uint8_t {
+        IDLE,
+        ERASING,
+        RECORDING,
+        FULL,
+        REPLAYING
+    };
+
+    struct Status {
+        State state;
+        uint32_t frames;
+        uint32_t droppedFrames;
+        uint32_t bytes;
+        uint32_t capacity;
+    };
+
+private:
+    enum class Job : uint8_t {
+        START,
+        FLUSH,
+        STOP,
+        REPLAY
+    };
+
+    struct Request {
+        Job job;
+        uint8_t buffer;
+        uint16_t length;
+    };
+
+    os::TaskInterruptable mTask;
+    CanController& mCan;
+    const hal::Flash& mFlash;
+    os::Queue<Request, 4> mJobs;
+
+    std::array<std::array<uint8_t, BUFFERSIZE>, 2> mBuffers;
+    std::array<volatile bool, 2> mIsBufferPending {{false, false}};
+    size_t mActiveBuffer = 0;
+    size_t mFill = 0;
+
+    volatile State mState = State::IDLE;
+    uint32_t mLastTimestamp = 0;
+    size_t mWriteOffset = 0;
+    uint32_t mFrames = 0;
+    uint32_t mDroppedFrames = 0;
+
+    // SLCAN text of the frame which is currently received from the coprocessor
+    std::array<char, 32> mLine;
+    size_t mLineLength = 0;
+
+    void taskFunction(const bool&);
+    void handleJob(const Request& request, const bool& join);
+    void parseSlcanFrame(std::string_view line, const uint32_t timestamp);
+    void append(uint8_t const* record, const size_t length);
+    void erase(void);
+    void write(const size_t buffer, const size_t length);
+    void finish(void);
+    void replayRecording(const bool& join);
+    size_t formatSlcanFrame(uint8_t const* record, char* line) const;
+
+public:
+    CanRecorder(CanController& can, const hal::Flash& flash);
+
+    CanRecorder(const CanRecorder&) = delete;
+    CanRecorder(CanRecorder&&) = delete;
+    CanRecorder& operator=(const CanRecorder&) = delete;
+    CanRecorder& operator=(CanRecorder&&) = delete;
+
+    // Receive path, called by the CanTask with every chunk of SLCAN data
+    void record(std::string_view slcan, const uint32_t timestamp);
+
+    bool start(void);
+    void stop(void);
+    bool replay(void);
+    bool isRecording(void) const;
+    Status getStatus(void) const;
+
+    void suspend(void);
+    void resume(void);
+
+#ifdef UNITTEST
+    friend int ::ut_RecordAndReplay(void);
+    friend int ::ut_RecordUntilFull(void);
+    friend int ::ut_RecordThroughput(void);
+#endif
+};
+}
@@ -0,0 +1,473 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+#include "unittest.h"
+#include "CanController.h"
+#include "CanRecorder.h"
+
+//--------------------------BUFFERS--------------------------
+static constexpr size_t PAGE_ERASE_TIME_US = 20000;
+static constexpr size_t HALFWORD_PROGRAM_TIME_US = 52;
+static constexpr size_t FLASH_ENDURANCE = 10000;
+
+static constexpr size_t UART_BAUDRATE = 115200;
+static constexpr size_t BITS_PER_CHAR = 10;
+
+uint64_t g_simulatedTimeUs;
+
+// The flash region is backed by a temporary file
+FILE* g_flashFile;
+uint64_t g_flashBusyUs;
+size_t g_pageErases;
+size_t g_bytesProgrammed;
+size_t g_programErrors;
+
+size_t g_queueItemSize;
+std::deque<std::pair<uint64_t, std::vector<uint8_t> > > g_queue;
+
+std::vector<std::pair<uint32_t, std::string> > g_sentFrames;
+
+//--------------------------MOCKING--------------------------
+constexpr const std::array<const hal::Gpio, hal::Gpio::__ENUM__SIZE + 1> hal::Factory<hal::Gpio>::Container;
+constexpr const std::array<const hal::Usart, hal::Usart::__ENUM__SIZE + 1> hal::Factory<hal::Usart>::Container;
+constexpr const std::array<const hal::Dma, hal::Dma::__ENUM__SIZE + 1> hal::Factory<hal::Dma>::Container;
+constexpr const std::array<const hal::UsartWithDma,
+                           hal::Usart::__ENUM__SIZE> hal::Factory<hal::UsartWithDma>::Container;
+constexpr const std::array<const hal::Flash, hal::Flash::__ENUM__SIZE> hal::Factory<hal::Flash>::Container;
+
+void os::TaskInterruptable::join(void) {}
+
+void os::TaskInterruptable::start(void) {}
+
+os::TaskInterruptable::TaskInterruptable(char const* name, unsigned short stack, os::Task::Priority prio,
+                                         std::function<void(bool const&)> func) :
+    Task(name, stack, prio, func) {}
+
+os::TaskInterruptable::~TaskInterruptable(void) {}
+
+void os::TaskInterruptable::taskFunction(void) {}
+
+os::Task::Task(char const* name, unsigned short stack, os::Task::Priority prio,
+               std::function<void(bool const&)> func) {}
+
+os::Task::~Task(void) {}
+
+void os::Task::taskFunction(void) {}
+
+void os::ThisTask::sleep(const std::chrono::milliseconds ms)
+{
+    g_simulatedTimeUs += ms.count() * 1000;
+}
+
+void os::ThisTask::sleepUntil(uint32_t& previousWakeTick, const std::chrono::milliseconds increment)
+{
+    previousWakeTick += increment.count();
+    g_simulatedTimeUs = std::max<uint64_t>(g_simulatedTimeUs, previousWakeTick * 1000ULL);
+}
+
+uint32_t os::Task::getTickCount(void)
+{
+    return g_simulatedTimeUs / 1000;
+}
+
+void os::ThisTask::enterCriticalSection(void) {}
+
+void os::ThisTask::exitCriticalSection(void) {}
+
+QueueHandle_t xQueueGenericCreate(const UBaseType_t uxQueueLength,
+                                  const UBaseType_t uxItemSize,
+                                  const uint8_t     ucQueueType)
+{
+    g_queueItemSize = uxItemSize;
+    return reinterpret_cast<QueueHandle_t>(1);
+}
+
+void vQueueDelete(QueueHandle_t xQueue) {}
+
+BaseType_t xQueueGenericSend(QueueHandle_t xQueue, const void* const pvItemToQueue, TickType_t xTicksToWait,
+                             const BaseType_t xCopyPosition)
+{
+    auto item = static_cast<const uint8_t*>(pvItemToQueue);
+    g_queue.emplace_back(g_simulatedTimeUs, std::vector<uint8_t>(item, item + g_queueItemSize));
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void* const pvBuffer, TickType_t xTicksToWait)
+{
+    if (g_queue.empty()) {
+        return pdFALSE;
+    }
+    std::memcpy(pvBuffer, g_queue.front().second.data(), g_queueItemSize);
+    g_queue.pop_front();
+    return pdTRUE;
+}
+
+bool hal::Flash::erasePage(const size_t offset) const
+{
+    const std::vector<uint8_t> erased(PAGESIZE, 0xff);
+    std::fseek(g_flashFile, offset, SEEK_SET);
+    std::fwrite(erased.data(), 1, erased.size(), g_flashFile);
+    g_flashBusyUs += PAGE_ERASE_TIME_US;
+    g_pageErases++;
+    return true;
+}
+
+bool hal::Flash::program(const size_t offset, uint16_t const* const data, const size_t numberOfHalfWords) const
+{
+    for (size_t i = 0; i < numberOfHalfWords; i++) {
+        uint16_t current;
+        std::fseek(g_flashFile, offset + i * sizeof(uint16_t), SEEK_SET);
+        std::fread(&current, sizeof(current), 1, g_flashFile);
+        if (current != 0xffff) {
+            // PGERR, the half word wasn't erased
+            g_programErrors++;
+            return false;
+        }
+        std::fseek(g_flashFile, offset + i * sizeof(uint16_t), SEEK_SET);
+        std::fwrite(&data[i], sizeof(data[i]), 1, g_flashFile);
+        g_flashBusyUs += HALFWORD_PROGRAM_TIME_US;
+        g_bytesProgrammed += sizeof(uint16_t);
+    }
+    return true;
+}
+
+void hal::Flash::read(const size_t offset, uint8_t* const data, const size_t length) const
+{
+    std::fseek(g_flashFile, offset, SEEK_SET);
+    std::fread(data, 1, length, g_flashFile);
+}
+
+size_t hal::Flash::getSize(void) const
+{
+    return mSize;
+}
+
+app::CanController::CanController(const hal::UsartWithDma& interface,
+                                  const hal::Gpio&         supplyPin,
+                                  const hal::Gpio&         usartTxPin) :
+    os::DeepSleepModule(),
+    mTask("", 0, os::Task::Priority::LOW, [](const bool&){}),
+    mInterface(interface),
+    mCanSupplyVoltage(supplyPin),
+    mUsartTxPin(usartTxPin)
+{}
+
+void app::CanController::enterDeepSleep(void) {}
+
+void app::CanController::exitDeepSleep(void) {}
+
+size_t app::CanController::send(std::string_view data, const uint32_t ticksToWait)
+{
+    g_sentFrames.emplace_back(os::Task::getTickCount(), std::string(data));
+    return data.length();
+}
+
+//--------------------------HELPERS--------------------------
+static app::CanController& canController(void)
+{
+    static app::CanController can(hal::Factory<hal::UsartWithDma>::get<hal::Usart::MODEM_COM>(),
+                                  hal::Factory<hal::Gpio>::get<hal::Gpio::SECCO_PWR>(),
+                                  hal::Factory<hal::Gpio>::get<hal::Gpio::SECCO_PWR>());
+    return can;
+}
+
+static const hal::Flash& flash(void)
+{
+    return hal::Factory<hal::Flash>::get<hal::Flash::CAN_RECORDER>();
+}
+
+static void resetFlash(void)
+{
+    if (g_flashFile) {
+        std::fclose(g_flashFile);
+    }
+    g_flashFile = std::tmpfile();
+
+    // A fresh region contains garbage, which has to be erased first
+    const std::vector<uint8_t> garbage(flash().getSize(), 0x5a);
+    std::fwrite(garbage.data(), 1, garbage.size(), g_flashFile);
+
+    g_flashBusyUs = 0;
+    g_pageErases = 0;
+    g_bytesProgrammed = 0;
+    g_programErrors = 0;
+    g_queue.clear();
+    g_sentFrames.clear();
+}
+
+// Replay sends upper case hex digits
+static std::string toUpperHex(std::string s)
+{
+    std::transform(s.begin() + 1, s.end(), s.begin() + 1, ::toupper);
+    return s;
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_RecordAndReplay(void)
+{
+    TestCaseBegin();
+
+    resetFlash();
+    app::CanRecorder recorder(canController(), flash());
+    const bool join = false;
+
+    auto runJobs = [&](app::CanRecorder& r) {
+                       while (!g_queue.empty()) {
+                           app::CanRecorder::Request request;
+                           std::memcpy(&request, g_queue.front().second.data(), sizeof(request));
+                           g_queue.pop_front();
+                           r.handleJob(request, join);
+                       }
+                   };
+
+    CHECK(recorder.start());
+    CHECK(!recorder.start());
+    runJobs(recorder);
+    CHECK(recorder.isRecording());
+    CHECK(g_pageErases == flash().getSize() / hal::Flash::PAGESIZE);
+
+    const std::vector<std::pair<uint32_t, std::string> > frames = {
+        {3, "t24180102030405060708\r"},
+        {8, "T1ABCDEF03AABBCC\r"},
+        {8, "r7DF0\r"},
+        {20, "R1234567F2\r"},
+        {1020, "t1230\r"},
+        {1021, "t7e880362010200000000\r"},
+        {1500, "t641101\r"}
+    };
+
+    // frames are split over chunks and mixed with other answers of the coprocessor
+    const uint32_t startTick = os::Task::getTickCount();
+    for (const auto& frame : frames) {
+        g_simulatedTimeUs = (startTick + frame.first) * 1000ULL;
+        const std::string data = "\a" + frame.second + "z\r";
+        for (size_t i = 0; i < data.length(); i += 5) {
+            recorder.record(std::string_view(data).substr(i, 5), os::Task::getTickCount());
+        }
+    }
+
+    recorder.stop();
+    runJobs(recorder);
+    CHECK(!recorder.isRecording());
+    CHECK(g_programErrors == 0);
+
+    const auto status = recorder.getStatus();
+    CHECK(status.state == app::CanRecorder::State::IDLE);
+    CHECK(status.frames == frames.size());
+    CHECK(status.droppedFrames == 0);
+    CHECK(status.bytes == 14 + 10 + 6 + 8 + 6 + 14 + 6);
+
+    // nothing is recorded after the stop
+    recorder.record("t24180102030405060708\r", os::Task::getTickCount());
+    CHECK(recorder.getStatus().frames == frames.size());
+
+    CHECK(recorder.replay());
+    CHECK(!recorder.start());
+    const uint32_t replayTick = os::Task::getTickCount();
+    runJobs(recorder);
+    CHECK(recorder.getStatus().state == app::CanRecorder::State::IDLE);
+
+    CHECK(g_sentFrames.size() == frames.size());
+    for (size_t i = 0; i < std::min(frames.size(), g_sentFrames.size()); i++) {
+        CHECK(g_sentFrames[i].second == toUpperHex(frames[i].second));
+        CHECK(g_sentFrames[i].first - replayTick == frames[i].first);
+    }
+
+    // The recording survives a reset
+    app::CanRecorder restarted(canController(), flash());
+    g_sentFrames.clear();
+    CHECK(restarted.replay());
+    runJobs(restarted);
+    CHECK(g_sentFrames.size() == frames.size());
+
+    // Only the page that was written is erased again
+    const size_t erases = g_pageErases;
+    CHECK(recorder.start());
+    runJobs(recorder);
+    CHECK(g_pageErases == erases + 1);
+    recorder.stop();
+    runJobs(recorder);
+
+    TestCaseEnd();
+}
+
+int ut_RecordUntilFull(void)
+{
+    TestCaseBegin();
+
+    resetFlash();
+    app::CanRecorder recorder(canController(), flash());
+    const bool join = false;
+
+    auto runJobs = [&](app::CanRecorder& r) {
+                       while (!g_queue.empty()) {
+                           app::CanRecorder::Request request;
+                           std::memcpy(&request, g_queue.front().second.data(), sizeof(request));
+                           g_queue.pop_front();
+                           r.handleJob(request, join);
+                       }
+                   };
+
+    CHECK(recorder.start());
+    runJobs(recorder);
+
+    const size_t capacity = flash().getSize();
+    const size_t recordSize = 14;
+    const size_t fittingFrames = capacity / recordSize;
+
+    for (size_t i = 0; (i < 2 * fittingFrames) && recorder.isRecording(); i++) {
+        g_simulatedTimeUs += 1000;
+        recorder.record("t24180102030405060708\r", os::Task::getTickCount());
+        runJobs(recorder);
+    }
+
+    const auto status = recorder.getStatus();
+    CHECK(status.state == app::CanRecorder::State::FULL);
+    CHECK(status.bytes == capacity);
+    CHECK(status.droppedFrames == 0);
+    CHECK(g_programErrors == 0);
+
+    // stop has nothing to do after the recording stopped itself
+    recorder.stop();
+    CHECK(g_queue.empty());
+
+    // the record which was cut at the end of the region is skipped
+    CHECK(recorder.replay());
+    runJobs(recorder);
+    CHECK(g_sentFrames.size() == fittingFrames);
+
+    const size_t erases = g_pageErases;
+    CHECK(recorder.start());
+    runJobs(recorder);
+    CHECK(g_pageErases == erases + capacity / hal::Flash::PAGESIZE);
+    recorder.stop();
+    runJobs(recorder);
+
+    TestCaseEnd();
+}
+
+int ut_RecordThroughput(void)
+{
+    TestCaseBegin();
+
+    static constexpr size_t NUMBER_OF_FRAMES = 3000;
+    const std::string frame = "t24180102030405060708\r";
+    const size_t recordSize = 14;
+
+    resetFlash();
+    app::CanRecorder recorder(canController(), flash());
+    const bool join = false;
+    uint64_t writerFreeUs = 0;
+
+    // The recorder task programs the queued buffers one after another. A buffer
+    // is free again when the flash finished programming it.
+    auto runWriterUntil = [&](const uint64_t nowUs) {
+                              while (!g_queue.empty()) {
+                                  app::CanRecorder::Request request;
+                                  std::memcpy(&request, g_queue.front().second.data(), sizeof(request));
+                                  const uint64_t startUs = std::max(g_queue.front().first, writerFreeUs);
+                                  const uint64_t durationUs = request.job == app::CanRecorder::Job::FLUSH ?
+                                                              request.length / 2 * HALFWORD_PROGRAM_TIME_US : 0;
+                                  if (startUs + durationUs > nowUs) {
+                                      return;
+                                  }
+                                  g_queue.pop_front();
+                                  recorder.handleJob(request, join);
+                                  writerFreeUs = startUs + durationUs;
+                              }
+                          };
+
+    printf("%s: %d byte records, %d byte RAM buffers, %d us per programmed half word\n", __FUNCTION__,
+           static_cast<int>(recordSize), static_cast<int>(app::CanRecorder::BUFFERSIZE),
+           static_cast<int>(HALFWORD_PROGRAM_TIME_US));
+
+    size_t maxFramesPerSecond = 0;
+    for (const size_t framesPerSecond : {500, 1000, 2000, 2500, 2700, 2800, 3000, 4000}) {
+        recorder.stop();
+        runWriterUntil(UINT64_MAX);
+        CHECK(recorder.start());
+        runWriterUntil(UINT64_MAX);
+        CHECK(recorder.isRecording());
+
+        const uint64_t startUs = g_simulatedTimeUs;
+        const uint64_t programmedBefore = g_bytesProgrammed;
+        const uint64_t busyBefore = g_flashBusyUs;
+        writerFreeUs = startUs;
+
+        for (size_t i = 0; i < NUMBER_OF_FRAMES; i++) {
+            g_simulatedTimeUs = startUs + i * 1000000ULL / framesPerSecond;
+            runWriterUntil(g_simulatedTimeUs);
+            recorder.record(frame, os::Task::getTickCount());
+        }
+
+        const auto status = recorder.getStatus();
+        if (status.droppedFrames == 0) {
+            maxFramesPerSecond = framesPerSecond;
+        }
+        runWriterUntil(UINT64_MAX);
+
+        printf("    %4d frames/s: %4d dropped, flash busy %3d%%, %d byte/s programmed\n",
+               static_cast<int>(framesPerSecond), static_cast<int>(status.droppedFrames),
+               static_cast<int>((g_flashBusyUs - busyBefore) * 100 / (g_simulatedTimeUs - startUs)),
+               static_cast<int>((g_bytesProgrammed - programmedBefore) * 1000000 /
+                                (g_flashBusyUs - busyBefore)));
+        CHECK(g_programErrors == 0);
+    }
+
+    // The SLCAN link to the coprocessor limits the frame rate long before the recorder does
+    const size_t uartFramesPerSecond = UART_BAUDRATE / BITS_PER_CHAR / frame.length();
+    CHECK(maxFramesPerSecond >= 2000);
+    CHECK(maxFramesPerSecond > uartFramesPerSecond);
+
+    const size_t capacity = flash().getSize();
+    printf("    no drops up to %d frames/s, the SLCAN link at %d baud delivers at most %d frames/s\n",
+           static_cast<int>(maxFramesPerSecond), static_cast<int>(UART_BAUDRATE),
+           static_cast<int>(uartFramesPerSecond));
+
+    for (const size_t framesPerSecond : {50, 200, static_cast<int>(uartFramesPerSecond)}) {
+        const size_t bytesPerHour = framesPerSecond * recordSize * 3600;
+        const double erasesPerHour = static_cast<double>(bytesPerHour) / capacity;
+        printf("    %3d frames/s: %d kB/h, region full after %d s, %.1f erase cycles/h when recording"
+               " continuously, endurance of %d cycles reached after %d h\n",
+               static_cast<int>(framesPerSecond), static_cast<int>(bytesPerHour / 1024),
+               static_cast<int>(capacity / (framesPerSecond * recordSize)), erasesPerHour,
+               static_cast<int>(FLASH_ENDURANCE), static_cast<int>(FLASH_ENDURANCE / erasesPerHour));
+    }
+
+    // cost of the receive path on the host
+    recorder.stop();
+    runWriterUntil(UINT64_MAX);
+    CHECK(recorder.start());
+    runWriterUntil(UINT64_MAX);
+    const size_t fittingFrames = capacity / recordSize;
+    std::chrono::nanoseconds recordTime(0);
+    for (size_t i = 0; i < fittingFrames; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        recorder.record(frame, i);
+        recordTime += std::chrono::steady_clock::now() - start;
+        runWriterUntil(UINT64_MAX);
+    }
+    printf("    receive path %d ns/frame (host)\n",
+           static_cast<int>(recordTime.count() / fittingFrames));
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_RecordAndReplay);
+    RunTest(true, ut_RecordUntilFull);
+    RunTest(true, ut_RecordThroughput);
+    UnitTestMainEnd();
+}
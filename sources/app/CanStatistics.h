@@ -0,0 +1,219 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <limits>
+#include <functional>
+#include <string_view>
+#include "log2.h"
+#include "os_Task.h"
+
+namespace app
+{
+/**
+ * Traffic statistics per CAN ID in a fixed size hash table with linear probing.
+ * Lookups are bounded to MAXPROBES slots, so an update is O(1). Frames of IDs
+ * that find no free slot are only counted as dropped.
+ */
+template<size_t n>
+class CanStatistics
+{
+    static_assert((n & (n - 1)) == 0, "Size has to be a power of two");
+    // hash() shifts by 32 - log2(n), which is undefined for a shift by 32
+    static_assert(n > 1, "Size has to be at least two");
+
+public:
+    static constexpr uint32_t EXTENDED_ID_FLAG = 0x80000000;
+
+    struct __attribute__((packed)) Entry {
+        uint32_t id;
+        uint32_t count;
+        uint32_t bytes;
+        uint32_t lastTimestamp;
+        uint16_t minInterval;
+        uint16_t maxInterval;
+    };
+
+    struct __attribute__((packed)) Header {
+        uint16_t numberOfEntries;
+        uint16_t entrySize;
+        uint32_t droppedFrames;
+    };
+
+    void update(const uint32_t id, const uint8_t length, const uint32_t timestamp);
+    void parse(std::string_view slcan, const uint32_t timestamp);
+    void reset(void);
+
+    Entry const* find(const uint32_t id) const;
+    size_t getNumberOfIds(void) const;
+    uint32_t getNumberOfDroppedFrames(void) const;
+
+    void dump(const std::function<void(std::string_view)>& send) const;
+
+private:
+    static constexpr size_t MAXPROBES = 8;
+
+    std::array<Entry, n> mEntries {};
+    size_t mNumberOfIds = 0;
+    uint32_t mDroppedFrames = 0;
+
+    enum class ParserState { IDLE, ID, LENGTH, SKIP };
+    ParserState mParserState = ParserState::IDLE;
+    uint32_t mParsedId = 0;
+    size_t mMissingIdDigits = 0;
+
+    static inline size_t hash(const uint32_t id)
+    {
+        return (id * 2654435761u) >> (32 - constexpr_log2<n>());
+    }
+
+    static inline uint8_t hexToNibble(const char c)
+    {
+        return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+    }
+
+    Entry* lookup(const uint32_t id);
+};
+}
+
+template<size_t n>
+typename app::CanStatistics<n>::Entry * app::CanStatistics<n>::lookup(const uint32_t id)
+{
+    for (size_t probe = 0; probe < MAXPROBES; probe++) {
+        Entry& entry = mEntries[(hash(id) + probe) & (n - 1)];
+        if ((entry.count == 0) || (entry.id == id)) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+template<size_t n>
+void app::CanStatistics<n>::update(const uint32_t id, const uint8_t length, const uint32_t timestamp)
+{
+    Entry* const entry = lookup(id);
+
+    if (entry == nullptr) {
+        mDroppedFrames++;
+        return;
+    }
+
+    if (entry->count == 0) {
+        entry->id = id;
+        entry->minInterval = std::numeric_limits<uint16_t>::max();
+        entry->maxInterval = 0;
+        mNumberOfIds++;
+    } else {
+        const uint32_t interval = timestamp - entry->lastTimestamp;
+        const uint16_t saturated = interval > std::numeric_limits<uint16_t>::max() ?
+                                   std::numeric_limits<uint16_t>::max() : interval;
+        if (saturated < entry->minInterval) {
+            entry->minInterval = saturated;
+        }
+        if (saturated > entry->maxInterval) {
+            entry->maxInterval = saturated;
+        }
+    }
+
+    entry->count++;
+    entry->bytes += length;
+    entry->lastTimestamp = timestamp;
+}
+
+template<size_t n>
+void app::CanStatistics<n>::parse(std::string_view slcan, const uint32_t timestamp)
+{
+    // Only the header of "tiiil...", "Tiiiiiiiil...", "riiil" and "Riiiiiiiil" frames is
+    // decoded. The payload is skipped until the terminating '\r'.
+    for (const char c : slcan) {
+        switch (mParserState) {
+        case ParserState::IDLE:
+            if ((c == 't') || (c == 'r')) {
+                mParsedId = 0;
+                mMissingIdDigits = 3;
+                mParserState = ParserState::ID;
+            } else if ((c == 'T') || (c == 'R')) {
+                mParsedId = EXTENDED_ID_FLAG;
+                mMissingIdDigits = 8;
+                mParserState = ParserState::ID;
+            }
+            break;
+
+        case ParserState::ID:
+            mParsedId = (mParsedId & EXTENDED_ID_FLAG) | ((mParsedId << 4) & ~EXTENDED_ID_FLAG) | hexToNibble(c);
+            if (--mMissingIdDigits == 0) {
+                mParserState = ParserState::LENGTH;
+            }
+            break;
+
+        case ParserState::LENGTH:
+            update(mParsedId, hexToNibble(c), timestamp);
+            mParserState = ParserState::SKIP;
+            break;
+
+        case ParserState::SKIP:
+            break;
+        }
+
+        if ((c == '\r') || (c == '\a')) {
+            mParserState = ParserState::IDLE;
+        }
+    }
+}
+
+template<size_t n>
+void app::CanStatistics<n>::reset(void)
+{
+    mEntries.fill(Entry {});
+    mNumberOfIds = 0;
+    mDroppedFrames = 0;
+}
+
+template<size_t n>
+typename app::CanStatistics<n>::Entry const * app::CanStatistics<n>::find(const uint32_t id) const
+{
+    for (size_t probe = 0; probe < MAXPROBES; probe++) {
+        const Entry& entry = mEntries[(hash(id) + probe) & (n - 1)];
+        if (entry.count == 0) {
+            return nullptr;
+        }
+        if (entry.id == id) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+template<size_t n>
+size_t app::CanStatistics<n>::getNumberOfIds(void) const
+{
+    return mNumberOfIds;
+}
+
+template<size_t n>
+uint32_t app::CanStatistics<n>::getNumberOfDroppedFrames(void) const
+{
+    return mDroppedFrames;
+}
+
+template<size_t n>
+void app::CanStatistics<n>::dump(const std::function<void(std::string_view)>& send) const
+{
+    const Header header {static_cast<uint16_t>(mNumberOfIds), sizeof(Entry), mDroppedFrames};
+    send(std::string_view(reinterpret_cast<const char*>(&header), sizeof(header)));
+
+    for (const Entry& entry : mEntries) {
+        os::ThisTask::enterCriticalSection();
+        const Entry copy = entry;
+        os::ThisTask::exitCriticalSection();
+
+        if (copy.count != 0) {
+            send(std::string_view(reinterpret_cast<const char*>(&copy), sizeof(copy)));
+        }
+    }
+}
@@ -0,0 +1,205 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "unittest.h"
+#include "CanStatistics.h"
+
+//--------------------------MOCKING--------------------------
+void os::ThisTask::enterCriticalSection(void) {}
+
+void os::ThisTask::exitCriticalSection(void) {}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_Update(void)
+{
+    TestCaseBegin();
+
+    app::CanStatistics<64> stats;
+
+    stats.update(0x241, 8, 100);
+    stats.update(0x241, 8, 110);
+    stats.update(0x241, 2, 150);
+    stats.update(0x7e8, 3, 150);
+
+    CHECK(stats.getNumberOfIds() == 2);
+    CHECK(stats.getNumberOfDroppedFrames() == 0);
+
+    auto entry = stats.find(0x241);
+    CHECK(entry != nullptr);
+    CHECK(entry->count == 3);
+    CHECK(entry->bytes == 18);
+    CHECK(entry->lastTimestamp == 150);
+    CHECK(entry->minInterval == 10);
+    CHECK(entry->maxInterval == 40);
+
+    entry = stats.find(0x7e8);
+    CHECK(entry != nullptr);
+    CHECK(entry->count == 1);
+    CHECK(entry->minInterval == 0xffff);
+    CHECK(entry->maxInterval == 0);
+
+    CHECK(stats.find(0x123) == nullptr);
+
+    stats.reset();
+    CHECK(stats.getNumberOfIds() == 0);
+    CHECK(stats.find(0x241) == nullptr);
+
+    TestCaseEnd();
+}
+
+int ut_TableFull(void)
+{
+    TestCaseBegin();
+
+    app::CanStatistics<16> stats;
+
+    for (uint32_t id = 0; id < 100; id++) {
+        stats.update(id, 1, 0);
+    }
+
+    CHECK(stats.getNumberOfIds() <= 16);
+    CHECK(stats.getNumberOfIds() + stats.getNumberOfDroppedFrames() == 100);
+
+    size_t found = 0;
+    for (uint32_t id = 0; id < 100; id++) {
+        found += stats.find(id) != nullptr;
+    }
+    CHECK(found == stats.getNumberOfIds());
+
+    TestCaseEnd();
+}
+
+int ut_Parse(void)
+{
+    TestCaseBegin();
+
+    app::CanStatistics<64> stats;
+    const std::string slcan = "t24180102030405060708\rT1ABCDEF03AABBCC\r\rr7DF0\rt2412013E\r\a";
+
+    // feed the stream in chunks that split frames at every possible position
+    for (size_t chunk = 1; chunk <= slcan.length(); chunk++) {
+        stats.reset();
+        for (size_t i = 0; i < slcan.length(); i += chunk) {
+            stats.parse(std::string_view(slcan).substr(i, chunk), i);
+        }
+
+        CHECK(stats.getNumberOfIds() == 3);
+
+        auto entry = stats.find(0x241);
+        CHECK(entry != nullptr);
+        if (entry) {
+            CHECK(entry->count == 2);
+            CHECK(entry->bytes == 10);
+        }
+
+        entry = stats.find(app::CanStatistics<64>::EXTENDED_ID_FLAG | 0x1ABCDEF0);
+        CHECK(entry != nullptr);
+        if (entry) {
+            CHECK(entry->count == 1);
+            CHECK(entry->bytes == 3);
+        }
+
+        entry = stats.find(0x7df);
+        CHECK(entry != nullptr);
+        if (entry) {
+            CHECK(entry->bytes == 0);
+        }
+    }
+
+    TestCaseEnd();
+}
+
+int ut_Dump(void)
+{
+    TestCaseBegin();
+
+    using Stats = app::CanStatistics<64>;
+    Stats stats;
+    stats.update(0x241, 8, 100);
+    stats.update(0x7e8, 3, 200);
+
+    std::string dump;
+    stats.dump([&](std::string_view chunk){
+        dump.append(chunk.data(), chunk.length());
+    });
+
+    CHECK(dump.length() == sizeof(Stats::Header) + 2 * sizeof(Stats::Entry));
+
+    Stats::Header header;
+    std::memcpy(&header, dump.data(), sizeof(header));
+    CHECK(header.numberOfEntries == 2);
+    CHECK(header.entrySize == sizeof(Stats::Entry));
+    CHECK(header.droppedFrames == 0);
+
+    uint32_t bytes = 0;
+    for (size_t i = 0; i < 2; i++) {
+        Stats::Entry entry;
+        std::memcpy(&entry, dump.data() + sizeof(header) + i * sizeof(entry), sizeof(entry));
+        CHECK((entry.id == 0x241) || (entry.id == 0x7e8));
+        CHECK(entry.count == 1);
+        bytes += entry.bytes;
+    }
+    CHECK(bytes == 11);
+
+    TestCaseEnd();
+}
+
+int ut_UpdateBenchmark(void)
+{
+    TestCaseBegin();
+
+    static constexpr size_t NUMBER_OF_FRAMES = 1000000;
+    app::CanStatistics<64> stats;
+
+    // 40 IDs, which is a typical number of periodic messages on a powertrain bus
+    std::vector<uint32_t> ids;
+    for (uint32_t i = 0; i < 40; i++) {
+        ids.push_back(0x100 + i * 0x11);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < NUMBER_OF_FRAMES; i++) {
+        stats.update(ids[i % ids.size()], 8, i);
+    }
+    const auto updateNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                                               std::chrono::steady_clock::now() -
+                                                                               start).count() / NUMBER_OF_FRAMES;
+
+    const std::string frame = "t24180102030405060708\r";
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < NUMBER_OF_FRAMES; i++) {
+        stats.parse(frame, i);
+    }
+    const auto parseNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                                              std::chrono::steady_clock::now() -
+                                                                              start).count() / NUMBER_OF_FRAMES;
+
+    CHECK(stats.getNumberOfDroppedFrames() == 0);
+    CHECK(stats.find(0x241)->count == NUMBER_OF_FRAMES);
+
+    // A fully loaded 1 Mbit/s bus carries less than 20000 frames per second,
+    // which leaves 50 us per frame.
+    printf("%s: update %d ns/frame, parse incl. update %d ns/frame (host)\n",
+           __FUNCTION__, (int)updateNs, (int)parseNs);
+    CHECK(parseNs < 50000);
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_Update);
+    RunTest(true, ut_TableFull);
+    RunTest(true, ut_Parse);
+    RunTest(true, ut_Dump);
+    RunTest(true, ut_UpdateBenchmark);
+    UnitTestMainEnd();
+}
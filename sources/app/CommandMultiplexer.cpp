@@ -5,7 +5,10 @@
 
 #include "CommandMultiplexer.h"
 #include "trace.h"
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <algorithm>
 
 using app::CommandMultiplexer;
 using app::Socket;
@@ -44,9 +47,32 @@ void CommandMultiplexer::exitDeepSleep(void)
     mCommandMultiplexerTask.start();
 }
 
+const std::array<CommandMultiplexer::CommandHandler,
+                 CommandMultiplexer::NUMBER_OF_COMMANDS> CommandMultiplexer::CommandHandlers =
+{{
+    &CommandMultiplexer::handleRunDemo,
+    &CommandMultiplexer::handleFlashCanMcu,
+    &CommandMultiplexer::handleCanOn,
+    &CommandMultiplexer::handleCanOff,
+    &CommandMultiplexer::handleEnableCanRx,
+    &CommandMultiplexer::handleDisableCanRx,
+    &CommandMultiplexer::handleDongleReset,
+    &CommandMultiplexer::handleRemoteCodeUpdate,
+    &CommandMultiplexer::handleRemoteCodeExecution,
+    &CommandMultiplexer::handleCanStatistics,
+    &CommandMultiplexer::handleCanRecorder,
+    &CommandMultiplexer::handleCpuLoad
+}};
+
 void CommandMultiplexer::multiplexCommand(const std::string_view input)
 {
     Trace(ZONE_INFO, "Got cmd\r\n");
+
+    if (input[0] == BINARY_FRAME_START) {
+        multiplexBinaryCommand(input);
+        return;
+    }
+
     const auto ctrlindex = input.find('$');
 
     if (ctrlindex != std::string_view::npos) {
@@ -54,94 +80,300 @@ void CommandMultiplexer::multiplexCommand(const std::string_view input)
             Trace(ZONE_INFO, "Empty command received.\r\n");
             return;
         }
-        SpecialCommand_t cmd = SpecialCommand_t(input[ctrlindex + 1]);
-        handleSpecialCommand(cmd,
-                             std::string_view(input.data() + ctrlindex + 2,
-                                              input.length() - ctrlindex - 2));
+        mRequest = Request {false, static_cast<uint8_t>(input[ctrlindex + 1] - '0'), 0};
+        dispatchCommand(mRequest.opcode,
+                        std::string_view(input.data() + ctrlindex + 2,
+                                         input.length() - ctrlindex - 2));
+        flushReply();
     } else {
         showHelp();
     }
 }
 
+void CommandMultiplexer::multiplexBinaryCommand(const std::string_view frame)
+{
+    uint16_t payloadLength;
+    std::memcpy(&payloadLength, frame.data() + 1, sizeof(payloadLength));
+
+    mRequest = Request {true,
+                        static_cast<uint8_t>(frame[3]),
+                        static_cast<uint8_t>(frame[4])};
+
+    uint16_t crc;
+    std::memcpy(&crc, frame.data() + BINARY_HEADER_SIZE + payloadLength, sizeof(crc));
+
+    if (crc != crc16(reinterpret_cast<uint8_t const*>(frame.data() + 1), BINARY_HEADER_SIZE - 1 + payloadLength)) {
+        Trace(ZONE_ERROR, "CRC of binary command %d invalid\r\n", mRequest.sequence);
+        mRequest.opcode = BINARY_NACK;
+    } else if (!dispatchCommand(mRequest.opcode, std::string_view(frame.data() + BINARY_HEADER_SIZE, payloadLength))) {
+        mRequest.opcode = BINARY_NACK;
+    }
+    flushReply();
+}
+
+bool CommandMultiplexer::dispatchCommand(const uint8_t opcode, const std::string_view data)
+{
+    if (opcode >= CommandHandlers.size()) {
+        Trace(ZONE_INFO, "Unknown special command '%c'\r\n", opcode + '0');
+        return false;
+    }
+    (this->*CommandHandlers[opcode])(data);
+    return true;
+}
+
+size_t CommandMultiplexer::completeBinaryFrame(size_t length)
+{
+    static constexpr size_t minimalFrameLength = BINARY_HEADER_SIZE + BINARY_CRC_SIZE;
+    size_t frameLength = minimalFrameLength;
+
+    while (true) {
+        if (length >= 3) {
+            uint16_t payloadLength;
+            std::memcpy(&payloadLength, mCommandBuffer.data() + 1, sizeof(payloadLength));
+            frameLength = minimalFrameLength + payloadLength;
+
+            if (frameLength > mCommandBuffer.size()) {
+                Trace(ZONE_ERROR, "Binary command too long: %u\r\n", static_cast<unsigned int>(frameLength));
+                return 0;
+            }
+        }
+
+        if (length >= frameLength) {
+            break;
+        }
+
+        const size_t received =
+            mCtrlSock->receive(reinterpret_cast<uint8_t*>(mCommandBuffer.data() + length),
+                               frameLength - length, BINARY_FRAME_TIMEOUT);
+        if (!received) {
+            Trace(ZONE_ERROR, "Timeout while waiting for binary command\r\n");
+            return 0;
+        }
+        length += received;
+    }
+
+    mPendingLength = length - frameLength;
+    return frameLength;
+}
+
+uint16_t CommandMultiplexer::crc16(uint8_t const* data, const size_t length)
+{
+    // CRC-16/CCITT-FALSE
+    uint16_t crc = 0xffff;
+
+    for (size_t i = 0; i < length; i++) {
+        crc ^= static_cast<uint16_t>(data[i]) << 8;
+        for (size_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+uint32_t CommandMultiplexer::crc32(uint32_t crc, uint8_t const* data, const size_t numberOfWords)
+{
+    // Polynomial, initial value and word order of the CRC unit
+    for (size_t i = 0; i < numberOfWords; i++) {
+        uint32_t word;
+        std::memcpy(&word, data + i * sizeof(word), sizeof(word));
+        crc ^= word;
+        for (size_t bit = 0; bit < 32; bit++) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+void CommandMultiplexer::reply(std::string_view data)
+{
+    while (!data.empty()) {
+        if (mReplyLength == MAXREPLYPAYLOADSIZE) {
+            flushReply();
+        }
+
+        const size_t length = std::min(data.length(), MAXREPLYPAYLOADSIZE - mReplyLength);
+        std::memcpy(mReplyBuffer.data() + BINARY_HEADER_SIZE + mReplyLength, data.data(), length);
+        mReplyLength += length;
+        data.remove_prefix(length);
+    }
+}
+
+void CommandMultiplexer::flushReply(void)
+{
+    if (!mRequest.isBinary) {
+        if (mReplyLength) {
+            mCtrlSock->send(std::string_view(mReplyBuffer.data() + BINARY_HEADER_SIZE, mReplyLength));
+        }
+        mReplyLength = 0;
+        return;
+    }
+
+    const uint16_t payloadLength = mReplyLength;
+    const uint8_t opcode = mRequest.opcode == BINARY_NACK ? BINARY_NACK : mRequest.opcode | BINARY_REPLY_FLAG;
+
+    mReplyBuffer[0] = BINARY_FRAME_START;
+    std::memcpy(mReplyBuffer.data() + 1, &payloadLength, sizeof(payloadLength));
+    mReplyBuffer[3] = opcode;
+    mReplyBuffer[4] = mRequest.sequence;
+
+    const uint16_t crc = crc16(reinterpret_cast<uint8_t const*>(mReplyBuffer.data() + 1),
+                               BINARY_HEADER_SIZE - 1 + payloadLength);
+    std::memcpy(mReplyBuffer.data() + BINARY_HEADER_SIZE + payloadLength, &crc, sizeof(crc));
+
+    mCtrlSock->send(std::string_view(mReplyBuffer.data(), BINARY_HEADER_SIZE + payloadLength + BINARY_CRC_SIZE));
+    mReplyLength = 0;
+}
+
 void CommandMultiplexer::showHelp(void) const
 {
-    mCtrlSock->send("--------CARSEC Dongle ---------\r\n");
-    mCtrlSock->send("\r\n");
-    mCtrlSock->send("Commands:\r\n");
-    mCtrlSock->send("$0x =  RUN_DEMO x\r\n");
-    mCtrlSock->send("$1  =  FLASH_CAN_MCU\r\n");
-    mCtrlSock->send("$2  =  CAN_ON\r\n");
-    mCtrlSock->send("$3  =  CAN_OFF\r\n");
-    mCtrlSock->send("$4  =  ENABLE_CAN_RX\r\n");
-    mCtrlSock->send("$5  =  DISABLE_CAN_RX\r\n");
-    mCtrlSock->send("$6  =  DONGLE_RESET\r\n");
-    mCtrlSock->send("$7  =  RC_UPDATE\r\n");
-    mCtrlSock->send("$8  =  RC_EXECUTE\r\n");
+    mCtrlSock->send("--------CARSEC Dongle ---------\r\n"
+                    "\r\n"
+                    "Commands:\r\n"
+                    "$0x =  RUN_DEMO x\r\n"
+                    "$1  =  FLASH_CAN_MCU\r\n"
+                    "$2  =  CAN_ON\r\n"
+                    "$3  =  CAN_OFF\r\n"
+                    "$4  =  ENABLE_CAN_RX\r\n"
+                    "$5  =  DISABLE_CAN_RX\r\n"
+                    "$6  =  DONGLE_RESET\r\n"
+                    "$7  =  RC_UPDATE\r\n"
+                    "$8  =  RC_EXECUTE\r\n"
+                    "$9x =  CAN_STATISTICS x=0 off, x=1 on, else dump\r\n"
+                    "$:x =  CAN_RECORDER x=0 stop, x=1 record, x=r replay, else status\r\n"
+                    "$;  =  CPU_LOAD\r\n"
+                    "\r\n"
+                    "Binary frames start with STX, see CommandMultiplexer.h\r\n");
     os::ThisTask::sleep(std::chrono::milliseconds(500));
 }
 
-void CommandMultiplexer::handleSpecialCommand(CommandMultiplexer::SpecialCommand_t cmd, const std::string_view data)
+void CommandMultiplexer::handleFlashCanMcu(const std::string_view data)
 {
-    switch (cmd) {
-    case SpecialCommand_t::FLASH_CAN_MCU:
-        Trace(ZONE_INFO, "Flash CAN MCU requested.\r\n");
-        mCan.triggerFirmwareUpdate();
-        mCtrlSock->send("$Triggerd FW Update\r\n");
-        break;
+    Trace(ZONE_INFO, "Flash CAN MCU requested.\r\n");
+    mCan.triggerFirmwareUpdate();
+    reply("$Triggerd FW Update\r\n");
+}
 
-    case SpecialCommand_t::CAN_ON:
-        Trace(ZONE_INFO, "CAN ON requested.\r\n");
-        mCan.on();
-        mCtrlSock->send("$CAN ON\r\n");
-        break;
+void CommandMultiplexer::handleCanOn(const std::string_view data)
+{
+    Trace(ZONE_INFO, "CAN ON requested.\r\n");
+    mCan.on();
+    reply("$CAN ON\r\n");
+}
 
-    case SpecialCommand_t::CAN_OFF:
-        Trace(ZONE_INFO, "CAN OFF requested.\r\n");
-        mCan.off();
-        mCtrlSock->send("$CAN OFF\r\n");
-        break;
+void CommandMultiplexer::handleCanOff(const std::string_view data)
+{
+    Trace(ZONE_INFO, "CAN OFF requested.\r\n");
+    mCan.off();
+    reply("$CAN OFF\r\n");
+}
 
-    case SpecialCommand_t::ENABLE_CAN_RX:
-        Trace(ZONE_INFO, "Enable CAN RX requested.\r\n");
-        mCanRxEnabled = true;
-        mCtrlSock->send("$CAN RX on\r\n");
-        break;
+void CommandMultiplexer::handleEnableCanRx(const std::string_view data)
+{
+    Trace(ZONE_INFO, "Enable CAN RX requested.\r\n");
+    mCanRxEnabled = true;
+    reply("$CAN RX on\r\n");
+}
 
-    case SpecialCommand_t::DISABLE_CAN_RX:
-        Trace(ZONE_INFO, "Disable CAN RX requested.\r\n");
-        mCanRxEnabled = false;
-        mCtrlSock->send("$CAN RX off\r\n");
-        break;
+void CommandMultiplexer::handleDisableCanRx(const std::string_view data)
+{
+    Trace(ZONE_INFO, "Disable CAN RX requested.\r\n");
+    mCanRxEnabled = false;
+    reply("$CAN RX off\r\n");
+}
 
-    case SpecialCommand_t::RUN_DEMO:
-        Trace(ZONE_INFO, "Run demo requested.\r\n");
-        mCtrlSock->send("$RUN DEMO\r\n");
-        mDemo.runDemo(data);
-        break;
+void CommandMultiplexer::handleRunDemo(const std::string_view data)
+{
+    Trace(ZONE_INFO, "Run demo requested.\r\n");
+    reply("$RUN DEMO\r\n");
+    mDemo.runDemo(data);
+}
 
-    case SpecialCommand_t::DONGLE_RESET:
-        Trace(ZONE_INFO, "Reset myself... bye.bye!\r\n");
-        mCtrlSock->send("Reset myself... bye.bye!\r\n");
-        os::ThisTask::sleep(std::chrono::milliseconds(500));
-        NVIC_SystemReset();
-        break;
+void CommandMultiplexer::handleDongleReset(const std::string_view data)
+{
+    Trace(ZONE_INFO, "Reset myself... bye.bye!\r\n");
+    reply("Reset myself... bye.bye!\r\n");
+    flushReply();
+    os::ThisTask::sleep(std::chrono::milliseconds(500));
+#if defined(SIMULATION)
+    // Whoever started the simulation may start it again
+    std::_Exit(EXIT_SUCCESS);
+#elif !defined(UNITTEST)
+    NVIC_SystemReset();
+#endif
+}
 
-    case SpecialCommand_t::RC_EXECUTE:
-        Trace(ZONE_INFO, "EXECUTE Remote Code.\r\n");
-        mCtrlSock->send("Run Remote Code!\r\n");
-        remoteCodeExecution();
-        break;
+void CommandMultiplexer::handleRemoteCodeExecution(const std::string_view data)
+{
+    Trace(ZONE_INFO, "EXECUTE Remote Code.\r\n");
+    if (!mIsRemoteCodeValid) {
+        reply("$RC INVALID\r\n");
+        return;
+    }
+    reply("Run Remote Code!\r\n");
+    flushReply();
+    remoteCodeExecution();
+}
 
-    case SpecialCommand_t::RC_UPDATE:
-        Trace(ZONE_INFO, "Update Remote Code.\r\n");
-        mCtrlSock->send("Update Remote Code!\r\n");
-        updateRemoteCode(data);
-        break;
+void CommandMultiplexer::handleRemoteCodeUpdate(const std::string_view data)
+{
+    Trace(ZONE_INFO, "Update Remote Code.\r\n");
+    updateRemoteCode(data);
+}
 
-    default:
-        Trace(ZONE_INFO, "Unknown special command '%c'\r\n", cmd);
-        break;
+void CommandMultiplexer::handleCanStatistics(const std::string_view data)
+{
+    Trace(ZONE_INFO, "CAN statistics requested.\r\n");
+    if (!data.empty() && (data[0] == '0')) {
+        mCan.disableStatistics();
+        reply("$CAN STATS off\r\n");
+    } else if (!data.empty() && (data[0] == '1')) {
+        mCan.enableStatistics();
+        reply("$CAN STATS on\r\n");
+    } else {
+        reply("$CAN STATS\r\n");
+        mCan.dumpStatistics([&](const std::string_view chunk){
+            reply(chunk);
+        });
+    }
+}
+
+void CommandMultiplexer::handleCanRecorder(const std::string_view data)
+{
+    Trace(ZONE_INFO, "CAN recorder requested.\r\n");
+#ifdef RECORD_CAN
+    if (!data.empty() && (data[0] == '0')) {
+        mCan.stopRecording();
+        reply("$REC stop\r\n");
+    } else if (!data.empty() && (data[0] == '1')) {
+        reply(mCan.startRecording() ? "$REC record\r\n" : "$REC busy\r\n");
+    } else if (!data.empty() && (data[0] == 'r')) {
+        reply(mCan.replayRecording() ? "$REC replay\r\n" : "$REC busy\r\n");
+    } else {
+        CanRecorder::Status status {};
+        mCan.getRecorderStatus(status);
+
+        std::array<char, 64> text;
+        const int length = std::snprintf(text.data(), text.size(), "$REC %d %d frames %d dropped %d/%d byte\r\n",
+                                         static_cast<int>(status.state), status.frames, status.droppedFrames,
+                                         status.bytes, status.capacity);
+        reply(std::string_view(text.data(), std::min(static_cast<size_t>(length), text.size() - 1)));
     }
+#else
+    reply("$REC off\r\n");
+#endif
+}
+
+void CommandMultiplexer::handleCpuLoad(const std::string_view data)
+{
+    Trace(ZONE_INFO, "CPU load requested.\r\n");
+#ifdef MEASURE_CPU_LOAD
+    reply("$CPU LOAD\r\n");
+    mCpuLoad.dump([&](const std::string_view chunk){
+        reply(chunk);
+    });
+#else
+    reply("$CPU LOAD off\r\n");
+#endif
 }
 
 __attribute__ ((section(".rce.str"))) uint8_t str[] = "hello from RCE\r\n";
@@ -154,53 +386,144 @@ __attribute__ ((section(".rce"))) void CommandMultiplexer::remoteCodeExecution(v
     mCtrlSock->send(std::string_view(reinterpret_cast<const char*>(str), sizeof(str)), 100);
 }
 
-extern "C" char _rce_start;
-extern "C" char _rce_end;
+extern "C" char _rce_start[];
+extern "C" char _rce_end[];
 
-void CommandMultiplexer::updateRemoteCode(const std::string_view code)
+void CommandMultiplexer::updateRemoteCode(const std::string_view command)
 {
-    if (code.length() <= 2) {
-        Trace(ZONE_ERROR, "Code to short to contain a 2 byte length field\r\n");
+    if (command.empty()) {
+        replyRemoteCodeStatus("ERROR");
         return;
     }
-    size_t length;
 
-    std::memcpy(&length, code.data(), sizeof(length));
+    const std::string_view data(command.data() + 1, command.length() - 1);
+
+    switch (command[0]) {
+    case 'B':
+        beginRemoteCodeUpdate(data);
+        break;
+
+    case 'D':
+        storeRemoteCode(data);
+        break;
+
+    case 'R':
+        replyRemoteCodeStatus("RESUME");
+        break;
 
-    uint8_t* p = (uint8_t*)(&_rce_start);
-    uint8_t const* const end = (uint8_t*)(&_rce_end);
+    case 'C':
+        commitRemoteCode();
+        break;
 
-    if (length > static_cast<size_t>(end - p)) {
-        Trace(ZONE_ERROR, "Provide a valid length smaller than %d \r\n", (end - p));
+    default:
+        Trace(ZONE_ERROR, "Unknown remote code command\r\n");
+        replyRemoteCodeStatus("ERROR");
+        break;
+    }
+}
+
+void CommandMultiplexer::beginRemoteCodeUpdate(const std::string_view data)
+{
+    uint16_t length;
+    uint32_t crc;
+
+    if (data.length() != sizeof(length) + sizeof(crc)) {
+        replyRemoteCodeStatus("ERROR");
         return;
     }
+    std::memcpy(&length, data.data(), sizeof(length));
+    std::memcpy(&crc, data.data() + sizeof(length), sizeof(crc));
 
-    std::string_view segment(code.data() + 2, code.length() - 2);
+    const size_t availableMemory = std::min(MAXREMOTECODESIZE, static_cast<size_t>(_rce_end - _rce_start));
 
-    do {
-        if (p + segment.length() > end) {
-            Trace(ZONE_ERROR, "Memory would overflow \r\n");
-            return;
-        }
+    if ((length == 0) || (length > availableMemory) || (length % sizeof(uint32_t))) {
+        Trace(ZONE_ERROR, "Provide a valid length smaller than %u \r\n",
+              static_cast<unsigned int>(availableMemory));
+        replyRemoteCodeStatus("ERROR");
+        return;
+    }
 
-        if (segment.length() > length) {
-            Trace(ZONE_ERROR, "More bytes in segment than I'm waiting for\r\n");
-            return;
-        }
+    // From now on the .rce section is overwritten, so the old code must not run anymore.
+    mIsRemoteCodeValid = false;
+    mIsRemoteCodeUpdateRunning = true;
+    mRemoteCodeBlocks.reset();
+    mRemoteCodeLength = length;
+    mRemoteCodeCrcOffset = 0;
+    mRemoteCodeCrc = 0xffffffff;
+    mRemoteCodeExpectedCrc = crc;
+    replyRemoteCodeStatus("BEGIN");
+}
 
-        std::memcpy(p, segment.data(), segment.length());
-        p += segment.length();
-        length -= segment.length();
+void CommandMultiplexer::storeRemoteCode(const std::string_view data)
+{
+    uint16_t offset;
 
-        const size_t newSegmentLength = mCtrlSock->receive(
-                                                           reinterpret_cast<uint8_t*>(mCommandBuffer.data()),
-                                                           mCommandBuffer.size(), 2000);
-        if (!newSegmentLength) {
-            Trace(ZONE_ERROR, "Timeout while waiting for more data \r\n");
-            return;
+    if (!mIsRemoteCodeUpdateRunning || (data.length() <= sizeof(offset))) {
+        replyRemoteCodeStatus("ERROR");
+        return;
+    }
+    std::memcpy(&offset, data.data(), sizeof(offset));
+    const std::string_view chunk(data.data() + sizeof(offset), data.length() - sizeof(offset));
+    const size_t end = offset + chunk.length();
+
+    if ((offset % REMOTECODE_BLOCKSIZE) || (end > mRemoteCodeLength) ||
+        ((end % REMOTECODE_BLOCKSIZE) && (end != mRemoteCodeLength)))
+    {
+        Trace(ZONE_ERROR, "Invalid chunk %u-%u\r\n", offset, static_cast<unsigned int>(end));
+        replyRemoteCodeStatus("ERROR");
+        return;
+    }
+
+    // Blocks in front of mRemoteCodeCrcOffset are already part of the CRC. Chunks
+    // which are sent again after a resume must not change them anymore.
+    for (size_t block = offset; block < end; block += REMOTECODE_BLOCKSIZE) {
+        if (block >= mRemoteCodeCrcOffset) {
+            std::memcpy(_rce_start + block, chunk.data() + block - offset,
+                        std::min(REMOTECODE_BLOCKSIZE, end - block));
+            mRemoteCodeBlocks.set(block / REMOTECODE_BLOCKSIZE);
         }
-        segment = std::string_view(mCommandBuffer.data(), newSegmentLength);
-    } while (p < end && length);
+    }
+
+    // The CRC runs in software, the data register of the CRC unit would have to
+    // survive between the commands of an update.
+    while ((mRemoteCodeCrcOffset < mRemoteCodeLength) &&
+           mRemoteCodeBlocks.test(mRemoteCodeCrcOffset / REMOTECODE_BLOCKSIZE))
+    {
+        const size_t length = std::min(REMOTECODE_BLOCKSIZE, mRemoteCodeLength - mRemoteCodeCrcOffset);
+        uint8_t const* const data = reinterpret_cast<uint8_t const*>(_rce_start + mRemoteCodeCrcOffset);
+
+        mRemoteCodeCrc = crc32(mRemoteCodeCrc, data, length / sizeof(uint32_t));
+        mRemoteCodeCrcOffset += length;
+    }
+    replyRemoteCodeStatus("DATA");
+}
+
+void CommandMultiplexer::commitRemoteCode(void)
+{
+    if (!mIsRemoteCodeUpdateRunning || (mRemoteCodeCrcOffset != mRemoteCodeLength)) {
+        replyRemoteCodeStatus("INCOMPLETE");
+        return;
+    }
+
+    mIsRemoteCodeUpdateRunning = false;
+
+    if (mRemoteCodeCrc != mRemoteCodeExpectedCrc) {
+        Trace(ZONE_ERROR, "CRC of remote code invalid\r\n");
+        replyRemoteCodeStatus("CRC ERROR");
+        return;
+    }
+
+    mIsRemoteCodeValid = true;
+    replyRemoteCodeStatus("COMMITTED");
+}
+
+void CommandMultiplexer::replyRemoteCodeStatus(const char* status)
+{
+    std::array<char, 32> text;
+    const int length = std::snprintf(text.data(), text.size(), "$RC %s %u\r\n", status,
+                                     static_cast<unsigned int>(mRemoteCodeCrcOffset));
+
+    reply(std::string_view(text.data(), std::min(static_cast<size_t>(length), text.size() - 1)));
 }
 
 void CommandMultiplexer::commandMultiplexerTaskFunction(const bool& join)
@@ -208,9 +531,19 @@ void CommandMultiplexer::commandMultiplexerTaskFunction(const bool& join)
     Trace(ZONE_INFO, "Start command multiplexer \r\n");
 
     do {
-        const auto length =
-            mCtrlSock->receive(reinterpret_cast<uint8_t*>(mCommandBuffer.data()), mCommandBuffer.size());
-        if (length) {
+        auto length = mPendingLength;
+        mPendingLength = 0;
+        if (!length) {
+            length = mCtrlSock->receive(reinterpret_cast<uint8_t*>(mCommandBuffer.data()), mCommandBuffer.size());
+        }
+        if (length && (mCommandBuffer[0] == BINARY_FRAME_START)) {
+            const auto frameLength = completeBinaryFrame(length);
+            if (frameLength) {
+                multiplexCommand(std::string_view(mCommandBuffer.data(), frameLength));
+                // The next command follows directly after the frame
+                std::memmove(mCommandBuffer.data(), mCommandBuffer.data() + frameLength, mPendingLength);
+            }
+        } else if (length) {
             multiplexCommand(std::string_view(mCommandBuffer.data(), length));
         }
     } while (!join);
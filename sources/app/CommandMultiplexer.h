@@ -7,11 +7,25 @@
 
 #include <string_view>
 #include <memory>
+#include <array>
+#include <bitset>
 #include "TaskInterruptable.h"
 #include "DeepSleepInterface.h"
 #include "Socket.h"
 #include "CanController.h"
 #include "DemoExecuter.h"
+#ifdef MEASURE_CPU_LOAD
+#include "CpuLoad.h"
+#endif
+
+#ifdef UNITTEST
+int ut_AsciiCommands(void);
+int ut_BinaryCommands(void);
+int ut_BinaryFrameErrors(void);
+int ut_CommandLatency(void);
+int ut_RemoteCodeUpdate(void);
+int ut_RemoteCodeUpdateResume(void);
+#endif
 
 namespace app
 {
@@ -22,8 +36,54 @@ class CommandMultiplexer final :
     virtual void exitDeepSleep(void) override;
 
     static constexpr uint32_t STACKSIZE = 1024;
-    static constexpr size_t MAXCOMMANDSIZE = 64;
+    static constexpr size_t MAXCOMMANDSIZE = 128;
     std::array<char, MAXCOMMANDSIZE> mCommandBuffer;
+    // Bytes of the next command which were received together with a binary frame
+    size_t mPendingLength = 0;
+
+    // Binary command frame:
+    //  STX | payload length (2 byte) | opcode | sequence | payload | CRC16 (2 byte)
+    // Multi byte fields are little endian, the CRC covers everything between STX
+    // and CRC. Replies use the same format with BINARY_REPLY_FLAG set in the opcode
+    // and the sequence number of the request. Replies which don't fit into one
+    // frame are split into several frames with the same sequence number.
+    static constexpr char BINARY_FRAME_START = 0x02;
+    static constexpr size_t BINARY_HEADER_SIZE = 5;
+    static constexpr size_t BINARY_CRC_SIZE = 2;
+    static constexpr uint8_t BINARY_REPLY_FLAG = 0x80;
+    static constexpr uint8_t BINARY_NACK = 0xff;
+    static constexpr uint32_t BINARY_FRAME_TIMEOUT = 1000;
+
+    static constexpr size_t MAXREPLYSIZE = 256;
+    static constexpr size_t MAXREPLYPAYLOADSIZE = MAXREPLYSIZE - BINARY_HEADER_SIZE - BINARY_CRC_SIZE;
+    std::array<char, MAXREPLYSIZE> mReplyBuffer;
+    size_t mReplyLength = 0;
+
+    struct Request {
+        bool isBinary;
+        uint8_t opcode;
+        uint8_t sequence;
+    };
+    Request mRequest {};
+
+    // Remote code updates are streamed into the .rce section with sub commands of RC_UPDATE:
+    //  'B' length (2 byte) CRC32 (4 byte)  start a new image, the current one becomes invalid
+    //  'D' offset (2 byte) data            store a chunk, offset and length are multiples of
+    //                                      REMOTECODE_BLOCKSIZE, except for the end of the image
+    //  'R'                                 report the offset to resume the transfer from
+    //  'C'                                 commit the image after length and CRC are verified
+    // Chunks may arrive in any order. The CRC runs over the image as soon as a
+    // contiguous block from its start is complete, so the commit only has to
+    // compare. The length of the image has to be a multiple of 4 byte.
+    static constexpr size_t REMOTECODE_BLOCKSIZE = 16;
+    static constexpr size_t MAXREMOTECODESIZE = 1024;
+    std::bitset<MAXREMOTECODESIZE / REMOTECODE_BLOCKSIZE> mRemoteCodeBlocks;
+    size_t mRemoteCodeLength = 0;
+    size_t mRemoteCodeCrcOffset = 0;
+    uint32_t mRemoteCodeCrc = 0;
+    uint32_t mRemoteCodeExpectedCrc = 0;
+    bool mIsRemoteCodeUpdateRunning = false;
+    bool mIsRemoteCodeValid = true;
 
     enum class SpecialCommand_t {
         RUN_DEMO = '0',
@@ -34,22 +94,59 @@ class CommandMultiplexer final :
         DISABLE_CAN_RX,
         DONGLE_RESET,
         RC_UPDATE,
-        RC_EXECUTE
+        RC_EXECUTE,
+        CAN_STATISTICS,
+        CAN_RECORDER,
+        CPU_LOAD
     };
 
+    static constexpr size_t NUMBER_OF_COMMANDS = static_cast<size_t>(SpecialCommand_t::CPU_LOAD) -
+                                                 static_cast<size_t>(SpecialCommand_t::RUN_DEMO) + 1;
+
+    // Indexed by opcode, which is the SpecialCommand_t relative to RUN_DEMO.
+    using CommandHandler = void (CommandMultiplexer::*)(const std::string_view);
+    static const std::array<CommandHandler, NUMBER_OF_COMMANDS> CommandHandlers;
+
     os::TaskInterruptable mCommandMultiplexerTask;
     std::shared_ptr<Socket> mCtrlSock;
     std::shared_ptr<Socket> mDataSock;
     CanController& mCan;
     DemoExecuter& mDemo;
     bool mCanRxEnabled = false;
+#ifdef MEASURE_CPU_LOAD
+    os::CpuLoad mCpuLoad;
+#endif
 
     void multiplexCommand(const std::string_view cmd);
-    void handleSpecialCommand(SpecialCommand_t cmd, const std::string_view);
+    void multiplexBinaryCommand(const std::string_view frame);
+    bool dispatchCommand(const uint8_t opcode, const std::string_view data);
+    size_t completeBinaryFrame(size_t length);
+    static uint16_t crc16(uint8_t const* data, const size_t length);
+    static uint32_t crc32(uint32_t crc, uint8_t const* data, const size_t numberOfWords);
+
+    void reply(std::string_view data);
+    void flushReply(void);
+
+    void handleRunDemo(const std::string_view data);
+    void handleFlashCanMcu(const std::string_view data);
+    void handleCanOn(const std::string_view data);
+    void handleCanOff(const std::string_view data);
+    void handleEnableCanRx(const std::string_view data);
+    void handleDisableCanRx(const std::string_view data);
+    void handleDongleReset(const std::string_view data);
+    void handleRemoteCodeUpdate(const std::string_view data);
+    void handleRemoteCodeExecution(const std::string_view data);
+    void handleCanStatistics(const std::string_view data);
+    void handleCanRecorder(const std::string_view data);
+    void handleCpuLoad(const std::string_view data);
 
     void commandMultiplexerTaskFunction(const bool&);
     void remoteCodeExecution(void);
-    void updateRemoteCode(const std::string_view code);
+    void updateRemoteCode(const std::string_view command);
+    void beginRemoteCodeUpdate(const std::string_view data);
+    void storeRemoteCode(const std::string_view data);
+    void commitRemoteCode(void);
+    void replyRemoteCodeStatus(const char* status);
     void showHelp(void) const;
 
 public:
@@ -62,5 +159,14 @@ public:
     CommandMultiplexer(CommandMultiplexer&&) = delete;
     CommandMultiplexer& operator=(const CommandMultiplexer&) = delete;
     CommandMultiplexer& operator=(CommandMultiplexer&&) = delete;
+
+#ifdef UNITTEST
+    friend int ::ut_AsciiCommands(void);
+    friend int ::ut_BinaryCommands(void);
+    friend int ::ut_BinaryFrameErrors(void);
+    friend int ::ut_CommandLatency(void);
+    friend int ::ut_RemoteCodeUpdate(void);
+    friend int ::ut_RemoteCodeUpdateResume(void);
+#endif
 };
 }
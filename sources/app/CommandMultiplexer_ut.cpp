@@ -0,0 +1,767 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+#include "unittest.h"
+#include "CommandMultiplexer.h"
+
+//--------------------------BUFFERS--------------------------
+// The modem emulation models every Socket::send as one AT+USOWR write, which is
+// the worst case when the modem task drains the send buffer between two calls.
+static constexpr size_t MODEM_BAUDRATE = 115200;
+static constexpr size_t BITS_PER_BYTE = 10;
+static constexpr size_t AT_WRITE_OVERHEAD = sizeof("AT+USOWR=0,256\r") + sizeof("@") +
+                                            sizeof("\r\n+USOWR: 0,256\r\n\r\nOK\r\n");
+static constexpr size_t AT_READ_OVERHEAD = sizeof("+UUSORD: 0,256\r\n") + sizeof("AT+USORD=0,256\r") +
+                                           sizeof("\r\n+USORD: 0,256,\"\"\r\n\r\nOK\r\n");
+static constexpr size_t RCE_SIZE = 1024;
+
+uint64_t g_simulatedTimeUs;
+std::deque<char> g_socketRx;
+size_t g_maxReceiveChunk = 64;
+std::vector<std::string> g_socketTx;
+
+bool g_canOn;
+size_t g_numberOfStatisticEntries;
+bool g_isRecording;
+
+extern "C" char _rce_start[RCE_SIZE] __attribute__((aligned(4)));
+char _rce_start[RCE_SIZE];
+asm (".globl _rce_end\n.set _rce_end, _rce_start + 1024");
+
+//--------------------------MOCKING--------------------------
+constexpr const std::array<const hal::Gpio, hal::Gpio::__ENUM__SIZE + 1> hal::Factory<hal::Gpio>::Container;
+constexpr const std::array<const hal::Usart, hal::Usart::__ENUM__SIZE + 1> hal::Factory<hal::Usart>::Container;
+constexpr const std::array<const hal::Dma, hal::Dma::__ENUM__SIZE + 1> hal::Factory<hal::Dma>::Container;
+constexpr const std::array<const hal::UsartWithDma,
+                           hal::Usart::__ENUM__SIZE> hal::Factory<hal::UsartWithDma>::Container;
+
+void os::TaskInterruptable::join(void) {}
+
+void os::TaskInterruptable::start(void) {}
+
+os::TaskInterruptable::TaskInterruptable(char const* name, unsigned short stack, os::Task::Priority prio,
+                                         std::function<void(bool const&)> func) :
+    Task(name, stack, prio, func) {}
+
+os::TaskInterruptable::~TaskInterruptable(void) {}
+
+void os::TaskInterruptable::taskFunction(void) {}
+
+os::Task::Task(char const* name, unsigned short stack, os::Task::Priority prio,
+               std::function<void(bool const&)> func) {}
+
+os::Task::~Task(void) {}
+
+void os::Task::taskFunction(void) {}
+
+os::Timer::Timer(char const* name, const std::chrono::milliseconds period, const Mode mode,
+                 std::function<void(void)> function) {}
+
+os::Timer::~Timer(void) {}
+
+void os::ThisTask::sleep(const std::chrono::milliseconds ms)
+{
+    g_simulatedTimeUs += ms.count() * 1000;
+}
+
+uint32_t os::Task::getTickCount(void)
+{
+    return g_simulatedTimeUs / 1000;
+}
+
+os::Mutex::Mutex(void) {}
+
+os::Mutex::~Mutex(void) {}
+
+bool os::Mutex::take(uint32_t ticksToWait) const
+{
+    return true;
+}
+
+bool os::Mutex::give(void) const
+{
+    return true;
+}
+
+os::Mutex::operator bool() const
+{
+    return true;
+}
+
+size_t hal::Usart::send(uint8_t const* const data, const size_t length) const
+{
+    return length;
+}
+
+QueueHandle_t xQueueGenericCreate(const UBaseType_t uxQueueLength,
+                                  const UBaseType_t uxItemSize,
+                                  const uint8_t     ucQueueType)
+{
+    return reinterpret_cast<QueueHandle_t>(1);
+}
+
+void vQueueDelete(QueueHandle_t xQueue) {}
+
+StreamBufferHandle_t xStreamBufferGenericCreate(size_t     xBufferSizeBytes,
+                                                size_t     xTriggerLevelBytes,
+                                                BaseType_t xIsMessageBuffer)
+{
+    return reinterpret_cast<StreamBufferHandle_t>(1);
+}
+
+void vStreamBufferDelete(StreamBufferHandle_t xStreamBuffer) {}
+
+void app::ATCmd::okReceived(void) {}
+
+void app::ATCmd::errorReceived(void) {}
+
+app::AT::Return_t app::ATCmd::onResponseMatch(void)
+{
+    return Return_t::FINISHED;
+}
+
+app::AT::Return_t app::ATCmdUSOCR::onResponseMatch(void)
+{
+    return Return_t::FINISHED;
+}
+
+app::AT::Return_t app::ATCmdUSOCTL::onResponseMatch(void)
+{
+    return Return_t::FINISHED;
+}
+
+app::Socket::Socket(const Protocol                   protocol,
+                    ATParser&                        parser,
+                    AT::SendFunction&                send,
+                    const std::string_view           ip,
+                    const std::string_view           port,
+                    const std::function<void(void)>& errorCallback) :
+    mATCmdUSOCR(send),
+    mATCmdUSOCO(send),
+    mATCmdUSOSO(send),
+    mATCmdUSOCTL(send),
+    mHandleError(errorCallback),
+    mProtocol(protocol),
+    mIP(ip),
+    mPort(port)
+{}
+
+app::Socket::~Socket(void) {}
+
+size_t app::Socket::send(std::string_view message, const uint32_t ticksToWait)
+{
+    g_socketTx.emplace_back(message.data(), message.length());
+    g_simulatedTimeUs += (AT_WRITE_OVERHEAD + message.length()) * BITS_PER_BYTE * 1000000 / MODEM_BAUDRATE;
+    return message.length();
+}
+
+size_t app::Socket::receive(uint8_t* message, size_t length, uint32_t ticksToWait)
+{
+    size_t i;
+    for (i = 0; i < std::min(length, g_maxReceiveChunk) && !g_socketRx.empty(); i++) {
+        message[i] = g_socketRx.front();
+        g_socketRx.pop_front();
+    }
+    if (i) {
+        g_simulatedTimeUs += (AT_READ_OVERHEAD + i) * BITS_PER_BYTE * 1000000 / MODEM_BAUDRATE;
+    }
+    return i;
+}
+
+void app::Socket::registerReceiveCallback(std::function<void(std::string_view)> f) {}
+
+class SocketEmulation :
+    public app::Socket
+{
+    virtual void sendData(void) override {}
+    virtual void receiveData(size_t) override {}
+    virtual bool create(void) override { return true; }
+    virtual bool open(void) override { return true; }
+    virtual void checkIfDataAvailable(void) override {}
+
+    static app::ATParser* const parser;
+    static app::AT::SendFunction sendFunction;
+    static const std::function<void(void)> errorCallback;
+
+public:
+    SocketEmulation(void) :
+        Socket(Protocol::TCP, *parser, sendFunction, "", "", errorCallback) {}
+};
+
+app::ATParser* const SocketEmulation::parser = nullptr;
+app::AT::SendFunction SocketEmulation::sendFunction;
+const std::function<void(void)> SocketEmulation::errorCallback;
+
+app::CanController::CanController(const hal::UsartWithDma& interface,
+                                  const hal::Gpio&         supplyPin,
+                                  const hal::Gpio&         usartTxPin) :
+    os::DeepSleepModule(),
+    mTask("", 0, os::Task::Priority::LOW, [](const bool&){}),
+    mInterface(interface),
+    mCanSupplyVoltage(supplyPin),
+    mUsartTxPin(usartTxPin)
+{}
+
+void app::CanController::enterDeepSleep(void) {}
+
+void app::CanController::exitDeepSleep(void) {}
+
+void app::CanController::on(void)
+{
+    g_canOn = true;
+}
+
+void app::CanController::off(void)
+{
+    g_canOn = false;
+}
+
+void app::CanController::triggerFirmwareUpdate(void) {}
+
+size_t app::CanController::send(std::string_view data, const uint32_t ticksToWait)
+{
+    return data.length();
+}
+
+void app::CanController::registerReceiveCallback(std::function<void(std::string_view)> f) {}
+
+void app::CanController::enableStatistics(void) {}
+
+void app::CanController::disableStatistics(void) {}
+
+void app::CanController::dumpStatistics(const std::function<void(std::string_view)>& send) const
+{
+    using Stats = CanStatistics<STATISTICSSIZE>;
+    const Stats::Header header {static_cast<uint16_t>(g_numberOfStatisticEntries), sizeof(Stats::Entry), 0};
+    send(std::string_view(reinterpret_cast<const char*>(&header), sizeof(header)));
+
+    for (size_t i = 0; i < g_numberOfStatisticEntries; i++) {
+        const Stats::Entry entry {static_cast<uint32_t>(0x100 + i), 1, 8, 0, 10, 10};
+        send(std::string_view(reinterpret_cast<const char*>(&entry), sizeof(entry)));
+    }
+}
+
+#ifdef RECORD_CAN
+bool app::CanController::startRecording(void)
+{
+    const bool wasRecording = g_isRecording;
+    g_isRecording = true;
+    return !wasRecording;
+}
+
+void app::CanController::stopRecording(void)
+{
+    g_isRecording = false;
+}
+
+bool app::CanController::replayRecording(void)
+{
+    return !g_isRecording;
+}
+
+bool app::CanController::getRecorderStatus(CanRecorder::Status& status) const
+{
+    status = CanRecorder::Status {g_isRecording ? CanRecorder::State::RECORDING : CanRecorder::State::IDLE,
+                                  100, 0, 1400, 128 * 1024};
+    return true;
+}
+#endif
+
+app::IsoTp::IsoTp(CanController& can, const uint32_t txId, const uint32_t rxId) :
+    os::DeepSleepModule(),
+    mTesterPresentTimer("", std::chrono::milliseconds(0), os::Timer::Mode::PERIODIC, [](){}),
+    mCan(can), mTxId(txId), mRxId(rxId)
+{}
+
+void app::IsoTp::enterDeepSleep(void) {}
+
+void app::IsoTp::exitDeepSleep(void) {}
+
+app::DemoExecuter::DemoExecuter(CanController& can) :
+    os::DeepSleepModule(),
+    mDemoExecuterTask("", 0, os::Task::Priority::LOW, [](const bool&){}),
+    mCan(can),
+    mIsoTp(can, REQUEST_ID, RESPONSE_ID)
+{}
+
+void app::DemoExecuter::enterDeepSleep(void) {}
+
+void app::DemoExecuter::exitDeepSleep(void) {}
+
+void app::DemoExecuter::runDemo(std::string_view data) {}
+
+//--------------------------HELPERS--------------------------
+static std::string binaryFrame(const uint8_t opcode, const uint8_t sequence, const std::string& payload)
+{
+    std::string frame(5, '\0');
+    frame[0] = 0x02;
+    frame[1] = payload.length() & 0xff;
+    frame[2] = payload.length() >> 8;
+    frame[3] = opcode;
+    frame[4] = sequence;
+    frame += payload;
+
+    uint16_t crc = 0xffff;
+    for (size_t i = 1; i < frame.length(); i++) {
+        crc ^= static_cast<uint8_t>(frame[i]) << 8;
+        for (size_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    frame += static_cast<char>(crc & 0xff);
+    frame += static_cast<char>(crc >> 8);
+    return frame;
+}
+
+static bool checkReplyFrame(const std::string& frame, const uint8_t opcode, const uint8_t sequence,
+                            std::string& payload)
+{
+    if ((frame.length() < 7) || (frame[0] != 0x02)) {
+        return false;
+    }
+    const size_t length = static_cast<uint8_t>(frame[1]) | static_cast<uint8_t>(frame[2]) << 8;
+    payload = frame.substr(5, length);
+    return (frame.length() == length + 7) &&
+           (static_cast<uint8_t>(frame[3]) == opcode) &&
+           (static_cast<uint8_t>(frame[4]) == sequence) &&
+           (binaryFrame(frame[3], frame[4], payload) == frame);
+}
+
+// CRC-32 of the CRC unit over 32 bit words
+static uint32_t crc32(const std::string& data)
+{
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < data.length(); i += sizeof(uint32_t)) {
+        uint32_t word;
+        std::memcpy(&word, data.data() + i, sizeof(word));
+        crc ^= word;
+        for (size_t bit = 0; bit < 32; bit++) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static std::string remoteCodeBegin(const std::string& image)
+{
+    std::string payload("B");
+    const uint16_t length = image.length();
+    const uint32_t crc = crc32(image);
+    payload.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    payload.append(reinterpret_cast<const char*>(&crc), sizeof(crc));
+    return binaryFrame(7, 0, payload);
+}
+
+static std::string remoteCodeData(const std::string& image, const uint16_t offset, const size_t length)
+{
+    std::string payload("D");
+    payload.append(reinterpret_cast<const char*>(&offset), sizeof(offset));
+    payload += image.substr(offset, length);
+    return binaryFrame(7, offset / 16, payload);
+}
+
+static std::string replyPayload(void)
+{
+    std::string payload;
+    for (const auto& tx : g_socketTx) {
+        std::string framePayload;
+        if (checkReplyFrame(tx, static_cast<uint8_t>(tx[3]), static_cast<uint8_t>(tx[4]), framePayload)) {
+            payload += framePayload;
+        }
+    }
+    return payload;
+}
+
+static std::string randomImage(const size_t length)
+{
+    std::mt19937 generator(length);
+    std::string image;
+    for (size_t i = 0; i < length; i++) {
+        image += static_cast<char>(generator());
+    }
+    return image;
+}
+
+static void queueCommand(const std::string& input)
+{
+    g_socketRx.insert(g_socketRx.end(), input.begin(), input.end());
+    g_socketTx.clear();
+}
+
+static app::CanController& getCanController(void)
+{
+    static app::CanController can(hal::Factory<hal::UsartWithDma>::get<hal::Usart::SECCO_COM>(),
+                                  hal::Factory<hal::Gpio>::get<hal::Gpio::SECCO_PWR>(),
+                                  hal::Factory<hal::Gpio>::get<hal::Gpio::SECCO_PWR>());
+    return can;
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_AsciiCommands(void)
+{
+    TestCaseBegin();
+
+    auto socket = std::make_shared<SocketEmulation>();
+    app::DemoExecuter demo(getCanController());
+    app::CommandMultiplexer multiplexer(socket, socket, getCanController(), demo);
+    auto runCommand = [&](const std::string& input){
+                          queueCommand(input);
+                          multiplexer.commandMultiplexerTaskFunction(true);
+                      };
+
+    g_canOn = false;
+    runCommand("$2\r\n");
+    CHECK(g_canOn);
+    CHECK(g_socketTx.size() == 1);
+    CHECK(g_socketTx[0] == "$CAN ON\r\n");
+
+    runCommand("$3\r\n");
+    CHECK(!g_canOn);
+    CHECK(g_socketTx.size() == 1);
+    CHECK(g_socketTx[0] == "$CAN OFF\r\n");
+
+    runCommand("help\r\n");
+    CHECK(g_socketTx.size() == 1);
+    CHECK(g_socketTx[0].find("$9x =  CAN_STATISTICS") != std::string::npos);
+
+    runCommand("$Z\r\n");
+    CHECK(g_socketTx.empty());
+
+    g_numberOfStatisticEntries = 20;
+    runCommand("$9\r\n");
+    std::string dump;
+    for (const auto& tx : g_socketTx) {
+        dump += tx;
+    }
+    CHECK(g_socketTx.size() == 2);
+    CHECK(dump.length() == sizeof("$CAN STATS\r\n") - 1 + 8 + 20 * 20);
+
+    runCommand("$:1\r\n");
+    CHECK(g_isRecording);
+    CHECK(g_socketTx.size() == 1);
+    CHECK(g_socketTx[0] == "$REC record\r\n");
+
+    runCommand("$:r\r\n");
+    CHECK(g_socketTx.size() == 1);
+    CHECK(g_socketTx[0] == "$REC busy\r\n");
+
+    runCommand("$:\r\n");
+    CHECK(g_socketTx.size() == 1);
+    CHECK(g_socketTx[0] == "$REC 2 100 frames 0 dropped 1400/131072 byte\r\n");
+
+    runCommand("$:0\r\n");
+    CHECK(!g_isRecording);
+    CHECK(g_socketTx.size() == 1);
+    CHECK(g_socketTx[0] == "$REC stop\r\n");
+
+    TestCaseEnd();
+}
+
+int ut_BinaryCommands(void)
+{
+    TestCaseBegin();
+
+    const uint8_t check[] = "123456789";
+    CHECK(app::CommandMultiplexer::crc16(check, 9) == 0x29b1);
+
+    auto socket = std::make_shared<SocketEmulation>();
+    app::DemoExecuter demo(getCanController());
+    app::CommandMultiplexer multiplexer(socket, socket, getCanController(), demo);
+    auto runCommand = [&](const std::string& input){
+                          queueCommand(input);
+                          multiplexer.commandMultiplexerTaskFunction(true);
+                      };
+    std::string payload;
+
+    // frames which are received in pieces are completed
+    for (size_t chunk = 1; chunk <= 8; chunk++) {
+        g_maxReceiveChunk = chunk;
+        g_canOn = false;
+        runCommand(binaryFrame(2, chunk, ""));
+        CHECK(g_canOn);
+        CHECK(g_socketTx.size() == 1);
+        CHECK(checkReplyFrame(g_socketTx[0], 0x82, chunk, payload));
+        CHECK(payload == "$CAN ON\r\n");
+    }
+    g_maxReceiveChunk = 64;
+
+    // a frame which is received together with the previous one is the next command
+    runCommand(binaryFrame(2, 1, "") + binaryFrame(3, 2, ""));
+    CHECK(g_canOn);
+    CHECK(g_socketRx.empty());
+    CHECK(g_socketTx.size() == 1);
+    CHECK(checkReplyFrame(g_socketTx[0], 0x82, 1, payload));
+    g_socketTx.clear();
+    multiplexer.commandMultiplexerTaskFunction(true);
+    CHECK(!g_canOn);
+    CHECK(g_socketTx.size() == 1);
+    CHECK(checkReplyFrame(g_socketTx[0], 0x83, 2, payload));
+    CHECK(payload == "$CAN OFF\r\n");
+
+    // long replies are split into frames with the same sequence number
+    g_numberOfStatisticEntries = 64;
+    runCommand(binaryFrame(9, 0xa5, "2"));
+    CHECK(g_socketTx.size() == 6);
+
+    std::string dump;
+    for (const auto& tx : g_socketTx) {
+        CHECK(checkReplyFrame(tx, 0x89, 0xa5, payload));
+        dump += payload;
+    }
+    CHECK(dump.length() == sizeof("$CAN STATS\r\n") - 1 + 8 + 64 * 20);
+
+    TestCaseEnd();
+}
+
+int ut_BinaryFrameErrors(void)
+{
+    TestCaseBegin();
+
+    auto socket = std::make_shared<SocketEmulation>();
+    app::DemoExecuter demo(getCanController());
+    app::CommandMultiplexer multiplexer(socket, socket, getCanController(), demo);
+    auto runCommand = [&](const std::string& input){
+                          queueCommand(input);
+                          multiplexer.commandMultiplexerTaskFunction(true);
+                      };
+    std::string payload;
+
+    // corrupted CRC
+    g_canOn = false;
+    std::string frame = binaryFrame(2, 7, "");
+    frame[5] ^= 0x01;
+    runCommand(frame);
+    CHECK(!g_canOn);
+    CHECK(g_socketTx.size() == 1);
+    CHECK(checkReplyFrame(g_socketTx[0], 0xff, 7, payload));
+    CHECK(payload.empty());
+
+    // unknown opcode
+    runCommand(binaryFrame(0x42, 8, ""));
+    CHECK(g_socketTx.size() == 1);
+    CHECK(checkReplyFrame(g_socketTx[0], 0xff, 8, payload));
+
+    // longer than the command buffer
+    runCommand(binaryFrame(2, 9, std::string(200, 'x')));
+    CHECK(!g_canOn);
+    CHECK(g_socketTx.empty());
+    g_socketRx.clear();
+
+    // incomplete frame
+    frame = binaryFrame(2, 10, "");
+    runCommand(frame.substr(0, frame.length() - 1));
+    CHECK(!g_canOn);
+    CHECK(g_socketTx.empty());
+
+    TestCaseEnd();
+}
+
+int ut_CommandLatency(void)
+{
+    TestCaseBegin();
+
+    static constexpr size_t NUMBER_OF_COMMANDS = 10000;
+
+    auto socket = std::make_shared<SocketEmulation>();
+    app::DemoExecuter demo(getCanController());
+    app::CommandMultiplexer multiplexer(socket, socket, getCanController(), demo);
+    auto runCommand = [&](const std::string& input){
+                          queueCommand(input);
+                          multiplexer.commandMultiplexerTaskFunction(true);
+                      };
+
+    struct Scenario {
+        const char* name;
+        std::string command;
+        size_t entries;
+    };
+
+    const std::array<Scenario, 4> scenarios = {{
+        {"ASCII  CAN_ON      ", "$2\r\n", 0},
+        {"binary CAN_ON      ", binaryFrame(2, 1, ""), 0},
+        {"ASCII  stats dump  ", "$9\r\n", 20},
+        {"binary stats dump  ", binaryFrame(9, 1, "2"), 20}
+    }};
+
+    printf("%s: command handling on the host, AT writes and modem link time per reply (%d baud)\n",
+           __FUNCTION__, (int)MODEM_BAUDRATE);
+
+    for (const auto& scenario : scenarios) {
+        g_numberOfStatisticEntries = scenario.entries;
+
+        const auto start = std::chrono::steady_clock::now();
+        size_t writes = 0;
+        uint64_t linkTimeUs = 0;
+        for (size_t i = 0; i < NUMBER_OF_COMMANDS; i++) {
+            const uint64_t simulatedStart = g_simulatedTimeUs;
+            runCommand(scenario.command);
+            writes += g_socketTx.size();
+            linkTimeUs += g_simulatedTimeUs - simulatedStart;
+        }
+        const auto hostNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                                                std::chrono::steady_clock::now() -
+                                                                                start).count() / NUMBER_OF_COMMANDS;
+
+        printf("    %s %6d ns | %d AT writes | %6d us\n", scenario.name, (int)hostNs,
+               (int)(writes / NUMBER_OF_COMMANDS), (int)(linkTimeUs / NUMBER_OF_COMMANDS));
+        CHECK(writes / NUMBER_OF_COMMANDS <= 2);
+    }
+
+    TestCaseEnd();
+}
+
+int ut_RemoteCodeUpdate(void)
+{
+    TestCaseBegin();
+
+    auto socket = std::make_shared<SocketEmulation>();
+    app::DemoExecuter demo(getCanController());
+    app::CommandMultiplexer multiplexer(socket, socket, getCanController(), demo);
+    auto runCommand = [&](const std::string& input){
+                          queueCommand(input);
+                          multiplexer.commandMultiplexerTaskFunction(true);
+                      };
+
+    const std::string image = randomImage(1000);
+
+    runCommand(binaryFrame(8, 0, ""));
+    CHECK(replyPayload() == "Run Remote Code!\r\n");
+
+    // invalid length
+    runCommand(remoteCodeBegin(image + "xx"));
+    CHECK(replyPayload() == "$RC ERROR 0\r\n");
+    runCommand(remoteCodeBegin(randomImage(1028)));
+    CHECK(replyPayload() == "$RC ERROR 0\r\n");
+
+    runCommand(remoteCodeBegin(image));
+    CHECK(replyPayload() == "$RC BEGIN 0\r\n");
+
+    // the old code must not run while it is overwritten
+    runCommand(binaryFrame(8, 0, ""));
+    CHECK(replyPayload() == "$RC INVALID\r\n");
+
+    // misaligned chunks are rejected
+    runCommand(remoteCodeData(image, 8, 32));
+    CHECK(replyPayload() == "$RC ERROR 0\r\n");
+    runCommand(remoteCodeData(image, 0, 40));
+    CHECK(replyPayload() == "$RC ERROR 0\r\n");
+
+    // chunks in random order
+    std::vector<uint16_t> offsets;
+    for (uint16_t offset = 0; offset < image.length(); offset += 112) {
+        offsets.push_back(offset);
+    }
+    std::shuffle(offsets.begin(), offsets.end(), std::mt19937(42));
+
+    for (size_t i = 0; i < offsets.size(); i++) {
+        runCommand(binaryFrame(7, 0, "C"));
+        CHECK(replyPayload().find("$RC INCOMPLETE") == 0);
+        runCommand(remoteCodeData(image, offsets[i], 112));
+        CHECK(replyPayload().find("$RC DATA") == 0);
+    }
+    CHECK(std::memcmp(_rce_start, image.data(), image.length()) == 0);
+
+    runCommand(binaryFrame(7, 0, "R"));
+    CHECK(replyPayload() == "$RC RESUME 1000\r\n");
+    runCommand(binaryFrame(7, 0, "C"));
+    CHECK(replyPayload() == "$RC COMMITTED 1000\r\n");
+    runCommand(binaryFrame(8, 0, ""));
+    CHECK(replyPayload().find("Run Remote Code!") == 0);
+
+    // a corrupted chunk is detected on commit
+    std::string corrupted = image;
+    corrupted[500] ^= 0x01;
+    runCommand(remoteCodeBegin(image));
+    for (uint16_t offset = 0; offset < image.length(); offset += 112) {
+        runCommand(remoteCodeData(corrupted, offset, 112));
+    }
+    runCommand(binaryFrame(7, 0, "C"));
+    CHECK(replyPayload() == "$RC CRC ERROR 1000\r\n");
+    runCommand(binaryFrame(8, 0, ""));
+    CHECK(replyPayload() == "$RC INVALID\r\n");
+
+    TestCaseEnd();
+}
+
+int ut_RemoteCodeUpdateResume(void)
+{
+    TestCaseBegin();
+
+    auto socket = std::make_shared<SocketEmulation>();
+    app::DemoExecuter demo(getCanController());
+    app::CommandMultiplexer multiplexer(socket, socket, getCanController(), demo);
+    auto runCommand = [&](const std::string& input){
+                          queueCommand(input);
+                          multiplexer.commandMultiplexerTaskFunction(true);
+                      };
+
+    const std::string image = randomImage(RCE_SIZE);
+
+    auto transfer = [&](const size_t from, const size_t to, const size_t chunk){
+                        for (size_t offset = from; offset < to; offset += chunk) {
+                            runCommand(remoteCodeData(image, offset, std::min(chunk, to - offset)));
+                        }
+                    };
+
+    printf("%s: %d byte image over the modem emulation (%d baud)\n", __FUNCTION__, (int)RCE_SIZE,
+           (int)MODEM_BAUDRATE);
+
+    for (const size_t chunk : {16, 48, 112}) {
+        const uint64_t start = g_simulatedTimeUs;
+        runCommand(remoteCodeBegin(image));
+        transfer(0, image.length(), chunk);
+        runCommand(binaryFrame(7, 0, "C"));
+        CHECK(replyPayload() == "$RC COMMITTED 1024\r\n");
+        const uint64_t duration = g_simulatedTimeUs - start;
+        printf("    %3d byte chunks: %6d ms, %5d byte/s\n", (int)chunk, (int)(duration / 1000),
+               (int)(image.length() * 1000000 / duration));
+    }
+
+    // connection drops after 70% of the image, the rest is resumed
+    uint64_t start = g_simulatedTimeUs;
+    runCommand(remoteCodeBegin(image));
+    transfer(0, 720, 112);
+    const uint64_t dropped = g_simulatedTimeUs - start;
+
+    start = g_simulatedTimeUs;
+    runCommand(binaryFrame(7, 0, "R"));
+    CHECK(replyPayload() == "$RC RESUME 720\r\n");
+    transfer(720, image.length(), 112);
+    runCommand(binaryFrame(7, 0, "C"));
+    CHECK(replyPayload() == "$RC COMMITTED 1024\r\n");
+    const uint64_t resumed = g_simulatedTimeUs - start;
+
+    start = g_simulatedTimeUs;
+    runCommand(remoteCodeBegin(image));
+    transfer(0, image.length(), 112);
+    runCommand(binaryFrame(7, 0, "C"));
+    CHECK(replyPayload() == "$RC COMMITTED 1024\r\n");
+    const uint64_t restarted = g_simulatedTimeUs - start;
+
+    printf("    after a drop at 720 byte: resume %d ms, restart %d ms (%d ms lost before the drop)\n",
+           (int)(resumed / 1000), (int)(restarted / 1000), (int)(dropped / 1000));
+    CHECK(resumed < restarted);
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_AsciiCommands);
+    RunTest(true, ut_BinaryCommands);
+    RunTest(true, ut_BinaryFrameErrors);
+    RunTest(true, ut_CommandLatency);
+    RunTest(true, ut_RemoteCodeUpdate);
+    RunTest(true, ut_RemoteCodeUpdateResume);
+    UnitTestMainEnd();
+}
@@ -5,12 +5,28 @@
 
 #pragma once
 
+#include <array>
+#include <cstring>
 #include "TaskInterruptable.h"
 #include "DeepSleepInterface.h"
 #include "UsartWithDma.h"
+#include "Cobs.h"
+#include "TxRateController.h"
+#include "LinkQuality.h"
+#include "ClockSync.h"
 
 namespace app
 {
+/**
+ * Exchanges DTOs over a UART. Frames are COBS encoded and delimited by a zero,
+ * so the receiver is in sync again with the next frame after bytes were lost.
+ * The receiver runs a circular DMA and decodes the frames as soon as the line
+ * gets idle. A sequence number precedes the DTO in every frame, so the
+ * receiver can count the frames which got lost on the way. Every SYNC_INTERVAL
+ * frames a ClockSync header follows it, flagged in the highest bit of the
+ * sequence number, from which both sides estimate the clock of the other one.
+ * The TxRateController decides when the transmit task sends, by default every 10 ms.
+ */
 template<typename rxDto, typename txDto>
 struct Communication final :
     private os::DeepSleepModule {
@@ -19,17 +35,40 @@ struct Communication final :
         OFFSET_ERROR,
         UPDATE_ERROR,
         NO_COMMUNICATION_ERROR,
-        TX_ERROR
+        TX_ERROR,
+        SCHEMA_ERROR
+    };
+
+    struct Statistics {
+        com::TxRateController::Statistics tx;
+        com::LinkStatistics rx;
+        com::ClockSync::Statistics sync;
     };
 
+    static constexpr uint8_t SYNC_INTERVAL = 8;
+
     Communication(const hal::UsartWithDma& interface, rxDto&, txDto&,
-                  std::function<void(ErrorCode)> errorCallback = nullptr);
+                  std::function<void(ErrorCode)> errorCallback = nullptr,
+                  com::TxRateController rateController = com::TxRateController());
 
     Communication(const Communication&) = delete;
     Communication(Communication&&) = default;
     Communication& operator=(const Communication&) = delete;
     Communication& operator=(Communication&&) = delete;
 
+    Statistics getStatistics(void) const;
+
+    // Kept up to date by the receive task, so a DTO can reference and send it
+    com::LinkStatistics& getLinkStatistics(void);
+
+    void traceLinkStatistics(void) const;
+
+    // Offset and drift of the clock of the other side, e.g. to map its timestamps to os::Task::getMicroseconds()
+    inline const com::ClockSync& getClockSync(void) const
+    {
+        return mClockSync;
+    }
+
 #ifdef UNITTEST
     void triggerRxTaskExecution(void) { this->RxTaskFunction(true); }
     void triggerTxTaskExecution(void) { this->TxTaskFunction(true); }
@@ -38,30 +77,53 @@ struct Communication final :
 private:
     virtual void enterDeepSleep(void) override;
     virtual void exitDeepSleep(void) override;
+    // The DMA doesn't receive in stop mode
+    virtual bool isStopModeAllowed(void) const override {return false;}
 
     static constexpr uint32_t STACKSIZE = 1024;
+    static constexpr size_t RECEIVE_TIMEOUT_BITS = 10;
+    static constexpr uint32_t NO_COMMUNICATION_TIMEOUT = 30;
 
     const hal::UsartWithDma& mInterface;
     rxDto& mRxDto;
     txDto& mTxDto;
     std::function<void(ErrorCode)> mErrorCallback;
+    com::TxRateController mRateController;
+
+    static constexpr size_t SEQUENCE_SIZE = sizeof(uint8_t);
+    static constexpr uint8_t SYNC_FLAG = 0x80;
+    static constexpr size_t HEADER_SIZE = SEQUENCE_SIZE + com::ClockSync::HEADER_SIZE;
+
+    std::array<uint8_t, 2 * com::Cobs::encodedLength(HEADER_SIZE + rxDto::capacity())> mRxBuffer;
+    std::array<uint8_t, HEADER_SIZE + rxDto::capacity()> mRxFrame;
+    std::array<uint8_t, com::Cobs::encodedLength(HEADER_SIZE + txDto::capacity())> mTxFrame;
+    com::CobsDecoder mDecoder;
+    com::LinkQuality mLinkQuality;
+    com::ClockSync mClockSync;
+    size_t mRxPosition = 0;
+    uint32_t mLastRxTick = 0;
+    uint8_t mTxSequence = 0;
 
     os::TaskInterruptable mTxTask;
     os::TaskInterruptable mRxTask;
 
     void TxTaskFunction(const bool&);
     void RxTaskFunction(const bool&);
+    void handleFrame(void);
 };
 }
 
 template<typename rxDto, typename txDto>
 app::Communication<rxDto, txDto>::Communication(const hal::UsartWithDma& interface, rxDto& rx_dto, txDto& tx_dto,
-                                                std::function<void(ErrorCode)> errorCallback) :
+                                                std::function<void(ErrorCode)> errorCallback,
+                                                com::TxRateController rateController) :
     os::DeepSleepModule(),
         mInterface(interface),
     mRxDto(rx_dto),
     mTxDto(tx_dto),
     mErrorCallback(errorCallback),
+    mRateController(rateController),
+    mDecoder(mRxFrame.data(), mRxFrame.size()),
     mTxTask("4ComTx",
             Communication::STACKSIZE,
             os::Task::Priority::VERY_HIGH,
@@ -89,60 +151,141 @@ void app::Communication<rxDto, txDto>::enterDeepSleep(void)
 template<typename rxDto, typename txDto>
 void app::Communication<rxDto, txDto>::exitDeepSleep(void)
 {
+    // The values didn't age while sleeping
+    mLinkQuality.restart(os::Task::getTickCount());
     mRxTask.start();
     mTxTask.start();
 }
 
+template<typename rxDto, typename txDto>
+typename app::Communication<rxDto, txDto>::Statistics app::Communication<rxDto, txDto>::getStatistics(void) const
+{
+    return Statistics {
+               mRateController.getStatistics(os::Task::getTickCount()),
+               mLinkQuality.statistics(),
+               mClockSync.getStatistics()
+    };
+}
+
+template<typename rxDto, typename txDto>
+com::LinkStatistics& app::Communication<rxDto, txDto>::getLinkStatistics(void)
+{
+    return mLinkQuality.statistics();
+}
+
+template<typename rxDto, typename txDto>
+void app::Communication<rxDto, txDto>::traceLinkStatistics(void) const
+{
+    mLinkQuality.trace();
+}
+
 template<typename rxDto, typename txDto>
 void app::Communication<rxDto, txDto>::TxTaskFunction(const bool& join)
 {
     do {
+        if (!mRateController.isTransmissionDue(os::Task::getTickCount())) {
+            os::ThisTask::sleep(std::chrono::milliseconds(mRateController.pollPeriod()));
+            continue;
+        }
+
         mTxDto.prepareForTx();
+        const uint8_t sequence = mTxSequence++ & com::LinkQuality::SEQUENCE_MASK;
+        const bool hasSyncHeader = (sequence % SYNC_INTERVAL) == 0;
+        uint8_t syncHeader[com::ClockSync::HEADER_SIZE];
+        mClockSync.transmitting(sequence, hasSyncHeader ? syncHeader : nullptr, os::Task::getMicroseconds());
+
+        com::CobsEncoder encoder(mTxFrame.data());
+        encoder.push(hasSyncHeader ? sequence | SYNC_FLAG : sequence);
+        if (hasSyncHeader) {
+            encoder.push(syncHeader, sizeof(syncHeader));
+        }
+        encoder.push(mTxDto.data(), mTxDto.length());
+        const size_t length = encoder.finish();
 
         constexpr uint32_t ticksToWaitForTx = 30;
-        const auto bytesTransmitted = mInterface.send(mTxDto.data(),
-                                                      mTxDto.length(),
-                                                      ticksToWaitForTx);
+        const auto bytesTransmitted = mInterface.send(mTxFrame.data(), length, ticksToWaitForTx);
 
-        if (bytesTransmitted != mTxDto.length()) {
+        if (bytesTransmitted != length) {
             if (mErrorCallback) {
                 mErrorCallback(ErrorCode::TX_ERROR);
             }
         }
-        os::ThisTask::sleep(std::chrono::milliseconds(10));
+        mRateController.transmitted(os::Task::getTickCount(), bytesTransmitted);
+        os::ThisTask::sleep(std::chrono::milliseconds(mRateController.pollPeriod()));
     } while (!join);
 }
 
 template<typename rxDto, typename txDto>
 void app::Communication<rxDto, txDto>::RxTaskFunction(const bool& join)
 {
-    mInterface.enableReceiveTimeout(10);
+    mInterface.startCircularReceive(mRxBuffer.data(), mRxBuffer.size(), RECEIVE_TIMEOUT_BITS);
+    mRxPosition = 0;
+    mLastRxTick = os::Task::getTickCount();
 
     do {
-        os::ThisTask::sleep(std::chrono::milliseconds(9));
-
-        constexpr uint32_t ticksToWaitForRx = 30;
+        const size_t position = mInterface.waitForCircularReceive(mRxBuffer.size(), NO_COMMUNICATION_TIMEOUT);
+        mLinkQuality.update(os::Task::getTickCount());
 
-        const auto bytesReceived = mInterface.receiveWithTimeout(mRxDto.data(),
-                                                                 mRxDto.length(),
-                                                                 ticksToWaitForRx);
-
-        if (bytesReceived != mRxDto.length()) {
-            if (mErrorCallback) {
+        if (position == mRxPosition) {
+            if ((os::Task::getTickCount() - mLastRxTick >= NO_COMMUNICATION_TIMEOUT) && mErrorCallback) {
                 mErrorCallback(ErrorCode::NO_COMMUNICATION_ERROR);
             }
             continue;
         }
+        mLastRxTick = os::Task::getTickCount();
 
-        if (!mRxDto.isValid()) {
-            if (mErrorCallback) {
-                mErrorCallback(ErrorCode::CRC_ERROR);
+        for ( ; mRxPosition != position; mRxPosition = (mRxPosition + 1) % mRxBuffer.size()) {
+            if (mDecoder.push(mRxBuffer[mRxPosition])) {
+                handleFrame();
             }
-            continue;
         }
-
-        mRxDto.updateTuple();
     } while (!join);
 
-    mInterface.disableReceiveTimeout();
+    mInterface.stopCircularReceive();
+}
+
+template<typename rxDto, typename txDto>
+void app::Communication<rxDto, txDto>::handleFrame(void)
+{
+    if (!mDecoder.isValid()) {
+        mLinkQuality.resync();
+        if (mErrorCallback) {
+            mErrorCallback(ErrorCode::OFFSET_ERROR);
+        }
+        return;
+    }
+
+    const bool hasSyncHeader = (mDecoder.length() >= SEQUENCE_SIZE) && (mRxFrame[0] & SYNC_FLAG);
+    const size_t headerSize = hasSyncHeader ? HEADER_SIZE : SEQUENCE_SIZE;
+    const size_t length = mDecoder.length() - headerSize;
+    if ((mDecoder.length() < headerSize) || !mRxDto.isComplete(length)) {
+        mLinkQuality.lengthError();
+        if (mErrorCallback) {
+            mErrorCallback(ErrorCode::OFFSET_ERROR);
+        }
+        return;
+    }
+    std::memcpy(mRxDto.data(), mRxFrame.data() + headerSize, length);
+
+    if (!mRxDto.isValid()) {
+        mLinkQuality.crcError();
+        if (mErrorCallback) {
+            mErrorCallback(ErrorCode::CRC_ERROR);
+        }
+        return;
+    }
+
+    if (!mRxDto.hasMatchingSchema()) {
+        mLinkQuality.schemaError();
+        if (mErrorCallback) {
+            mErrorCallback(ErrorCode::SCHEMA_ERROR);
+        }
+        return;
+    }
+
+    mRxDto.updateTuple();
+    const uint8_t sequence = mRxFrame[0] & com::LinkQuality::SEQUENCE_MASK;
+    mLinkQuality.goodFrame(os::Task::getTickCount(), sequence);
+    mClockSync.received(sequence, hasSyncHeader ? mRxFrame.data() + SEQUENCE_SIZE : nullptr,
+                        os::Task::getMicroseconds(), com::Cobs::encodedLength(mDecoder.length()));
 }
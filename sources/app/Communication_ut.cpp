@@ -4,30 +4,50 @@
  */
 
 #include <cmath>
-#include <thread>
+#include <deque>
 #include <iostream>
 #include <cstring>
+#include <limits>
 #include "unittest.h"
 #include "Communication.h"
 #include "DataTransferObject.h"
-
-#define NUM_TEST_LOOPS 255
+#include "Deadband.h"
 
 //--------------------------BUFFERS--------------------------
-uint32_t g_currentTickCount;
 bool g_taskJoined, g_taskStarted;
-uint8_t g_crc;
-std::thread::id g_masterThreadId, g_slaveThreadId;
-static constexpr size_t MEMORYSIZE = 255;
-uint8_t g_masterRxMemroy[MEMORYSIZE], g_slaveRxMemory[MEMORYSIZE];
 bool g_comError = false;
 
+// Simulated time in ns, the UART transfers one byte in 10 bit times at 115200 baud
+static constexpr uint64_t NS_PER_MS = 1000000;
+static constexpr uint64_t BITTIME = 1000000000 / 115200;
+static constexpr uint64_t BYTETIME = 10 * BITTIME;
+// The receiver wakes up 10 bit times after the last byte
+static constexpr uint64_t RECEIVE_TIMEOUT_US = 10 * BITTIME / 1000;
+uint64_t g_now;
+
+// One direction of the serial link. The transmitter is called periodically while the receiver waits.
+struct Link {
+    std::deque<std::pair<uint64_t, uint8_t> > inFlight;
+    uint64_t lineFree = 0;
+    size_t bytesSent = 0;
+    size_t dropByte = std::numeric_limits<size_t>::max();
+    size_t corruptByte = std::numeric_limits<size_t>::max();
+
+    uint8_t* ring = nullptr;
+    size_t ringSize = 0;
+    size_t writePosition = 0;
+    size_t timeoutBits = 0;
+
+    std::function<void(void)> transmitter;
+    uint64_t nextTransmission = 0;
+    uint64_t period = 10 * NS_PER_MS;
+} g_link;
+
 //--------------------------MOCKING--------------------------
 constexpr const std::array<const hal::Crc, hal::Crc::__ENUM__SIZE> hal::Factory<hal::Crc>::Container;
 constexpr const std::array<const hal::Usart, hal::Usart::__ENUM__SIZE + 1> hal::Factory<hal::Usart>::Container;
 constexpr const std::array<const hal::Dma, hal::Dma::__ENUM__SIZE + 1> hal::Factory<hal::Dma>::Container;
-constexpr const std::array<const hal::UsartWithDma,
-                           hal::Usart::__ENUM__SIZE> hal::Factory<hal::UsartWithDma>::Container;
+constexpr const std::array<const hal::UsartWithDma, 1> hal::Factory<hal::UsartWithDma>::Container;
 
 void os::TaskInterruptable::join(void)
 {
@@ -58,64 +78,202 @@ void os::ThisTask::sleep(const std::chrono::milliseconds ms) {}
 
 uint32_t os::Task::getTickCount(void)
 {
-    return g_currentTickCount;
+    return g_now / NS_PER_MS;
+}
+
+uint32_t os::Task::getMicroseconds(void)
+{
+    return g_now / 1000;
 }
 
+// The software CRC of the unit, a frame with its CRC appended results in 0
 uint8_t hal::Crc::getCrc(uint8_t const* const data, const size_t length) const
 {
-    return g_crc;
+    return mSoftwareCrc.calculate(static_cast<uint8_t>(mInitialValue), data, length);
 }
 
 size_t hal::UsartWithDma::send(uint8_t const* const data, const size_t length, const uint32_t ticksToWait) const
 {
-    if (std::this_thread::get_id() == g_masterThreadId) {
-        std::memcpy(g_slaveRxMemory, data, length);
-    } else {
-        std::memcpy(g_masterRxMemroy, data, length);
+    if (g_comError) {
+        return 0;
     }
-    return g_comError ? 0 : length;
-}
 
-size_t hal::UsartWithDma::receive(uint8_t* const data, const size_t length, const uint32_t ticksToWait) const
-{
-    if (std::this_thread::get_id() == g_slaveThreadId) {
-        std::memcpy(data, g_slaveRxMemory, length);
-    } else {
-        std::memcpy(data, g_masterRxMemroy, length);
+    const uint64_t start = std::max(g_now, g_link.lineFree);
+    for (size_t i = 0; i < length; i++) {
+        const size_t index = g_link.bytesSent++;
+        if (index != g_link.dropByte) {
+            g_link.inFlight.emplace_back(start + (i + 1) * BYTETIME,
+                                         index == g_link.corruptByte ? data[i] ^ 0x10 : data[i]);
+        }
     }
-    return g_comError ? 0 : length;
+    g_link.lineFree = start + length * BYTETIME;
+    return length;
 }
 
-void hal::UsartWithDma::enableReceiveTimeout(const size_t) const {}
+void hal::UsartWithDma::startCircularReceive(uint8_t* const data, const size_t length, const size_t bits) const
+{
+    g_link.ring = data;
+    g_link.ringSize = length;
+    g_link.writePosition = 0;
+    g_link.timeoutBits = bits;
+}
 
-size_t hal::UsartWithDma::receiveWithTimeout(uint8_t* const data, const size_t length,
-                                             const uint32_t ticksToWait) const
+size_t hal::UsartWithDma::waitForCircularReceive(const size_t length, const uint32_t ticksToWait) const
 {
-    return receive(data, length, ticksToWait);
+    const uint64_t deadline = g_now + ticksToWait * NS_PER_MS;
+
+    for ( ; ; ) {
+        // The receiver wakes up when the line gets idle, or at the half and at the end of the ring
+        uint64_t event = std::numeric_limits<uint64_t>::max();
+        size_t position = g_link.writePosition;
+        for (size_t i = 0; i < g_link.inFlight.size(); i++) {
+            const uint64_t arrival = g_link.inFlight[i].first;
+            position = (position + 1) % length;
+            if ((position == 0) || (position == length / 2)) {
+                event = arrival;
+                break;
+            }
+            if ((i + 1 == g_link.inFlight.size()) || (g_link.inFlight[i + 1].first - arrival > BYTETIME)) {
+                event = arrival + g_link.timeoutBits * BITTIME;
+                break;
+            }
+        }
+
+        const uint64_t wakeup = std::max(g_now, std::min(event, deadline));
+        if (g_link.transmitter && (g_link.nextTransmission <= wakeup)) {
+            g_now = std::max(g_now, g_link.nextTransmission);
+            g_link.nextTransmission += g_link.period;
+            g_link.transmitter();
+            continue;
+        }
+
+        g_now = wakeup;
+        while (!g_link.inFlight.empty() && (g_link.inFlight.front().first <= g_now)) {
+            g_link.ring[g_link.writePosition] = g_link.inFlight.front().second;
+            g_link.writePosition = (g_link.writePosition + 1) % length;
+            g_link.inFlight.pop_front();
+        }
+        return g_link.writePosition;
+    }
 }
 
-void hal::UsartWithDma::disableReceiveTimeout() const {}
+void hal::UsartWithDma::stopCircularReceive(void) const {}
 
 void os::ThisTask::enterCriticalSection() {}
 
 void os::ThisTask::exitCriticalSection() {}
 
+//--------------------------HELPERS--------------------------
+// Frames with a sequence number divisible by 8 carry the ClockSync header
+template<typename Dto>
+static size_t frameLength(const Dto& dto, const size_t frame)
+{
+    const size_t syncHeader = ((frame & 0x7f) % 8 == 0) ? com::ClockSync::HEADER_SIZE : 0;
+    return com::Cobs::encodedLength(1 + syncHeader + dto.length());
+}
+
+static void resetLink(void)
+{
+    g_now = 0;
+    g_comError = false;
+    g_link.inFlight.clear();
+    g_link.lineFree = 0;
+    g_link.bytesSent = 0;
+    g_link.dropByte = std::numeric_limits<size_t>::max();
+    g_link.corruptByte = std::numeric_limits<size_t>::max();
+    g_link.transmitter = nullptr;
+    g_link.nextTransmission = 0;
+    g_link.period = 10 * NS_PER_MS;
+}
+
+struct RideResult {
+    com::TxRateController::Statistics tx;
+    uint32_t maxRxStaleness;
+    uint64_t maxStepLatency;
+};
+
+/**
+ * 20 s of a motor current which steps every second and is noisy in between,
+ * and of a slowly rising speed, sent from the slave to the master.
+ */
+static RideResult simulateRide(const uint32_t minPeriod, const uint32_t maxPeriod, const bool useDeadband)
+{
+    static constexpr float NOISE = 0.1f;
+    float current = 0, speed = 0, rxCurrent = 0, rxSpeed = 0, unused = 0;
+
+    auto txDto = com::make_dto(current, speed);
+    auto rxDto = com::make_dto(rxCurrent, rxSpeed);
+    auto unusedDto = com::make_dto(unused);
+    auto deadband = com::make_deadband(std::tie(current, speed), std::make_tuple(5 * NOISE, 1.0f));
+
+    app::Communication<decltype(rxDto), decltype(unusedDto)> masterCom(hal::Factory<hal::UsartWithDma>::get<hal::
+                                                                                                            Usart::
+                                                                                                            MSCOM_IF>(),
+                                                                       rxDto,
+                                                                       unusedDto);
+    app::Communication<decltype(unusedDto), decltype(txDto)> slaveCom(hal::Factory<hal::UsartWithDma>::get<hal::
+                                                                                                           Usart::
+                                                                                                           MSCOM_IF>(),
+                                                                      unusedDto,
+                                                                      txDto,
+                                                                      nullptr,
+                                                                      com::TxRateController(minPeriod, maxPeriod,
+                                                                                            useDeadband ? &deadband :
+                                                                                            nullptr));
+
+    resetLink();
+    g_link.period = minPeriod * NS_PER_MS;
+
+    uint32_t seed = 1;
+    float level = 0;
+    uint64_t stepTime = 1003 * NS_PER_MS;
+    bool isStepPending = false;
+    g_link.transmitter = [&] {
+                             const uint64_t ms = g_now / NS_PER_MS;
+                             seed = seed * 1103515245 + 12345;
+                             // The steps aren't aligned to the transmit task
+                             if (!isStepPending && (g_now >= stepTime)) {
+                                 const float step = ((seed >> 16) % 4) + 1.0f;
+                                 level += (seed & 0x80000000) ? step : -step;
+                                 isStepPending = true;
+                             }
+                             current = level + NOISE * (((seed >> 8) % 201) / 100.0f - 1.0f);
+                             speed = ms * 0.001f;
+                             slaveCom.triggerTxTaskExecution();
+                         };
+
+    RideResult result {};
+    while (g_now < 20000 * NS_PER_MS) {
+        masterCom.triggerRxTaskExecution();
+        if (isStepPending && (std::abs(rxCurrent - level) <= NOISE)) {
+            result.maxStepLatency = std::max(result.maxStepLatency, g_now - stepTime);
+            stepTime += 1003 * NS_PER_MS;
+            isStepPending = false;
+        }
+    }
+
+    result.tx = slaveCom.getStatistics().tx;
+    result.maxRxStaleness = masterCom.getStatistics().rx.maxGoodFrameAge;
+    return result;
+}
+
 //-------------------------TESTCASES-------------------------
 
 int ut_CrcError(void)
 {
     TestCaseBegin();
 
-    g_crc = 0x00;
-    g_currentTickCount = 0;
-    g_comError = false;
+    resetLink();
 
-    auto crcError = false;
+    size_t crcErrors = 0;
+    size_t offsetErrors = 0;
 
-    uint32_t a, b;
+    uint32_t a = 0, b = 0, slaveA = 0x11111111, slaveB = 0;
 
     auto rxDto = com::make_dto(a);
     auto txDto = com::make_dto(b);
+    auto slaveRxDto = com::make_dto(slaveB);
+    auto slaveTxDto = com::make_dto(slaveA);
 
     app::Communication<decltype(rxDto), decltype(txDto)> masterCom(hal::Factory<hal::UsartWithDma>::get<hal::Usart::
                                                                                                         MSCOM_IF>(),
@@ -126,47 +284,96 @@ int ut_CrcError(void)
                                                                    if (error ==
                                                                        decltype(masterCom) ::ErrorCode::CRC_ERROR)
                                                                    {
-                                                                       crcError = true;
+                                                                       crcErrors++;
+                                                                   }
+                                                                   if (error ==
+                                                                       decltype(masterCom) ::ErrorCode::OFFSET_ERROR)
+                                                                   {
+                                                                       offsetErrors++;
                                                                    }
         });
-    app::Communication<decltype(txDto), decltype(rxDto)> slaveCom(hal::Factory<hal::UsartWithDma>::get<hal::Usart::
-                                                                                                       MSCOM_IF>(),
-                                                                  txDto,
-                                                                  rxDto);
-
-    std::thread masterThread([&] {
-                             g_masterThreadId = std::this_thread::get_id();
+    app::Communication<decltype(slaveRxDto), decltype(slaveTxDto)> slaveCom(hal::Factory<hal::UsartWithDma>::get<hal::
+                                                                                                                 Usart::
+                                                                                                                 MSCOM_IF>(),
+                                                                            slaveRxDto,
+                                                                            slaveTxDto);
+
+    size_t frames = 0;
+    g_link.transmitter = [&] {
+                             slaveA++;
+                             frames++;
+                             slaveCom.triggerTxTaskExecution();
+                         };
+
+    for (size_t i = 0; i < 10; i++) {
+        masterCom.triggerRxTaskExecution();
+    }
+    CHECK(crcErrors == 0);
+    CHECK(offsetErrors == 0);
+    CHECK(a == slaveA);
+
+    // COBS shifts the frame {sequence, sync header, timestamp, a, schema, crc} by one byte, a has no zeros
+    const size_t syncHeader = frameLength(slaveTxDto, frames) - frameLength(slaveTxDto, frames + 1);
+    g_link.corruptByte = g_link.bytesSent + 1 + sizeof(uint8_t) + syncHeader + sizeof(uint32_t);
+    for (size_t i = 0; i < 10; i++) {
+        masterCom.triggerRxTaskExecution();
+    }
+    CHECK(crcErrors == 1);
+    CHECK(offsetErrors == 0);
+    CHECK(a == slaveA);
 
-                             for (size_t i = 0; i < 100; i++) {
-                                 masterCom.triggerTxTaskExecution();
-                                 masterCom.triggerRxTaskExecution();
-                                 std::this_thread::yield();
-                                 std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                             }
-        });
-    std::thread slaveThread([&] {
-                            g_slaveThreadId = std::this_thread::get_id();
-
-                            for (size_t i = 0; i < 100; i++) {
-                                slaveCom.triggerTxTaskExecution();
-                                slaveCom.triggerRxTaskExecution();
-                                std::this_thread::yield();
-                                std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                            }
-        });
+    const auto statistics = masterCom.getStatistics().rx;
+    CHECK(statistics.crcErrors == 1);
+    CHECK(statistics.sequenceGaps == 1);
+    CHECK(statistics.framesOk == frames - 1);
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    TestCaseEnd();
+}
 
-    CHECK(crcError == false);
+int ut_SchemaError(void)
+{
+    TestCaseBegin();
 
-    g_crc = 0x11;
+    resetLink();
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    size_t schemaErrors = 0;
+    uint32_t a = 0, slaveA = 0x11111111;
+    uint16_t b = 0, slaveB = 0x2222, unused = 0;
 
-    CHECK(crcError == true);
+    // The slave was built with the members in another order
+    auto rxDto = com::make_dto(a, b);
+    auto txDto = com::make_dto(unused);
+    auto slaveRxDto = com::make_dto(unused);
+    auto slaveTxDto = com::make_dto(slaveB, slaveA);
 
-    masterThread.join();
-    slaveThread.join();
+    app::Communication<decltype(rxDto), decltype(txDto)> masterCom(hal::Factory<hal::UsartWithDma>::get<hal::Usart::
+                                                                                                        MSCOM_IF>(),
+                                                                   rxDto,
+                                                                   txDto,
+                                                                   [&](auto error)
+        {
+                                                                   if (error ==
+                                                                       decltype(masterCom) ::ErrorCode::SCHEMA_ERROR)
+                                                                   {
+                                                                       schemaErrors++;
+                                                                   }
+        });
+    app::Communication<decltype(slaveRxDto), decltype(slaveTxDto)> slaveCom(hal::Factory<hal::UsartWithDma>::get<hal::
+                                                                                                                 Usart::
+                                                                                                                 MSCOM_IF>(),
+                                                                            slaveRxDto,
+                                                                            slaveTxDto);
+
+    g_link.transmitter = [&] {
+                             slaveCom.triggerTxTaskExecution();
+                         };
+
+    for (size_t i = 0; i < 10; i++) {
+        masterCom.triggerRxTaskExecution();
+    }
+    CHECK(schemaErrors > 0);
+    CHECK(a == 0);
+    CHECK(b == 0);
 
     TestCaseEnd();
 }
@@ -175,11 +382,7 @@ int ut_DeepSleep(void)
 {
     TestCaseBegin();
 
-    g_crc = 0;
-    g_currentTickCount = 0;
-    g_comError = false;
-    memset(g_masterRxMemroy, 0, MEMORYSIZE);
-    memset(g_slaveRxMemory, 0, MEMORYSIZE);
+    resetLink();
 
     CHECK(false == g_taskJoined);
     CHECK(false == g_taskStarted);
@@ -209,11 +412,7 @@ int ut_ValueExchange(void)
 {
     TestCaseBegin();
 
-    g_crc = 0;
-    g_currentTickCount = 0;
-    g_comError = false;
-
-    uint32_t mRx, mTx, sRx, sTx;
+    uint32_t mRx = 0, mTx = 0, sRx = 0, sTx = 0;
 
     auto masterRxDto = com::make_dto(mRx);
     auto masterTxDto = com::make_dto(mTx);
@@ -237,38 +436,295 @@ int ut_ValueExchange(void)
                                                                               slaveRxDto,
                                                                               slaveTxDto);
 
-    std::thread masterThread([&] {
-                             g_masterThreadId = std::this_thread::get_id();
+    // Both directions are simulated one after the other on the same link
+    resetLink();
+    g_link.transmitter = [&] {
+                             masterCom.triggerTxTaskExecution();
+                         };
+    for (uint32_t i = 0; i < 20; i++) {
+        mTx = i * 0x01010101;
+        slaveCom.triggerRxTaskExecution();
+        CHECK(sRx == mTx);
+    }
 
-                             for (size_t i = 0; i < 1000; i++) {
-                                 masterCom.triggerTxTaskExecution();
-                                 masterCom.triggerRxTaskExecution();
-                                 std::this_thread::yield();
-                                 std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                             }
-        });
-    std::thread slaveThread([&] {
-                            g_slaveThreadId = std::this_thread::get_id();
-
-                            for (size_t i = 0; i < 1000; i++) {
-                                slaveCom.triggerTxTaskExecution();
-                                slaveCom.triggerRxTaskExecution();
-                                std::this_thread::yield();
-                                std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                            }
+    resetLink();
+    g_link.transmitter = [&] {
+                             slaveCom.triggerTxTaskExecution();
+                         };
+    for (uint32_t i = 0; i < 20; i++) {
+        sTx = i << 8;
+        masterCom.triggerRxTaskExecution();
+        CHECK(mRx == sTx);
+    }
+
+    TestCaseEnd();
+}
+
+int ut_NoCommunication(void)
+{
+    TestCaseBegin();
+
+    resetLink();
+
+    size_t noCommunicationErrors = 0;
+    uint32_t a = 0, b = 0;
+
+    auto rxDto = com::make_dto(a);
+    auto txDto = com::make_dto(b);
+
+    app::Communication<decltype(rxDto), decltype(txDto)> masterCom(hal::Factory<hal::UsartWithDma>::get<hal::Usart::
+                                                                                                        MSCOM_IF>(),
+                                                                   rxDto,
+                                                                   txDto,
+                                                                   [&](auto error)
+        {
+                                                                   if (error ==
+                                                                       decltype(masterCom) ::ErrorCode::
+                                                                       NO_COMMUNICATION_ERROR)
+                                                                   {
+                                                                       noCommunicationErrors++;
+                                                                   }
         });
 
-    for (size_t i = 0; i < 20; i++) {
-        mTx = i;
-        sTx = i;
-        std::this_thread::sleep_for(std::chrono::milliseconds(3));
-        CHECK(mRx == i);
-        CHECK(sRx == i);
-        g_currentTickCount += 5;
+    masterCom.triggerRxTaskExecution();
+    CHECK(noCommunicationErrors == 1);
+    CHECK(g_now == 30 * NS_PER_MS);
+
+    TestCaseEnd();
+}
+
+/**
+ * Latency from the start of the transmission to the update of the tuple and
+ * the time until the receiver delivers values again after a byte was lost,
+ * with a DTO of the size of the slave to master DTO.
+ */
+int ut_LatencyAndRecovery(void)
+{
+    TestCaseBegin();
+
+    struct Payload {
+        uint32_t counter;
+        uint8_t values[28];
+    };
+
+    Payload tx {}, rx {}, unused {};
+    size_t frameErrors = 0;
+
+    auto rxDto = com::make_dto(rx);
+    auto txDto = com::make_dto(tx);
+    auto unusedDto = com::make_dto(unused);
+
+    app::Communication<decltype(rxDto), decltype(txDto)> masterCom(hal::Factory<hal::UsartWithDma>::get<hal::Usart::
+                                                                                                        MSCOM_IF>(),
+                                                                   rxDto,
+                                                                   txDto,
+                                                                   [&](auto){
+        frameErrors++;
+    });
+    app::Communication<decltype(unusedDto), decltype(txDto)> slaveCom(hal::Factory<hal::UsartWithDma>::get<hal::
+                                                                                                           Usart::
+                                                                                                           MSCOM_IF>(),
+                                                                      unusedDto,
+                                                                      txDto);
+
+    std::vector<uint64_t> sendTime;
+    resetLink();
+    g_link.transmitter = [&] {
+                             tx.counter = sendTime.size();
+                             for (size_t i = 0; i < sizeof(tx.values); i++) {
+                                 tx.values[i] = tx.counter + i;
+                             }
+                             sendTime.push_back(g_now);
+                             slaveCom.triggerTxTaskExecution();
+                         };
+
+    std::vector<uint64_t> latencies;
+    const auto runUntil = [&](const uint64_t end, std::vector<uint64_t>& updates) {
+                              uint32_t last = rx.counter;
+                              while (g_now < end) {
+                                  masterCom.triggerRxTaskExecution();
+                                  if (rx.counter != last) {
+                                      CHECK(0 == std::memcmp(&rx, &tx, sizeof(rx)));
+                                      updates.push_back(g_now);
+                                      latencies.push_back(g_now - sendTime[rx.counter]);
+                                      last = rx.counter;
+                                  }
+                              }
+                          };
+
+    std::vector<uint64_t> updates;
+    runUntil(1000 * NS_PER_MS, updates);
+    CHECK(frameErrors == 0);
+    CHECK(updates.size() >= sendTime.size() - 2);
+
+    uint64_t maxLatency = 0;
+    uint64_t sumLatency = 0;
+    for (const auto latency : latencies) {
+        maxLatency = std::max(maxLatency, latency);
+        sumLatency += latency;
+    }
+    const size_t maxFrameLength = frameLength(txDto, 0);
+    std::cout << "frame " << maxFrameLength << " byte, latency send -> updateTuple avg "
+              << sumLatency / latencies.size() / 1000 << " us max " << maxLatency / 1000 << " us" << std::endl;
+    CHECK(maxLatency <= (maxFrameLength + 1) * BYTETIME);
+
+    // Loss of a data byte, of a code byte and of the delimiter
+    const char* lost[] = {"data byte", "code byte", "delimiter"};
+    for (size_t i = 0; i < 3; i++) {
+        const size_t position[] = {10, 0, frameLength(txDto, sendTime.size()) - 1};
+        g_link.dropByte = g_link.bytesSent + position[i];
+        const uint64_t lossTime = g_link.nextTransmission + (position[i] + 1) * BYTETIME;
+        frameErrors = 0;
+
+        updates.clear();
+        runUntil(g_now + 100 * NS_PER_MS, updates);
+
+        uint64_t recovery = 0;
+        for (const auto update : updates) {
+            if (update > lossTime) {
+                recovery = update - lossTime;
+                break;
+            }
+        }
+        std::cout << "lost " << lost[i] << ": " << frameErrors << " frame error, next update after "
+                  << recovery / 1000 << " us" << std::endl;
+        CHECK(frameErrors == 1);
+        CHECK(recovery > 0);
+        // Without the delimiter the damaged frame swallows the next one
+        CHECK(recovery < (i == 2 ? 3 : 2) * g_link.period);
+        CHECK(updates.size() >= 100 / 10 - 2);
+    }
+
+    // Without the delimiter two frames are lost
+    const auto& statistics = masterCom.getLinkStatistics();
+    masterCom.traceLinkStatistics();
+    CHECK(statistics.sequenceGaps == 4);
+    CHECK(statistics.crcErrors + statistics.lengthErrors + statistics.resyncs == 3);
+    CHECK(statistics.schemaErrors == 0);
+    CHECK(statistics.framesOk == sendTime.size() - 4 - (g_link.inFlight.empty() ? 0 : 1));
+    CHECK(statistics.lastGoodFrameAge < 2 * g_link.period / NS_PER_MS);
+
+    // The slave sends every 10 ms, the gaps take 20 or 30 ms
+    const size_t regular = com::LinkQuality::bucket(10);
+    const size_t gap = com::LinkQuality::bucket(20);
+    uint32_t intervals = 0;
+    for (size_t i = 0; i < com::LinkStatistics::HISTOGRAM_BUCKETS; i++) {
+        intervals += statistics.interArrival[i];
+        if ((i != regular) && (i != gap)) {
+            CHECK(statistics.interArrival[i] == 0);
+        }
+    }
+    CHECK(intervals == statistics.framesOk - 1);
+    CHECK(statistics.interArrival[gap] == 3);
+
+    TestCaseEnd();
+}
+
+/**
+ * Both sides estimate the clock of the other one. They share the simulated
+ * clock here, so the estimated offset is the error.
+ */
+int ut_ClockSync(void)
+{
+    TestCaseBegin();
+
+    uint32_t mRx = 0, mTx = 0, sRx = 0, sTx = 0;
+
+    auto masterRxDto = com::make_dto(mRx);
+    auto masterTxDto = com::make_dto(mTx);
+    auto slaveRxDto = com::make_dto(sRx);
+    auto slaveTxDto = com::make_dto(sTx);
+
+    app::Communication<decltype(masterRxDto), decltype(masterTxDto)> masterCom(
+                                                                               hal::Factory<hal::UsartWithDma>::get<hal
+                                                                                                                    ::
+                                                                                                                    Usart
+                                                                                                                    ::
+                                                                                                                    MSCOM_IF>(),
+                                                                               masterRxDto,
+                                                                               masterTxDto);
+    app::Communication<decltype(slaveRxDto), decltype(slaveTxDto)> slaveCom(
+                                                                            hal::Factory<hal::UsartWithDma>::get<hal
+                                                                                                                 ::
+                                                                                                                 Usart
+                                                                                                                 ::
+                                                                                                                 MSCOM_IF>(),
+                                                                            slaveRxDto,
+                                                                            slaveTxDto);
+
+    // The directions take turns on the link, each one sends every 20 ms
+    resetLink();
+    while (g_now < 5000 * NS_PER_MS) {
+        g_link.transmitter = [&] {
+                                 slaveCom.triggerTxTaskExecution();
+                             };
+        masterCom.triggerRxTaskExecution();
+        g_link.transmitter = [&] {
+                                 masterCom.triggerTxTaskExecution();
+                             };
+        slaveCom.triggerRxTaskExecution();
+    }
+
+    const auto& sync = masterCom.getClockSync();
+    const auto& statistics = sync.getStatistics();
+    const int32_t offset = sync.offset(os::Task::getMicroseconds());
+    std::cout << "offset " << offset << " us, min delay " << statistics.minDelay << " us, "
+              << statistics.samples << " samples" << std::endl;
+    CHECK(sync.isSynchronised());
+    CHECK(slaveCom.getClockSync().isSynchronised());
+    // The receiver wakes up at the idle line or, if the frame ends there, at the half of the ring.
+    // So one way may look up to a receive timeout longer.
+    CHECK(std::abs(offset) <= RECEIVE_TIMEOUT_US / 2 + 1);
+    CHECK(statistics.samples >= 5000 / 20 / 8 - 2);
+    // Both ways wait for the idle line
+    CHECK(statistics.minDelay < 2 * 2 * RECEIVE_TIMEOUT_US);
+
+    // A frame with a sync header takes the transfer time and the idle line
+    const size_t bucket = log2_bucket<com::ClockSync::LATENCY_BUCKETS>(
+        frameLength(slaveTxDto, 0) * BYTETIME / 1000 + RECEIVE_TIMEOUT_US);
+    uint32_t frames = 0;
+    for (size_t i = 0; i < com::ClockSync::LATENCY_BUCKETS; i++) {
+        frames += statistics.latency[i];
+    }
+    CHECK(frames > 0);
+    CHECK(statistics.latency[bucket] == frames);
+
+    TestCaseEnd();
+}
+
+/**
+ * A deadband sends changes with the latency of a fast fixed rate and falls
+ * back to a heartbeat while the values are steady.
+ */
+int ut_AdaptiveRate(void)
+{
+    TestCaseBegin();
+
+    const char* name[] = {"fixed 10 ms", "fixed 2 ms", "deadband 2..100 ms"};
+    const RideResult result[] = {
+        simulateRide(10, 10, false),
+        simulateRide(2, 2, false),
+        simulateRide(2, 100, true)
+    };
+
+    for (size_t i = 0; i < 3; i++) {
+        std::cout << name[i] << ": " << result[i].tx.transmissions << " frames ("
+                  << result[i].tx.triggeredTransmissions << " triggered), utilisation avg "
+                  << 100 * result[i].tx.averageUtilisation << "% peak " << 100 * result[i].tx.peakUtilisation
+                  << "%, step latency max " << result[i].maxStepLatency / 1000 << " us, staleness max "
+                  << result[i].maxRxStaleness << " ms" << std::endl;
+        CHECK(result[i].tx.averageUtilisation <= result[i].tx.peakUtilisation + 0.01f);
+        CHECK(result[i].tx.peakUtilisation < 1.0f);
     }
 
-    masterThread.join();
-    slaveThread.join();
+    // A step is sampled within one period and then needs one frame
+    CHECK(result[0].maxRxStaleness <= 10 + 5);
+    CHECK(result[0].maxStepLatency <= (10 + 2) * NS_PER_MS);
+    CHECK(result[1].maxStepLatency <= (2 + 2) * NS_PER_MS);
+    CHECK(result[2].maxStepLatency <= (2 + 2) * NS_PER_MS);
+    CHECK(result[2].maxRxStaleness <= 100 + 2 + 5);
+    CHECK(result[2].tx.triggeredTransmissions >= 19);
+    CHECK(result[2].tx.averageUtilisation < result[0].tx.averageUtilisation / 4);
 
     TestCaseEnd();
 }
@@ -278,6 +734,11 @@ int main(int argc, const char* argv[])
     UnitTestMainBegin();
     RunTest(true, ut_DeepSleep);
     RunTest(true, ut_CrcError);
+    RunTest(true, ut_SchemaError);
     RunTest(true, ut_ValueExchange);
+    RunTest(true, ut_NoCommunication);
+    RunTest(true, ut_LatencyAndRecovery);
+    RunTest(true, ut_ClockSync);
+    RunTest(true, ut_AdaptiveRate);
     UnitTestMainEnd();
 }
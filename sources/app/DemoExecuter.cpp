@@ -6,19 +6,75 @@
 #include "DemoExecuter.h"
 #include "trace.h"
 #include <cstdlib>
+#include <algorithm>
 
 using app::CanController;
 using app::DemoExecuter;
 
 static const int __attribute__((unused)) g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_VERBOSE | ZONE_INFO;
 
+using namespace std::literals::string_view_literals;
+
+// GM DeviceControl (0xAE) requests to the body control module. IsoTp sends
+// TesterPresent when a demo starts, so the first request of each demo is
+// delayed by 100 ms.
+constexpr std::array<DemoExecuter::Demo, DemoExecuter::NUMBER_OF_DEMOS> DemoExecuter::Demos = {{
+    {"Wipers", 1, {{
+         {100, "\xAE\x03\x80\x00\x03\x00\x00"sv}
+     }}},
+    {"Honk", 2, {{
+         {100, "\xAE\x10\x01\x01\x00\x00\x00"sv},
+         {200, "\xAE\x10\x01\x00\x00\x00\x00"sv}
+     }}},
+    {"Doors", 2, {{
+         {100, "\xAE\x01\x04\x04\x00\x00\x00"sv},
+         {1100, "\xAE\x01\x02\x02\x00\x00\x00"sv}
+     }}},
+    {"Window", 2, {{
+         {100, "\xAE\x3B\x01\x01\x00\x00\x00"sv},
+         {3100, "\xAE\x3B\x01\x02\x00\x00\x00"sv}
+     }}},
+    {"Lights", 7, {{
+         {1100, "\xAE\x02\xF0\xF0\x78\x78\x00"sv}, // Front Fog Lamps
+         {2100, "\xAE\x07\x03\x80\x00\x80\x00"sv}, // Left Park Lamps
+         {3100, "\xAE\x0F\x04\x04\x00\x00\x00"sv}, // License Plate Lamps
+         {4100, "\xAE\x1A\x03\x80\x00\x80\x00"sv}, // Right Stop Lamp
+         {5100, "\xAE\x73\x03\x03"sv},             // Headlamp Low Beam
+         {6100, "\xAE\x74\x03\x03"sv},             // Dedicated Daytime Running Lamp
+         {11100, "\xAE\x00\x00\x00\x00\x00\x00"sv} // Release Control
+         /* // These lights groups are activated using bitmasks
+            "\xAE\x02\x00\x00\x08\x08\x00" // Backup Lamps
+            "\xAE\x02\x00\x00\x10\x10\x00" // Rear Fog Lamp(s) Relay
+            "\xAE\x02\x00\x00\x20\x20\x00" // Center Stop Lamp
+            "\xAE\x02\x00\x00\x40\x40\x00" // Front Fog Lamps
+            "\xAE\x02\x10\x10\x00\x00\x00" // Left Front Turn Signal Lamp
+            "\xAE\x02\x20\x20\x00\x00\x00" // Left Rear Turn Signal Lamp
+            "\xAE\x02\x40\x40\x00\x00\x00" // Right Front Turn Signal Lamp
+            "\xAE\x02\x80\x80\x00\x00\x00" // Right Rear Turn Signal Lamp
+            "\xAE\x07\x01\x80\x00\x00\x00" // Left Park Lamps
+            "\xAE\x07\x02\x00\x00\x80\x00" // Right Park Lamps
+            "\xAE\x1A\x01\x80\x00\x00\x00" // Right Stop Lamp
+            "\xAE\x1A\x02\x00\x00\x80\x00" // Left Stop Lamp
+            "\xAE\x73\x01\x01"             // Left Headlamp Low Beam
+            "\xAE\x73\x02\x02"             // Right Headlamp Low Beam
+            "\xAE\x74\x01\x01"             // Left Dedicated Daytime Running Lamp
+            "\xAE\x74\x02\x02"             // Right Dedicated Daytime Running Lamp
+          */
+     }}},
+    {"Washers", 3, {{
+         {100, "\xAE\x03\x08\x08\x00\x00\x00"sv},
+         {1100, "\xAE\x03\x08\x00\x00\x00\x00"sv},
+         {1100, "\xAE\x00\x00\x00\x00\x00\x00"sv}  // Release Control
+     }}}
+}};
+
 DemoExecuter::DemoExecuter(CanController& can) :
     os::DeepSleepModule(), mDemoExecuterTask("DemoExecuter",
                                              DemoExecuter::STACKSIZE, os::Task::Priority::LOW,
                                              [this](const bool& join)
 {
     DemoExecuterTaskFunction(join);
-}), mCan(can), mDemoQueue()
+}), mCan(can), mIsoTp(can, REQUEST_ID, RESPONSE_ID), mDemoQueue()
 {}
 
 void DemoExecuter::enterDeepSleep(void)
@@ -31,110 +87,39 @@ void DemoExecuter::exitDeepSleep(void)
     mDemoExecuterTask.start();
 }
 
-void DemoExecuter::send_GM_tester_present_twice()
+void DemoExecuter::playDemo(const Demo& demo)
 {
-    mCan.send("t2412013E\r");
-    os::ThisTask::sleep(std::chrono::milliseconds(50));
-    mCan.send("t2412013E\r");
-    os::ThisTask::sleep(std::chrono::milliseconds(50));
-}
+    Trace(ZONE_INFO, "Running demo %s!\r\n", demo.name);
 
-void DemoExecuter::demo_wipers_run(const char* args)
-{
-    Trace(ZONE_INFO, "Running demo Wipers!\r\n");
-    send_GM_tester_present_twice();
-    mCan.send("t241807AE038000030000\r");
-}
+    mIsoTp.enableTesterPresent();
 
-void DemoExecuter::demo_horn_run(const char* args)
-{
-    Trace(ZONE_INFO, "Running demo Honk!\r\n");
-    send_GM_tester_present_twice();
-    mCan.send("t241807AE100101000000\r");
-    os::ThisTask::sleep(std::chrono::milliseconds(100));
-    mCan.send("t241807AE100100000000\r");
-}
+    const uint32_t startTick = os::Task::getTickCount();
+    uint32_t wakeTick = startTick;
+    uint32_t maxJitter = 0;
+    uint32_t sumJitter = 0;
 
-void DemoExecuter::demo_doors_run(const char* args)
-{
-    Trace(ZONE_INFO, "Running demo Doors!\r\n");
-    send_GM_tester_present_twice();
-    mCan.send("t241807AE010404000000\r");
-    os::ThisTask::sleep(std::chrono::milliseconds(1000));
-    send_GM_tester_present_twice();
-    mCan.send("t241807AE010202000000\r");
-}
+    // Requests are played against absolute deadlines, so the time spent in
+    // mIsoTp.send doesn't shift the following ones.
+    for (size_t step = 0; step < demo.numberOfSteps; step++) {
+        const uint32_t deadline = startTick + demo.steps[step].offset;
 
-void DemoExecuter::demo_window_run(const char* args)
-{
-    Trace(ZONE_INFO, "Running demo Window!\r\n");
-    send_GM_tester_present_twice();
-    mCan.send("t241807AE3B0101000000\r");
-    os::ThisTask::sleep(std::chrono::milliseconds(3000));
-    send_GM_tester_present_twice();
-    mCan.send("t241807AE3B0102000000\r");
-}
+        if (deadline != wakeTick) {
+            os::ThisTask::sleepUntil(wakeTick, std::chrono::milliseconds(deadline - wakeTick));
+        }
+        const uint32_t jitter = os::Task::getTickCount() - deadline;
+        maxJitter = std::max(maxJitter, jitter);
+        sumJitter += jitter;
 
-void DemoExecuter::demo_lights_run(const char* args)
-{
-    Trace(ZONE_INFO, "Running demo Lights!\r\n");
-    send_GM_tester_present_twice();
-    os::ThisTask::sleep(std::chrono::milliseconds(1000));
-    send_GM_tester_present_twice();
-    mCan.send("t241807AE02f0f0787800\r"); // Front Fog Lamps
-    os::ThisTask::sleep(std::chrono::milliseconds(1000));
-    send_GM_tester_present_twice();
-    mCan.send("t241807AE070380008000\r"); // Left Park Lamps
-    os::ThisTask::sleep(std::chrono::milliseconds(1000));
-    send_GM_tester_present_twice();
-    mCan.send("t241807AE0F0404000000\r"); // License Plate Lamps
-    os::ThisTask::sleep(std::chrono::milliseconds(1000));
-    send_GM_tester_present_twice();
-    mCan.send("t241807AE1A0380008000\r"); // Right Stop Lamp
-    os::ThisTask::sleep(std::chrono::milliseconds(1000));
-    send_GM_tester_present_twice();
-    mCan.send("t241504AE730303\r");       // Headlamp Low Beam
-    os::ThisTask::sleep(std::chrono::milliseconds(1000));
-    send_GM_tester_present_twice();
-    mCan.send("t241504AE740303\r");       // Dedicated Daytime Running Lamp
-    /* // These lights groups are activated using bitmasks
-       os::ThisTask::sleep(std::chrono::milliseconds(1000));send_GM_tester_present_twice();mCan.send("t241807AE020000080800\r"); // Backup Lamps
-       os::ThisTask::sleep(std::chrono::milliseconds(1000));send_GM_tester_present_twice();mCan.send("t241807AE020000101000\r"); // Rear Fog Lamp(s) Relay
-       os::ThisTask::sleep(std::chrono::milliseconds(1000));send_GM_tester_present_twice();mCan.send("t241807AE020000202000\r"); // Center Stop Lamp
-       os::ThisTask::sleep(std::chrono::milliseconds(1000));send_GM_tester_present_twice();mCan.send("t241807AE020000404000\r"); // Front Fog Lamps
-       os::ThisTask::sleep(std::chrono::milliseconds(1000));send_GM_tester_present_twice();mCan.send("t241807AE021010000000\r"); // Left Front Turn Signal Lamp
-       os::ThisTask::sleep(std::chrono::milliseconds(1000));send_GM_tester_present_twice();mCan.send("t241807AE022020000000\r"); // Left Rear Turn Signal Lamp
-       os::ThisTask::sleep(std::chrono::milliseconds(1000));send_GM_tester_present_twice();mCan.send("t241807AE024040000000\r"); // Right Front Turn Signal Lamp
-       os::ThisTask::sleep(std::chrono::milliseconds(1000));send_GM_tester_present_twice();mCan.send("t241807AE028080000000\r"); // Right Rear Turn Signal Lamp
-
-       os::ThisTask::sleep(std::chrono::milliseconds(1000));send_GM_tester_present_twice();mCan.send("t241807AE070180000000\r"); // Left Park Lamps
-       os::ThisTask::sleep(std::chrono::milliseconds(1000));send_GM_tester_present_twice();mCan.send("t241807AE070200008000\r"); // Right Park Lamps
-
-       os::ThisTask::sleep(std::chrono::milliseconds(1000));send_GM_tester_present_twice();mCan.send("t241807AE0F0404000000\r"); // License Plate Lamps
-       os::ThisTask::sleep(std::chrono::milliseconds(1000));send_GM_tester_present_twice();mCan.send("t241807AE1A0180000000\r"); // Right Stop Lamp
-       os::ThisTask::sleep(std::chrono::milliseconds(1000));send_GM_tester_present_twice();mCan.send("t241807AE1A0200008000\r"); // Left Stop Lamp
-
-       os::ThisTask::sleep(std::chrono::milliseconds(1000));send_GM_tester_present_twice();mCan.send("t241504AE730101\r");       // Left Headlamp Low Beam
-       os::ThisTask::sleep(std::chrono::milliseconds(1000));send_GM_tester_present_twice();mCan.send("t241504AE730202\r");       // Right Headlamp Low Beam
-       os::ThisTask::sleep(std::chrono::milliseconds(1000));send_GM_tester_present_twice();mCan.send("t241504AE740101\r");       // Left Dedicated Daytime Running Lamp
-       os::ThisTask::sleep(std::chrono::milliseconds(1000));send_GM_tester_present_twice();mCan.send("t241504AE740202\r");       // Right Dedicated Daytime Running Lamp
-     */
-
-    os::ThisTask::sleep(std::chrono::milliseconds(5000));
-
-    send_GM_tester_present_twice();
-    mCan.send("t241807AE00\r"); // Release Control
-}
+        if (!mIsoTp.send(demo.steps[step].request)) {
+            Trace(ZONE_ERROR, "Request %u of demo %s failed\r\n", static_cast<unsigned int>(step), demo.name);
+        }
+    }
 
-void DemoExecuter::demo_washers_run(const char* args)
-{
-    Trace(ZONE_INFO, "Running demo Washers!\r\n");
-    send_GM_tester_present_twice();
-    mCan.send("t241807AE030808000000\r");
-    os::ThisTask::sleep(std::chrono::milliseconds(1000));
-    send_GM_tester_present_twice();
-    mCan.send("t241807AE030800000000\r");
-    mCan.send("t241807AE00\r"); // Release Control
+    mIsoTp.disableTesterPresent();
+
+    Trace(ZONE_INFO, "Demo %s finished: %u requests, jitter max %u ms, mean %u us\r\n",
+          demo.name, static_cast<unsigned int>(demo.numberOfSteps), static_cast<unsigned int>(maxJitter),
+          static_cast<unsigned int>(sumJitter * 1000 / demo.numberOfSteps));
 }
 
 void DemoExecuter::DemoExecuterTaskFunction(const bool& join)
@@ -149,33 +134,11 @@ void DemoExecuter::DemoExecuterTaskFunction(const bool& join)
         auto received = mDemoQueue.receive(demoBuffer);
 
         if (received) {
-            int demo_index = std::strtol(demoBuffer.data(), NULL, 10);
-            Trace(ZONE_INFO, "Demo %d requested.\r\n", demo_index);
-
-            switch (demo_index) {
-            case 0:
-                demo_wipers_run(nullptr);
-                break;
-
-            case 1:
-                demo_horn_run(nullptr);
-                break;
-
-            case 2:
-                demo_doors_run(nullptr);
-                break;
-
-            case 3:
-                demo_window_run(nullptr);
-                break;
-
-            case 4:
-                demo_lights_run(nullptr);
-                break;
+            const size_t demo_index = std::strtol(demoBuffer.data(), NULL, 10);
+            Trace(ZONE_INFO, "Demo %u requested.\r\n", static_cast<unsigned int>(demo_index));
 
-            case 5:
-                demo_washers_run(nullptr);
-                break;
+            if (demo_index < Demos.size()) {
+                playDemo(Demos[demo_index]);
             }
         }
     } while (!join);
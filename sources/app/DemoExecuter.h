@@ -6,6 +6,7 @@
 #pragma once
 
 #include "CanController.h"
+#include "IsoTp.h"
 #include "TaskInterruptable.h"
 #include "DeepSleepInterface.h"
 #include "os_Queue.h"
@@ -22,21 +23,33 @@ class DemoExecuter final :
 
     static constexpr uint32_t STACKSIZE = 1024;
 
+    struct DemoStep {
+        uint32_t offset; // ms after start of the demo
+        std::string_view request;
+    };
+
+    static constexpr size_t MAX_STEPS_PER_DEMO = 8;
+    static constexpr size_t NUMBER_OF_DEMOS = 6;
+
+    struct Demo {
+        const char* name;
+        size_t numberOfSteps;
+        std::array<DemoStep, MAX_STEPS_PER_DEMO> steps;
+    };
+
+    static const std::array<Demo, NUMBER_OF_DEMOS> Demos;
+
+    // Body control module
+    static constexpr uint32_t REQUEST_ID = 0x241;
+    static constexpr uint32_t RESPONSE_ID = 0x641;
+
     os::TaskInterruptable mDemoExecuterTask;
     CanController& mCan;
+    IsoTp mIsoTp;
     os::Queue<std::array<char, 10>, 10> mDemoQueue;
 
-    const std::chrono::milliseconds mExecutionInterval = std::chrono::milliseconds(100);
-
     void DemoExecuterTaskFunction(const bool&);
-
-    void send_GM_tester_present_twice(void);
-    void demo_wipers_run(const char* args);
-    void demo_horn_run(const char* args);
-    void demo_doors_run(const char* args);
-    void demo_window_run(const char* args);
-    void demo_lights_run(const char* args);
-    void demo_washers_run(const char* args);
+    void playDemo(const Demo& demo);
 
 public:
     DemoExecuter(CanController& can);
@@ -0,0 +1,391 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include "IsoTp.h"
+#include "LockGuard.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstring>
+
+using app::CanController;
+using app::IsoTp;
+
+static const int __attribute__((unused)) g_DebugZones = ZONE_ERROR | ZONE_WARNING;
+
+constexpr std::string_view IsoTp::TESTER_PRESENT;
+
+static inline uint8_t hexToNibble(const char c)
+{
+    return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+IsoTp::IsoTp(CanController& can, const uint32_t txId, const uint32_t rxId) :
+    os::DeepSleepModule(), mTesterPresentTimer("TesterPresent",
+                                               std::chrono::milliseconds(TESTER_PRESENT_INTERVAL),
+                                               os::Timer::Mode::PERIODIC,
+                                               [this]()
+{
+    testerPresentTimerFunction();
+}), mCan(can), mTxId(txId), mRxId(rxId), mReceiveQueue(), mTransactionMutex()
+{
+    mCan.registerDiagnosticCallback([this](const std::string_view data){
+        receiveSlcan(data);
+    });
+}
+
+void IsoTp::enterDeepSleep(void)
+{
+    mTesterPresentTimer.stop(portMAX_DELAY);
+}
+
+void IsoTp::exitDeepSleep(void)
+{
+    if (mIsTesterPresentEnabled) {
+        mTesterPresentTimer.start(portMAX_DELAY);
+    }
+}
+
+void IsoTp::receiveSlcan(std::string_view data)
+{
+    // Frames are split over several chunks of the receive buffer of the CanController
+    for (const char c : data) {
+        if ((c == '\r') || (c == '\a')) {
+            if (mLineLength <= mLine.size()) {
+                parseSlcanFrame(std::string_view(mLine.data(), mLineLength));
+            }
+            mLineLength = 0;
+        } else {
+            if (mLineLength < mLine.size()) {
+                mLine[mLineLength] = c;
+            }
+            mLineLength++;
+        }
+    }
+}
+
+void IsoTp::parseSlcanFrame(std::string_view line)
+{
+    size_t idDigits;
+    uint32_t id;
+
+    if ((line.length() >= 5) && (line[0] == 't')) {
+        idDigits = 3;
+        id = 0;
+    } else if ((line.length() >= 10) && (line[0] == 'T')) {
+        idDigits = 8;
+        id = EXTENDED_ID_FLAG;
+    } else {
+        return;
+    }
+
+    for (size_t i = 1; i <= idDigits; i++) {
+        id = (id & EXTENDED_ID_FLAG) | ((id << 4) & ~EXTENDED_ID_FLAG) | hexToNibble(line[i]);
+    }
+
+    if (id != mRxId) {
+        return;
+    }
+
+    Frame frame;
+    frame.length = hexToNibble(line[idDigits + 1]);
+    const std::string_view payload = line.substr(idDigits + 2);
+
+    if ((frame.length == 0) || (frame.length > CAN_FRAME_SIZE) || (payload.length() < frame.length * 2U)) {
+        Trace(ZONE_WARNING, "Invalid frame from ECU\r\n");
+        return;
+    }
+
+    for (size_t i = 0; i < frame.length; i++) {
+        frame.data[i] = hexToNibble(payload[i * 2]) << 4 | hexToNibble(payload[i * 2 + 1]);
+    }
+
+    if (!mReceiveQueue.sendBack(frame, 0U)) {
+        Trace(ZONE_WARNING, "Receive queue full\r\n");
+    }
+}
+
+bool IsoTp::sendFrame(uint8_t const* data, const size_t length, const uint32_t ticksToWait)
+{
+    static constexpr char hex[] = "0123456789ABCDEF";
+    std::array<char, 1 + 8 + 1 + CAN_FRAME_SIZE * 2 + 1> line;
+    auto it = line.begin();
+
+    if (mTxId & EXTENDED_ID_FLAG) {
+        *it++ = 'T';
+        for (int shift = 28; shift >= 0; shift -= 4) {
+            *it++ = hex[(mTxId >> shift) & 0xf];
+        }
+    } else {
+        *it++ = 't';
+        for (int shift = 8; shift >= 0; shift -= 4) {
+            *it++ = hex[(mTxId >> shift) & 0xf];
+        }
+    }
+
+    // Frames are always padded to 8 byte, like the diagnostic tools of most OEMs do
+    *it++ = '0' + CAN_FRAME_SIZE;
+    for (size_t i = 0; i < CAN_FRAME_SIZE; i++) {
+        const uint8_t byte = i < length ? data[i] : CAN_FRAME_PADDING;
+        *it++ = hex[byte >> 4];
+        *it++ = hex[byte & 0xf];
+    }
+    *it++ = '\r';
+
+    const size_t lineLength = it - line.begin();
+    return mCan.send(std::string_view(line.data(), lineLength), ticksToWait) == lineLength;
+}
+
+bool IsoTp::receiveFrame(Frame& frame, const uint32_t timeout)
+{
+    return mReceiveQueue.receive(frame, timeout);
+}
+
+uint32_t IsoTp::separationTimeToTicks(const uint8_t stmin)
+{
+    // A sleep of n ticks lasts at least n - 1 tick periods, so one tick is added
+    // to guarantee the minimum separation time.
+    if (stmin == 0) {
+        return 0;
+    }
+    if (stmin <= 0x7f) {
+        return stmin + 1;
+    }
+    if ((stmin >= 0xf1) && (stmin <= 0xf9)) {
+        // 100 us - 900 us
+        return 2;
+    }
+    // Reserved values have to be treated as the maximum of 127 ms
+    return 0x7f + 1;
+}
+
+bool IsoTp::waitForFlowControl(uint8_t& blockSize, uint32_t& separationTime)
+{
+    Frame frame;
+    size_t waitFrames = 0;
+
+    while (receiveFrame(frame, N_BS_TIMEOUT)) {
+        if ((frame.data[0] & 0xf0) != static_cast<uint8_t>(FrameType::FLOW_CONTROL)) {
+            continue;
+        }
+
+        switch (static_cast<FlowStatus>(frame.data[0] & 0x0f)) {
+        case FlowStatus::CONTINUE_TO_SEND:
+            blockSize = frame.data[1];
+            separationTime = separationTimeToTicks(frame.data[2]);
+            return true;
+
+        case FlowStatus::WAIT:
+            if (++waitFrames > MAX_WAIT_FRAMES) {
+                Trace(ZONE_ERROR, "Too many wait frames\r\n");
+                return false;
+            }
+            break;
+
+        default:
+            Trace(ZONE_ERROR, "ECU aborted transfer: flow status %d\r\n", frame.data[0] & 0x0f);
+            return false;
+        }
+    }
+
+    Trace(ZONE_ERROR, "Timeout while waiting for flow control\r\n");
+    return false;
+}
+
+bool IsoTp::transmit(std::string_view payload)
+{
+    std::array<uint8_t, CAN_FRAME_SIZE> frame;
+
+    if (payload.empty() || (payload.length() > MAX_MESSAGE_SIZE)) {
+        Trace(ZONE_ERROR, "Invalid message length %u\r\n", static_cast<unsigned int>(payload.length()));
+        return false;
+    }
+
+    if (payload.length() < CAN_FRAME_SIZE) {
+        frame[0] = static_cast<uint8_t>(FrameType::SINGLE) | payload.length();
+        std::memcpy(frame.data() + 1, payload.data(), payload.length());
+        return sendFrame(frame.data(), payload.length() + 1);
+    }
+
+    frame[0] = static_cast<uint8_t>(FrameType::FIRST) | (payload.length() >> 8);
+    frame[1] = payload.length() & 0xff;
+    std::memcpy(frame.data() + 2, payload.data(), CAN_FRAME_SIZE - 2);
+    if (!sendFrame(frame.data(), CAN_FRAME_SIZE)) {
+        return false;
+    }
+
+    size_t offset = CAN_FRAME_SIZE - 2;
+    uint8_t sequenceNumber = 1;
+
+    while (offset < payload.length()) {
+        uint8_t blockSize;
+        uint32_t separationTime;
+
+        if (!waitForFlowControl(blockSize, separationTime)) {
+            return false;
+        }
+
+        for (size_t block = 0; ((blockSize == 0) || (block < blockSize)) && (offset < payload.length()); block++) {
+            // STmin separates consecutive frames, the first one may follow the flow control immediately
+            if (separationTime && block) {
+                os::ThisTask::sleep(std::chrono::milliseconds(separationTime));
+            }
+
+            const size_t length = std::min(CAN_FRAME_SIZE - 1, payload.length() - offset);
+            frame[0] = static_cast<uint8_t>(FrameType::CONSECUTIVE) | (sequenceNumber++ & 0x0f);
+            std::memcpy(frame.data() + 1, payload.data() + offset, length);
+            if (!sendFrame(frame.data(), length + 1)) {
+                return false;
+            }
+            offset += length;
+        }
+    }
+    return true;
+}
+
+size_t IsoTp::receiveMessage(const uint8_t serviceId, uint8_t* response, const size_t maxLength, uint32_t timeout)
+{
+    static constexpr uint8_t NEGATIVE_RESPONSE = 0x7f;
+    static constexpr uint8_t RESPONSE_PENDING = 0x78;
+    static constexpr uint8_t POSITIVE_RESPONSE_OFFSET = 0x40;
+    Frame frame;
+
+    while (true) {
+        if (!receiveFrame(frame, timeout)) {
+            Trace(ZONE_ERROR, "No response from ECU\r\n");
+            return 0;
+        }
+
+        const auto type = static_cast<FrameType>(frame.data[0] & 0xf0);
+        const uint8_t* const data = type == FrameType::FIRST ? &frame.data[2] : &frame.data[1];
+        const bool isNegativeResponse = (data[0] == NEGATIVE_RESPONSE) && (data[1] == serviceId);
+
+        // Responses to an earlier TesterPresent or request are skipped
+        if (((type != FrameType::SINGLE) && (type != FrameType::FIRST)) ||
+            ((data[0] != serviceId + POSITIVE_RESPONSE_OFFSET) && !isNegativeResponse))
+        {
+            continue;
+        }
+
+        if (type == FrameType::FIRST) {
+            break;
+        }
+
+        const size_t length = frame.data[0] & 0x0f;
+        if ((length == 0) || (length >= frame.length)) {
+            Trace(ZONE_ERROR, "Invalid single frame\r\n");
+            return 0;
+        }
+        if (isNegativeResponse && (length == 3) && (data[2] == RESPONSE_PENDING)) {
+            timeout = P2_EXTENDED_TIMEOUT;
+            continue;
+        }
+        if (length > maxLength) {
+            Trace(ZONE_ERROR, "Response too long %u\r\n", static_cast<unsigned int>(length));
+            return 0;
+        }
+        std::memcpy(response, data, length);
+        return length;
+    }
+
+    const size_t length = (frame.data[0] & 0x0f) << 8 | frame.data[1];
+    std::array<uint8_t, 3> flowControl {{static_cast<uint8_t>(FrameType::FLOW_CONTROL), RECEIVE_BLOCKSIZE,
+                                         RECEIVE_STMIN}};
+
+    if (length > maxLength) {
+        Trace(ZONE_ERROR, "Response too long %u\r\n", static_cast<unsigned int>(length));
+        flowControl[0] |= static_cast<uint8_t>(FlowStatus::OVERFLOW);
+        sendFrame(flowControl.data(), flowControl.size());
+        return 0;
+    }
+
+    std::memcpy(response, &frame.data[2], CAN_FRAME_SIZE - 2);
+    size_t received = CAN_FRAME_SIZE - 2;
+    uint8_t sequenceNumber = 1;
+    size_t block = 0;
+
+    sendFrame(flowControl.data(), flowControl.size());
+
+    while (received < length) {
+        if (!receiveFrame(frame, N_CR_TIMEOUT)) {
+            Trace(ZONE_ERROR, "Timeout while waiting for consecutive frame\r\n");
+            return 0;
+        }
+
+        if ((frame.data[0] & 0xf0) != static_cast<uint8_t>(FrameType::CONSECUTIVE)) {
+            continue;
+        }
+        if ((frame.data[0] & 0x0f) != (sequenceNumber++ & 0x0f)) {
+            Trace(ZONE_ERROR, "Wrong sequence number\r\n");
+            return 0;
+        }
+
+        const size_t chunk = std::min(CAN_FRAME_SIZE - 1, length - received);
+        std::memcpy(response + received, &frame.data[1], chunk);
+        received += chunk;
+
+        if (RECEIVE_BLOCKSIZE && (++block == RECEIVE_BLOCKSIZE) && (received < length)) {
+            block = 0;
+            sendFrame(flowControl.data(), flowControl.size());
+        }
+    }
+    return length;
+}
+
+bool IsoTp::send(std::string_view payload)
+{
+    os::LockGuard<os::Mutex> lock(mTransactionMutex);
+
+    mReceiveQueue.reset();
+    const bool success = transmit(payload);
+    mTickOfLastRequest = os::Task::getTickCount();
+    return success;
+}
+
+size_t IsoTp::request(std::string_view payload, uint8_t* response, const size_t maxLength)
+{
+    os::LockGuard<os::Mutex> lock(mTransactionMutex);
+
+    mReceiveQueue.reset();
+    const bool success = transmit(payload);
+    mTickOfLastRequest = os::Task::getTickCount();
+
+    if (!success) {
+        return 0;
+    }
+    return receiveMessage(payload[0], response, maxLength, P2_TIMEOUT);
+}
+
+void IsoTp::enableTesterPresent(void)
+{
+    mIsTesterPresentEnabled = true;
+    send(TESTER_PRESENT);
+    mTesterPresentTimer.start(portMAX_DELAY);
+}
+
+void IsoTp::disableTesterPresent(void)
+{
+    mIsTesterPresentEnabled = false;
+    mTesterPresentTimer.stop(portMAX_DELAY);
+}
+
+void IsoTp::testerPresentTimerFunction(void)
+{
+    // Every request restarts the session timer of the ECU, so TesterPresent is
+    // only needed if the last one is older than half an interval.
+    if (!mIsTesterPresentEnabled ||
+        (os::Task::getTickCount() - mTickOfLastRequest < TESTER_PRESENT_INTERVAL / 2))
+    {
+        return;
+    }
+
+    // The timer service task must neither wait for a running transfer nor for a
+    // busy link. A TesterPresent which doesn't get through is sent next period.
+    os::LockGuard<os::Mutex> lock(mTransactionMutex, 0);
+    const uint8_t frame[] = {static_cast<uint8_t>(FrameType::SINGLE) | TESTER_PRESENT.length(),
+                             static_cast<uint8_t>(TESTER_PRESENT[0])};
+    if (lock && sendFrame(frame, sizeof(frame), TESTER_PRESENT_SEND_TIMEOUT)) {
+        mTickOfLastRequest = os::Task::getTickCount();
+    }
+}
@@ -0,0 +1,130 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <string_view>
+#include "Timer.h"
+#include "DeepSleepInterface.h"
+#include "os_Queue.h"
+#include "Mutex.h"
+#include "CanController.h"
+
+#ifdef UNITTEST
+int ut_SingleFrame(void);
+int ut_MultiFrameRequest(void);
+int ut_MultiFrameResponse(void);
+int ut_FlowControl(void);
+int ut_TesterPresent(void);
+int ut_Benchmark(void);
+#endif
+
+namespace app
+{
+/**
+ * ISO 15765-2 transport for UDS requests to one ECU. Frames are exchanged as
+ * SLCAN text with the CAN coprocessor. Outgoing messages are segmented and
+ * paced by the block size and STmin of the receiver, incoming messages are
+ * reassembled. While enabled, a timer keeps the diagnostic session alive with
+ * TesterPresent, unless a request already did so.
+ */
+class IsoTp final :
+    private os::DeepSleepModule
+{
+    virtual void enterDeepSleep(void) override;
+    virtual void exitDeepSleep(void) override;
+
+    static constexpr size_t CAN_FRAME_SIZE = 8;
+    static constexpr uint8_t CAN_FRAME_PADDING = 0x00;
+    static constexpr size_t MAX_MESSAGE_SIZE = 4095;
+    static constexpr size_t MAX_WAIT_FRAMES = 10;
+
+    // ISO 15765-2 timeouts in ms
+    static constexpr uint32_t N_BS_TIMEOUT = 1000;
+    static constexpr uint32_t N_CR_TIMEOUT = 1000;
+    static constexpr uint32_t P2_TIMEOUT = 150;
+    static constexpr uint32_t P2_EXTENDED_TIMEOUT = 5000;
+
+    // Flow control which is sent to the ECU for multi frame responses
+    static constexpr uint8_t RECEIVE_BLOCKSIZE = 0;
+    static constexpr uint8_t RECEIVE_STMIN = 0;
+
+    static constexpr uint32_t TESTER_PRESENT_INTERVAL = 500;
+    // Enough for one SLCAN line to the coprocessor, the timer service task must not wait longer
+    static constexpr uint32_t TESTER_PRESENT_SEND_TIMEOUT = 5;
+    static constexpr std::string_view TESTER_PRESENT = "\x3e";
+
+    enum class FrameType : uint8_t {
+        SINGLE = 0x00,
+        FIRST = 0x10,
+        CONSECUTIVE = 0x20,
+        FLOW_CONTROL = 0x30
+    };
+
+    enum class FlowStatus : uint8_t {
+        CONTINUE_TO_SEND = 0,
+        WAIT = 1,
+        OVERFLOW = 2
+    };
+
+    struct Frame {
+        uint8_t length;
+        std::array<uint8_t, CAN_FRAME_SIZE> data;
+    };
+
+    os::Timer mTesterPresentTimer;
+    CanController& mCan;
+    const uint32_t mTxId;
+    const uint32_t mRxId;
+
+    os::Queue<Frame, 16> mReceiveQueue;
+    os::Mutex mTransactionMutex;
+
+    // SLCAN text of the frame which is currently received from the coprocessor
+    std::array<char, 32> mLine;
+    size_t mLineLength = 0;
+
+    bool mIsTesterPresentEnabled = false;
+    uint32_t mTickOfLastRequest = 0;
+
+    void testerPresentTimerFunction(void);
+    void receiveSlcan(std::string_view data);
+    void parseSlcanFrame(std::string_view line);
+    bool sendFrame(uint8_t const* data, const size_t length, const uint32_t ticksToWait = N_BS_TIMEOUT);
+    bool receiveFrame(Frame& frame, const uint32_t timeout);
+
+    bool transmit(std::string_view payload);
+    bool waitForFlowControl(uint8_t& blockSize, uint32_t& separationTime);
+    size_t receiveMessage(const uint8_t serviceId, uint8_t* response, const size_t maxLength, uint32_t timeout);
+    static uint32_t separationTimeToTicks(const uint8_t stmin);
+
+public:
+    static constexpr uint32_t EXTENDED_ID_FLAG = 0x80000000;
+
+    IsoTp(CanController& can, const uint32_t txId, const uint32_t rxId);
+
+    IsoTp(const IsoTp&) = delete;
+    IsoTp(IsoTp&&) = delete;
+    IsoTp& operator=(const IsoTp&) = delete;
+    IsoTp& operator=(IsoTp&&) = delete;
+
+    bool send(std::string_view payload);
+    size_t request(std::string_view payload, uint8_t* response, const size_t maxLength);
+
+    void enableTesterPresent(void);
+    void disableTesterPresent(void);
+
+#ifdef UNITTEST
+    friend int ::ut_SingleFrame(void);
+    friend int ::ut_MultiFrameRequest(void);
+    friend int ::ut_MultiFrameResponse(void);
+    friend int ::ut_FlowControl(void);
+    friend int ::ut_TesterPresent(void);
+    friend int ::ut_Benchmark(void);
+#endif
+};
+}
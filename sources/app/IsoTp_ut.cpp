@@ -0,0 +1,722 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+#include "unittest.h"
+#include "IsoTp.h"
+
+using namespace std::literals::string_view_literals;
+
+//--------------------------BUFFERS--------------------------
+static constexpr uint32_t TESTER_ID = 0x241;
+static constexpr uint32_t ECU_ID = 0x641;
+
+static constexpr size_t UART_BAUDRATE = 115200;
+static constexpr size_t BITS_PER_CHAR = 10;
+static constexpr size_t CAN_FRAME_TIME_US = 260; // 8 byte frame incl. stuff bits at 500 kbit/s
+static constexpr size_t ECU_RESPONSE_TIME_US = 1000;
+
+uint64_t g_simulatedTimeUs;
+bool g_isMutexBusy = false;
+size_t g_mutexGives = 0;
+bool g_isTimerActive = false;
+bool g_isLinkBusy = false;
+uint32_t g_sendTicksToWait = 0;
+std::function<void(void)> g_sleepHook;
+std::function<void(std::string_view)> g_diagnosticCallback;
+
+size_t g_queueItemSize;
+std::deque<std::vector<uint8_t> > g_queue;
+
+static void transferLine(const size_t length)
+{
+    g_simulatedTimeUs += length * BITS_PER_CHAR * 1000000 / UART_BAUDRATE + CAN_FRAME_TIME_US;
+}
+
+struct EcuSimulation {
+    struct Frame {
+        uint64_t timestampUs;
+        std::vector<uint8_t> data;
+    };
+
+    // Flow control which is sent for multi frame requests
+    size_t waitFrames = 0;
+    uint8_t flowStatus = 0;
+    uint8_t blockSize = 0;
+    uint8_t separationTime = 0;
+    bool isFlowControlSilent = false;
+
+    // Responses
+    size_t pendingResponses = 0;
+    std::function<std::vector<uint8_t>(const std::vector<uint8_t>&)> handler;
+
+    std::vector<Frame> received;
+    std::vector<uint8_t> request;
+    size_t requestLength = 0;
+    uint8_t expectedSequenceNumber = 0;
+    size_t framesInBlock = 0;
+    bool sequenceError = false;
+
+    std::vector<uint8_t> response;
+    size_t responseOffset = 0;
+    size_t flowControlsReceived = 0;
+
+    void sendFrame(const std::vector<uint8_t>& data, const size_t chunkSize = 64)
+    {
+        static constexpr char hex[] = "0123456789ABCDEF";
+        std::string line = "t641" + std::to_string(data.size());
+        for (const auto& b : data) {
+            line += hex[b >> 4];
+            line += hex[b & 0xf];
+        }
+        line += '\r';
+
+        transferLine(line.length());
+        for (size_t i = 0; i < line.length(); i += chunkSize) {
+            g_diagnosticCallback(std::string_view(line).substr(i, chunkSize));
+        }
+    }
+
+    void sendFlowControl(void)
+    {
+        for (size_t i = 0; i < waitFrames; i++) {
+            sendFrame({0x31, 0, 0});
+        }
+        if (!isFlowControlSilent) {
+            sendFrame({static_cast<uint8_t>(0x30 | flowStatus), blockSize, separationTime});
+        }
+    }
+
+    void respond(void)
+    {
+        g_simulatedTimeUs += ECU_RESPONSE_TIME_US;
+
+        if (!handler) {
+            return;
+        }
+        for (size_t i = 0; i < pendingResponses; i++) {
+            sendFrame({0x03, 0x7f, request[0], 0x78});
+        }
+
+        response = handler(request);
+        if (response.size() < 8) {
+            std::vector<uint8_t> frame {static_cast<uint8_t>(response.size())};
+            frame.insert(frame.end(), response.begin(), response.end());
+            sendFrame(frame);
+        } else {
+            std::vector<uint8_t> frame {static_cast<uint8_t>(0x10 | response.size() >> 8),
+                                        static_cast<uint8_t>(response.size() & 0xff)};
+            frame.insert(frame.end(), response.begin(), response.begin() + 6);
+            responseOffset = 6;
+            sendFrame(frame);
+        }
+    }
+
+    void sendConsecutiveFrames(void)
+    {
+        uint8_t sequenceNumber = 1;
+        while (responseOffset < response.size()) {
+            const size_t length = std::min<size_t>(7, response.size() - responseOffset);
+            std::vector<uint8_t> frame {static_cast<uint8_t>(0x20 | (sequenceNumber++ & 0x0f))};
+            frame.insert(frame.end(), response.begin() + responseOffset,
+                         response.begin() + responseOffset + length);
+            responseOffset += length;
+            sendFrame(frame);
+        }
+    }
+
+    void receive(const std::vector<uint8_t>& data)
+    {
+        received.push_back({g_simulatedTimeUs, data});
+
+        switch (data[0] & 0xf0) {
+        case 0x00:
+            request.assign(data.begin() + 1, data.begin() + 1 + (data[0] & 0x0f));
+            respond();
+            break;
+
+        case 0x10:
+            requestLength = (data[0] & 0x0f) << 8 | data[1];
+            request.assign(data.begin() + 2, data.end());
+            expectedSequenceNumber = 1;
+            framesInBlock = 0;
+            sendFlowControl();
+            break;
+
+        case 0x20:
+            if ((data[0] & 0x0f) != expectedSequenceNumber) {
+                sequenceError = true;
+            }
+            expectedSequenceNumber = (expectedSequenceNumber + 1) & 0x0f;
+            request.insert(request.end(), data.begin() + 1, data.end());
+            if (request.size() >= requestLength) {
+                request.resize(requestLength);
+                respond();
+            } else if (blockSize && (++framesInBlock == blockSize)) {
+                framesInBlock = 0;
+                sendFlowControl();
+            }
+            break;
+
+        case 0x30:
+            flowControlsReceived++;
+            if ((data[0] & 0x0f) == 0) {
+                sendConsecutiveFrames();
+            }
+            break;
+        }
+    }
+
+    size_t countRequests(const uint8_t serviceId) const
+    {
+        size_t count = 0;
+        for (const auto& frame : received) {
+            count += ((frame.data[0] & 0xf0) == 0x00) && (frame.data[1] == serviceId);
+        }
+        return count;
+    }
+};
+
+EcuSimulation* g_ecu;
+
+//--------------------------MOCKING--------------------------
+constexpr const std::array<const hal::Gpio, hal::Gpio::__ENUM__SIZE + 1> hal::Factory<hal::Gpio>::Container;
+constexpr const std::array<const hal::Usart, hal::Usart::__ENUM__SIZE + 1> hal::Factory<hal::Usart>::Container;
+constexpr const std::array<const hal::Dma, hal::Dma::__ENUM__SIZE + 1> hal::Factory<hal::Dma>::Container;
+constexpr const std::array<const hal::UsartWithDma,
+                           hal::Usart::__ENUM__SIZE> hal::Factory<hal::UsartWithDma>::Container;
+
+void os::TaskInterruptable::join(void) {}
+
+void os::TaskInterruptable::start(void) {}
+
+os::TaskInterruptable::TaskInterruptable(char const* name, unsigned short stack, os::Task::Priority prio,
+                                         std::function<void(bool const&)> func) :
+    Task(name, stack, prio, func) {}
+
+os::TaskInterruptable::~TaskInterruptable(void) {}
+
+void os::TaskInterruptable::taskFunction(void) {}
+
+os::Timer::Timer(char const* name, const std::chrono::milliseconds period, const Mode mode,
+                 std::function<void(void)> function) {}
+
+os::Timer::~Timer(void) {}
+
+bool os::Timer::start(uint32_t ticksToWait) const
+{
+    g_isTimerActive = true;
+    return true;
+}
+
+bool os::Timer::stop(uint32_t ticksToWait) const
+{
+    g_isTimerActive = false;
+    return true;
+}
+
+os::Task::Task(char const* name, unsigned short stack, os::Task::Priority prio,
+               std::function<void(bool const&)> func) {}
+
+os::Task::~Task(void) {}
+
+void os::Task::taskFunction(void) {}
+
+void os::ThisTask::sleep(const std::chrono::milliseconds ms)
+{
+    g_simulatedTimeUs += ms.count() * 1000;
+}
+
+void os::ThisTask::sleepUntil(uint32_t& previousWakeTick, const std::chrono::milliseconds increment)
+{
+    previousWakeTick += increment.count();
+    g_simulatedTimeUs = std::max<uint64_t>(g_simulatedTimeUs, previousWakeTick * 1000ULL);
+    if (g_sleepHook) {
+        g_sleepHook();
+    }
+}
+
+uint32_t os::Task::getTickCount(void)
+{
+    return g_simulatedTimeUs / 1000;
+}
+
+os::Mutex::Mutex(void) {}
+
+os::Mutex::~Mutex(void) {}
+
+bool os::Mutex::take(uint32_t ticksToWait) const
+{
+    return !g_isMutexBusy;
+}
+
+bool os::Mutex::give(void) const
+{
+    g_mutexGives++;
+    return true;
+}
+
+os::Mutex::operator bool() const
+{
+    return true;
+}
+
+QueueHandle_t xQueueGenericCreate(const UBaseType_t uxQueueLength,
+                                  const UBaseType_t uxItemSize,
+                                  const uint8_t     ucQueueType)
+{
+    g_queueItemSize = uxItemSize;
+    return reinterpret_cast<QueueHandle_t>(1);
+}
+
+void vQueueDelete(QueueHandle_t xQueue) {}
+
+BaseType_t xQueueGenericSend(QueueHandle_t xQueue, const void* const pvItemToQueue, TickType_t xTicksToWait,
+                             const BaseType_t xCopyPosition)
+{
+    auto item = static_cast<const uint8_t*>(pvItemToQueue);
+    g_queue.emplace_back(item, item + g_queueItemSize);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void* const pvBuffer, TickType_t xTicksToWait)
+{
+    if (g_queue.empty()) {
+        g_simulatedTimeUs += xTicksToWait * 1000ULL;
+        return pdFALSE;
+    }
+    std::memcpy(pvBuffer, g_queue.front().data(), g_queueItemSize);
+    g_queue.pop_front();
+    return pdTRUE;
+}
+
+BaseType_t xQueueGenericReset(QueueHandle_t xQueue, BaseType_t xNewQueue)
+{
+    g_queue.clear();
+    return pdTRUE;
+}
+
+app::CanController::CanController(const hal::UsartWithDma& interface,
+                                  const hal::Gpio&         supplyPin,
+                                  const hal::Gpio&         usartTxPin) :
+    os::DeepSleepModule(),
+    mTask("", 0, os::Task::Priority::LOW, [](const bool&){}),
+    mInterface(interface),
+    mCanSupplyVoltage(supplyPin),
+    mUsartTxPin(usartTxPin)
+{}
+
+void app::CanController::enterDeepSleep(void) {}
+
+void app::CanController::exitDeepSleep(void) {}
+
+size_t app::CanController::send(std::string_view data, const uint32_t ticksToWait)
+{
+    auto nibble = [](const char c) -> uint8_t {
+                      return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+                  };
+
+    g_sendTicksToWait = ticksToWait;
+    if (g_isLinkBusy) {
+        return 0;
+    }
+    transferLine(data.length());
+
+    if ((data.length() < 5) || (data[0] != 't') || (data.back() != '\r')) {
+        return 0;
+    }
+    const uint32_t id = nibble(data[1]) << 8 | nibble(data[2]) << 4 | nibble(data[3]);
+    const size_t length = nibble(data[4]);
+    if ((id != TESTER_ID) || (data.length() != 6 + length * 2)) {
+        return 0;
+    }
+
+    std::vector<uint8_t> frame;
+    for (size_t i = 0; i < length; i++) {
+        frame.push_back(nibble(data[5 + i * 2]) << 4 | nibble(data[6 + i * 2]));
+    }
+    g_ecu->receive(frame);
+    return data.length();
+}
+
+void app::CanController::registerDiagnosticCallback(std::function<void(std::string_view)> f)
+{
+    g_diagnosticCallback = f;
+}
+
+//--------------------------HELPERS--------------------------
+static app::CanController& canController(void)
+{
+    static app::CanController can(hal::Factory<hal::UsartWithDma>::get<hal::Usart::MODEM_COM>(),
+                                  hal::Factory<hal::Gpio>::get<hal::Gpio::SECCO_PWR>(),
+                                  hal::Factory<hal::Gpio>::get<hal::Gpio::SECCO_PWR>());
+    return can;
+}
+
+static std::vector<uint8_t> echo(const std::vector<uint8_t>& request)
+{
+    std::vector<uint8_t> response(request);
+    response[0] += 0x40;
+    return response;
+}
+
+static std::string pattern(const size_t length)
+{
+    std::string data(length, '\0');
+    data[0] = 0x36;
+    for (size_t i = 1; i < length; i++) {
+        data[i] = i & 0xff;
+    }
+    return data;
+}
+
+static void reset(EcuSimulation& ecu)
+{
+    g_ecu = &ecu;
+    g_queue.clear();
+    g_isMutexBusy = false;
+    g_sleepHook = nullptr;
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_SingleFrame(void)
+{
+    TestCaseBegin();
+
+    EcuSimulation ecu;
+    reset(ecu);
+    app::IsoTp isoTp(canController(), TESTER_ID, ECU_ID);
+
+    ecu.handler = echo;
+    std::array<uint8_t, 64> response;
+
+    const size_t length = isoTp.request("\x22\xf1\x90", response.data(), response.size());
+    CHECK(length == 3);
+    CHECK(response[0] == 0x62);
+    CHECK(response[1] == 0xf1);
+    CHECK(response[2] == 0x90);
+
+    // every frame is padded to 8 byte
+    CHECK(ecu.received.size() == 1);
+    CHECK(ecu.received[0].data.size() == 8);
+    CHECK(ecu.received[0].data[0] == 0x03);
+    CHECK(ecu.received[0].data[7] == 0x00);
+
+    // frames of other IDs, remote frames and broken lines are ignored, frames
+    // split over several chunks of the receive buffer are assembled
+    for (size_t chunk = 1; chunk <= 8; chunk++) {
+        g_queue.clear();
+        g_diagnosticCallback("t7E8803620102000000\rr6410\rt641\r");
+        ecu.sendFrame({0x02, 0x50, 0x03}, chunk);
+        CHECK(g_queue.size() == 1);
+    }
+
+    // responses to other services are skipped, negative responses are returned
+    ecu.handler = [](const std::vector<uint8_t>& request) {
+                      return std::vector<uint8_t> {0x7f, request[0], 0x31};
+                  };
+    CHECK(isoTp.request("\x31\x01\x02", response.data(), response.size()) == 3);
+    CHECK(response[0] == 0x7f);
+    CHECK(response[2] == 0x31);
+
+    // a 7 byte payload still fits into a single frame
+    ecu.received.clear();
+    CHECK(isoTp.send(pattern(7)));
+    CHECK(ecu.received.size() == 1);
+    CHECK(ecu.received[0].data[0] == 0x07);
+
+    // no response
+    ecu.handler = nullptr;
+    const uint64_t start = g_simulatedTimeUs;
+    CHECK(isoTp.request("\x10\x03", response.data(), response.size()) == 0);
+    CHECK(g_simulatedTimeUs - start >= 150000);
+
+    CHECK(!isoTp.send(""));
+
+    TestCaseEnd();
+}
+
+int ut_MultiFrameRequest(void)
+{
+    TestCaseBegin();
+
+    EcuSimulation ecu;
+    reset(ecu);
+    app::IsoTp isoTp(canController(), TESTER_ID, ECU_ID);
+
+    ecu.handler = [](const std::vector<uint8_t>& request) {
+                      return std::vector<uint8_t> {static_cast<uint8_t>(request[0] + 0x40), 0x01};
+                  };
+
+    // 200 byte need 28 consecutive frames, so the sequence number wraps around
+    const std::string payload = pattern(200);
+    std::array<uint8_t, 8> response;
+
+    for (const uint8_t blockSize : {0, 1, 4, 8}) {
+        for (const uint8_t separationTime : {0x00, 0x01, 0x05, 0xf3}) {
+            ecu.received.clear();
+            ecu.blockSize = blockSize;
+            ecu.separationTime = separationTime;
+
+            CHECK(isoTp.request(payload, response.data(), response.size()) == 2);
+            CHECK(response[0] == 0x76);
+            CHECK(!ecu.sequenceError);
+            CHECK(std::string(ecu.request.begin(), ecu.request.end()) == payload);
+            CHECK(ecu.received.size() == 1 + 28);
+
+            // STmin is kept between consecutive frames of a block
+            const uint64_t minimumGapUs = separationTime <= 0x7f ? separationTime * 1000 : 100;
+            size_t framesInBlock = 0;
+            for (size_t i = 2; i < ecu.received.size(); i++) {
+                if (blockSize && (++framesInBlock == blockSize)) {
+                    framesInBlock = 0;
+                    continue;
+                }
+                CHECK(ecu.received[i].timestampUs - ecu.received[i - 1].timestampUs >= minimumGapUs);
+            }
+        }
+    }
+
+    // the longest message ISO-TP can carry
+    ecu.blockSize = 0;
+    ecu.separationTime = 0;
+    CHECK(isoTp.send(pattern(4095)));
+    CHECK(ecu.request.size() == 4095);
+    CHECK(!isoTp.send(pattern(4096)));
+
+    TestCaseEnd();
+}
+
+int ut_MultiFrameResponse(void)
+{
+    TestCaseBegin();
+
+    EcuSimulation ecu;
+    reset(ecu);
+    app::IsoTp isoTp(canController(), TESTER_ID, ECU_ID);
+
+    std::vector<uint8_t> expected(300);
+    expected[0] = 0x62;
+    for (size_t i = 1; i < expected.size(); i++) {
+        expected[i] = i * 7;
+    }
+    ecu.handler = [&](const std::vector<uint8_t>&) {
+                      return expected;
+                  };
+
+    std::array<uint8_t, 512> response;
+    CHECK(isoTp.request("\x22\xf1\x00", response.data(), response.size()) == expected.size());
+    CHECK(std::equal(expected.begin(), expected.end(), response.begin()));
+    CHECK(ecu.flowControlsReceived == 1);
+
+    // response pending extends the timeout
+    ecu.pendingResponses = 3;
+    CHECK(isoTp.request("\x22\xf1\x00", response.data(), response.size()) == expected.size());
+    ecu.pendingResponses = 0;
+
+    // a response which doesn't fit into the buffer is refused with an overflow
+    ecu.received.clear();
+    ecu.flowControlsReceived = 0;
+    CHECK(isoTp.request("\x22\xf1\x00", response.data(), 100) == 0);
+    CHECK(ecu.flowControlsReceived == 1);
+    CHECK(ecu.received.back().data[0] == 0x32);
+
+    // a lost consecutive frame is detected by its sequence number
+    g_queue.clear();
+    ecu.response = expected;
+    ecu.responseOffset = 6;
+    ecu.sendFrame({0x11, 0x2c, 0x62, 0x01, 0x02, 0x03, 0x04, 0x05});
+    ecu.sendFrame({0x21, 0, 0, 0, 0, 0, 0, 0});
+    ecu.sendFrame({0x23, 0, 0, 0, 0, 0, 0, 0});
+    CHECK(isoTp.receiveMessage(0x22, response.data(), response.size(), 150) == 0);
+
+    TestCaseEnd();
+}
+
+int ut_FlowControl(void)
+{
+    TestCaseBegin();
+
+    EcuSimulation ecu;
+    reset(ecu);
+    app::IsoTp isoTp(canController(), TESTER_ID, ECU_ID);
+
+    const std::string payload = pattern(64);
+
+    // some wait frames are accepted
+    ecu.waitFrames = 10;
+    CHECK(isoTp.send(payload));
+    CHECK(ecu.request.size() == payload.size());
+
+    // too many are not
+    ecu.waitFrames = 11;
+    ecu.request.clear();
+    CHECK(!isoTp.send(payload));
+    CHECK(ecu.request.size() == 6);
+    ecu.waitFrames = 0;
+
+    // overflow aborts the transfer
+    ecu.flowStatus = 2;
+    CHECK(!isoTp.send(payload));
+    CHECK(ecu.request.size() == 6);
+    ecu.flowStatus = 0;
+
+    // missing flow control times out after N_Bs
+    ecu.isFlowControlSilent = true;
+    const uint64_t start = g_simulatedTimeUs;
+    CHECK(!isoTp.send(payload));
+    CHECK(g_simulatedTimeUs - start >= 1000000);
+    CHECK(g_simulatedTimeUs - start < 1100000);
+    ecu.isFlowControlSilent = false;
+
+    CHECK(app::IsoTp::separationTimeToTicks(0x00) == 0);
+    CHECK(app::IsoTp::separationTimeToTicks(0x01) == 2);
+    CHECK(app::IsoTp::separationTimeToTicks(0x7f) == 128);
+    CHECK(app::IsoTp::separationTimeToTicks(0x80) == 128);
+    CHECK(app::IsoTp::separationTimeToTicks(0xf1) == 2);
+    CHECK(app::IsoTp::separationTimeToTicks(0xf9) == 2);
+    CHECK(app::IsoTp::separationTimeToTicks(0xfa) == 128);
+
+    TestCaseEnd();
+}
+
+int ut_TesterPresent(void)
+{
+    TestCaseBegin();
+
+    EcuSimulation ecu;
+    reset(ecu);
+    app::IsoTp isoTp(canController(), TESTER_ID, ECU_ID);
+    ecu.handler = echo;
+
+    // One period of the timer, the hook runs meanwhile
+    auto expire = [&]() {
+                      g_simulatedTimeUs += app::IsoTp::TESTER_PRESENT_INTERVAL * 1000;
+                      if (g_sleepHook) {
+                          g_sleepHook();
+                      }
+                      if (g_isTimerActive) {
+                          isoTp.testerPresentTimerFunction();
+                      }
+                  };
+
+    // disabled
+    expire();
+    CHECK(!g_isTimerActive);
+    CHECK(ecu.countRequests(0x3e) == 0);
+
+    // enabling sends one immediately
+    isoTp.enableTesterPresent();
+    CHECK(g_isTimerActive);
+    CHECK(ecu.countRequests(0x3e) == 1);
+
+    expire();
+    CHECK(ecu.countRequests(0x3e) == 2);
+
+    // a recent request already kept the session alive
+    g_sleepHook = [&]() {
+                      isoTp.send("\xae\x03\x80\x00\x03\x00\x00"sv);
+                  };
+    expire();
+    CHECK(ecu.countRequests(0x3e) == 2);
+    g_sleepHook = nullptr;
+
+    // a running transfer isn't interrupted, and its lock isn't released
+    g_isMutexBusy = true;
+    const size_t gives = g_mutexGives;
+    expire();
+    CHECK(ecu.countRequests(0x3e) == 2);
+    CHECK(g_mutexGives == gives);
+    g_isMutexBusy = false;
+
+    expire();
+    CHECK(ecu.countRequests(0x3e) == 3);
+    CHECK(g_sendTicksToWait == app::IsoTp::TESTER_PRESENT_SEND_TIMEOUT);
+
+    // a busy link skips one TesterPresent instead of blocking the timer service task
+    g_isLinkBusy = true;
+    expire();
+    g_isLinkBusy = false;
+    CHECK(ecu.countRequests(0x3e) == 3);
+    expire();
+    CHECK(ecu.countRequests(0x3e) == 4);
+
+    isoTp.disableTesterPresent();
+    CHECK(!g_isTimerActive);
+    expire();
+    CHECK(ecu.countRequests(0x3e) == 4);
+
+    // a session of 10 s with a request every 200 ms needs no TesterPresent at all
+    isoTp.enableTesterPresent();
+    const size_t before = ecu.countRequests(0x3e);
+    uint64_t nextRequestUs = g_simulatedTimeUs;
+    g_sleepHook = [&]() {
+                      while (nextRequestUs <= g_simulatedTimeUs) {
+                          isoTp.send("\xae\x10\x01\x01\x00\x00\x00"sv);
+                          nextRequestUs += 200000;
+                      }
+                  };
+    for (size_t i = 0; i < 20; i++) {
+        expire();
+    }
+    CHECK(ecu.countRequests(0x3e) == before);
+    g_sleepHook = nullptr;
+    isoTp.disableTesterPresent();
+
+    TestCaseEnd();
+}
+
+int ut_Benchmark(void)
+{
+    TestCaseBegin();
+
+    EcuSimulation ecu;
+    reset(ecu);
+    app::IsoTp isoTp(canController(), TESTER_ID, ECU_ID);
+    ecu.handler = [](const std::vector<uint8_t>& request) {
+                      return std::vector<uint8_t> {static_cast<uint8_t>(request[0] + 0x40)};
+                  };
+
+    std::array<uint8_t, 8> response;
+
+    uint64_t start = g_simulatedTimeUs;
+    CHECK(isoTp.request("\x3e", response.data(), response.size()) == 1);
+    printf("%s: single frame request latency %d us (simulated)\n", __FUNCTION__,
+           static_cast<int>(g_simulatedTimeUs - start));
+
+    // 1 kB like a TransferData block
+    const std::string payload = pattern(1024);
+
+    for (const uint8_t blockSize : {0, 8}) {
+        for (const uint8_t separationTime : {0, 1, 5}) {
+            ecu.blockSize = blockSize;
+            ecu.separationTime = separationTime;
+
+            start = g_simulatedTimeUs;
+            CHECK(isoTp.request(payload, response.data(), response.size()) == 1);
+            const uint64_t durationUs = g_simulatedTimeUs - start;
+            printf("%s: BS %d STmin %d ms: %d B/s (simulated)\n", __FUNCTION__,
+                   blockSize, separationTime, static_cast<int>(payload.size() * 1000000 / durationUs));
+        }
+    }
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_SingleFrame);
+    RunTest(true, ut_MultiFrameRequest);
+    RunTest(true, ut_MultiFrameResponse);
+    RunTest(true, ut_FlowControl);
+    RunTest(true, ut_TesterPresent);
+    RunTest(true, ut_Benchmark);
+    UnitTestMainEnd();
+}
@@ -11,12 +11,12 @@ using app::ModemDriver;
 
 static const int __attribute__((unused)) g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_VERBOSE | ZONE_INFO;
 
-os::StreamBuffer<uint8_t, ModemDriver::BUFFERSIZE> ModemDriver::InputBuffer;
+os::RingBuffer<uint8_t, ModemDriver::BUFFERSIZE> ModemDriver::InputBuffer;
 
 void ModemDriver::ModemDriverInterruptHandler(uint8_t data)
 {
 #define MODEM_TX_DEBUG
-#ifdef MODEM_TX_DEBUG
+#if defined(MODEM_TX_DEBUG) && !defined(SIMULATION)
     //TODO: Remove this debug lines
     USART1->DR = (data & (uint16_t)0x01FF);
 #endif
@@ -48,7 +48,7 @@ ModemDriver::ModemDriver(const hal::UsartWithDma& interface,
     return mInterface.send(in, timeout.count());
 }),
     mRecv([&](uint8_t* output, const size_t length, std::chrono::milliseconds timeout) -> bool {
-    return InputBuffer.receive(reinterpret_cast<char*>(output), length, timeout.count());
+    return InputBuffer.receive(output, length, timeout.count());
 }),
     mParser(mRecv),
     mUrcCallbackReceive([&](const size_t socket, const size_t bytes){
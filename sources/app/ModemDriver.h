@@ -12,6 +12,7 @@
 #include "TaskInterruptable.h"
 #include "DeepSleepInterface.h"
 #include "os_StreamBuffer.h"
+#include "os_RingBuffer.h"
 #include "os_Queue.h"
 #include "UsartWithDma.h"
 #include "Gpio.h"
@@ -29,7 +30,7 @@ class ModemDriver final :
     static constexpr size_t STACKSIZE = 2048;
     static constexpr size_t BUFFERSIZE = 1024;
     static constexpr size_t ERROR_THRESHOLD = 20;
-    static os::StreamBuffer<uint8_t, BUFFERSIZE> InputBuffer;
+    static os::RingBuffer<uint8_t, BUFFERSIZE> InputBuffer;
 
     std::vector<std::shared_ptr<Socket> > mSockets;
 
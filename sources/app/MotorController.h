@@ -21,6 +21,8 @@ class MotorController final :
 {
     virtual void enterDeepSleep(void) override;
     virtual void exitDeepSleep(void) override;
+    // The PWM of the motor halts in stop mode
+    virtual bool isStopModeAllowed(void) const override {return false;}
 
     static constexpr uint32_t STACKSIZE = 2048;
 
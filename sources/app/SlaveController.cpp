@@ -16,7 +16,7 @@ constexpr std::chrono::milliseconds SlaveController::UPDATE_EXTERNAL_INTERVAL;
 
 SlaveController::SlaveController(
                                  BalanceController&                     rBal,
-                                 const virt::BalanceController&         vBal,
+                                 const MasterValues&                    masterValues,
                                  const MotorController&                 rMot,
                                  virt::MotorController&                 vMot,
                                  const dev::Battery&                    rBat,
@@ -30,9 +30,7 @@ SlaveController::SlaveController(
                                  virt::TemperatureSensor&               vTemp3,
                                  virt::TemperatureSensor&               vTemp4,
                                  const dev::Light&                      rLight1,
-                                 const dev::Light&                      rLight2,
-                                 const virt::Light&                     vLight1,
-                                 const virt::Light&                     vLight2) :
+                                 const dev::Light&                      rLight2) :
     mUpdateExternalObjectsTask("6UpdateExternalTask",
                                SlaveController::STACKSIZE,
                                os::Task::Priority::HIGH,
@@ -48,7 +46,11 @@ SlaveController::SlaveController(
     UpdateInternalObjectsTaskFunction(join);
 }),
     mRealBalancer(rBal),
-    mVirtBalancer(vBal),
+    mMasterValues(masterValues),
+    // The descriptions are overwritten by the first snapshot
+    mVirtLight1(interface::Light::HEADLIGHT),
+    mVirtLight2(interface::Light::HEADLIGHT),
+    mVirtBalancer(),
     mRealMotorController(rMot),
     mVirtMotorController(vMot),
     mRealBattery(rBat),
@@ -62,14 +64,14 @@ SlaveController::SlaveController(
     mVirtTempSensor3(vTemp3),
     mVirtTempSensor4(vTemp4),
     mRealLight1(rLight1),
-    mRealLight2(rLight2),
-    mVirtLight1(vLight1),
-    mVirtLight2(vLight2)
+    mRealLight2(rLight2)
 {}
 
 void SlaveController::UpdateInternalObjectsTaskFunction(const bool& join)
 {
     do {
+        mMasterValues.readSnapshot(mVirtLight1, mVirtLight2, mVirtBalancer);
+
         mRealBalancer.setTargetAngleInDegree(mVirtBalancer.getTargetAngleInDegree());
 
         mRealLight1.setColor(mVirtLight1.getColor());
@@ -16,12 +16,18 @@
 #include "Battery.h"
 #include "Light.h"
 #include "TaskInterruptable.h"
+#include "DataTransferObject.h"
 #include <limits>
 
 namespace app
 {
 class SlaveController final
 {
+public:
+    // Values which the master sends, see masterToSlaveDTO in main.cpp
+    using MasterValues = com::DataTransferObject<virt::Light, virt::Light, virt::BalanceController>;
+
+private:
     static constexpr uint32_t STACKSIZE = 1024;
     static constexpr auto UPDATE_INTERNAL_INTERVAL = std::chrono::milliseconds(20);
     static constexpr auto UPDATE_EXTERNAL_INTERVAL = std::chrono::milliseconds(20);
@@ -30,7 +36,12 @@ class SlaveController final
     os::TaskInterruptable mUpdateInternalObjectsTask;
 
     BalanceController& mRealBalancer;
-    const virt::BalanceController& mVirtBalancer;
+
+    // Consistent copy of the last frame of the master, taken by readSnapshot
+    const MasterValues& mMasterValues;
+    virt::Light mVirtLight1;
+    virt::Light mVirtLight2;
+    virt::BalanceController mVirtBalancer;
 
     const MotorController& mRealMotorController;
     virt::MotorController& mVirtMotorController;
@@ -51,15 +62,12 @@ class SlaveController final
     const dev::Light& mRealLight1;
     const dev::Light& mRealLight2;
 
-    const virt::Light& mVirtLight1;
-    const virt::Light& mVirtLight2;
-
     void UpdateExternalObjectsTaskFunction(const bool&);
     void UpdateInternalObjectsTaskFunction(const bool&);
 
 public:
     SlaveController(BalanceController&,
-                    const virt::BalanceController&,
+                    const MasterValues&,
                     const MotorController&,
                     virt::MotorController&,
                     const dev::Battery&,
@@ -73,9 +81,7 @@ public:
                     virt::TemperatureSensor&,
                     virt::TemperatureSensor&,
                     const dev::Light&,
-                    const dev::Light&,
-                    const virt::Light&,
-                    const virt::Light&);
+                    const dev::Light&);
 
     SlaveController(const SlaveController&) = delete;
     SlaveController(SlaveController&&) = delete;
@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include "TestCrc.h"
+#include "CRC.h"
+#include "SoftwareCrc8.h"
+#include "trace.h"
+
+static const int __attribute__((used)) g_DebugZones = ZONE_ERROR | ZONE_WARNING |
+                                                      ZONE_VERBOSE | ZONE_INFO;
+using hal::Crc;
+using hal::Factory;
+using os::TaskEndless;
+
+static constexpr size_t BENCHMARK_LENGTH = 1024;
+static constexpr SoftwareCrc8<8> slice8(0x83);
+
+static uint8_t benchmarkData[BENCHMARK_LENGTH];
+
+template<typename Function>
+static void traceCyclesPerByte(const char* name, const size_t length, Function f)
+{
+    const uint32_t start = DWT->CYCCNT;
+    const uint8_t crc = f(benchmarkData, length);
+    const uint32_t cycles = DWT->CYCCNT - start;
+    Trace(ZONE_INFO, "%s %d byte: %d cycles, %d.%02d cycles/byte, crc 0x%02x\r\n", name, length, cycles,
+          cycles / length, (cycles * 100 / length) % 100, crc);
+}
+
+const TaskEndless app::crcTest("CrcBenchmark", 1024, os::Task::Priority::LOW, [](const bool&){
+                               constexpr auto& crcUnit = Factory<Crc>::get<Crc::SYSTEM_CRC>();
+
+                               CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+                               DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+                               for (size_t i = 0; i < BENCHMARK_LENGTH; i++) {
+                                   benchmarkData[i] = static_cast<uint8_t>(i * 7 + 3);
+                               }
+
+                               while (true) {
+                                   for (const size_t length : {16u, 64u, 1024u}) {
+                                       traceCyclesPerByte("bytewise  ", length, [](uint8_t const* data, size_t len) {
+                                CRC_ResetDR();
+                                while (len--) {
+                                    CRC_CalcCRC8bits(*data++);
+                                }
+                                return static_cast<uint8_t>(CRC_GetCRC());
+                            });
+                                       // Word wise below the DMA threshold, DMA above
+                                       traceCyclesPerByte("getCrc    ", length, [](uint8_t const* data, size_t len) {
+                                return crcUnit.getCrc(data, len);
+                            });
+                                       traceCyclesPerByte("slice by 4", length, [](uint8_t const* data, size_t len) {
+                                return crcUnit.getCrcFromISR(data, len);
+                            });
+                                       traceCyclesPerByte("slice by 8", length, [](uint8_t const* data, size_t len) {
+                                return slice8.calculate(0, data, len);
+                            });
+                                   }
+                                   os::ThisTask::sleep(std::chrono::seconds(5));
+                               }
+    });
@@ -0,0 +1,13 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#pragma once
+
+#include "TaskEndless.h"
+
+namespace app
+{
+extern const os::TaskEndless crcTest;
+}
@@ -0,0 +1,25 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include "TestCriticalSection.h"
+#include "trace.h"
+
+#ifndef MEASURE_CRITICAL_SECTIONS
+#error "Build with -DMEASURE_CRITICAL_SECTIONS"
+#endif
+
+static const int __attribute__((used)) g_DebugZones = ZONE_ERROR | ZONE_WARNING |
+                                                      ZONE_VERBOSE | ZONE_INFO;
+using os::TaskEndless;
+
+const TaskEndless app::criticalSectionTest("CriticalSection", 1024, os::Task::Priority::LOW, [](const bool&){
+                                           os::ThisTask::resetMaxCriticalSectionCycles();
+
+                                           while (true) {
+                                               os::ThisTask::sleep(std::chrono::seconds(1));
+                                               Trace(ZONE_INFO, "Longest critical section: %d cycles\r\n",
+                                                     os::ThisTask::getMaxCriticalSectionCycles());
+                                           }
+    });
@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include "TestLinkQuality.h"
+#include "LinkQuality.h"
+#include "stm32f30x.h"
+#include "trace.h"
+
+static const int __attribute__((used)) g_DebugZones = ZONE_ERROR | ZONE_WARNING |
+                                                      ZONE_VERBOSE | ZONE_INFO;
+using os::TaskEndless;
+
+static constexpr size_t FRAMES = 1000;
+
+static com::LinkQuality quality;
+
+// Records the frames like the receive task and measures each one with the cycle counter
+const TaskEndless app::linkQualityTest("LinkQuality", 1024, os::Task::Priority::LOW, [](const bool&){
+                                       CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+                                       DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+                                       uint32_t now = 0;
+                                       uint8_t sequence = 0;
+
+                                       while (true) {
+                                           uint32_t maxCycles = 0;
+                                           uint32_t sumCycles = 0;
+
+                                           for (size_t i = 0; i < FRAMES; i++) {
+                                               now += 10 + (i & 0x7);
+                                               // Every 100th frame is lost
+                                               sequence += (i % 100 == 0) ? 2 : 1;
+
+                                               const uint32_t start = DWT->CYCCNT;
+                                               quality.update(now);
+                                               quality.goodFrame(now, sequence);
+                                               const uint32_t cycles = DWT->CYCCNT - start;
+
+                                               maxCycles = cycles > maxCycles ? cycles : maxCycles;
+                                               sumCycles += cycles;
+                                           }
+
+                                           const uint32_t cyclesPerUs = SystemCoreClock / 1000000;
+                                           Trace(ZONE_INFO, "recording: avg %d max %d cycles, max %d ns\r\n",
+                                                 sumCycles / FRAMES, maxCycles, maxCycles * 1000 / cyclesPerUs);
+                                           if (maxCycles >= cyclesPerUs) {
+                                               Trace(ZONE_ERROR, "recording takes longer than 1 us\r\n");
+                                           }
+                                           quality.trace();
+                                           os::ThisTask::sleep(std::chrono::seconds(5));
+                                       }
+    });
@@ -0,0 +1,29 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include "TestTicklessIdle.h"
+#include "TicklessIdle.h"
+#include "trace.h"
+
+static const int __attribute__((used)) g_DebugZones = ZONE_ERROR | ZONE_WARNING |
+                                                      ZONE_VERBOSE | ZONE_INFO;
+using os::TaskEndless;
+
+// Measure the idle current with the other apps removed from the build, the
+// board stops between the reports unless a module vetoes the stop mode.
+const TaskEndless app::ticklessIdleTest("TicklessIdle", 1024, os::Task::Priority::LOW, [](const bool&){
+                                        while (true) {
+                                            os::ThisTask::sleep(std::chrono::seconds(10));
+
+                                            const os::TicklessIdle::Statistics statistics =
+                                                os::TicklessIdle::getStatistics();
+                                            Trace(ZONE_INFO, "%d stops (%d ticks), %d sleeps, %d vetoes\r\n",
+                                                  statistics.stops, statistics.stoppedTicks,
+                                                  statistics.sleeps, statistics.vetoes);
+                                            Trace(ZONE_INFO, "Wake up %d us, max %d us\r\n",
+                                                  statistics.lastWakeupMicroseconds,
+                                                  statistics.maxWakeupMicroseconds);
+                                        }
+    });
@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "ClockSync.h"
+#include "log2.h"
+
+using com::ClockSync;
+
+constexpr size_t ClockSync::HEADER_SIZE;
+constexpr size_t ClockSync::LATENCY_BUCKETS;
+constexpr uint32_t ClockSync::DEFAULT_BYTES_PER_SECOND;
+constexpr uint32_t ClockSync::DELAY_TOLERANCE;
+constexpr size_t ClockSync::HISTORY;
+constexpr uint16_t ClockSync::INVALID_HOLD;
+constexpr float ClockSync::OFFSET_GAIN;
+constexpr float ClockSync::DRIFT_GAIN;
+
+ClockSync::ClockSync(const uint32_t bytesPerSecond) :
+    mBytesPerSecond(bytesPerSecond) {}
+
+void ClockSync::transmitting(const uint8_t sequence, uint8_t* const header, const uint32_t now)
+{
+    mHistory[sequence % HISTORY] = Transmission {sequence, true, now};
+
+    if (header == nullptr) {
+        return;
+    }
+    const uint32_t hold = now - mLastRxStart;
+    const uint16_t holdTime = (mHasRx && (hold < INVALID_HOLD)) ? static_cast<uint16_t>(hold) : INVALID_HOLD;
+    std::memcpy(header, &now, sizeof(now));
+    header[sizeof(now)] = mLastRxSequence;
+    std::memcpy(header + sizeof(now) + sizeof(mLastRxSequence), &holdTime, sizeof(holdTime));
+}
+
+void ClockSync::received(const uint8_t sequence, uint8_t const* const header, const uint32_t now,
+                         const size_t encodedLength)
+{
+    const uint32_t start = now - static_cast<uint32_t>(uint64_t(encodedLength) * 1000000 / mBytesPerSecond);
+
+    if (header != nullptr) {
+        uint32_t t3;
+        uint8_t echo;
+        uint16_t hold;
+        std::memcpy(&t3, header, sizeof(t3));
+        echo = header[sizeof(t3)];
+        std::memcpy(&hold, header + sizeof(t3) + sizeof(echo), sizeof(hold));
+
+        const Transmission& t1 = mHistory[echo % HISTORY];
+        if ((hold != INVALID_HOLD) && t1.isValid && (t1.sequence == echo)) {
+            const uint32_t delay = (start - t1.time) - hold;
+            // A delay which underflows is caused by a frame which got stuck
+            if (delay < 0x80000000) {
+                update(t3 - start + delay / 2, delay, start);
+            }
+        }
+
+        if (mIsSynchronised) {
+            const uint32_t latency = now - toLocal(t3, now);
+            mStatistics.latency[log2_bucket<LATENCY_BUCKETS>(latency)]++;
+        }
+    }
+
+    mLastRxSequence = sequence;
+    mLastRxStart = start;
+    mHasRx = true;
+}
+
+uint32_t ClockSync::offset(const uint32_t localTime) const
+{
+    const int32_t elapsed = static_cast<int32_t>(localTime - mLastUpdate);
+    return mOffset + static_cast<int32_t>(std::lround(mOffsetFraction + mDrift * elapsed));
+}
+
+void ClockSync::update(const uint32_t sample, const uint32_t delay, const uint32_t now)
+{
+    // The samples so far were all delayed, start over with this one
+    if (mIsSynchronised && (delay + DELAY_TOLERANCE < mStatistics.minDelay)) {
+        mFitSamples = 0;
+        mDrift = 0;
+        mIsSynchronised = false;
+    }
+
+    if (!mIsSynchronised) {
+        mOffset = sample;
+        mOffsetFraction = 0;
+        mLastUpdate = now;
+        mStatistics.minDelay = delay;
+        mStatistics.samples++;
+        mFitSamples = 1;
+        mIsSynchronised = true;
+        return;
+    }
+
+    // The shortest round trip ages, so the filter follows a slower link
+    mStatistics.minDelay = (delay < mStatistics.minDelay + 1) ? delay : mStatistics.minDelay + 1;
+    if (delay > mStatistics.minDelay + DELAY_TOLERANCE) {
+        mStatistics.rejectedSamples++;
+        return;
+    }
+    mStatistics.samples++;
+    mFitSamples++;
+
+    // The gains of a least squares line fit over all samples so far, until they drop to the
+    // fixed gains. So the drift is known soon after the start.
+    const float n = static_cast<float>(mFitSamples);
+    const float offsetGain = std::max(OFFSET_GAIN, 2 * (2 * n - 1) / (n * (n + 1)));
+    const float driftGain = std::max(DRIFT_GAIN, 6 / (n * (n + 1)));
+
+    const int32_t elapsed = static_cast<int32_t>(now - mLastUpdate);
+    const float predicted = mOffsetFraction + mDrift * elapsed;
+    const float error = static_cast<int32_t>(sample - mOffset) - predicted;
+    const float corrected = predicted + offsetGain * error;
+
+    if (elapsed > 0) {
+        mDrift += driftGain * error / elapsed;
+    }
+    const int32_t whole = static_cast<int32_t>(std::lround(corrected));
+    mOffset += whole;
+    mOffsetFraction = corrected - whole;
+    mLastUpdate = now;
+    mStatistics.drift = mDrift * 1e6f;
+}
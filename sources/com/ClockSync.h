@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace com
+{
+/**
+ * NTP style estimate of the offset and the drift of the remote clock, from
+ * timestamps which travel with the regular frames of a link. Times are in
+ * microseconds and wrap around.
+ *
+ * The sender remembers when it sent its last frames. A sync header carries the
+ * transmit time t3 and echoes the last frame received from the other side
+ * together with the time the remote held it:
+ *  t1: transmit time of the echoed frame, local clock
+ *  t2 = t3 - hold: receive time of the echoed frame, remote clock
+ *  t4: receive time of the sync header, local clock
+ * delay = (t4 - t1) - hold
+ * offset = t2 - t1 - delay / 2 = t3 - t4 + delay / 2
+ * Like NTP this assumes both directions take equally long. The receive times
+ * are taken back to the start of the frame, so frames of different length
+ * don't bias the offset.
+ *
+ * Samples which took much longer than the shortest recent round trip were
+ * delayed on one of the ways and are rejected. The others correct the offset
+ * and the drift like a phase locked loop.
+ */
+class ClockSync final
+{
+public:
+    static constexpr size_t HEADER_SIZE = sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint16_t);
+    static constexpr size_t LATENCY_BUCKETS = 16;
+    static constexpr uint32_t DEFAULT_BYTES_PER_SECOND = 115200 / 10;
+    // Samples delayed by more than this compared to the shortest round trip are rejected
+    static constexpr uint32_t DELAY_TOLERANCE = 100;
+
+    struct Statistics {
+        uint32_t samples;
+        uint32_t rejectedSamples;
+        // Shortest recent round trip without the hold time
+        uint32_t minDelay;
+        // Rate of the remote clock relative to the local one in parts per million
+        float drift;
+        // Remote transmit time to local receipt of the last frame, bucket n counts 2^(n-1) to 2^n - 1 us
+        uint32_t latency[LATENCY_BUCKETS];
+    };
+
+    ClockSync(const uint32_t bytesPerSecond = DEFAULT_BYTES_PER_SECOND);
+
+    // Called for every frame right before it's sent. The header is written if it isn't null.
+    void transmitting(const uint8_t sequence, uint8_t* const header, const uint32_t now);
+
+    // Called for every valid frame, with its header if it carried one
+    void received(const uint8_t sequence, uint8_t const* const header, const uint32_t now,
+                  const size_t encodedLength);
+
+    inline bool isSynchronised(void) const
+    {
+        return mIsSynchronised;
+    }
+
+    // Remote clock minus local clock at the given local time
+    uint32_t offset(const uint32_t localTime) const;
+
+    // Maps a remote time to local microseconds
+    inline uint32_t toLocal(const uint32_t remoteTime, const uint32_t localNow) const
+    {
+        return remoteTime - offset(localNow);
+    }
+
+    inline const Statistics& getStatistics(void) const
+    {
+        return mStatistics;
+    }
+
+private:
+    static constexpr size_t HISTORY = 16;
+    static constexpr uint16_t INVALID_HOLD = 0xffff;
+    static constexpr float OFFSET_GAIN = 0.125f;
+    static constexpr float DRIFT_GAIN = 0.002f;
+
+    struct Transmission {
+        uint8_t sequence;
+        bool isValid;
+        uint32_t time;
+    };
+
+    const uint32_t mBytesPerSecond;
+    Transmission mHistory[HISTORY] = {};
+    uint8_t mLastRxSequence = 0;
+    bool mHasRx = false;
+    uint32_t mLastRxStart = 0;
+
+    bool mIsSynchronised = false;
+    uint32_t mOffset = 0;
+    float mOffsetFraction = 0;
+    float mDrift = 0;
+    uint32_t mLastUpdate = 0;
+    uint32_t mFitSamples = 0;
+    Statistics mStatistics {};
+
+    void update(const uint32_t sample, const uint32_t delay, const uint32_t now);
+};
+}
@@ -0,0 +1,169 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <map>
+
+#include "ClockSync.h"
+#include "unittest.h"
+
+//--------------------------HELPERS--------------------------
+static constexpr uint32_t BYTES_PER_SECOND = 11520;
+
+// A node with a clock which runs off by drift ppm, the simulation runs in true nanoseconds
+struct Node {
+    com::ClockSync sync;
+    uint32_t startTime;
+    double drift;
+    size_t frameLength;
+    uint8_t sequence = 0;
+
+    uint32_t clock(const uint64_t ns) const
+    {
+        return startTime + static_cast<uint32_t>(static_cast<uint64_t>(ns * (1 + drift * 1e-6)) / 1000);
+    }
+};
+
+struct SyncResult {
+    // Time after which the error stays below 100 us and the largest error in the second half of the run
+    uint64_t convergenceTime;
+    double maxError;
+};
+
+/**
+ * Both nodes send a frame every period, the frames take the serial transfer
+ * time, a random jitter and sometimes a long additional delay.
+ */
+static SyncResult simulate(Node& a, Node& b, const uint64_t periodNs, const size_t syncInterval,
+                           const uint64_t durationNs)
+{
+    std::multimap<uint64_t, std::function<void(uint64_t)> > events;
+    uint32_t seed = 1;
+    const auto random = [&seed](const uint32_t max) {
+                            seed = seed * 1103515245 + 12345;
+                            return (seed >> 8) % max;
+                        };
+
+    std::function<void(Node&, Node&, uint64_t)> send;
+    send = [&](Node& from, Node& to, const uint64_t ns) {
+               const uint8_t sequence = from.sequence++ & 0x7f;
+               uint8_t header[com::ClockSync::HEADER_SIZE];
+               const bool hasHeader = (sequence % syncInterval) == 0;
+               from.sync.transmitting(sequence, hasHeader ? header : nullptr, from.clock(ns));
+
+               uint64_t latency = from.frameLength * 1000000000ull / BYTES_PER_SECOND + 50000 + random(200000);
+               if (random(100) < 5) {
+                   latency += 3000000;
+               }
+               std::array<uint8_t, com::ClockSync::HEADER_SIZE> copy;
+               std::copy(header, header + sizeof(header), copy.begin());
+               const size_t length = from.frameLength;
+               events.emplace(ns + latency, [&to, sequence, hasHeader, copy, length](uint64_t arrival) {
+            to.sync.received(sequence, hasHeader ? copy.data() : nullptr, to.clock(arrival), length);
+        });
+               events.emplace(ns + periodNs, [&](uint64_t next) {send(from, to, next); });
+           };
+
+    events.emplace(0, [&](uint64_t ns) {send(a, b, ns); });
+    events.emplace(periodNs / 3, [&](uint64_t ns) {send(b, a, ns); });
+
+    SyncResult result {0, 0};
+    while (!events.empty() && (events.begin()->first < durationNs)) {
+        const uint64_t now = events.begin()->first;
+        const auto event = events.begin()->second;
+        events.erase(events.begin());
+        event(now);
+
+        const double error = static_cast<int32_t>(a.sync.offset(a.clock(now)) - (b.clock(now) - a.clock(now)));
+        if (!a.sync.isSynchronised() || (std::abs(error) >= 100)) {
+            result.convergenceTime = now;
+        }
+        if (now > durationNs / 2) {
+            result.maxError = std::max(result.maxError, std::abs(error));
+        }
+    }
+    return result;
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_Convergence(void)
+{
+    TestCaseBegin();
+
+    const double drifts[] = {0, 100, -250};
+    for (const double drift : drifts) {
+        Node a {com::ClockSync(BYTES_PER_SECOND), 0xfffff000, 0, 40};
+        Node b {com::ClockSync(BYTES_PER_SECOND), 0x12345678, drift, 20};
+        const auto result = simulate(a, b, 10000000, 1, 60000000000ull);
+        const auto& statistics = a.sync.getStatistics();
+
+        printf("drift %6.1f ppm: estimated %7.2f and %7.2f ppm, converged after %4u ms, max error %5.1f us, "
+               "%u samples %u rejected\n",
+               drift, statistics.drift, b.sync.getStatistics().drift,
+               static_cast<unsigned>(result.convergenceTime / 1000000), result.maxError,
+               static_cast<unsigned>(statistics.samples), static_cast<unsigned>(statistics.rejectedSamples));
+        CHECK(result.convergenceTime < 5000000000ull);
+        CHECK(result.maxError < 100);
+        CHECK(statistics.rejectedSamples > 0);
+        // The other side sees the inverse drift
+        CHECK(std::abs(statistics.drift - drift) < 10);
+        CHECK(std::abs(b.sync.getStatistics().drift + drift) < 10);
+    }
+
+    TestCaseEnd();
+}
+
+int ut_SparseHeaders(void)
+{
+    TestCaseBegin();
+
+    // A sync header in every 8th frame of a 100 ms heartbeat
+    Node a {com::ClockSync(BYTES_PER_SECOND), 0, 0, 40};
+    Node b {com::ClockSync(BYTES_PER_SECOND), 0x80000000, 100, 20};
+    const auto result = simulate(a, b, 100000000, 8, 600000000000ull);
+    printf("sparse: converged after %u ms, max error %5.1f us\n",
+           static_cast<unsigned>(result.convergenceTime / 1000000), result.maxError);
+    CHECK(result.convergenceTime < 20000000000ull);
+    CHECK(result.maxError < 500);
+
+    TestCaseEnd();
+}
+
+int ut_Latency(void)
+{
+    TestCaseBegin();
+
+    Node a {com::ClockSync(BYTES_PER_SECOND), 1000, 0, 40};
+    Node b {com::ClockSync(BYTES_PER_SECOND), 5000000, 50, 20};
+    simulate(a, b, 10000000, 1, 10000000000ull);
+
+    // 20 byte take 1736 us, plus 50 to 250 us and in 5% of the frames 3 ms
+    const auto& latency = a.sync.getStatistics().latency;
+    uint32_t frames = 0;
+    for (size_t i = 0; i < com::ClockSync::LATENCY_BUCKETS; i++) {
+        printf("latency >= %5u us: %u\n", (i == 0) ? 0u : 1u << (i - 1), static_cast<unsigned>(latency[i]));
+        frames += latency[i];
+    }
+    CHECK(frames > 900);
+    CHECK(latency[11] > frames * 8 / 10);
+    CHECK(latency[13] > 0);
+    CHECK(latency[11] + latency[12] + latency[13] == frames);
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_Convergence);
+    RunTest(true, ut_SparseHeaders);
+    RunTest(true, ut_Latency);
+    UnitTestMainEnd();
+}
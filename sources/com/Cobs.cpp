@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include "Cobs.h"
+
+using com::Cobs;
+using com::CobsDecoder;
+using com::CobsEncoder;
+
+size_t Cobs::encode(uint8_t const* data, const size_t length, uint8_t* out)
+{
+    CobsEncoder encoder(out);
+    encoder.push(data, length);
+    return encoder.finish();
+}
+
+void CobsEncoder::push(const uint8_t byte)
+{
+    if (byte != Cobs::DELIMITER) {
+        *mIt++ = byte;
+        ++*mCode;
+    }
+    if ((byte == Cobs::DELIMITER) || (*mCode == 0xff)) {
+        // A full block of 254 bytes isn't followed by an implicit zero
+        mCode = mIt++;
+        *mCode = 1;
+    }
+}
+
+void CobsEncoder::push(uint8_t const* data, const size_t length)
+{
+    for (size_t i = 0; i < length; i++) {
+        push(data[i]);
+    }
+}
+
+size_t CobsEncoder::finish(void)
+{
+    *mIt++ = Cobs::DELIMITER;
+    return mIt - mOut;
+}
+
+bool CobsDecoder::push(const uint8_t byte)
+{
+    if (byte == Cobs::DELIMITER) {
+        const bool isFrame = mReceived != 0;
+        if (isFrame) {
+            mIsValid = mIsValid && (mRemaining == 0);
+            mLength = mIsValid ? mLength : 0;
+        }
+        mReceived = 0;
+        mRemaining = 0;
+        return isFrame;
+    }
+
+    if (mReceived++ == 0) {
+        mLength = 0;
+        mCode = 0xff;
+        mIsValid = true;
+    }
+
+    if (mRemaining == 0) {
+        if ((mCode != 0xff) && (mLength++ < mCapacity)) {
+            mData[mLength - 1] = 0;
+        }
+        mCode = byte;
+        mRemaining = byte - 1;
+    } else {
+        if (mLength++ < mCapacity) {
+            mData[mLength - 1] = byte;
+        }
+        mRemaining--;
+    }
+
+    mIsValid = mIsValid && (mLength <= mCapacity);
+    return false;
+}
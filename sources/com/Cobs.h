@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace com
+{
+/**
+ * Consistent Overhead Byte Stuffing. Encoded frames contain no zeros, so a
+ * zero delimits them and a receiver which lost or gained bytes is in sync
+ * again with the next delimiter.
+ */
+struct Cobs {
+    static constexpr uint8_t DELIMITER = 0x00;
+
+    // Encoded length of a frame with the given length, including the delimiter
+    static constexpr size_t encodedLength(const size_t length)
+    {
+        return length + length / 254 + 1 + sizeof(DELIMITER);
+    }
+
+    // Returns the encoded length including the delimiter. out needs encodedLength(length) bytes.
+    static size_t encode(uint8_t const* data, const size_t length, uint8_t* out);
+};
+
+/**
+ * Encodes a frame byte by byte, so a frame can be assembled from several
+ * buffers without copying them together first.
+ */
+class CobsEncoder final
+{
+    uint8_t* const mOut;
+    uint8_t* mCode;
+    uint8_t* mIt;
+
+public:
+    // out needs Cobs::encodedLength() of all pushed bytes
+    CobsEncoder(uint8_t* const out) :
+        mOut(out), mCode(out), mIt(out + 1)
+    {
+        *mCode = 1;
+    }
+
+    CobsEncoder(const CobsEncoder&) = delete;
+    CobsEncoder(CobsEncoder&&) = default;
+    CobsEncoder& operator=(const CobsEncoder&) = delete;
+    CobsEncoder& operator=(CobsEncoder&&) = delete;
+
+    void push(const uint8_t byte);
+    void push(uint8_t const* data, const size_t length);
+
+    // Appends the delimiter and returns the encoded length including it
+    size_t finish(void);
+};
+
+/**
+ * Decodes a COBS byte stream byte by byte into a buffer, so frames can be
+ * decoded directly out of a circular DMA buffer.
+ */
+class CobsDecoder final
+{
+    uint8_t* const mData;
+    const size_t mCapacity;
+    size_t mLength = 0;
+    size_t mReceived = 0;
+    uint8_t mCode = 0xff;
+    uint8_t mRemaining = 0;
+    bool mIsValid = true;
+
+public:
+    CobsDecoder(uint8_t* const data, const size_t capacity) :
+        mData(data), mCapacity(capacity) {}
+
+    CobsDecoder(const CobsDecoder&) = delete;
+    CobsDecoder(CobsDecoder&&) = default;
+    CobsDecoder& operator=(const CobsDecoder&) = delete;
+    CobsDecoder& operator=(CobsDecoder&&) = delete;
+
+    // Returns true if the byte delimited a frame. Consecutive delimiters don't make an empty frame.
+    bool push(const uint8_t byte);
+
+    // State of the last delimited frame. Truncated frames and frames which don't fit are invalid.
+    inline bool isValid(void) const
+    {
+        return mIsValid;
+    }
+
+    inline size_t length(void) const
+    {
+        return mLength;
+    }
+};
+}
@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <cstring>
+
+#include "Cobs.h"
+#include "unittest.h"
+
+//--------------------------HELPERS--------------------------
+static std::vector<uint8_t> encode(const std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> out(com::Cobs::encodedLength(data.size()));
+    out.resize(com::Cobs::encode(data.data(), data.size(), out.data()));
+    return out;
+}
+
+static bool decode(const std::vector<uint8_t>& encoded, std::vector<uint8_t>& data)
+{
+    std::array<uint8_t, 600> buffer;
+    com::CobsDecoder decoder(buffer.data(), data.size());
+    size_t frames = 0;
+
+    for (const auto byte : encoded) {
+        frames += decoder.push(byte);
+    }
+    data.assign(buffer.begin(), buffer.begin() + decoder.length());
+    return (frames == 1) && decoder.isValid();
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_Encode(void)
+{
+    TestCaseBegin();
+
+    CHECK(encode({}) == std::vector<uint8_t>({0x01, 0x00}));
+    CHECK(encode({0x00}) == std::vector<uint8_t>({0x01, 0x01, 0x00}));
+    CHECK(encode({0x11, 0x22, 0x00, 0x33}) == std::vector<uint8_t>({0x03, 0x11, 0x22, 0x02, 0x33, 0x00}));
+    CHECK(encode({0x11, 0x00, 0x00}) == std::vector<uint8_t>({0x02, 0x11, 0x01, 0x01, 0x00}));
+
+    std::vector<uint8_t> block(254);
+    for (size_t i = 0; i < block.size(); i++) {
+        block[i] = i + 1;
+    }
+    const auto encoded = encode(block);
+    CHECK(encoded.size() == com::Cobs::encodedLength(block.size()));
+    CHECK(encoded[0] == 0xff);
+    CHECK(encoded[255] == 0x01);
+    CHECK(0 == std::count(encoded.begin(), encoded.end() - 1, 0));
+
+    // A frame assembled from several parts equals the frame of the whole
+    std::vector<uint8_t> assembled(com::Cobs::encodedLength(1 + block.size()));
+    com::CobsEncoder encoder(assembled.data());
+    encoder.push(0x00);
+    encoder.push(block.data(), block.size());
+    assembled.resize(encoder.finish());
+    block.insert(block.begin(), 0x00);
+    CHECK(assembled == encode(block));
+
+    TestCaseEnd();
+}
+
+int ut_RoundTrip(void)
+{
+    TestCaseBegin();
+
+    uint32_t seed = 1;
+    for (size_t length = 0; length < 560; length++) {
+        std::vector<uint8_t> data(length);
+        for (auto& byte : data) {
+            seed = seed * 1103515245 + 12345;
+            // Many zeros and long runs without zeros
+            byte = (length % 3) ? (seed >> 16) & 0x03 : ((seed >> 16) | 1);
+        }
+
+        const auto encoded = encode(data);
+        CHECK(encoded.size() <= com::Cobs::encodedLength(length));
+        CHECK(0 == std::count(encoded.begin(), encoded.end() - 1, 0));
+
+        std::vector<uint8_t> decoded(length);
+        CHECK(decode(encoded, decoded));
+        CHECK(decoded == data);
+    }
+
+    TestCaseEnd();
+}
+
+int ut_Resync(void)
+{
+    TestCaseBegin();
+
+    std::array<uint8_t, 8> buffer;
+    com::CobsDecoder decoder(buffer.data(), buffer.size());
+
+    // Too long for the buffer
+    for (const auto byte : encode({1, 2, 3, 4, 5, 6, 7, 8, 9})) {
+        decoder.push(byte);
+    }
+    CHECK(!decoder.isValid());
+    CHECK(decoder.length() == 0);
+
+    // Truncated frame, the code byte promises more data
+    CHECK(!decoder.push(0x05));
+    CHECK(!decoder.push(0x11));
+    CHECK(decoder.push(0x00));
+    CHECK(!decoder.isValid());
+
+    // Consecutive delimiters are no frames
+    CHECK(!decoder.push(0x00));
+
+    // The next frame is decoded again
+    size_t frames = 0;
+    for (const auto byte : encode({0x00, 0xAB, 0x00})) {
+        frames += decoder.push(byte);
+    }
+    CHECK(frames == 1);
+    CHECK(decoder.isValid());
+    CHECK(decoder.length() == 3);
+    CHECK(buffer[0] == 0x00);
+    CHECK(buffer[1] == 0xAB);
+    CHECK(buffer[2] == 0x00);
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_Encode);
+    RunTest(true, ut_RoundTrip);
+    RunTest(true, ut_Resync);
+    UnitTestMainEnd();
+}
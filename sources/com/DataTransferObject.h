@@ -5,21 +5,39 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <tuple>
 #include <cstring>
 #include "os_Task.h"
 #include "for_each_tuple.h"
+#include "DtoSchema.h"
 #include "CRC.h"
 
 #ifdef UNITTEST
 int ut_tuple(void);
 int ut_tupleCopy(void);
 int ut_makeDto(void);
+int ut_snapshot(void);
+int ut_schema(void);
 #endif
 
 namespace com
 {
+/**
+ * updateTuple publishes the received values without masking interrupts. The
+ * referenced variables are written one after the other, so a reader which
+ * needs all values of one frame takes them with readSnapshot, like the
+ * SlaveController does.
+ *
+ * The snapshot is a seqlock with two buffers. The writer fills the buffer
+ * which isn't published and then increments the sequence. A reader retries
+ * if the sequence changed while it copied, so a reader which interrupts the
+ * writer never has to wait for it.
+ *
+ * Every frame carries the schema hash of the tuple, so a frame of a peer
+ * built with another tuple layout is rejected even if its length and CRC fit.
+ */
 template<typename ... types>
 class DataTransferObject
 {
@@ -30,14 +48,27 @@ class DataTransferObject
     typedef struct __attribute__((packed)) {
         uint32_t timestamp;
         uint8_t data [DATASIZE];
+        uint16_t schema;
         uint8_t crc;
     } DataTransferStruct;
 
     DataTransferStruct mTransferData;
 
+    uint8_t mSnapshot[2][DATASIZE];
+    volatile uint32_t mSequence = 0;
+
 public:
+    using Schema = DtoSchema<types ...>;
+
     DataTransferObject(types& ... tuple) :
-        mTransferTuple(tuple ...) {}
+        mTransferTuple(tuple ...)
+    {
+        uint8_t* ptr = mSnapshot[0];
+        for_each(mTransferTuple, [&ptr](const auto& x){
+            std::memcpy(ptr, &x, sizeof(x));
+            ptr += sizeof(x);
+        });
+    }
 
     DataTransferObject(const DataTransferObject&) = delete;
     DataTransferObject(DataTransferObject&&) = default;
@@ -48,6 +79,19 @@ public:
     void prepareForTx(void);
     bool isValid(void);
 
+    inline bool hasMatchingSchema(void) const
+    {
+        return mTransferData.schema == Schema::HASH;
+    }
+
+    // Consistent copy of the values of the last received frame
+    void readSnapshot(types& ... values) const;
+
+    inline bool isComplete(const size_t length) const
+    {
+        return length == this->length();
+    }
+
     inline uint8_t* data(void)
     {
         return reinterpret_cast<uint8_t*>(&mTransferData);
@@ -58,10 +102,17 @@ public:
         return sizeof(mTransferData);
     }
 
+    static constexpr inline size_t capacity(void)
+    {
+        return sizeof(DataTransferStruct);
+    }
+
 #ifdef UNITTEST
     friend int ::ut_tuple(void);
     friend int ::ut_tupleCopy(void);
     friend int ::ut_makeDto(void);
+    friend int ::ut_snapshot(void);
+    friend int ::ut_schema(void);
 #endif
 };
 
@@ -84,6 +135,7 @@ void com::DataTransferObject<types ...>::prepareForTx(void)
         std::memcpy(ptr, &x, sizeof(x));
         ptr += sizeof(x);
     });
+    mTransferData.schema = Schema::HASH;
     const hal::Crc& crcUnit = hal::Factory<hal::Crc>::get<hal::Crc::SYSTEM_CRC>();
     mTransferData.crc = crcUnit.getCrc(this->data(), this->length() - sizeof(mTransferData.crc));
 }
@@ -99,11 +151,31 @@ bool com::DataTransferObject<types ...>::isValid(void)
 template<typename ... types>
 void com::DataTransferObject<types ...>::updateTuple(void)
 {
+    const uint32_t sequence = mSequence + 1;
+    std::memcpy(mSnapshot[sequence % 2], mTransferData.data, DATASIZE);
+    std::atomic_thread_fence(std::memory_order_release);
+    mSequence = sequence;
+
     uint8_t const* ptr = mTransferData.data;
-    os::ThisTask::enterCriticalSection();
     for_each(mTransferTuple, [&ptr](auto& x){
         std::memcpy(&x, ptr, sizeof(x));
         ptr += sizeof(x);
     });
-    os::ThisTask::exitCriticalSection();
+}
+
+template<typename ... types>
+void com::DataTransferObject<types ...>::readSnapshot(types& ... values) const
+{
+    uint32_t sequence;
+    do {
+        sequence = mSequence;
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        uint8_t const* ptr = mSnapshot[sequence % 2];
+        for_each(std::tie(values ...), [&ptr](auto& x){
+            std::memcpy(static_cast<void*>(&x), ptr, sizeof(x));
+            ptr += sizeof(x);
+        });
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while (sequence != mSequence);
 }
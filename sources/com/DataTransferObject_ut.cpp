@@ -6,6 +6,7 @@
 #include <cmath>
 #include <iostream>
 #include <cstring>
+#include <thread>
 
 #include "DataTransferObject.h"
 #include "unittest.h"
@@ -49,7 +50,8 @@ int ut_length(void)
 
     com::DataTransferObject<uint8_t, uint32_t, uint16_t> dto(c, a, b);
 
-    const size_t length = sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint8_t) + sizeof(uint32_t) + sizeof(uint8_t);
+    const size_t length = sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint8_t) + sizeof(uint32_t) + sizeof(uint16_t) +
+                          sizeof(uint8_t);
 
     CHECK(dto.length() == length);
 
@@ -122,11 +124,20 @@ int ut_tupleCopy(void)
 
     CHECK(dtoC == c);
 
+    uint16_t dtoSchema = *(reinterpret_cast<uint16_t*>(memory +
+                                                       sizeof(uint32_t) +
+                                                       sizeof(uint32_t) +
+                                                       sizeof(uint16_t) +
+                                                       sizeof(uint8_t)));
+
+    CHECK(dtoSchema == decltype(dto)::Schema::HASH);
+
     uint8_t dtoCRC = *(reinterpret_cast<uint8_t*>(memory +
                                                   sizeof(uint32_t) +
                                                   sizeof(uint32_t) +
                                                   sizeof(uint16_t) +
-                                                  sizeof(uint8_t)));
+                                                  sizeof(uint8_t) +
+                                                  sizeof(uint16_t)));
 
     CHECK(dtoCRC == g_crc);
 
@@ -215,6 +226,97 @@ int ut_makeDto(void)
     TestCaseEnd();
 }
 
+int ut_snapshot(void)
+{
+    TestCaseBegin();
+
+    uint32_t a = 1, b = 1, c = 1;
+    auto dto = com::make_dto(a, b, c);
+
+    const auto receive = [&](const uint32_t value) {
+                             for (size_t i = 0; i < 3; i++) {
+                                 std::memcpy(dto.mTransferData.data + i * sizeof(value), &value, sizeof(value));
+                             }
+                             dto.updateTuple();
+                         };
+
+    uint32_t x = 0, y = 0, z = 0;
+    dto.readSnapshot(x, y, z);
+    CHECK(x == 1 && y == 1 && z == 1);
+
+    receive(2);
+    dto.readSnapshot(x, y, z);
+    CHECK(x == 2 && y == 2 && z == 2);
+    CHECK(a == 2 && b == 2 && c == 2);
+
+    // A reader which interrupts the writer gets the last published values
+    const uint32_t next = 3;
+    std::memcpy(dto.mSnapshot[(dto.mSequence + 1) % 2], &next, sizeof(next));
+    dto.readSnapshot(x, y, z);
+    CHECK(x == 2 && y == 2 && z == 2);
+
+    // Concurrent writer and reader
+    static constexpr uint32_t UPDATES = 200000;
+    std::thread writer([&] {
+        for (uint32_t i = 3; i < UPDATES; i++) {
+            receive(i);
+        }
+    });
+
+    size_t reads = 0, tornReads = 0;
+    uint32_t last = 0;
+    do {
+        dto.readSnapshot(x, y, z);
+        tornReads += (x != y) || (y != z) || (x < last);
+        last = x;
+        reads++;
+    } while (x != UPDATES - 1);
+    writer.join();
+
+    std::cout << reads << " snapshots read during " << UPDATES << " updates" << std::endl;
+    CHECK(tornReads == 0);
+
+    TestCaseEnd();
+}
+
+int ut_schema(void)
+{
+    TestCaseBegin();
+
+    struct Color {
+        uint8_t red, green, blue;
+    };
+
+    // Type, order and size of the members change the hash
+    static_assert(com::DtoSchema<uint32_t, uint16_t>::HASH != com::DtoSchema<uint16_t, uint32_t>::HASH, "");
+    static_assert(com::DtoSchema<uint32_t>::HASH != com::DtoSchema<int32_t>::HASH, "");
+    static_assert(com::DtoSchema<uint32_t>::HASH != com::DtoSchema<float>::HASH, "");
+    static_assert(com::DtoSchema<uint32_t>::HASH != com::DtoSchema<uint32_t, uint32_t>::HASH, "");
+    static_assert(com::DtoSchema<Color>::HASH != com::DtoSchema<uint8_t, uint8_t, uint8_t>::HASH, "");
+    static_assert(com::DtoSchema<Color>::FIELDS[0].size == 3, "");
+    static_assert(com::DtoSchema<float, int8_t>::FIELDS[1].kind == com::FieldKind::SIGNED, "");
+
+    g_crc = 0;
+    g_currentTickCount = 0;
+
+    // Same length, different order
+    uint32_t a = 0x12345678, d = 0;
+    uint16_t b = 0x9abc, c = 0;
+    auto tx = com::make_dto(a, b);
+    auto rx = com::make_dto(c, d);
+    auto rxSame = com::make_dto(a, b);
+    CHECK(tx.length() == rx.length());
+
+    tx.prepareForTx();
+    std::memcpy(rx.data(), tx.data(), tx.length());
+    std::memcpy(rxSame.data(), tx.data(), tx.length());
+    CHECK(rx.isValid());
+    CHECK(!rx.hasMatchingSchema());
+    CHECK(rxSame.hasMatchingSchema());
+
+    TestCaseEnd();
+}
+
 int main(int argc, const char* argv[])
 {
     UnitTestMainBegin();
@@ -224,6 +326,8 @@ int main(int argc, const char* argv[])
     RunTest(true, ut_tupleUpdate);
     RunTest(true, ut_tupleValid);
     RunTest(true, ut_makeDto);
+    RunTest(true, ut_snapshot);
+    RunTest(true, ut_schema);
 
     UnitTestMainEnd();
 }
@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#pragma once
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "TxRateController.h"
+
+namespace com
+{
+/**
+ * Triggers a transmission as soon as one of the watched values differs from
+ * its last transmitted value by more than its deadband. A deadband of 0
+ * triggers on every change.
+ */
+template<typename ... types>
+class Deadband final :
+    public TxTrigger
+{
+    const std::tuple<types& ...> mValues;
+    const std::tuple<types ...> mDeadbands;
+    std::tuple<types ...> mTransmitted;
+
+    template<typename T>
+    static bool isOutside(const T value, const T reference, const T deadband)
+    {
+        static_assert(std::is_arithmetic<T>::value, "Deadbands work on arithmetic values only");
+        return (value > reference ? value - reference : reference - value) > deadband;
+    }
+
+    template<size_t ... Indices>
+    bool isTriggered(std::index_sequence<Indices ...> ) const
+    {
+        bool triggered = false;
+        using swallow = int[];
+        (void)swallow {
+            1,
+            (triggered |= isOutside<types>(std::get<Indices>(mValues), std::get<Indices>(mTransmitted),
+                                           std::get<Indices>(mDeadbands)), int {}) ...
+        };
+        return triggered;
+    }
+
+public:
+    Deadband(const std::tuple<types& ...> values, const std::tuple<types ...> deadbands) :
+        mValues(values), mDeadbands(deadbands), mTransmitted(values) {}
+
+    virtual bool isTriggered(void) const override
+    {
+        return isTriggered(std::index_sequence_for<types ...> {});
+    }
+
+    virtual void transmitted(void) override
+    {
+        mTransmitted = mValues;
+    }
+};
+
+// make_deadband(std::tie(speed, current), std::make_tuple(0.5f, 1.0f))
+template<typename ... types>
+Deadband<types ...> make_deadband(const std::tuple<types& ...> values, const std::tuple<types ...> deadbands)
+{
+    return Deadband<types ...>(values, deadbands);
+}
+}
@@ -0,0 +1,191 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <tuple>
+#include <cstring>
+#include "os_Task.h"
+#include "for_each_tuple.h"
+#include "DtoSchema.h"
+#include "CRC.h"
+
+#ifdef UNITTEST
+int ut_deltaLayout(void);
+int ut_deltaKeyframe(void);
+#endif
+
+namespace com
+{
+/**
+ * Drop-in replacement for DataTransferObject, which only transfers the tuple
+ * members that changed since the last frame.
+ *
+ * Frame layout:
+ *  timestamp (4 byte)
+ *  schema hash of the tuple (2 byte)
+ *  changed (1 bit per member, LSB of the first byte is the first member)
+ *  data of the changed members in tuple order
+ *  crc (1 byte)
+ *
+ * Every KEYFRAME_INTERVAL-th frame carries all members, so a receiver which
+ * missed a frame or started late is in sync again after the next keyframe.
+ * Members are compared bytewise with the last transmitted frame.
+ */
+template<size_t KEYFRAME_INTERVAL, typename ... types>
+class DeltaTransferObject
+{
+    static_assert(KEYFRAME_INTERVAL > 0, "Invalid keyframe interval");
+
+    std::tuple<types& ...> mTransferTuple;
+
+    static constexpr size_t NUMBEROFMEMBERS = sizeof ... (types);
+    static constexpr size_t DATASIZE = pack_size<types ...> ::value;
+    static constexpr size_t BITMAPSIZE = (NUMBEROFMEMBERS + 7) / 8;
+
+    typedef struct __attribute__((packed)) {
+        uint32_t timestamp;
+        uint16_t schema;
+        uint8_t changed [BITMAPSIZE];
+        uint8_t data [DATASIZE + sizeof(uint8_t)];
+    } DataTransferStruct;
+
+    static constexpr size_t HEADERSIZE = sizeof(uint32_t) + sizeof(uint16_t) + BITMAPSIZE;
+
+    DataTransferStruct mTransferData;
+    uint8_t mLastTransmitted[DATASIZE];
+    size_t mLength = sizeof(mTransferData);
+    size_t mFramesUntilKeyframe = 0;
+
+    size_t payloadLength(void) const;
+
+public:
+    using Schema = DtoSchema<types ...>;
+
+    DeltaTransferObject(types& ... tuple) :
+        mTransferTuple(tuple ...) {}
+
+    DeltaTransferObject(const DeltaTransferObject&) = delete;
+    DeltaTransferObject(DeltaTransferObject&&) = default;
+    DeltaTransferObject& operator=(const DeltaTransferObject&) = delete;
+    DeltaTransferObject& operator=(DeltaTransferObject&&) = delete;
+
+    void updateTuple(void);
+    void prepareForTx(void);
+    bool isComplete(const size_t length);
+    bool isValid(void);
+
+    inline bool hasMatchingSchema(void) const
+    {
+        return mTransferData.schema == Schema::HASH;
+    }
+
+    inline bool isKeyframe(void) const
+    {
+        return payloadLength() == DATASIZE;
+    }
+
+    inline uint8_t* data(void)
+    {
+        return reinterpret_cast<uint8_t*>(&mTransferData);
+    }
+
+    inline size_t length(void) const
+    {
+        return mLength;
+    }
+
+    static constexpr inline size_t capacity(void)
+    {
+        return sizeof(DataTransferStruct);
+    }
+
+#ifdef UNITTEST
+    friend int ::ut_deltaLayout(void);
+    friend int ::ut_deltaKeyframe(void);
+#endif
+};
+
+template<size_t KEYFRAME_INTERVAL, typename ... _Elements>
+constexpr com::DeltaTransferObject<KEYFRAME_INTERVAL, typename std::remove_pointer_t<std::decay_t<_Elements> > ...>
+make_delta_dto(_Elements&& ... __args)
+{
+    typedef com::DeltaTransferObject<KEYFRAME_INTERVAL,
+                                     typename std::remove_pointer_t<std::decay_t<_Elements> > ...> __result_type;
+    return __result_type(std::forward<_Elements>(__args) ...);
+}
+}
+
+template<size_t KEYFRAME_INTERVAL, typename ... types>
+size_t com::DeltaTransferObject<KEYFRAME_INTERVAL, types ...>::payloadLength(void) const
+{
+    size_t length = 0;
+
+    for_each_indexed(mTransferTuple, [this, &length](const size_t i, const auto& x){
+        if (mTransferData.changed[i / 8] & (1 << (i % 8))) {
+            length += sizeof(x);
+        }
+    });
+    return length;
+}
+
+template<size_t KEYFRAME_INTERVAL, typename ... types>
+void com::DeltaTransferObject<KEYFRAME_INTERVAL, types ...>::prepareForTx(void)
+{
+    const bool keyframe = mFramesUntilKeyframe == 0;
+    mFramesUntilKeyframe = keyframe ? KEYFRAME_INTERVAL - 1 : mFramesUntilKeyframe - 1;
+
+    mTransferData.timestamp = os::Task::getTickCount();
+    mTransferData.schema = Schema::HASH;
+    std::memset(mTransferData.changed, 0, sizeof(mTransferData.changed));
+    uint8_t* last = mLastTransmitted;
+    uint8_t* ptr = mTransferData.data;
+
+    for_each_indexed(mTransferTuple, [this, keyframe, &last, &ptr](const size_t i, const auto& x){
+        if (keyframe || std::memcmp(last, &x, sizeof(x))) {
+            // The member is copied only once, so the frame matches the snapshot
+            // even if another task modifies it meanwhile.
+            std::memcpy(last, &x, sizeof(x));
+            std::memcpy(ptr, last, sizeof(x));
+            mTransferData.changed[i / 8] |= 1 << (i % 8);
+            ptr += sizeof(x);
+        }
+        last += sizeof(x);
+    });
+
+    const hal::Crc& crcUnit = hal::Factory<hal::Crc>::get<hal::Crc::SYSTEM_CRC>();
+    mLength = HEADERSIZE + payloadLength() + sizeof(uint8_t);
+    this->data()[mLength - sizeof(uint8_t)] = crcUnit.getCrc(this->data(), mLength - sizeof(uint8_t));
+}
+
+template<size_t KEYFRAME_INTERVAL, typename ... types>
+bool com::DeltaTransferObject<KEYFRAME_INTERVAL, types ...>::isComplete(const size_t length)
+{
+    mLength = length;
+    return (length > HEADERSIZE) && (length <= capacity());
+}
+
+template<size_t KEYFRAME_INTERVAL, typename ... types>
+bool com::DeltaTransferObject<KEYFRAME_INTERVAL, types ...>::isValid(void)
+{
+    const hal::Crc& crcUnit = hal::Factory<hal::Crc>::get<hal::Crc::SYSTEM_CRC>();
+    const bool crcValid = (0x00 == (crcUnit.getCrc(this->data(), this->length())));
+    return crcValid && (mLength == HEADERSIZE + payloadLength() + sizeof(uint8_t));
+}
+
+template<size_t KEYFRAME_INTERVAL, typename ... types>
+void com::DeltaTransferObject<KEYFRAME_INTERVAL, types ...>::updateTuple(void)
+{
+    uint8_t const* ptr = mTransferData.data;
+    os::ThisTask::enterCriticalSection();
+    for_each_indexed(mTransferTuple, [this, &ptr](const size_t i, auto& x){
+        if (mTransferData.changed[i / 8] & (1 << (i % 8))) {
+            std::memcpy(&x, ptr, sizeof(x));
+            ptr += sizeof(x);
+        }
+    });
+    os::ThisTask::exitCriticalSection();
+}
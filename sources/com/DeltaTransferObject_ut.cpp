@@ -0,0 +1,308 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include <cmath>
+#include <iostream>
+#include <cstring>
+
+#include "DeltaTransferObject.h"
+#include "DataTransferObject.h"
+#include "unittest.h"
+#include "os_Task.h"
+
+//--------------------------BUFFERS--------------------------
+uint32_t g_currentTickCount;
+
+//--------------------------MOCKING--------------------------
+constexpr const std::array<const hal::Crc, hal::Crc::__ENUM__SIZE> hal::Factory<hal::Crc>::Container;
+
+void os::ThisTask::enterCriticalSection(void){}
+
+void os::ThisTask::exitCriticalSection(void) {}
+
+uint32_t os::Task::getTickCount(void)
+{
+    return g_currentTickCount;
+}
+
+// The software CRC of the unit, a frame with its CRC appended results in 0
+uint8_t hal::Crc::getCrc(uint8_t const* const data, const size_t length) const
+{
+    return mSoftwareCrc.calculate(static_cast<uint8_t>(mInitialValue), data, length);
+}
+
+//--------------------------HELPERS--------------------------
+template<typename Tx, typename Rx>
+static bool transfer(Tx& tx, Rx& rx)
+{
+    tx.prepareForTx();
+    std::memcpy(rx.data(), tx.data(), tx.length());
+    if (!rx.isComplete(tx.length()) || !rx.isValid()) {
+        return false;
+    }
+    rx.updateTuple();
+    return true;
+}
+
+// The members of the virtual objects which are exchanged between master and slave
+struct Light {
+    uint8_t red, green, blue, white;
+};
+
+struct BalanceController {
+    float targetAngle;
+};
+
+struct TemperatureSensor {
+    float temperature;
+};
+
+struct Battery {
+    float temperature, current, voltage;
+};
+
+struct MotorController {
+    float torque, rps;
+};
+
+struct MasterToSlave {
+    Light light1, light2;
+    BalanceController balancer;
+};
+
+struct SlaveToMaster {
+    TemperatureSensor motorTemp, batteryTemp, fetTemp;
+    Battery battery;
+    MotorController motor;
+};
+
+/**
+ * Ride of the balance robot sampled like on the target: The SteeringController
+ * sets the target angle every 30 ms, the SlaveController samples the battery,
+ * the NTCs and the hall sensor every 20 ms. The robot stands still for the
+ * first and the last 10 s, the lights are switched twice.
+ */
+static void rideAt(const uint32_t tick, MasterToSlave& master, SlaveToMaster& slave)
+{
+    static uint32_t noise = 12345;
+    const auto adc = [](const float value, const float lsb) {
+                         noise = noise * 1103515245 + 12345;
+                         return (std::round(value / lsb) + static_cast<int>((noise >> 16) % 3) - 1) * lsb;
+                     };
+    const float t = tick / 1000.0f;
+    const bool isRiding = (t >= 10) && (t < 50);
+    const float speed = isRiding ? 4 * std::sin((t - 10) * 0.3f) : 0;
+
+    master.light1 = (t >= 5) && (t < 40) ? Light {255, 255, 255, 0} : Light {0, 0, 0, 0};
+    master.light2 = (t >= 5) ? Light {255, 0, 0, 0} : Light {0, 0, 0, 0};
+    if (tick % 30 == 0) {
+        master.balancer.targetAngle = std::round(speed * 10) / 10;
+    }
+
+    if (tick % 20 == 0) {
+        // NTCs are converted with a lookup table in steps of one degree
+        slave.motorTemp.temperature = std::floor(25 + t / 8);
+        slave.batteryTemp.temperature = std::floor(22 + t / 20);
+        slave.fetTemp.temperature = std::floor(27 + t / 6);
+        slave.battery.temperature = slave.batteryTemp.temperature;
+        slave.battery.voltage = adc(36.5f - std::fabs(speed) * 0.2f, 0.0145f);
+        slave.battery.current = isRiding ? adc(std::fabs(speed) * 2, 0.008f) : 0;
+        slave.motor.rps = std::round(speed * 6) / 6;
+    }
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_deltaLayout(void)
+{
+    TestCaseBegin();
+
+    g_currentTickCount = 0xDEADBEEF;
+
+    uint32_t a = 1, rxA = 0;
+    uint16_t b = 2, rxB = 0;
+    uint8_t c = 3, rxC = 0;
+
+    com::DeltaTransferObject<100, uint32_t, uint16_t, uint8_t> tx(a, b, c);
+    com::DeltaTransferObject<100, uint32_t, uint16_t, uint8_t> rx(rxA, rxB, rxC);
+
+    // Header of timestamp, schema and one byte bitmap
+    const size_t header = sizeof(uint32_t) + sizeof(uint16_t) + 1;
+    CHECK(tx.capacity() == header + sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint8_t) + 1);
+
+    // The first frame is a keyframe
+    CHECK(transfer(tx, rx));
+    CHECK(tx.length() == tx.capacity());
+    CHECK(rx.isKeyframe());
+    CHECK(tx.mTransferData.timestamp == g_currentTickCount);
+    CHECK(tx.mTransferData.schema == (com::DtoSchema<uint32_t, uint16_t, uint8_t>::HASH));
+    CHECK(rx.hasMatchingSchema());
+    CHECK(tx.mTransferData.changed[0] == 0b111);
+    CHECK(rxA == 1);
+    CHECK(rxB == 2);
+    CHECK(rxC == 3);
+
+    // Nothing changed, only header and crc are transferred
+    CHECK(transfer(tx, rx));
+    CHECK(tx.length() == header + 1);
+    CHECK(tx.mTransferData.changed[0] == 0);
+
+    b = 0xABCD;
+    CHECK(transfer(tx, rx));
+    CHECK(tx.length() == header + sizeof(uint16_t) + 1);
+    CHECK(tx.mTransferData.changed[0] == 0b010);
+    CHECK(!rx.isKeyframe());
+    CHECK(rxA == 1);
+    CHECK(rxB == 0xABCD);
+    CHECK(rxC == 3);
+
+    a = 0x12345678;
+    c = 0xEF;
+    CHECK(transfer(tx, rx));
+    CHECK(tx.mTransferData.changed[0] == 0b101);
+    CHECK(rxA == 0x12345678);
+    CHECK(rxB == 0xABCD);
+    CHECK(rxC == 0xEF);
+
+    // A bitmap which doesn't match the length of the frame is rejected
+    a = 0;
+    tx.prepareForTx();
+    std::memcpy(rx.data(), tx.data(), tx.length());
+    rx.mTransferData.changed[0] = 0b011;
+    rx.mTransferData.data[tx.length() - sizeof(uint32_t) - 1 - 1] = hal::Factory<hal::Crc>::get<hal::Crc::SYSTEM_CRC>().getCrc(
+        rx.data(), tx.length() - 1);
+    CHECK(rx.isComplete(tx.length()));
+    CHECK(!rx.isValid());
+
+    // Frames shorter than the header are incomplete
+    CHECK(!rx.isComplete(sizeof(uint32_t) + 1));
+    CHECK(!rx.isComplete(rx.capacity() + 1));
+
+    TestCaseEnd();
+}
+
+int ut_deltaKeyframe(void)
+{
+    TestCaseBegin();
+
+    g_currentTickCount = 0;
+
+    uint32_t a = 1, rxA = 0;
+    float b = 2, rxB = 0;
+
+    com::DeltaTransferObject<4, uint32_t, float> tx(a, b);
+    com::DeltaTransferObject<4, uint32_t, float> rx(rxA, rxB);
+
+    CHECK(transfer(tx, rx));
+    CHECK(rx.isKeyframe());
+
+    // The frame with the update of a is lost
+    a = 5;
+    tx.prepareForTx();
+    CHECK(tx.mTransferData.changed[0] == 0b01);
+
+    CHECK(transfer(tx, rx));
+    CHECK(!rx.isKeyframe());
+    CHECK(rxA == 1);
+    CHECK(transfer(tx, rx));
+    CHECK(rxA == 1);
+
+    // The next keyframe resynchronizes the receiver
+    CHECK(transfer(tx, rx));
+    CHECK(rx.isKeyframe());
+    CHECK(rxA == 5);
+    CHECK(rxB == 2);
+
+    // A corrupted frame is rejected
+    b = 3;
+    tx.prepareForTx();
+    std::memcpy(rx.data(), tx.data(), tx.length());
+    rx.data()[sizeof(uint32_t) + 1] ^= 0x10;
+    CHECK(rx.isComplete(tx.length()));
+    CHECK(!rx.isValid());
+
+    TestCaseEnd();
+}
+
+int ut_deltaRide(void)
+{
+    TestCaseBegin();
+
+    // 115200 baud, 8N1
+    constexpr double LINKBYTESPERSECOND = 115200 / 10;
+    constexpr uint32_t TXINTERVAL = 10;
+    constexpr uint32_t RIDEDURATION = 60000;
+
+    MasterToSlave master {}, masterRx {}, masterRxFull {};
+    SlaveToMaster slave {}, slaveRx {}, slaveRxFull {};
+
+    auto fullM2S = com::make_dto(master.light1, master.light2, master.balancer);
+    auto fullS2M = com::make_dto(slave.motorTemp, slave.batteryTemp, slave.fetTemp, slave.battery, slave.motor);
+    auto fullM2SRx = com::make_dto(masterRxFull.light1, masterRxFull.light2, masterRxFull.balancer);
+    auto fullS2MRx = com::make_dto(slaveRxFull.motorTemp, slaveRxFull.batteryTemp, slaveRxFull.fetTemp,
+                                   slaveRxFull.battery, slaveRxFull.motor);
+
+    // Keyframe every second
+    auto deltaM2S = com::make_delta_dto<100>(master.light1, master.light2, master.balancer);
+    auto deltaS2M = com::make_delta_dto<100>(slave.motorTemp, slave.batteryTemp, slave.fetTemp, slave.battery,
+                                             slave.motor);
+    auto deltaM2SRx = com::make_delta_dto<100>(masterRx.light1, masterRx.light2, masterRx.balancer);
+    auto deltaS2MRx = com::make_delta_dto<100>(slaveRx.motorTemp, slaveRx.batteryTemp, slaveRx.fetTemp,
+                                               slaveRx.battery, slaveRx.motor);
+
+    size_t updates = 0;
+    size_t fullBytes[2] = {0, 0};
+    size_t deltaBytes[2] = {0, 0};
+    size_t keyframes = 0;
+
+    for (uint32_t tick = 0; tick < RIDEDURATION; tick++) {
+        rideAt(tick, master, slave);
+        g_currentTickCount = tick;
+
+        if (tick % TXINTERVAL) {
+            continue;
+        }
+
+        CHECK(transfer(fullM2S, fullM2SRx));
+        CHECK(transfer(fullS2M, fullS2MRx));
+        CHECK(transfer(deltaM2S, deltaM2SRx));
+        CHECK(transfer(deltaS2M, deltaS2MRx));
+
+        CHECK(0 == std::memcmp(&master, &masterRx, sizeof(master)));
+        CHECK(0 == std::memcmp(&slave, &slaveRx, sizeof(slave)));
+
+        fullBytes[0] += fullM2S.length();
+        fullBytes[1] += fullS2M.length();
+        deltaBytes[0] += deltaM2S.length();
+        deltaBytes[1] += deltaS2M.length();
+        keyframes += deltaS2MRx.isKeyframe();
+        updates++;
+    }
+
+    const double updatesPerSecond = 1000.0 / TXINTERVAL;
+    const char* direction[2] = {"master->slave", "slave->master"};
+    for (size_t i = 0; i < 2; i++) {
+        const double full = static_cast<double>(fullBytes[i]) / updates;
+        const double delta = static_cast<double>(deltaBytes[i]) / updates;
+        std::cout << direction[i] << ": full " << full << " byte/update ("
+                  << 100 * full * updatesPerSecond / LINKBYTESPERSECOND << "% link), delta "
+                  << delta << " byte/update (" << 100 * delta * updatesPerSecond / LINKBYTESPERSECOND
+                  << "% link)" << std::endl;
+        CHECK(delta < full);
+    }
+    CHECK(keyframes >= updates / 100);
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_deltaLayout);
+    RunTest(true, ut_deltaKeyframe);
+    RunTest(true, ut_deltaRide);
+
+    UnitTestMainEnd();
+}
@@ -0,0 +1,192 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#pragma once
+
+#include <cstring>
+#include <ostream>
+#include <string>
+#include "ClockSync.h"
+#include "Cobs.h"
+#include "DtoSchema.h"
+#include "LinkQuality.h"
+#include "SoftwareCrc8.h"
+
+namespace com
+{
+/**
+ * Host side decoder for a captured UART log of app::Communication, which
+ * sends COBS framed DataTransferObject frames behind a sequence number and
+ * sometimes a ClockSync header, e.g. for logging on a PC.
+ *
+ * It is generated from the schema of the firmware's DTO, so it needs neither
+ * the member types nor the hal:
+ *  com::DtoDecoder<decltype(dto)::Schema> decoder;
+ *  decoder.decode(log, length, [](uint32_t timestamp, uint8_t const* data) {});
+ *
+ * The log may be fed in chunks of any size. Frames with a wrong length, CRC
+ * or schema are counted and skipped, like the frames missing in the sequence.
+ */
+template<typename Schema>
+class DtoDecoder final
+{
+    static constexpr size_t dataSize(void)
+    {
+        size_t size = 0;
+        for (size_t i = 0; i < Schema::COUNT; i++) {
+            size += Schema::FIELDS[i].size;
+        }
+        return size;
+    }
+
+public:
+    static constexpr size_t DATASIZE = dataSize();
+    // timestamp, data, schema, crc
+    static constexpr size_t FRAMESIZE = sizeof(uint32_t) + DATASIZE + sizeof(uint16_t) + sizeof(uint8_t);
+    static constexpr size_t SEQUENCE_SIZE = sizeof(uint8_t);
+    static constexpr uint8_t SYNC_FLAG = 0x80;
+
+    struct Statistics {
+        size_t frames;
+        size_t lengthErrors;
+        size_t crcErrors;
+        size_t schemaErrors;
+        size_t sequenceGaps;
+    };
+
+    // The polynomial of hal::Crc::SYSTEM_CRC
+    DtoDecoder(const uint8_t crcPolynomial = 0x83) :
+        mCrc(crcPolynomial), mDecoder(mFrame, sizeof(mFrame)) {}
+
+    // Calls onFrame(timestamp, data) with the member data of every valid frame
+    template<typename Function>
+    void decode(uint8_t const* stream, size_t length, Function onFrame)
+    {
+        while (length--) {
+            if (mDecoder.push(*stream++)) {
+                handleFrame(onFrame);
+            }
+        }
+    }
+
+    inline const Statistics& getStatistics(void) const
+    {
+        return mStatistics;
+    }
+
+    // Format of a whole frame without a sync header including the sequence number for the struct
+    // module of Python, for scripts which decode the log themselves
+    static std::string structFormat(void)
+    {
+        std::string format = "<BI";
+        for (size_t i = 0; i < Schema::COUNT; i++) {
+            format += fieldFormat(Schema::FIELDS[i]);
+        }
+        return format + "HB";
+    }
+
+    static void writeCsvHeader(std::ostream& out)
+    {
+        out << "timestamp";
+        for (size_t i = 0; i < Schema::COUNT; i++) {
+            out << ",field" << i;
+        }
+        out << '\n';
+    }
+
+    static void writeCsv(std::ostream& out, const uint32_t timestamp, uint8_t const* data)
+    {
+        out << timestamp;
+        for (size_t i = 0; i < Schema::COUNT; i++) {
+            out << ',';
+            writeField(out, Schema::FIELDS[i], data);
+            data += Schema::FIELDS[i].size;
+        }
+        out << '\n';
+    }
+
+private:
+    const SoftwareCrc8<8> mCrc;
+    uint8_t mFrame[SEQUENCE_SIZE + ClockSync::HEADER_SIZE + FRAMESIZE];
+    CobsDecoder mDecoder;
+    Statistics mStatistics {};
+    uint8_t mLastSequence = 0;
+
+    template<typename Function>
+    void handleFrame(Function& onFrame)
+    {
+        const size_t headerSize = SEQUENCE_SIZE + ((mFrame[0] & SYNC_FLAG) ? ClockSync::HEADER_SIZE : 0);
+        if (!mDecoder.isValid() || (mDecoder.length() != headerSize + FRAMESIZE)) {
+            mStatistics.lengthErrors++;
+            return;
+        }
+        uint8_t const* const frame = mFrame + headerSize;
+        if (mCrc.calculate(0, frame, FRAMESIZE) != 0) {
+            mStatistics.crcErrors++;
+            return;
+        }
+
+        uint16_t schema;
+        std::memcpy(&schema, frame + sizeof(uint32_t) + DATASIZE, sizeof(schema));
+        if (schema != Schema::HASH) {
+            mStatistics.schemaErrors++;
+            return;
+        }
+
+        const uint8_t sequence = mFrame[0] & LinkQuality::SEQUENCE_MASK;
+        if (mStatistics.frames != 0) {
+            mStatistics.sequenceGaps += (sequence - mLastSequence - 1) & LinkQuality::SEQUENCE_MASK;
+        }
+        mLastSequence = sequence;
+
+        uint32_t timestamp;
+        std::memcpy(&timestamp, frame, sizeof(timestamp));
+        mStatistics.frames++;
+        onFrame(timestamp, frame + sizeof(uint32_t));
+    }
+
+    static std::string fieldFormat(const FieldDescriptor& field)
+    {
+        const char* const formats[][9] = {
+            {"", "B", "H", "", "I", "", "", "", "Q"},
+            {"", "b", "h", "", "i", "", "", "", "q"},
+            {"", "", "", "", "f", "", "", "", "d"}
+        };
+        if ((field.kind != FieldKind::OTHER) && (field.size <= 8) &&
+            (*formats[static_cast<size_t>(field.kind)][field.size] != '\0'))
+        {
+            return formats[static_cast<size_t>(field.kind)][field.size];
+        }
+        return std::to_string(field.size) + "s";
+    }
+
+    static void writeField(std::ostream& out, const FieldDescriptor& field, uint8_t const* data)
+    {
+        if ((field.kind == FieldKind::FLOAT) && (field.size == sizeof(float))) {
+            float value;
+            std::memcpy(&value, data, sizeof(value));
+            out << value;
+        } else if ((field.kind == FieldKind::FLOAT) && (field.size == sizeof(double))) {
+            double value;
+            std::memcpy(&value, data, sizeof(value));
+            out << value;
+        } else if ((field.kind != FieldKind::OTHER) && (field.size <= sizeof(uint64_t))) {
+            uint64_t value = 0;
+            std::memcpy(&value, data, field.size);
+            const bool isNegative = (field.kind == FieldKind::SIGNED) && (data[field.size - 1] & 0x80);
+            if (isNegative) {
+                out << static_cast<int64_t>(value | (~0ull << (8 * field.size - 1)));
+            } else {
+                out << value;
+            }
+        } else {
+            static const char hex[] = "0123456789abcdef";
+            for (size_t i = 0; i < field.size; i++) {
+                out << hex[data[i] >> 4] << hex[data[i] & 0xf];
+            }
+        }
+    }
+};
+}
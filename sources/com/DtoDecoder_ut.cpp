@@ -0,0 +1,221 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "DataTransferObject.h"
+#include "DtoDecoder.h"
+#include "unittest.h"
+
+//--------------------------BUFFERS--------------------------
+uint32_t g_currentTickCount;
+
+//--------------------------MOCKING--------------------------
+constexpr const std::array<const hal::Crc, hal::Crc::__ENUM__SIZE> hal::Factory<hal::Crc>::Container;
+
+void os::ThisTask::enterCriticalSection(void) {}
+
+void os::ThisTask::exitCriticalSection(void) {}
+
+uint32_t os::Task::getTickCount(void)
+{
+    return g_currentTickCount;
+}
+
+uint8_t hal::Crc::getCrc(uint8_t const* const data, const size_t length) const
+{
+    return mSoftwareCrc.calculate(static_cast<uint8_t>(mInitialValue), data, length);
+}
+
+//--------------------------HELPERS--------------------------
+struct Color {
+    uint8_t red, green, blue;
+};
+
+// Like the slave to master DTO
+struct Values {
+    float motorTemperature = 0;
+    float batteryTemperature = 0;
+    int16_t current = 0;
+    uint32_t speed = 0;
+    Color color {};
+};
+
+// Like app::Communication, which sends a sequence number and in every 8th frame a sync header in front of the DTO
+template<typename Dto>
+static void appendFrame(Dto& dto, std::vector<uint8_t>& log)
+{
+    static uint8_t sequence = 0;
+    static com::ClockSync sync;
+    dto.prepareForTx();
+    const size_t offset = log.size();
+    log.resize(offset + com::Cobs::encodedLength(1 + com::ClockSync::HEADER_SIZE + dto.length()));
+
+    uint8_t header[com::ClockSync::HEADER_SIZE];
+    const bool hasHeader = (sequence % 8) == 0;
+    sync.transmitting(sequence, hasHeader ? header : nullptr, g_currentTickCount * 1000);
+
+    com::CobsEncoder encoder(log.data() + offset);
+    encoder.push(hasHeader ? sequence | 0x80 : sequence);
+    if (hasHeader) {
+        encoder.push(header, sizeof(header));
+    }
+    encoder.push(dto.data(), dto.length());
+    log.resize(offset + encoder.finish());
+    sequence = (sequence + 1) & com::LinkQuality::SEQUENCE_MASK;
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_DecodeLog(void)
+{
+    TestCaseBegin();
+
+    Values tx;
+    auto dto = com::make_dto(tx.motorTemperature, tx.batteryTemperature, tx.current, tx.speed, tx.color);
+    using Decoder = com::DtoDecoder<decltype(dto)::Schema>;
+    CHECK(Decoder::FRAMESIZE == dto.length());
+
+    // The capture started in the middle of a frame
+    std::vector<uint8_t> log {0x12, 0x34, com::Cobs::DELIMITER};
+    for (uint32_t i = 0; i < 10; i++) {
+        g_currentTickCount = 10 * i;
+        tx.current = -static_cast<int16_t>(i);
+        tx.speed = i;
+        appendFrame(dto, log);
+    }
+
+    // Fed in chunks which split the frames
+    Decoder decoder;
+    std::vector<uint32_t> timestamps;
+    for (size_t offset = 0; offset < log.size(); offset += 7) {
+        decoder.decode(log.data() + offset, std::min<size_t>(7, log.size() - offset),
+                       [&](uint32_t timestamp, uint8_t const* data) {
+            int16_t current;
+            std::memcpy(&current, data + 2 * sizeof(float), sizeof(current));
+            CHECK(current == -static_cast<int16_t>(timestamps.size()));
+            timestamps.push_back(timestamp);
+        });
+    }
+    CHECK(timestamps.size() == 10);
+    CHECK(timestamps.back() == 90);
+    CHECK(decoder.getStatistics().lengthErrors == 1);
+    CHECK(decoder.getStatistics().frames == 10);
+
+    TestCaseEnd();
+}
+
+int ut_RejectFrames(void)
+{
+    TestCaseBegin();
+
+    uint32_t a = 1;
+    uint16_t b = 2;
+    auto dto = com::make_dto(a, b);
+    auto reordered = com::make_dto(b, a);
+    auto longer = com::make_dto(a, a);
+
+    std::vector<uint8_t> log;
+    appendFrame(reordered, log);
+    appendFrame(longer, log);
+    appendFrame(dto, log);
+    log[log.size() - 3] ^= 0x01;
+    appendFrame(dto, log);
+
+    com::DtoDecoder<decltype(dto)::Schema> decoder;
+    decoder.decode(log.data(), log.size(), [](uint32_t, uint8_t const*){});
+    CHECK(decoder.getStatistics().schemaErrors == 1);
+    CHECK(decoder.getStatistics().lengthErrors == 1);
+    CHECK(decoder.getStatistics().crcErrors == 1);
+    CHECK(decoder.getStatistics().frames == 1);
+
+    // A frame which never made it into the log
+    std::vector<uint8_t> lost;
+    appendFrame(dto, lost);
+    const size_t end = log.size();
+    appendFrame(dto, log);
+    decoder.decode(log.data() + end, log.size() - end, [](uint32_t, uint8_t const*){});
+    CHECK(decoder.getStatistics().frames == 2);
+    CHECK(decoder.getStatistics().sequenceGaps == 1);
+
+    TestCaseEnd();
+}
+
+int ut_Output(void)
+{
+    TestCaseBegin();
+
+    using Decoder = com::DtoDecoder<com::DtoSchema<float, int16_t, uint32_t, Color, double> >;
+    CHECK(Decoder::structFormat() == "<BIfhI3sdHB");
+
+    const float f = 1.5f;
+    const int16_t i = -300;
+    const uint32_t u = 4000000000u;
+    const Color color {0x01, 0xab, 0xff};
+    const double d = -0.25;
+    uint8_t data[Decoder::DATASIZE];
+    std::memcpy(data, &f, 4);
+    std::memcpy(data + 4, &i, 2);
+    std::memcpy(data + 6, &u, 4);
+    std::memcpy(data + 10, &color, 3);
+    std::memcpy(data + 13, &d, 8);
+
+    std::ostringstream csv;
+    Decoder::writeCsvHeader(csv);
+    Decoder::writeCsv(csv, 42, data);
+    CHECK(csv.str() == "timestamp,field0,field1,field2,field3,field4\n42,1.5,-300,4000000000,01abff,-0.25\n");
+
+    TestCaseEnd();
+}
+
+int ut_Benchmark(void)
+{
+    TestCaseBegin();
+
+    Values tx;
+    auto dto = com::make_dto(tx.motorTemperature, tx.batteryTemperature, tx.current, tx.speed, tx.color);
+
+    std::vector<uint8_t> log;
+    for (uint32_t i = 0; log.size() < 16 * 1024 * 1024; i++) {
+        g_currentTickCount = i;
+        tx.motorTemperature = i * 0.01f;
+        tx.current = i;
+        tx.speed = i * 3;
+        tx.color.green = i;
+        appendFrame(dto, log);
+    }
+
+    com::DtoDecoder<decltype(dto)::Schema> decoder;
+    uint64_t sum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    decoder.decode(log.data(), log.size(), [&](uint32_t timestamp, uint8_t const*) {
+        sum += timestamp;
+    });
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+
+    const double megabytesPerSecond = log.size() / duration.count() / 1e6;
+    std::cout << decoder.getStatistics().frames << " frames, " << log.size() / 1e6 << " MB decoded with "
+              << megabytesPerSecond << " MB/s" << std::endl;
+    CHECK(decoder.getStatistics().lengthErrors == 0);
+    CHECK(decoder.getStatistics().sequenceGaps == 0);
+    CHECK(decoder.getStatistics().crcErrors == 0);
+    CHECK(sum > 0);
+    CHECK(megabytesPerSecond > 10);
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_DecodeLog);
+    RunTest(true, ut_RejectFrames);
+    RunTest(true, ut_Output);
+    RunTest(true, ut_Benchmark);
+    UnitTestMainEnd();
+}
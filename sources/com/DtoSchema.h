@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace com
+{
+enum class FieldKind : uint8_t {
+    UNSIGNED = 0,
+    SIGNED,
+    FLOAT,
+    OTHER
+};
+
+// Size and kind of a DTO member, so a host can decode a frame without the member types
+struct FieldDescriptor {
+    uint16_t size;
+    FieldKind kind;
+    uint32_t id;
+};
+
+/**
+ * Members with the same size and kind can't be told apart. Specialize this
+ * for class types which must not be exchanged for each other.
+ */
+template<typename T>
+struct dto_type_id {
+    static constexpr uint32_t value = 0;
+};
+
+template<typename T>
+constexpr FieldDescriptor describeField(void)
+{
+    return FieldDescriptor {
+               static_cast<uint16_t>(sizeof(T)),
+               std::is_floating_point<T>::value ? FieldKind::FLOAT :
+               (std::is_integral<T>::value && std::is_signed<T>::value) ? FieldKind::SIGNED :
+               std::is_integral<T>::value ? FieldKind::UNSIGNED : FieldKind::OTHER,
+               dto_type_id<T>::value
+    };
+}
+
+/**
+ * FNV-1a over the size, kind and id of the members in tuple order, folded to
+ * 16 bit. Master and slave compare it to reject frames of a different layout.
+ */
+template<typename ... types>
+constexpr uint16_t schemaHash(void)
+{
+    // The last descriptor keeps the array valid for an empty pack
+    const FieldDescriptor fields[] = {describeField<types>() ..., FieldDescriptor {0, FieldKind::OTHER, 0}};
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < sizeof ... (types); i++) {
+        const uint8_t bytes[] = {
+            static_cast<uint8_t>(fields[i].size), static_cast<uint8_t>(fields[i].size >> 8),
+            static_cast<uint8_t>(fields[i].kind),
+            static_cast<uint8_t>(fields[i].id), static_cast<uint8_t>(fields[i].id >> 8),
+            static_cast<uint8_t>(fields[i].id >> 16), static_cast<uint8_t>(fields[i].id >> 24)
+        };
+        for (const uint8_t byte : bytes) {
+            hash = (hash ^ byte) * 16777619u;
+        }
+    }
+    return static_cast<uint16_t>(hash ^ (hash >> 16));
+}
+
+template<typename ... types>
+struct DtoSchema {
+    static constexpr size_t COUNT = sizeof ... (types);
+    static constexpr uint16_t HASH = schemaHash<types ...>();
+    static constexpr FieldDescriptor FIELDS[COUNT + 1] = {describeField<types>() ...,
+                                                          FieldDescriptor {0, FieldKind::OTHER, 0}};
+};
+
+template<typename ... types>
+constexpr FieldDescriptor DtoSchema<types ...>::FIELDS[];
+}
@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include "LinkQuality.h"
+#include "trace.h"
+
+static const int __attribute__((unused)) g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_VERBOSE | ZONE_INFO;
+
+using com::LinkQuality;
+
+constexpr uint8_t LinkQuality::SEQUENCE_MASK;
+
+void LinkQuality::goodFrame(const uint32_t now, const uint8_t sequence)
+{
+    if (mHasGoodFrame) {
+        const uint32_t interval = now - mLastGoodFrame;
+        mStatistics.interArrival[bucket(interval)]++;
+        mStatistics.sequenceGaps += (sequence - mLastSequence - 1) & SEQUENCE_MASK;
+        mStatistics.maxGoodFrameAge = interval > mStatistics.maxGoodFrameAge ? interval : mStatistics.maxGoodFrameAge;
+    }
+    mStatistics.framesOk++;
+    mStatistics.lastGoodFrameAge = 0;
+    mLastGoodFrame = now;
+    mLastSequence = sequence;
+    mHasGoodFrame = true;
+}
+
+void LinkQuality::update(const uint32_t now)
+{
+    mStatistics.lastGoodFrameAge = now - mLastGoodFrame;
+    if (mStatistics.lastGoodFrameAge > mStatistics.maxGoodFrameAge) {
+        mStatistics.maxGoodFrameAge = mStatistics.lastGoodFrameAge;
+    }
+}
+
+void LinkQuality::restart(const uint32_t now)
+{
+    mLastGoodFrame = now;
+    mStatistics.lastGoodFrameAge = 0;
+    mHasGoodFrame = false;
+}
+
+void LinkQuality::trace(void) const
+{
+    Trace(ZONE_INFO, "ok: %u crc: %u length: %u schema: %u resync: %u gaps: %u\r\n",
+          static_cast<unsigned>(mStatistics.framesOk), static_cast<unsigned>(mStatistics.crcErrors),
+          static_cast<unsigned>(mStatistics.lengthErrors), static_cast<unsigned>(mStatistics.schemaErrors),
+          static_cast<unsigned>(mStatistics.resyncs), static_cast<unsigned>(mStatistics.sequenceGaps));
+    Trace(ZONE_INFO, "age: %u ms max: %u ms\r\n",
+          static_cast<unsigned>(mStatistics.lastGoodFrameAge), static_cast<unsigned>(mStatistics.maxGoodFrameAge));
+    for (size_t i = 0; i < LinkStatistics::HISTOGRAM_BUCKETS; i++) {
+        Trace(ZONE_INFO, "interval >= %u ms: %u\r\n",
+              (i == 0) ? 0u : 1u << (i - 1), static_cast<unsigned>(mStatistics.interArrival[i]));
+    }
+}
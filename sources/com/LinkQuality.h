@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "log2.h"
+
+namespace com
+{
+/**
+ * Receive statistics of a link. It's plain data, so a DTO can reference it
+ * and send the link quality to the other side.
+ *
+ * Bucket n of the inter-arrival histogram counts the intervals between two good
+ * frames from 2^(n-1) to 2^n - 1 ticks, the last bucket counts all longer ones.
+ */
+struct LinkStatistics {
+    static constexpr size_t HISTOGRAM_BUCKETS = 10;
+
+    uint32_t framesOk;
+    uint32_t crcErrors;
+    uint32_t lengthErrors;
+    uint32_t schemaErrors;
+    // Frames the COBS decoder dropped because they were truncated or too long
+    uint32_t resyncs;
+    // Frames the sender transmitted but which never arrived
+    uint32_t sequenceGaps;
+    // Ticks since the last good frame and the longest time without one
+    uint32_t lastGoodFrameAge;
+    uint32_t maxGoodFrameAge;
+    uint32_t interArrival[HISTOGRAM_BUCKETS];
+};
+
+/**
+ * Records the LinkStatistics of a receiver. Recording a frame is a handful of
+ * instructions without any loop, so it can run for every frame.
+ */
+class LinkQuality final
+{
+    LinkStatistics mStatistics {};
+    uint32_t mLastGoodFrame = 0;
+    uint8_t mLastSequence = 0;
+    bool mHasGoodFrame = false;
+
+public:
+    // Sequence numbers count modulo 128
+    static constexpr uint8_t SEQUENCE_MASK = 0x7f;
+
+    static size_t bucket(const uint32_t interval)
+    {
+        return log2_bucket<LinkStatistics::HISTOGRAM_BUCKETS>(interval);
+    }
+
+    void goodFrame(const uint32_t now, const uint8_t sequence);
+
+    inline void crcError(void)
+    {
+        mStatistics.crcErrors++;
+    }
+
+    inline void lengthError(void)
+    {
+        mStatistics.lengthErrors++;
+    }
+
+    inline void schemaError(void)
+    {
+        mStatistics.schemaErrors++;
+    }
+
+    inline void resync(void)
+    {
+        mStatistics.resyncs++;
+    }
+
+    // Updates the age of the last good frame
+    void update(const uint32_t now);
+
+    // The link was switched off until now, neither the age nor the sequence continue
+    void restart(const uint32_t now);
+
+    inline LinkStatistics& statistics(void)
+    {
+        return mStatistics;
+    }
+
+    inline const LinkStatistics& statistics(void) const
+    {
+        return mStatistics;
+    }
+
+    void trace(void) const;
+};
+}
@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include <chrono>
+#include <cstdio>
+
+#include "LinkQuality.h"
+#include "unittest.h"
+
+//-------------------------TESTCASES-------------------------
+
+int ut_Bucket(void)
+{
+    TestCaseBegin();
+
+    CHECK(com::LinkQuality::bucket(0) == 0);
+    CHECK(com::LinkQuality::bucket(1) == 1);
+    CHECK(com::LinkQuality::bucket(2) == 2);
+    CHECK(com::LinkQuality::bucket(3) == 2);
+    CHECK(com::LinkQuality::bucket(10) == 4);
+    CHECK(com::LinkQuality::bucket(255) == 8);
+    CHECK(com::LinkQuality::bucket(256) == 9);
+    CHECK(com::LinkQuality::bucket(0xffffffff) == com::LinkStatistics::HISTOGRAM_BUCKETS - 1);
+
+    TestCaseEnd();
+}
+
+int ut_Counters(void)
+{
+    TestCaseBegin();
+
+    com::LinkQuality quality;
+    const auto& statistics = quality.statistics();
+
+    quality.goodFrame(100, 7);
+    CHECK(statistics.framesOk == 1);
+    CHECK(statistics.sequenceGaps == 0);
+    CHECK(statistics.interArrival[com::LinkQuality::bucket(100)] == 0);
+
+    quality.goodFrame(110, 8);
+    quality.crcError();
+    quality.goodFrame(130, 10);
+    quality.resync();
+    quality.lengthError();
+    quality.schemaError();
+    CHECK(statistics.framesOk == 3);
+    CHECK(statistics.crcErrors == 1);
+    CHECK(statistics.resyncs == 1);
+    CHECK(statistics.lengthErrors == 1);
+    CHECK(statistics.schemaErrors == 1);
+    CHECK(statistics.sequenceGaps == 1);
+    CHECK(statistics.interArrival[com::LinkQuality::bucket(10)] == 1);
+    CHECK(statistics.interArrival[com::LinkQuality::bucket(20)] == 1);
+    CHECK(statistics.maxGoodFrameAge == 20);
+
+    // The sequence number wraps
+    quality.goodFrame(140, 2);
+    CHECK(statistics.sequenceGaps == 1 + 119);
+
+    quality.update(175);
+    CHECK(statistics.lastGoodFrameAge == 35);
+    CHECK(statistics.maxGoodFrameAge == 35);
+
+    // Neither the sleep nor the sequence across it count
+    quality.restart(1000);
+    quality.update(1005);
+    CHECK(statistics.lastGoodFrameAge == 5);
+    quality.goodFrame(1010, 100);
+    CHECK(statistics.sequenceGaps == 1 + 119);
+    CHECK(statistics.maxGoodFrameAge == 35);
+
+    quality.trace();
+
+    TestCaseEnd();
+}
+
+// The receive task records every frame. On the target TestLinkQuality measures it with the DWT.
+int ut_RecordingCost(void)
+{
+    TestCaseBegin();
+
+    static constexpr size_t FRAMES = 10000000;
+    com::LinkQuality quality;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < FRAMES; i++) {
+        const uint32_t now = static_cast<uint32_t>(i * 10 + (i & 0x7));
+        quality.update(now);
+        quality.goodFrame(now, (i + (i % 1000 == 0)) & com::LinkQuality::SEQUENCE_MASK);
+    }
+    const auto duration = std::chrono::steady_clock::now() - start;
+
+    const double ns = std::chrono::duration<double, std::nano>(duration).count() / FRAMES;
+    printf("recording %.2f ns/frame\n", ns);
+    CHECK(quality.statistics().framesOk == FRAMES);
+    CHECK(ns < 1000);
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_Bucket);
+    RunTest(true, ut_Counters);
+    RunTest(true, ut_RecordingCost);
+    UnitTestMainEnd();
+}
@@ -0,0 +1,286 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <tuple>
+#include <cstring>
+#include "os_Task.h"
+#include "for_each_tuple.h"
+#include "DtoSchema.h"
+#include "CRC.h"
+
+#ifdef UNITTEST
+int ut_multiRateLayout(void);
+#endif
+
+namespace com
+{
+// A member which is transferred in every DIVISOR-th frame
+template<size_t DIVISOR, typename T>
+struct RateField {
+    static_assert(DIVISOR > 0, "Invalid rate divisor");
+    static constexpr size_t divisor = DIVISOR;
+    using type = T;
+    T& value;
+};
+
+template<size_t DIVISOR, typename T>
+RateField<DIVISOR, T> every(T& value)
+{
+    return RateField<DIVISOR, T> {value};
+}
+
+// Changes the schema hash if a divisor changes
+template<size_t DIVISOR>
+struct RateDivisor {};
+
+template<size_t DIVISOR>
+struct dto_type_id<RateDivisor<DIVISOR> > {
+    static constexpr uint32_t value = DIVISOR;
+};
+
+namespace multirate
+{
+template<size_t N>
+struct Layout {
+    size_t phase[N + 1];
+    size_t maxSlotSize;
+};
+
+constexpr size_t gcd(const size_t a, const size_t b)
+{
+    return b == 0 ? a : gcd(b, a % b);
+}
+
+template<size_t ... DIVISORS>
+constexpr size_t cycle(void)
+{
+    const size_t divisors[] = {DIVISORS ..., 1};
+    size_t cycle = 1;
+    for (size_t i = 0; i < sizeof ... (DIVISORS); i++) {
+        cycle = cycle / gcd(cycle, divisors[i]) * divisors[i];
+    }
+    return cycle;
+}
+
+/**
+ * Every member gets the phase which keeps the largest frame of its slots
+ * smallest, so members with the same divisor are spread over the frames.
+ */
+template<size_t CYCLE, size_t N>
+constexpr Layout<N> makeLayout(const size_t(&divisors)[N + 1], const size_t(&sizes)[N + 1])
+{
+    Layout<N> layout {};
+    size_t slotSize[CYCLE] = {};
+
+    for (size_t i = 0; i < N; i++) {
+        size_t bestPhase = 0;
+        size_t bestSize = SIZE_MAX;
+        for (size_t phase = 0; phase < divisors[i]; phase++) {
+            size_t largest = 0;
+            for (size_t slot = phase; slot < CYCLE; slot += divisors[i]) {
+                largest = slotSize[slot] > largest ? slotSize[slot] : largest;
+            }
+            if (largest < bestSize) {
+                bestSize = largest;
+                bestPhase = phase;
+            }
+        }
+        layout.phase[i] = bestPhase;
+        for (size_t slot = bestPhase; slot < CYCLE; slot += divisors[i]) {
+            slotSize[slot] += sizes[i];
+        }
+    }
+
+    for (size_t slot = 0; slot < CYCLE; slot++) {
+        layout.maxSlotSize = slotSize[slot] > layout.maxSlotSize ? slotSize[slot] : layout.maxSlotSize;
+    }
+    return layout;
+}
+}
+
+/**
+ * Drop-in replacement for DataTransferObject, which transfers every member
+ * with its own rate divisor:
+ *  make_multirate_dto(every<1>(motor), every<10>(battery), every<50>(temperature))
+ *
+ * Frame layout:
+ *  timestamp (4 byte)
+ *  schema hash of the members and divisors (2 byte)
+ *  slot (2 byte)
+ *  data of the members scheduled for the slot in tuple order
+ *  crc (1 byte)
+ *
+ * The slot counts the frames modulo the least common multiple of the
+ * divisors. Which members a slot carries follows from the divisors at
+ * compile time, so a member is at most divisor frames old and a lost frame
+ * delays only the members of its slot.
+ */
+template<typename ... fields>
+class MultiRateTransferObject
+{
+    std::tuple<typename fields::type& ...> mTransferTuple;
+
+    static constexpr size_t NUMBEROFMEMBERS = sizeof ... (fields);
+    static constexpr size_t CYCLE = multirate::cycle<fields::divisor ...>();
+    static_assert(CYCLE <= 1000, "Choose divisors with a smaller least common multiple");
+
+    static constexpr size_t DIVISORS[NUMBEROFMEMBERS + 1] = {fields::divisor ..., 1};
+    static constexpr multirate::Layout<NUMBEROFMEMBERS> LAYOUT =
+        multirate::makeLayout<CYCLE, NUMBEROFMEMBERS>({fields::divisor ..., 1},
+                                                      {sizeof(typename fields::type) ..., 0});
+
+    typedef struct __attribute__((packed)) {
+        uint32_t timestamp;
+        uint16_t schema;
+        uint16_t slot;
+        uint8_t data [LAYOUT.maxSlotSize + sizeof(uint8_t)];
+    } DataTransferStruct;
+
+    static constexpr size_t HEADERSIZE = sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint16_t);
+
+    DataTransferStruct mTransferData;
+    size_t mLength = sizeof(mTransferData);
+    uint16_t mNextSlot = 0;
+
+    size_t payloadLength(const size_t slot) const;
+
+public:
+    using Schema = DtoSchema<typename fields::type ..., RateDivisor<fields::divisor> ...>;
+
+    MultiRateTransferObject(fields ... tuple) :
+        mTransferTuple(tuple.value ...) {}
+
+    MultiRateTransferObject(const MultiRateTransferObject&) = delete;
+    MultiRateTransferObject(MultiRateTransferObject&&) = default;
+    MultiRateTransferObject& operator=(const MultiRateTransferObject&) = delete;
+    MultiRateTransferObject& operator=(MultiRateTransferObject&&) = delete;
+
+    void updateTuple(void);
+    void prepareForTx(void);
+    bool isComplete(const size_t length);
+    bool isValid(void);
+
+    inline bool hasMatchingSchema(void) const
+    {
+        return mTransferData.schema == Schema::HASH;
+    }
+
+    static constexpr inline bool isScheduled(const size_t member, const size_t slot)
+    {
+        return slot % DIVISORS[member] == LAYOUT.phase[member];
+    }
+
+    inline size_t slot(void) const
+    {
+        return mTransferData.slot;
+    }
+
+    static constexpr inline size_t cycle(void)
+    {
+        return CYCLE;
+    }
+
+    inline uint8_t* data(void)
+    {
+        return reinterpret_cast<uint8_t*>(&mTransferData);
+    }
+
+    inline size_t length(void) const
+    {
+        return mLength;
+    }
+
+    static constexpr inline size_t capacity(void)
+    {
+        return sizeof(DataTransferStruct);
+    }
+
+#ifdef UNITTEST
+    friend int ::ut_multiRateLayout(void);
+#endif
+};
+
+template<typename ... fields>
+constexpr size_t MultiRateTransferObject<fields ...>::DIVISORS[];
+
+template<typename ... fields>
+constexpr multirate::Layout<MultiRateTransferObject<fields ...>::NUMBEROFMEMBERS> MultiRateTransferObject<fields ...>::LAYOUT;
+
+template<typename ... fields>
+MultiRateTransferObject<fields ...> make_multirate_dto(fields ... tuple)
+{
+    return MultiRateTransferObject<fields ...>(tuple ...);
+}
+}
+
+template<typename ... fields>
+size_t com::MultiRateTransferObject<fields ...>::payloadLength(const size_t slot) const
+{
+    size_t length = 0;
+
+    for_each_indexed(mTransferTuple, [slot, &length](const size_t i, const auto& x){
+        if (isScheduled(i, slot)) {
+            length += sizeof(x);
+        }
+    });
+    return length;
+}
+
+template<typename ... fields>
+void com::MultiRateTransferObject<fields ...>::prepareForTx(void)
+{
+    const size_t slot = mNextSlot;
+    mNextSlot = (slot + 1) % CYCLE;
+
+    mTransferData.timestamp = os::Task::getTickCount();
+    mTransferData.schema = Schema::HASH;
+    mTransferData.slot = slot;
+    uint8_t* ptr = mTransferData.data;
+
+    for_each_indexed(mTransferTuple, [slot, &ptr](const size_t i, const auto& x){
+        if (isScheduled(i, slot)) {
+            std::memcpy(ptr, &x, sizeof(x));
+            ptr += sizeof(x);
+        }
+    });
+
+    const hal::Crc& crcUnit = hal::Factory<hal::Crc>::get<hal::Crc::SYSTEM_CRC>();
+    mLength = HEADERSIZE + payloadLength(slot) + sizeof(uint8_t);
+    this->data()[mLength - sizeof(uint8_t)] = crcUnit.getCrc(this->data(), mLength - sizeof(uint8_t));
+}
+
+template<typename ... fields>
+bool com::MultiRateTransferObject<fields ...>::isComplete(const size_t length)
+{
+    mLength = length;
+    return (length > HEADERSIZE) && (length <= capacity());
+}
+
+template<typename ... fields>
+bool com::MultiRateTransferObject<fields ...>::isValid(void)
+{
+    const hal::Crc& crcUnit = hal::Factory<hal::Crc>::get<hal::Crc::SYSTEM_CRC>();
+    const bool crcValid = (0x00 == (crcUnit.getCrc(this->data(), this->length())));
+    return crcValid && (mTransferData.slot < CYCLE) &&
+           (mLength == HEADERSIZE + payloadLength(mTransferData.slot) + sizeof(uint8_t));
+}
+
+template<typename ... fields>
+void com::MultiRateTransferObject<fields ...>::updateTuple(void)
+{
+    const size_t slot = mTransferData.slot;
+    uint8_t const* ptr = mTransferData.data;
+    os::ThisTask::enterCriticalSection();
+    for_each_indexed(mTransferTuple, [slot, &ptr](const size_t i, auto& x){
+        if (isScheduled(i, slot)) {
+            std::memcpy(&x, ptr, sizeof(x));
+            ptr += sizeof(x);
+        }
+    });
+    os::ThisTask::exitCriticalSection();
+}
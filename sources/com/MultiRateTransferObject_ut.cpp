@@ -0,0 +1,194 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+
+#include "MultiRateTransferObject.h"
+#include "DataTransferObject.h"
+#include "Cobs.h"
+#include "unittest.h"
+#include "os_Task.h"
+
+//--------------------------BUFFERS--------------------------
+uint32_t g_currentTickCount;
+
+//--------------------------MOCKING--------------------------
+constexpr const std::array<const hal::Crc, hal::Crc::__ENUM__SIZE> hal::Factory<hal::Crc>::Container;
+
+void os::ThisTask::enterCriticalSection(void){}
+
+void os::ThisTask::exitCriticalSection(void) {}
+
+uint32_t os::Task::getTickCount(void)
+{
+    return g_currentTickCount;
+}
+
+// The software CRC of the unit, a frame with its CRC appended results in 0
+uint8_t hal::Crc::getCrc(uint8_t const* const data, const size_t length) const
+{
+    return mSoftwareCrc.calculate(static_cast<uint8_t>(mInitialValue), data, length);
+}
+
+//--------------------------HELPERS--------------------------
+template<typename Tx, typename Rx>
+static bool transfer(Tx& tx, Rx& rx)
+{
+    tx.prepareForTx();
+    std::memcpy(rx.data(), tx.data(), tx.length());
+    if (!rx.isComplete(tx.length()) || !rx.isValid() || !rx.hasMatchingSchema()) {
+        return false;
+    }
+    rx.updateTuple();
+    return true;
+}
+
+// The members of the slave to master DTO
+struct SlaveToMaster {
+    float motorTemp, batteryTemp, fetTemp;
+    float batteryTemperature, batteryCurrent, batteryVoltage;
+    float torque, rps;
+};
+
+//-------------------------TESTCASES-------------------------
+
+int ut_multiRateLayout(void)
+{
+    TestCaseBegin();
+
+    uint32_t a = 1, rxA = 0;
+    uint16_t b = 2, rxB = 0;
+    uint16_t c = 3, rxC = 0;
+
+    using com::every;
+    auto tx = com::make_multirate_dto(every<1>(a), every<2>(b), every<2>(c));
+    auto rx = com::make_multirate_dto(every<1>(rxA), every<2>(rxB), every<2>(rxC));
+
+    // b and c are sent alternately, so the frames have the same length
+    static_assert(decltype(tx)::cycle() == 2, "");
+    static_assert(decltype(tx)::capacity() == 8 + sizeof(uint32_t) + sizeof(uint16_t) + 1, "");
+    CHECK(tx.LAYOUT.phase[1] != tx.LAYOUT.phase[2]);
+
+    CHECK(transfer(tx, rx));
+    CHECK(tx.slot() == 0);
+    CHECK(tx.length() == tx.capacity());
+    CHECK(rxA == 1);
+    CHECK((rxB == 2) != (rxC == 3));
+
+    CHECK(transfer(tx, rx));
+    CHECK(tx.slot() == 1);
+    CHECK(rxA == 1 && rxB == 2 && rxC == 3);
+
+    // A lost frame delays only the members of its slot
+    a = 4;
+    b = 5;
+    c = 6;
+    tx.prepareForTx();
+    CHECK(transfer(tx, rx));
+    CHECK(rxA == 4);
+    CHECK((rxB == 5) != (rxC == 6));
+
+    // A corrupted frame is rejected
+    tx.prepareForTx();
+    std::memcpy(rx.data(), tx.data(), tx.length());
+    rx.data()[8] ^= 0x10;
+    CHECK(rx.isComplete(tx.length()));
+    CHECK(!rx.isValid());
+
+    // The divisors are part of the schema
+    auto other = com::make_multirate_dto(every<1>(rxA), every<4>(rxB), every<4>(rxC));
+    CHECK(decltype(other)::Schema::HASH != decltype(rx)::Schema::HASH);
+    CHECK(decltype(other)::capacity() == decltype(rx)::capacity());
+    CHECK(!transfer(tx, other));
+
+    TestCaseEnd();
+}
+
+/**
+ * The slave to master DTO with the motor values every frame, the battery
+ * every 5th and the temperatures every 50th frame, sent every 10 ms.
+ */
+int ut_multiRateRide(void)
+{
+    TestCaseBegin();
+
+    // 115200 baud, 8N1
+    constexpr double LINKBYTESPERSECOND = 115200 / 10;
+    constexpr uint32_t TXINTERVAL = 10;
+    constexpr uint32_t DURATION = 60000;
+
+    SlaveToMaster tx {}, rx {}, rxFull {};
+
+    using com::every;
+    auto multiRate = com::make_multirate_dto(every<50>(tx.motorTemp), every<50>(tx.batteryTemp),
+                                             every<50>(tx.fetTemp), every<5>(tx.batteryTemperature),
+                                             every<5>(tx.batteryCurrent), every<5>(tx.batteryVoltage),
+                                             every<1>(tx.torque), every<1>(tx.rps));
+    auto multiRateRx = com::make_multirate_dto(every<50>(rx.motorTemp), every<50>(rx.batteryTemp),
+                                               every<50>(rx.fetTemp), every<5>(rx.batteryTemperature),
+                                               every<5>(rx.batteryCurrent), every<5>(rx.batteryVoltage),
+                                               every<1>(rx.torque), every<1>(rx.rps));
+    auto full = com::make_dto(tx.motorTemp, tx.batteryTemp, tx.fetTemp, tx.batteryTemperature, tx.batteryCurrent,
+                              tx.batteryVoltage, tx.torque, tx.rps);
+    auto fullRx = com::make_dto(rxFull.motorTemp, rxFull.batteryTemp, rxFull.fetTemp, rxFull.batteryTemperature,
+                                rxFull.batteryCurrent, rxFull.batteryVoltage, rxFull.torque, rxFull.rps);
+
+    static constexpr size_t MEMBERS = 8;
+    const size_t divisors[MEMBERS] = {50, 50, 50, 5, 5, 5, 1, 1};
+    uint32_t lastUpdate[MEMBERS] = {};
+    uint32_t maxStaleness[MEMBERS] = {};
+    size_t fullBytes = 0, multiRateBytes = 0, maxFrame = 0;
+
+    for (uint32_t tick = 0; tick < DURATION; tick += TXINTERVAL) {
+        g_currentTickCount = tick;
+        float* values = &tx.motorTemp;
+        for (size_t i = 0; i < MEMBERS; i++) {
+            values[i] = tick * (i + 1);
+        }
+
+        CHECK(transfer(full, fullRx));
+        CHECK(transfer(multiRate, multiRateRx));
+        fullBytes += com::Cobs::encodedLength(full.length());
+        multiRateBytes += com::Cobs::encodedLength(multiRate.length());
+        maxFrame = std::max(maxFrame, multiRate.length());
+
+        float const* received = &rx.motorTemp;
+        for (size_t i = 0; i < MEMBERS; i++) {
+            if (received[i] == values[i]) {
+                maxStaleness[i] = std::max(maxStaleness[i], tick - lastUpdate[i]);
+                lastUpdate[i] = tick;
+            }
+        }
+    }
+
+    const double seconds = DURATION / 1000.0;
+    std::cout << "full " << fullBytes / seconds << " byte/s (" << 100 * fullBytes / seconds / LINKBYTESPERSECOND
+              << "% link), multi-rate " << multiRateBytes / seconds << " byte/s ("
+              << 100 * multiRateBytes / seconds / LINKBYTESPERSECOND << "% link), largest frame " << maxFrame
+              << " of " << multiRate.capacity() << " byte" << std::endl;
+    std::cout << "worst case staleness [ms]:";
+    for (size_t i = 0; i < MEMBERS; i++) {
+        std::cout << " " << maxStaleness[i];
+        CHECK(maxStaleness[i] == divisors[i] * TXINTERVAL);
+    }
+    std::cout << std::endl;
+
+    CHECK(multiRateBytes < fullBytes * 6 / 10);
+    // The slow members are spread, a frame carries at most one temperature and one battery value
+    CHECK(maxFrame <= 8 + 2 * sizeof(float) + sizeof(float) + sizeof(float) + 1);
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_multiRateLayout);
+    RunTest(true, ut_multiRateRide);
+
+    UnitTestMainEnd();
+}
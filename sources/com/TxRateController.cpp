@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include <algorithm>
+#include "TxRateController.h"
+
+using com::TxRateController;
+
+TxRateController::TxRateController(const uint32_t minPeriod, const uint32_t maxPeriod, TxTrigger* trigger,
+                                   const uint32_t linkBytesPerSecond) :
+    mMinPeriod(std::max(minPeriod, static_cast<uint32_t>(1))),
+    mMaxPeriod(std::max(maxPeriod, mMinPeriod)),
+    mTrigger(trigger),
+    mLinkBytesPerSecond(linkBytesPerSecond),
+    mHeartbeatPeriod(mMinPeriod) {}
+
+bool TxRateController::isTransmissionDue(const uint32_t now)
+{
+    const uint32_t elapsed = now - mLastTransmission;
+    mIsTriggered = (mTrigger != nullptr) && mTrigger->isTriggered();
+
+    return mIsFirstTransmission || (mIsTriggered && (elapsed >= mMinPeriod)) || (elapsed >= mHeartbeatPeriod);
+}
+
+void TxRateController::transmitted(const uint32_t now, const size_t bytes)
+{
+    if (mTrigger != nullptr) {
+        mTrigger->transmitted();
+    }
+
+    mHeartbeatPeriod = mIsTriggered ? mMinPeriod : std::min(2 * mHeartbeatPeriod, mMaxPeriod);
+    mTriggeredTransmissions += mIsTriggered;
+    mTransmissions++;
+    mLastTransmission = now;
+
+    if (mIsFirstTransmission) {
+        mIsFirstTransmission = false;
+        mFirstTransmission = now;
+        mWindowStart = now;
+    }
+    if (now - mWindowStart >= UTILISATION_WINDOW) {
+        mPeakWindowBytes = std::max(mPeakWindowBytes, mWindowBytes);
+        mWindowBytes = 0;
+        mWindowStart = now - (now - mWindowStart) % UTILISATION_WINDOW;
+    }
+    mWindowBytes += bytes;
+    mTotalBytes += bytes;
+}
+
+TxRateController::Statistics TxRateController::getStatistics(const uint32_t now) const
+{
+    const float bytesPerTick = mLinkBytesPerSecond / 1000.0f;
+    const uint32_t elapsed = std::max(now - mFirstTransmission, static_cast<uint32_t>(1));
+
+    return Statistics {
+               mIsFirstTransmission ? 0.0f : mTotalBytes / (elapsed * bytesPerTick),
+               std::max(mPeakWindowBytes, mWindowBytes) / (UTILISATION_WINDOW * bytesPerTick),
+               mTransmissions,
+               mTriggeredTransmissions
+    };
+}
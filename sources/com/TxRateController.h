@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace com
+{
+/**
+ * Tells the TxRateController that the data changed enough to be sent
+ * before the next heartbeat.
+ */
+struct TxTrigger {
+    virtual bool isTriggered(void) const = 0;
+    // Called after every transmission, triggered or not
+    virtual void transmitted(void) = 0;
+};
+
+/**
+ * Decides when a transmit task sends. A trigger sends after the minimum
+ * period. Without a trigger the heartbeat period doubles with every
+ * transmission up to the maximum period. The default sends every 10 ms.
+ *
+ * Periods are in ticks. The controller also counts the link utilisation, the
+ * peak is the highest utilisation of a UTILISATION_WINDOW.
+ */
+class TxRateController final
+{
+public:
+    static constexpr uint32_t DEFAULT_PERIOD = 10;
+    static constexpr uint32_t DEFAULT_LINK_BYTES_PER_SECOND = 115200 / 10;
+    static constexpr uint32_t UTILISATION_WINDOW = 100;
+
+    struct Statistics {
+        float averageUtilisation;
+        float peakUtilisation;
+        uint32_t transmissions;
+        uint32_t triggeredTransmissions;
+    };
+
+    TxRateController(const uint32_t minPeriod = DEFAULT_PERIOD, const uint32_t maxPeriod = DEFAULT_PERIOD,
+                     TxTrigger* trigger = nullptr,
+                     const uint32_t linkBytesPerSecond = DEFAULT_LINK_BYTES_PER_SECOND);
+
+    // The transmit task checks every pollPeriod() ticks if a transmission is due
+    inline uint32_t pollPeriod(void) const
+    {
+        return mMinPeriod;
+    }
+
+    bool isTransmissionDue(const uint32_t now);
+    void transmitted(const uint32_t now, const size_t bytes);
+    Statistics getStatistics(const uint32_t now) const;
+
+private:
+    const uint32_t mMinPeriod;
+    const uint32_t mMaxPeriod;
+    TxTrigger* const mTrigger;
+    const uint32_t mLinkBytesPerSecond;
+
+    uint32_t mHeartbeatPeriod;
+    uint32_t mLastTransmission = 0;
+    bool mIsTriggered = false;
+    bool mIsFirstTransmission = true;
+
+    uint32_t mFirstTransmission = 0;
+    uint32_t mWindowStart = 0;
+    size_t mWindowBytes = 0;
+    size_t mPeakWindowBytes = 0;
+    uint64_t mTotalBytes = 0;
+    uint32_t mTransmissions = 0;
+    uint32_t mTriggeredTransmissions = 0;
+};
+}
@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include <functional>
+#include <vector>
+
+#include "TxRateController.h"
+#include "Deadband.h"
+#include "unittest.h"
+
+//--------------------------HELPERS--------------------------
+// Polls the controller like the transmit task and returns the transmission ticks
+static std::vector<uint32_t> run(com::TxRateController& controller, const uint32_t end,
+                                 const std::function<void(uint32_t)>& beforePoll = nullptr)
+{
+    std::vector<uint32_t> transmissions;
+    for (uint32_t now = 0; now < end; now += controller.pollPeriod()) {
+        if (beforePoll) {
+            beforePoll(now);
+        }
+        if (controller.isTransmissionDue(now)) {
+            controller.transmitted(now, 10);
+            transmissions.push_back(now);
+        }
+    }
+    return transmissions;
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_FixedRate(void)
+{
+    TestCaseBegin();
+
+    com::TxRateController controller;
+    const auto transmissions = run(controller, 100);
+    CHECK(transmissions.size() == 10);
+    for (size_t i = 0; i < transmissions.size(); i++) {
+        CHECK(transmissions[i] == i * com::TxRateController::DEFAULT_PERIOD);
+    }
+
+    // 10 byte every 10 ms of 11.52 byte per ms
+    const auto stats = controller.getStatistics(100);
+    CHECK(stats.transmissions == 10);
+    CHECK(stats.triggeredTransmissions == 0);
+    CHECK(stats.averageUtilisation > 0.086f);
+    CHECK(stats.averageUtilisation < 0.087f);
+
+    TestCaseEnd();
+}
+
+int ut_HeartbeatBackoff(void)
+{
+    TestCaseBegin();
+
+    com::TxRateController controller(2, 50);
+    const auto transmissions = run(controller, 300);
+    const std::vector<uint32_t> expected {0, 4, 12, 28, 60, 110, 160, 210, 260};
+    CHECK(transmissions == expected);
+
+    TestCaseEnd();
+}
+
+int ut_DeadbandTrigger(void)
+{
+    TestCaseBegin();
+
+    int32_t position = 0;
+    float speed = 0;
+    auto deadband = com::make_deadband(std::tie(position, speed), std::make_tuple(int32_t(10), 0.5f));
+    CHECK(!deadband.isTriggered());
+
+    position = -10;
+    speed = 0.5f;
+    CHECK(!deadband.isTriggered());
+    speed = -0.6f;
+    CHECK(deadband.isTriggered());
+
+    // The reference is the transmitted value, so a slow drift triggers as well
+    deadband.transmitted();
+    CHECK(!deadband.isTriggered());
+    position = 0;
+    CHECK(!deadband.isTriggered());
+    position = 1;
+    CHECK(deadband.isTriggered());
+
+    // A trigger sends after the minimum period and restarts the backoff
+    deadband.transmitted();
+    com::TxRateController controller(2, 50, &deadband);
+    const auto transmissions = run(controller, 100, [&](uint32_t now) {
+        position = now == 40 ? 100 : position;
+    });
+    const std::vector<uint32_t> expected {0, 4, 12, 28, 40, 42, 46, 54, 70};
+    CHECK(transmissions == expected);
+    CHECK(controller.getStatistics(100).triggeredTransmissions == 1);
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_FixedRate);
+    RunTest(true, ut_HeartbeatBackoff);
+    RunTest(true, ut_DeadbandTrigger);
+    UnitTestMainEnd();
+}
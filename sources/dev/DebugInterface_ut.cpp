@@ -43,6 +43,13 @@ QueueHandle_t xQueueCreateMutex(const uint8_t ucQueueType)
     return nullptr;
 }
 
+#if OS_STATIC_ALLOCATION
+QueueHandle_t xQueueCreateMutexStatic(const uint8_t ucQueueType, StaticQueue_t* pxStaticQueue)
+{
+    return nullptr;
+}
+#endif
+
 BaseType_t xQueueGenericSend(QueueHandle_t     xQueue,
                              const void* const pvItemToQueue,
                              TickType_t        xTicksToWait,
@@ -0,0 +1,336 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include "Dma.h"
+#include "Simulation.h"
+#include "FreeRTOS.h"
+#include "trace.h"
+#include <semaphore.h>
+
+static const int __attribute__((unused)) g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_VERBOSE | ZONE_INFO;
+
+using hal::Dma;
+using hal::Factory;
+
+/*
+ * The channels move the data between the memory and the pseudo terminals of
+ * hal_posix/Usart.cpp. Sending hands the data over at once, but the transfer
+ * completes when the last byte left the wire at the baud rate of the USART.
+ * Receiving proceeds byte by byte as the USART is offered the bytes of its
+ * pseudo terminal.
+ */
+
+namespace
+{
+// The data register of a USART follows the status register
+constexpr uint32_t USART_DR_OFFSET = 0x4;
+
+struct Channel {
+    const Dma* dma = nullptr;
+    uint8_t* data = nullptr;
+    uint16_t length = 0;
+    bool repeat = false;
+    bool incrementMemory = true;
+    std::atomic<uint16_t> counter {0};
+    // Sending channels complete their transfers in a thread of their own
+    uint32_t transferCompleteBit = 0;
+    IRQn_Type irq;
+    sem_t isSending;
+    std::atomic<uint64_t> sentAt {0};
+};
+
+std::array<Channel, Dma::__ENUM__SIZE> g_Channels;
+// One bit per description, served by the interrupt of the channel
+std::atomic<uint32_t> g_PendingTransferComplete {0};
+std::atomic<uint32_t> g_PendingHalfTransfer {0};
+}
+
+static void serveDmaInterrupts(void)
+{
+    const uint32_t transferComplete = g_PendingTransferComplete.exchange(0);
+    const uint32_t halfTransfer = g_PendingHalfTransfer.exchange(0);
+
+    for (size_t i = 0; i < Dma::__ENUM__SIZE; i++) {
+        if (halfTransfer & (1u << i)) {
+            Dma::DMA_HTIRQHandler(*g_Channels[i].dma);
+        }
+        if (transferComplete & (1u << i)) {
+            Dma::DMA_TCIRQHandler(*g_Channels[i].dma);
+        }
+    }
+}
+
+static void* completeTransfers(void* parameter)
+{
+    Channel& channel = *static_cast<Channel*>(parameter);
+
+    while (true) {
+        while ((sem_wait(&channel.isSending) != 0) && (errno == EINTR)) {}
+
+        hal::posix::sleepUntil(channel.sentAt);
+        channel.counter = 0;
+        if (channel.transferCompleteBit) {
+            g_PendingTransferComplete |= channel.transferCompleteBit;
+            vPortGenerateSimulatedInterrupt(channel.irq);
+        }
+    }
+    return nullptr;
+}
+
+void Dma::DMA_IRQHandlerSemaphore(const Dma& dma, const Dma::SemaphoreArray& array)
+{
+    if (array[dma.mDescription] != nullptr) {
+        array[dma.mDescription]->giveFromISR();
+    }
+}
+
+void Dma::DMA_IRQHandlerCallback(const Dma& dma, const Dma::CallbackArray& array)
+{
+    if (array[dma.mDescription] != nullptr) {
+        array[dma.mDescription]();
+    }
+}
+
+void Dma::DMA_TCIRQHandler(const Dma& peripherie)
+{
+    DMA_IRQHandlerSemaphore(peripherie, Dma::TCInterruptSemaphores);
+    DMA_IRQHandlerCallback(peripherie, Dma::TCInterruptCallbacks);
+}
+void Dma::DMA_HTIRQHandler(const Dma& peripherie)
+{
+    DMA_IRQHandlerSemaphore(peripherie, Dma::HTInterruptSemaphores);
+    DMA_IRQHandlerCallback(peripherie, Dma::HTInterruptCallbacks);
+}
+void Dma::DMA_TEIRQHandler(const Dma& peripherie)
+{
+    DMA_IRQHandlerSemaphore(peripherie, Dma::TEInterruptSemaphores);
+    DMA_IRQHandlerCallback(peripherie, Dma::TEInterruptCallbacks);
+}
+
+void Dma::initialize(void) const
+{
+    Channel& channel = g_Channels[mDescription];
+    channel.dma = this;
+    if (mDmaInterrupt) {
+        vPortSetInterruptHandler(mDmaIRQn, serveDmaInterrupts);
+    }
+    if (mConfiguration.DMA_DIR == DMA_DIR_PeripheralDST) {
+        channel.transferCompleteBit = (mDmaInterrupt & DMA_IT_TC) ? 1u << mDescription : 0;
+        channel.irq = mDmaIRQn;
+        sem_init(&channel.isSending, 0, 0);
+        hal::posix::startThread(completeTransfers, &channel);
+    }
+}
+
+void Dma::setupTransfer(uint8_t const* const data, const size_t length, const bool repeat) const
+{
+    disable();
+
+    Channel& channel = g_Channels[mDescription];
+    channel.data = const_cast<uint8_t*>(data);
+    channel.length = static_cast<uint16_t>(length);
+    channel.repeat = repeat;
+    channel.incrementMemory = (mConfiguration.DMA_MemoryInc == DMA_MemoryInc_Enable);
+    channel.counter = channel.length;
+}
+
+void Dma::memcpy(void const* const dest, void const* const src, const size_t length) const
+{
+    if ((dest == nullptr) || (src == nullptr) || (length == 0)) {
+        return;
+    }
+
+    disable();
+    std::memcpy(const_cast<void*>(dest), src, length);
+    g_Channels[mDescription].counter = 0;
+    if (mDmaInterrupt & DMA_IT_TC) {
+        g_PendingTransferComplete |= 1u << mDescription;
+        vPortGenerateSimulatedInterrupt(mDmaIRQn);
+    }
+}
+
+void Dma::setupSendSingleCharMultipleTimes(uint8_t const* const data, const size_t length) const
+{
+    setupTransfer(data, length);
+    g_Channels[mDescription].incrementMemory = false;
+}
+
+void Dma::enable(void) const
+{
+    Channel& channel = g_Channels[mDescription];
+    const uint32_t usart = mConfiguration.DMA_PeripheralBaseAddr - USART_DR_OFFSET;
+
+    if (mConfiguration.DMA_DIR == DMA_DIR_PeripheralDST) {
+        uint64_t sentAt = hal::posix::getNanoseconds();
+        if (channel.incrementMemory) {
+            sentAt = hal::posix::sendToUsart(usart, channel.data, channel.counter);
+        } else {
+            for (size_t i = 0; i < channel.counter; i++) {
+                sentAt = hal::posix::sendToUsart(usart, channel.data, 1);
+            }
+        }
+        channel.sentAt = sentAt;
+        sem_post(&channel.isSending);
+        return;
+    }
+
+    hal::posix::setUsartReceiver(usart, [this, &channel](uint8_t data) {
+        const uint16_t counter = channel.counter;
+        if (counter == 0) {
+            // Stopped until the next transfer, the byte stays in the USART
+            return false;
+        }
+
+        channel.data[channel.incrementMemory ? channel.length - counter : 0] = data;
+        channel.counter = counter - 1;
+
+        if ((mDmaInterrupt & DMA_IT_HT) && (counter - 1 == channel.length / 2)) {
+            g_PendingHalfTransfer |= 1u << mDescription;
+            vPortGenerateSimulatedInterrupt(mDmaIRQn);
+        }
+        if (counter - 1 == 0) {
+            if (channel.repeat) {
+                channel.counter = channel.length;
+            }
+            if (mDmaInterrupt & DMA_IT_TC) {
+                g_PendingTransferComplete |= 1u << mDescription;
+                vPortGenerateSimulatedInterrupt(mDmaIRQn);
+            }
+        }
+        return true;
+    });
+}
+
+void Dma::disable(void) const
+{
+    if (mConfiguration.DMA_DIR == DMA_DIR_PeripheralSRC) {
+        hal::posix::setUsartReceiver(mConfiguration.DMA_PeripheralBaseAddr - USART_DR_OFFSET, nullptr);
+    }
+}
+
+bool Dma::registerInterruptSemaphore(os::Semaphore* const semaphore, const Dma::InterruptSource source) const
+{
+    switch (source) {
+    case Dma::TC:
+        if (mDmaInterrupt & DMA_IT_TC) {
+            Dma::TCInterruptSemaphores[mDescription] = semaphore;
+            return true;
+        } else {
+            Trace(ZONE_ERROR, "Invalid DMA configuration\r\n");
+            return false;
+        }
+
+    case Dma::HT:
+        if (mDmaInterrupt & DMA_IT_HT) {
+            Dma::HTInterruptSemaphores[mDescription] = semaphore;
+            return true;
+        } else {
+            Trace(ZONE_ERROR, "Invalid DMA configuration\r\n");
+            return false;
+        }
+
+    case Dma::TE:
+        if (mDmaInterrupt & DMA_IT_TE) {
+            Dma::TEInterruptSemaphores[mDescription] = semaphore;
+            return true;
+        } else {
+            Trace(ZONE_ERROR, "Invalid DMA configuration\r\n");
+            return false;
+        }
+    }
+
+    return false;
+}
+
+void Dma::unregisterInterruptSemaphore(const InterruptSource source) const
+{
+    switch (source) {
+    case Dma::TC:
+        Dma::TCInterruptSemaphores[mDescription] = nullptr;
+        return;
+
+    case Dma::HT:
+        Dma::HTInterruptSemaphores[mDescription] = nullptr;
+        return;
+
+    case Dma::TE:
+        Dma::TEInterruptSemaphores[mDescription] = nullptr;
+        return;
+    }
+}
+
+bool Dma::registerInterruptCallback(std::function<void(void)> function, const Dma::InterruptSource source) const
+{
+    switch (source) {
+    case Dma::TC:
+        if (mDmaInterrupt & DMA_IT_TC) {
+            Dma::TCInterruptCallbacks[mDescription] = function;
+            return true;
+        } else {
+            Trace(ZONE_ERROR, "Invalid DMA configuration\r\n");
+            return false;
+        }
+
+    case Dma::HT:
+        if (mDmaInterrupt & DMA_IT_HT) {
+            Dma::HTInterruptCallbacks[mDescription] = function;
+            return true;
+        } else {
+            Trace(ZONE_ERROR, "Invalid DMA configuration\r\n");
+            return false;
+        }
+
+    case Dma::TE:
+        if (mDmaInterrupt & DMA_IT_TE) {
+            Dma::TEInterruptCallbacks[mDescription] = function;
+            return true;
+        } else {
+            Trace(ZONE_ERROR, "Invalid DMA configuration\r\n");
+            return false;
+        }
+    }
+
+    return false;
+}
+
+void Dma::unregisterInterruptCallback(const InterruptSource source) const
+{
+    switch (source) {
+    case Dma::TC:
+        Dma::TCInterruptCallbacks[mDescription] = nullptr;
+        return;
+
+    case Dma::HT:
+        Dma::HTInterruptCallbacks[mDescription] = nullptr;
+        return;
+
+    case Dma::TE:
+        Dma::TEInterruptCallbacks[mDescription] = nullptr;
+        return;
+    }
+}
+
+uint16_t Dma::getCurrentDataCounter(void) const
+{
+    return g_Channels[mDescription].counter;
+}
+
+void Dma::setCurrentDataCounter(uint16_t value) const
+{
+    g_Channels[mDescription].counter = value;
+}
+
+Dma::SemaphoreArray Dma::TCInterruptSemaphores;
+Dma::SemaphoreArray Dma::HTInterruptSemaphores;
+Dma::SemaphoreArray Dma::TEInterruptSemaphores;
+Dma::CallbackArray Dma::TCInterruptCallbacks;
+Dma::CallbackArray Dma::HTInterruptCallbacks;
+Dma::CallbackArray Dma::TEInterruptCallbacks;
+
+constexpr const std::array<const Dma, Dma::Description::__ENUM__SIZE + 1> Factory<Dma>::Container;
+constexpr const std::array<const uint32_t, 2> Factory<Dma>::Clocks;
@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include "Flash.h"
+#include "trace.h"
+#include "LockGuard.h"
+#include <cstring>
+#include <vector>
+
+static const int __attribute__((unused)) g_DebugZones = ZONE_ERROR |
+                                                        ZONE_WARNING | ZONE_VERBOSE | ZONE_INFO;
+
+using hal::Flash;
+using hal::Factory;
+
+/*
+ * The regions live in the RAM of the simulation. They start erased, like on a
+ * new device, and neither erasing nor programming takes any time.
+ */
+
+static uint8_t* getImage(const size_t description, const size_t size)
+{
+    static std::array<std::vector<uint8_t>, Flash::__ENUM__SIZE> images;
+
+    if (images[description].empty()) {
+        images[description].assign(size, 0xff);
+    }
+    return images[description].data();
+}
+
+bool Flash::erasePage(const size_t offset) const
+{
+    if ((offset >= mSize) || (offset % PAGESIZE)) {
+        Trace(ZONE_WARNING, "Invalid page offset %u\r\n", static_cast<unsigned int>(offset));
+        return false;
+    }
+
+    os::LockGuard<os::Mutex> lock(FlashControllerMutex);
+
+    std::memset(getImage(mDescription, mSize) + offset, 0xff, PAGESIZE);
+    return true;
+}
+
+bool Flash::program(const size_t offset, uint16_t const* const data, const size_t numberOfHalfWords) const
+{
+    if ((data == nullptr) || (offset % sizeof(uint16_t)) ||
+        (offset + numberOfHalfWords * sizeof(uint16_t) > mSize))
+    {
+        Trace(ZONE_WARNING, "Invalid parameters\r\n");
+        return false;
+    }
+
+    os::LockGuard<os::Mutex> lock(FlashControllerMutex);
+
+    uint16_t* const image = reinterpret_cast<uint16_t*>(getImage(mDescription, mSize) + offset);
+    for (size_t i = 0; i < numberOfHalfWords; i++) {
+        // Like on the device, only erased half words can be programmed, except to zero
+        if ((image[i] != 0xffff) && (data[i] != 0)) {
+            Trace(ZONE_ERROR, "Programming at %x failed: %d\r\n", static_cast<unsigned int>(mStartAddress + offset),
+                  FLASH_ERROR_PG);
+            return false;
+        }
+        image[i] = data[i];
+    }
+    return true;
+}
+
+void Flash::read(const size_t offset, uint8_t* const data, const size_t length) const
+{
+    if ((data == nullptr) || (offset + length > mSize)) {
+        Trace(ZONE_WARNING, "Invalid parameters\r\n");
+        return;
+    }
+
+    // The image is created on first use, which has to be serialized
+    os::LockGuard<os::Mutex> lock(FlashControllerMutex);
+
+    std::memcpy(data, getImage(mDescription, mSize) + offset, length);
+}
+
+size_t Flash::getSize(void) const
+{
+    return mSize;
+}
+
+os::Mutex Flash::FlashControllerMutex;
+constexpr std::array<const Flash, Flash::__ENUM__SIZE> Factory<Flash>::Container;
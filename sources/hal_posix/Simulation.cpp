@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include "Simulation.h"
+#include <cerrno>
+#include <cstdlib>
+#include <ctime>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/prctl.h>
+
+namespace
+{
+struct Thread {
+    void* (*function)(void*);
+    void* parameter;
+};
+}
+
+static void* runThread(void* parameter)
+{
+    const Thread thread = *static_cast<Thread*>(parameter);
+    std::free(parameter);
+
+    // The default slack of 50 us would be more than a byte at 115200 baud
+    prctl(PR_SET_TIMERSLACK, 1);
+    return thread.function(thread.parameter);
+}
+
+void hal::posix::startThread(void* (*function)(void*), void* parameter)
+{
+    sigset_t allSignals;
+    sigset_t previousSignals;
+    pthread_t thread;
+    // Not with new, the kernel must not see the threads of the hardware
+    Thread* const start = static_cast<Thread*>(std::malloc(sizeof(Thread)));
+
+    *start = Thread {function, parameter};
+
+    // The mask is inherited, so the thread never takes a simulated interrupt
+    sigfillset(&allSignals);
+    pthread_sigmask(SIG_BLOCK, &allSignals, &previousSignals);
+    pthread_create(&thread, nullptr, runThread, start);
+    pthread_detach(thread);
+    pthread_sigmask(SIG_SETMASK, &previousSignals, nullptr);
+}
+
+uint64_t hal::posix::getNanoseconds(void)
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+void hal::posix::sleepUntil(const uint64_t nanoseconds)
+{
+    const timespec end {static_cast<time_t>(nanoseconds / 1000000000), static_cast<long>(nanoseconds % 1000000000)};
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &end, nullptr) == EINTR) {}
+}
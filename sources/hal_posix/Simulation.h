@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace hal
+{
+namespace posix
+{
+/**
+ * Every USART of the simulation is a pseudo terminal of the host. The slave
+ * is linked as USART1, USART2, ... into the working directory, so a terminal
+ * program or a script can talk to the firmware in place of the real device.
+ *
+ * Received bytes are paced by the baud rate of the USART, however fast the
+ * peer writes. Like on the wire, bytes which nobody reads are lost. Sending
+ * hands the bytes to the pseudo terminal at once, but the time on the wire
+ * is accounted for the transfer complete interrupt of the DMA.
+ */
+
+// For the simulated DMA, the peripheral is the base address of the USART.
+// Returns when the last byte has left the wire, see getNanoseconds().
+uint64_t sendToUsart(const uint32_t peripherie, uint8_t const* const data, const size_t length);
+
+// The receiver is offered the bytes of the USART before the receive interrupt
+// until it is reset. It returns whether it took the byte and is called with
+// the interrupts masked.
+void setUsartReceiver(const uint32_t peripherie, std::function<bool(uint8_t)> receiver);
+
+// A thread of the simulated hardware, which never handles the simulated
+// interrupts and must not use the kernel.
+void startThread(void* (*function)(void*), void* parameter);
+
+// CLOCK_MONOTONIC of the host
+uint64_t getNanoseconds(void);
+void sleepUntil(const uint64_t nanoseconds);
+}
+}
@@ -0,0 +1,425 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include "Usart.h"
+#include "Simulation.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "trace.h"
+// After the device header, termios.h defines macros like CR1
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <poll.h>
+#include <semaphore.h>
+#include <termios.h>
+#include <unistd.h>
+
+static const int __attribute__((unused)) g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_VERBOSE | ZONE_INFO;
+
+using hal::Factory;
+using hal::Usart;
+
+namespace
+{
+struct Line {
+    uint32_t peripherie = 0;
+    IRQn irq = IRQn::UsageFault_IRQn;
+    int master = -1;
+    // The receive data register, negative while RXNE is cleared
+    std::atomic<int> data {-1};
+    // Posted when the data register was read, so the next byte may follow
+    sem_t isRead;
+    std::atomic<bool> isInterruptEnabled {false};
+    std::function<bool(uint8_t)> receiver;
+    // The time of a frame on the wire, from the start bit to the stop bits
+    std::atomic<uint64_t> nanosecondsPerByte {0};
+    std::atomic<uint64_t> sendingUntil {0};
+};
+
+std::array<Line, Usart::__ENUM__SIZE> g_Lines;
+}
+
+static Line* findLine(const uint32_t peripherie)
+{
+    for (auto& line : g_Lines) {
+        if ((line.master >= 0) && (line.peripherie == peripherie)) {
+            return &line;
+        }
+    }
+    return nullptr;
+}
+
+static int takeData(Line& line)
+{
+    const int data = line.data.exchange(-1);
+    if (data >= 0) {
+        sem_post(&line.isRead);
+    }
+    return data;
+}
+
+static uint64_t getNanosecondsPerByte(const USART_InitTypeDef& configuration, const size_t baudRate)
+{
+    // The parity bit is part of the word length
+    const uint64_t bits = 1 + (configuration.USART_WordLength == USART_WordLength_9b ? 9 : 8) +
+                          (configuration.USART_StopBits == USART_StopBits_2 ? 2 : 1);
+
+    return baudRate ? bits * 1000000000 / baudRate : 0;
+}
+
+static void* receiveFromPseudoTerminal(void* parameter)
+{
+    Line& line = *static_cast<Line*>(parameter);
+    pollfd pollDescriptor {line.master, POLLIN, 0};
+    uint64_t nextByte = 0;
+
+    while (true) {
+        std::array<uint8_t, 64> buffer;
+        const ssize_t length = (poll(&pollDescriptor, 1, -1) > 0) ? read(line.master, buffer.data(), buffer.size()) : 0;
+        if (length <= 0) {
+            usleep(1000);
+            continue;
+        }
+
+        for (ssize_t i = 0; i < length; i++) {
+            // However fast the peer writes, a byte can't follow before its predecessor was on the wire
+            hal::posix::sleepUntil(nextByte);
+            nextByte = std::max(nextByte, hal::posix::getNanoseconds()) + line.nanosecondsPerByte;
+
+            line.data = buffer[i];
+            vPortGenerateSimulatedInterrupt(line.irq);
+            while ((sem_wait(&line.isRead) != 0) && (errno == EINTR)) {}
+        }
+    }
+    return nullptr;
+}
+
+#if USART1_INTERRUPT_ENABLED
+void USART1_IRQHandler(void)
+{
+    constexpr const Usart& uart = Factory<Usart>::getByPeripherie<USART1_BASE>();
+    Usart::USART_IRQHandler(uart);
+}
+#endif
+
+#if USART2_INTERRUPT_ENABLED
+void USART2_IRQHandler(void)
+{
+    constexpr const Usart& uart = Factory<Usart>::getByPeripherie<USART2_BASE>();
+    Usart::USART_IRQHandler(uart);
+}
+#endif
+
+#if USART3_INTERRUPT_ENABLED
+void USART3_IRQHandler(void)
+{
+    constexpr const Usart& uart = Factory<Usart>::getByPeripherie<USART3_BASE>();
+    Usart::USART_IRQHandler(uart);
+}
+#endif
+
+#if USART4_INTERRUPT_ENABLED
+void UART4_IRQHandler(void)
+{
+    constexpr const Usart& uart = Factory<Usart>::getByPeripherie<UART4_BASE>();
+    Usart::USART_IRQHandler(uart);
+}
+#endif
+
+#if USART5_INTERRUPT_ENABLED
+void UART5_IRQHandler(void)
+{
+    constexpr const Usart& uart = Factory<Usart>::getByPeripherie<UART5_BASE>();
+    Usart::USART_IRQHandler(uart);
+}
+#endif
+
+void Usart::USART_IRQHandler(const Usart& peripherie)
+{
+    Line& line = g_Lines[peripherie.mDescription];
+    const int data = line.data;
+
+    if (data < 0) {
+        return;
+    }
+    if (line.receiver && line.receiver(static_cast<uint8_t>(data))) {
+        takeData(line);
+    } else if (line.isInterruptEnabled && Usart::ReceiveInterruptCallbacks[peripherie.mDescription]) {
+        Usart::ReceiveInterruptCallbacks[peripherie.mDescription](static_cast<uint8_t>(takeData(line)));
+    }
+}
+
+void Usart::initialize() const
+{
+    static const char* const names[] = {"USART1", "USART2", "USART3", "UART4", "UART5"};
+    Line& line = g_Lines[mDescription];
+
+    line.peripherie = mPeripherie;
+    line.irq = getIRQn();
+    line.nanosecondsPerByte = getNanosecondsPerByte(mConfiguration, mConfiguration.USART_BaudRate);
+    line.master = posix_openpt(O_RDWR | O_NOCTTY);
+    if ((line.master < 0) || (grantpt(line.master) != 0) || (unlockpt(line.master) != 0)) {
+        Trace(ZONE_ERROR, "No pseudo terminal for USART %x\r\n", mPeripherie);
+        line.master = -1;
+        return;
+    }
+    fcntl(line.master, F_SETFL, fcntl(line.master, F_GETFL) | O_NONBLOCK);
+
+    // The slave stays open, so the master doesn't hang up while nobody is connected
+    const char* const slaveName = ptsname(line.master);
+    const int slave = open(slaveName, O_RDWR | O_NOCTTY);
+    termios attributes;
+    if ((slave >= 0) && (tcgetattr(slave, &attributes) == 0)) {
+        cfmakeraw(&attributes);
+        tcsetattr(slave, TCSANOW, &attributes);
+    }
+
+    // USART1 to USART3 and UART4 to UART5 have consecutive interrupts
+    const size_t number = line.irq >= UART4_IRQn ? line.irq - UART4_IRQn + 3 : line.irq - USART1_IRQn;
+    const char* const name = names[number];
+    unlink(name);
+    if (symlink(slaveName, name) != 0) {
+        Trace(ZONE_WARNING, "Can't link %s\r\n", name);
+    }
+    Trace(ZONE_INFO, "%s is %s\r\n", name, slaveName);
+
+    static void (* const handlers[])(void) = {
+#if USART1_INTERRUPT_ENABLED
+        USART1_IRQHandler,
+#else
+        nullptr,
+#endif
+#if USART2_INTERRUPT_ENABLED
+        USART2_IRQHandler,
+#else
+        nullptr,
+#endif
+#if USART3_INTERRUPT_ENABLED
+        USART3_IRQHandler,
+#else
+        nullptr,
+#endif
+#if USART4_INTERRUPT_ENABLED
+        UART4_IRQHandler,
+#else
+        nullptr,
+#endif
+#if USART5_INTERRUPT_ENABLED
+        UART5_IRQHandler,
+#else
+        nullptr,
+#endif
+    };
+    if (handlers[number] != nullptr) {
+        vPortSetInterruptHandler(line.irq, handlers[number]);
+    }
+
+    sem_init(&line.isRead, 0, 0);
+    hal::posix::startThread(receiveFromPseudoTerminal, &line);
+
+    mInitalized = true;
+}
+
+IRQn Usart::getIRQn(void) const
+{
+    switch (mPeripherie) {
+    case USART1_BASE:
+        return IRQn::USART1_IRQn;
+
+    case USART2_BASE:
+        return IRQn::USART2_IRQn;
+
+    case USART3_BASE:
+        return IRQn::USART3_IRQn;
+
+    case UART4_BASE:
+        return IRQn::UART4_IRQn;
+
+    case UART5_BASE:
+        return IRQn::UART5_IRQn;
+    }
+
+    return IRQn::UsageFault_IRQn;
+}
+
+bool Usart::isInitalized(void) const
+{
+    return mInitalized;
+}
+
+void Usart::setBaudRate(const size_t baudRate) const
+{
+    g_Lines[mDescription].nanosecondsPerByte = getNanosecondsPerByte(mConfiguration, baudRate);
+}
+
+void Usart::restoreDefaultConfiguration(void) const
+{
+    g_Lines[mDescription].nanosecondsPerByte = getNanosecondsPerByte(mConfiguration, mConfiguration.USART_BaudRate);
+}
+
+void Usart::enableNonBlockingReceive(std::function<void(uint8_t)> callback) const
+{
+    Line& line = g_Lines[mDescription];
+
+    ReceiveInterruptCallbacks[mDescription] = callback;
+    line.isInterruptEnabled = true;
+    if (line.data >= 0) {
+        vPortGenerateSimulatedInterrupt(line.irq);
+    }
+}
+
+void Usart::disableNonBlockingReceive(void) const
+{
+    g_Lines[mDescription].isInterruptEnabled = false;
+}
+
+void Usart::send(const uint16_t data) const
+{
+    const uint8_t byte = static_cast<uint8_t>(data);
+    hal::posix::sendToUsart(mPeripherie, &byte, sizeof(byte));
+}
+
+size_t Usart::send(uint8_t const* const data, const size_t length) const
+{
+    if (data == nullptr) {
+        return 0;
+    }
+
+    hal::posix::sendToUsart(mPeripherie, data, length);
+    return length;
+}
+
+bool Usart::isReadyToReceive(void) const
+{
+    return g_Lines[mDescription].data >= 0;
+}
+
+uint16_t Usart::receive(void) const
+{
+    const int data = takeData(g_Lines[mDescription]);
+    return data >= 0 ? static_cast<uint16_t>(data) : 0;
+}
+
+size_t Usart::receive(uint8_t* const data, const size_t length) const
+{
+    if (data == nullptr) {
+        return 0;
+    }
+
+    size_t bytesReceived = 0;
+    while (bytesReceived < length) {
+        if (this->isReadyToReceive()) {
+            data[bytesReceived] = (uint8_t)this->receive();
+            bytesReceived++;
+        }
+    }
+    return bytesReceived;
+}
+
+size_t Usart::receiveAvailableData(uint8_t* const data, const size_t length) const
+{
+    if (data == nullptr) {
+        return 0;
+    }
+
+    size_t bytesReceived = 0;
+    while (bytesReceived < length) {
+        if (this->isReadyToReceive()) {
+            data[bytesReceived] = (uint8_t)receive();
+            bytesReceived++;
+        } else {
+            return bytesReceived;
+        }
+    }
+    return bytesReceived;
+}
+
+bool Usart::isReadyToSend(void) const
+{
+    return true;
+}
+
+bool Usart::hasOverRunError(void) const
+{
+    return false;
+}
+
+bool Usart::hasNoiseError(void) const
+{
+    return false;
+}
+
+bool Usart::hasFramingError(void) const
+{
+    return false;
+}
+
+bool Usart::hasParityError(void) const
+{
+    return false;
+}
+
+void Usart::clearOverRunError(void) const
+{}
+
+void Usart::clearNoiseError(void) const
+{}
+
+void Usart::clearFramingError(void) const
+{}
+
+void Usart::clearParityError(void) const
+{}
+
+uint64_t hal::posix::sendToUsart(const uint32_t peripherie, uint8_t const* const data, const size_t length)
+{
+    const uint64_t now = getNanoseconds();
+    Line* const line = findLine(peripherie);
+    if (line == nullptr) {
+        return now;
+    }
+
+    // Queued behind the bytes which are still on the wire
+    const uint64_t end = std::max(now, line->sendingUntil.load()) + length * line->nanosecondsPerByte;
+    line->sendingUntil = end;
+
+    // Whatever the peer doesn't take in time is lost, like on the wire
+    size_t bytesSent = 0;
+    while (bytesSent < length) {
+        const ssize_t result = write(line->master, data + bytesSent, length - bytesSent);
+        if (result > 0) {
+            bytesSent += result;
+        } else if (errno != EINTR) {
+            break;
+        }
+    }
+    return end;
+}
+
+void hal::posix::setUsartReceiver(const uint32_t peripherie, std::function<bool(uint8_t)> receiver)
+{
+    Line* const line = findLine(peripherie);
+    if (line == nullptr) {
+        return;
+    }
+
+    // The previous receiver is destroyed outside of the critical section
+    taskENTER_CRITICAL();
+    line->receiver.swap(receiver);
+    const bool isPending = line->receiver && (line->data >= 0);
+    taskEXIT_CRITICAL();
+
+    if (isPending) {
+        vPortGenerateSimulatedInterrupt(line->irq);
+    }
+}
+
+Usart::ReceiveCallbackArray Usart::ReceiveInterruptCallbacks;
+
+constexpr const std::array<const Usart, Usart::__ENUM__SIZE + 1> Factory<Usart>::Container;
+constexpr const std::array<const uint32_t, Usart::__ENUM__SIZE> Factory<Usart>::Clocks;
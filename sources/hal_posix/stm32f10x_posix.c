@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+/*
+ * The parts of the device which the firmware uses beyond the drivers of
+ * hal_posix: the few functions of the standard peripheral library, which the
+ * unchanged drivers of hal_stm32f10x call, and the symbols of the linker
+ * script. Clocks and interrupt priorities don't exist on the host, the GPIOs
+ * keep their output data register and the SPI reads a floating MISO.
+ */
+
+#include <stdint.h>
+#include "stm32f10x.h"
+#include "stm32f10x_flash.h"
+#include "stm32f10x_gpio.h"
+#include "stm32f10x_rcc.h"
+#include "stm32f10x_spi.h"
+#include "stm32f10x_usart.h"
+#include "misc.h"
+
+uint32_t SystemCoreClock = 72000000;
+
+// The RCE_RAM region of the linker script, remote code updates are written to it
+char _rce_start[1024] __attribute__((aligned(4)));
+__asm__ (".globl _rce_end\n.set _rce_end, _rce_start + 1024");
+
+// GPIOA to GPIOG
+static uint16_t g_OutputData[7];
+
+static uint16_t* getOutputData(GPIO_TypeDef const* const GPIOx)
+{
+    return &g_OutputData[((uintptr_t)GPIOx - GPIOA_BASE) / (GPIOB_BASE - GPIOA_BASE)];
+}
+
+void RCC_GetClocksFreq(RCC_ClocksTypeDef* RCC_Clocks)
+{
+    RCC_Clocks->SYSCLK_Frequency = SystemCoreClock;
+    RCC_Clocks->HCLK_Frequency = SystemCoreClock;
+    RCC_Clocks->PCLK1_Frequency = SystemCoreClock / 2;
+    RCC_Clocks->PCLK2_Frequency = SystemCoreClock;
+    RCC_Clocks->ADCCLK_Frequency = SystemCoreClock / 6;
+}
+
+void RCC_AHBPeriphClockCmd(uint32_t RCC_AHBPeriph, FunctionalState NewState)
+{}
+
+void RCC_APB2PeriphClockCmd(uint32_t RCC_APB2Periph, FunctionalState NewState)
+{}
+
+void RCC_APB1PeriphClockCmd(uint32_t RCC_APB1Periph, FunctionalState NewState)
+{}
+
+void RCC_APB2PeriphResetCmd(uint32_t RCC_APB2Periph, FunctionalState NewState)
+{}
+
+void NVIC_PriorityGroupConfig(uint32_t NVIC_PriorityGroup)
+{}
+
+void FLASH_Lock(void)
+{}
+
+void USART_DMACmd(USART_TypeDef* USARTx, uint16_t USART_DMAReq, FunctionalState NewState)
+{}
+
+void GPIO_Init(GPIO_TypeDef* GPIOx, GPIO_InitTypeDef const* const GPIO_InitStruct)
+{
+    // The output data register selects the pull resistor of an input
+    if (GPIO_InitStruct->GPIO_Mode == GPIO_Mode_IPU) {
+        *getOutputData(GPIOx) |= GPIO_InitStruct->GPIO_Pin;
+    } else if (GPIO_InitStruct->GPIO_Mode == GPIO_Mode_IPD) {
+        *getOutputData(GPIOx) &= ~GPIO_InitStruct->GPIO_Pin;
+    }
+}
+
+void GPIO_PinRemapConfig(uint32_t GPIO_Remap, FunctionalState NewState)
+{}
+
+uint8_t GPIO_ReadInputDataBit(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin)
+{
+    // Nothing drives the pins from outside
+    return GPIO_ReadOutputDataBit(GPIOx, GPIO_Pin);
+}
+
+uint8_t GPIO_ReadOutputDataBit(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin)
+{
+    return (*getOutputData(GPIOx) & GPIO_Pin) ? (uint8_t)Bit_SET : (uint8_t)Bit_RESET;
+}
+
+void GPIO_WriteBit(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, BitAction BitVal)
+{
+    if (BitVal != Bit_RESET) {
+        *getOutputData(GPIOx) |= GPIO_Pin;
+    } else {
+        *getOutputData(GPIOx) &= ~GPIO_Pin;
+    }
+}
+
+void SPI_I2S_DeInit(SPI_TypeDef* SPIx)
+{}
+
+void SPI_Init(SPI_TypeDef* SPIx, const SPI_InitTypeDef* SPI_InitStruct)
+{}
+
+void SPI_Cmd(SPI_TypeDef* SPIx, FunctionalState NewState)
+{}
+
+void SPI_SSOutputCmd(SPI_TypeDef* SPIx, FunctionalState NewState)
+{}
+
+void SPI_I2S_SendData(SPI_TypeDef* SPIx, uint16_t Data)
+{}
+
+uint16_t SPI_I2S_ReceiveData(SPI_TypeDef* SPIx)
+{
+    return 0xffff;
+}
+
+FlagStatus SPI_I2S_GetFlagStatus(SPI_TypeDef* SPIx, uint16_t SPI_I2S_FLAG)
+{
+    return (SPI_I2S_FLAG & (SPI_I2S_FLAG_TXE | SPI_I2S_FLAG_RXNE)) ? SET : RESET;
+}
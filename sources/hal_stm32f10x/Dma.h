@@ -135,9 +135,14 @@ class Factory<Dma>
     template<uint32_t peripherieBase, enum Dma::Description index>
     static constexpr const Dma& getByPeripherie(void)
     {
-        return (Container[index]).mPeripherie ==
-               peripherieBase ? Container[index] : getByPeripherie<peripherieBase,
-                                                                   static_cast<enum Dma::Description>(index - 1)>();
+        // The first instance ends the recursion, the index must not wrap around
+        if constexpr (index == 0) {
+            return Container[index];
+        } else {
+            return (Container[index]).mPeripherie ==
+                   peripherieBase ? Container[index] : getByPeripherie<peripherieBase,
+                                                                       static_cast<enum Dma::Description>(index - 1)>();
+        }
     }
 
 public:
@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include "Flash.h"
+#include "trace.h"
+#include "LockGuard.h"
+#include <cstring>
+
+static const int __attribute__((unused)) g_DebugZones = ZONE_ERROR |
+                                                        ZONE_WARNING | ZONE_VERBOSE | ZONE_INFO;
+
+using hal::Flash;
+using hal::Factory;
+
+bool Flash::erasePage(const size_t offset) const
+{
+    if ((offset >= mSize) || (offset % PAGESIZE)) {
+        Trace(ZONE_WARNING, "Invalid page offset %d\r\n", offset);
+        return false;
+    }
+
+    os::LockGuard<os::Mutex> lock(FlashControllerMutex);
+
+    FLASH_Unlock();
+    const FLASH_Status status = FLASH_ErasePage(mStartAddress + offset);
+    FLASH_Lock();
+
+    if (status != FLASH_COMPLETE) {
+        Trace(ZONE_ERROR, "Erase of page %x failed: %d\r\n", mStartAddress + offset, status);
+        return false;
+    }
+    return true;
+}
+
+bool Flash::program(const size_t offset, uint16_t const* const data, const size_t numberOfHalfWords) const
+{
+    if ((data == nullptr) || (offset % sizeof(uint16_t)) ||
+        (offset + numberOfHalfWords * sizeof(uint16_t) > mSize))
+    {
+        Trace(ZONE_WARNING, "Invalid parameters\r\n");
+        return false;
+    }
+
+    os::LockGuard<os::Mutex> lock(FlashControllerMutex);
+
+    FLASH_Unlock();
+    FLASH_Status status = FLASH_COMPLETE;
+    for (size_t i = 0; (i < numberOfHalfWords) && (status == FLASH_COMPLETE); i++) {
+        // Every half word stalls the CPU for about 50 us, interrupts are served in between
+        status = FLASH_ProgramHalfWord(mStartAddress + offset + i * sizeof(uint16_t), data[i]);
+    }
+    FLASH_Lock();
+
+    if (status != FLASH_COMPLETE) {
+        Trace(ZONE_ERROR, "Programming at %x failed: %d\r\n", mStartAddress + offset, status);
+        return false;
+    }
+    return true;
+}
+
+void Flash::read(const size_t offset, uint8_t* const data, const size_t length) const
+{
+    if ((data == nullptr) || (offset + length > mSize)) {
+        Trace(ZONE_WARNING, "Invalid parameters\r\n");
+        return;
+    }
+    std::memcpy(data, reinterpret_cast<const void*>(mStartAddress + offset), length);
+}
+
+size_t Flash::getSize(void) const
+{
+    return mSize;
+}
+
+os::Mutex Flash::FlashControllerMutex;
+constexpr std::array<const Flash, Flash::__ENUM__SIZE> Factory<Flash>::Container;
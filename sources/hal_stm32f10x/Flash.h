@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#ifndef SOURCES_PMD_FLASH_H_
+#define SOURCES_PMD_FLASH_H_
+
+#include <cstdint>
+#include <array>
+#include "stm32f10x_flash.h"
+#include "Mutex.h"
+#include "hal_Factory.h"
+
+namespace hal
+{
+/**
+ * A region of the internal flash which is reserved for data. Offsets are
+ * relative to the start of the region. The STM32F10x programs half words,
+ * which have to be erased before. While a page is erased or programmed, every
+ * code fetch from flash stalls the CPU, including interrupt handlers. A page
+ * erase takes up to 40 ms, so it doesn't belong into a time critical path.
+ */
+struct Flash {
+#include "Flash_config.h"
+
+    static constexpr size_t PAGESIZE = 2048;
+
+    Flash() = delete;
+    Flash(const Flash&) = delete;
+    Flash(Flash&&) = default;
+    Flash& operator=(const Flash&) = delete;
+    Flash& operator=(Flash&&) = delete;
+
+    bool erasePage(const size_t offset) const;
+    bool program(const size_t offset, uint16_t const* const data, const size_t numberOfHalfWords) const;
+    void read(const size_t offset, uint8_t* const data, const size_t length) const;
+    size_t getSize(void) const;
+
+private:
+    constexpr Flash(const enum Description desc,
+                    const uint32_t         startAddress,
+                    const size_t           size) :
+        mDescription(std::move(desc)), mStartAddress(startAddress), mSize(size) {}
+
+    const enum Description mDescription;
+    const uint32_t mStartAddress;
+    const size_t mSize;
+
+    // All regions share one flash controller
+    static os::Mutex FlashControllerMutex;
+
+    friend class Factory<Flash>;
+};
+
+template<>
+class Factory<Flash>
+{
+#include "Flash_config.h"
+
+    Factory(void)
+    {
+        FLASH_Lock();
+    }
+
+public:
+
+    template<enum Flash::Description index>
+    static constexpr const Flash& get(void)
+    {
+        static_assert(index != Flash::Description::__ENUM__SIZE, "__ENUM__SIZE is not accessible");
+        static_assert(Container[index].mDescription == index, "Wrong mapping between Description and Container");
+
+        return Container[index];
+    }
+
+    template<typename U>
+    friend const U& getFactory(void);
+};
+}
+
+#endif /* SOURCES_PMD_FLASH_H_ */
@@ -112,6 +112,12 @@ void Usart::setBaudRate(const size_t baudRate) const
     USART_Cmd(reinterpret_cast<USART_TypeDef*>(mPeripherie), ENABLE);
 }
 
+void Usart::restoreDefaultConfiguration(void) const
+{
+    USART_Init(reinterpret_cast<USART_TypeDef*>(mPeripherie), &mConfiguration);
+    USART_Cmd(reinterpret_cast<USART_TypeDef*>(mPeripherie), ENABLE);
+}
+
 void Usart::enableNonBlockingReceive(std::function<void(uint8_t)> callback) const
 {
     ReceiveInterruptCallbacks[mDescription] = callback;
@@ -63,6 +63,7 @@ struct Usart {
     bool isInitalized(void) const;
 
     void setBaudRate(const size_t) const;
+    void restoreDefaultConfiguration(void) const;
 
     void enableNonBlockingReceive(std::function<void(uint8_t)> callback) const;
     void disableNonBlockingReceive(void) const;
@@ -129,9 +130,14 @@ class Factory<Usart>
     template<uint32_t peripherieBase, enum Usart::Description index>
     static constexpr const Usart& getByPeripherie(void)
     {
-        return (Container[index]).mPeripherie ==
-               peripherieBase ? Container[index] : getByPeripherie<peripherieBase,
-                                                                   static_cast<enum Usart::Description>(index - 1)>();
+        // The first instance ends the recursion, the index must not wrap around
+        if constexpr (index == 0) {
+            return Container[index];
+        } else {
+            return (Container[index]).mPeripherie ==
+                   peripherieBase ? Container[index] : getByPeripherie<peripherieBase,
+                                                                       static_cast<enum Usart::Description>(index - 1)>();
+        }
     }
 
 public:
@@ -4,6 +4,7 @@
  */
 
 #include "CRC.h"
+#include "Dma.h"
 #include "trace.h"
 #include "LockGuard.h"
 
@@ -33,11 +34,43 @@ uint8_t Crc::getCrc(uint8_t const* const data, const size_t length) const
     os::LockGuard<os::Mutex> lock(CrcUnitAvailableMutex[static_cast<size_t>(mDescription)]);
 
     CRC_ResetDR();
-    for (size_t i = 0; i < length; i++) {
-        CRC_CalcCRC8bits(data[i]);
+
+    // The DMA has no access to the CCM RAM
+    const bool isDmaAccessible = (reinterpret_cast<uintptr_t>(data) & 0xf0000000) != CCMDATARAM_BASE;
+    if ((length >= MIN_LENGTH_FOR_DMA_TRANSFER) && isDmaAccessible) {
+        const Dma& dma = Factory<Dma>::get<Dma::MEMORY>();
+        dma.memcpyToRegister(&CRC->DR, data, length);
+        while (dma.getCurrentDataCounter() != 0) {
+            os::ThisTask::yield();
+        }
+        dma.disable();
+        return CRC_GetCRC();
+    }
+
+    uint8_t const* it = data;
+    size_t remaining = length;
+    for ( ; remaining && (reinterpret_cast<uintptr_t>(it) & 0x3); remaining--) {
+        CRC_CalcCRC8bits(*it++);
+    }
+    // The unit takes the MSB of a word first, so the bytes are swapped into memory order
+    for ( ; remaining >= sizeof(uint32_t); remaining -= sizeof(uint32_t), it += sizeof(uint32_t)) {
+        CRC->DR = __REV(*reinterpret_cast<uint32_t const*>(it));
+    }
+    for ( ; remaining; remaining--) {
+        CRC_CalcCRC8bits(*it++);
     }
     return CRC_GetCRC();
 }
 
+uint8_t Crc::getCrcFromISR(uint8_t const* const data, const size_t length) const
+{
+    if ((data == nullptr) || (length == 0) || (mPolynomialSize != CRC_PolSize_8) ||
+        (mReverseInputSelection != CRC_ReverseInputData_No) || (mReverseOutputSelection != DISABLE))
+    {
+        return 0;
+    }
+    return mSoftwareCrc.calculate(static_cast<uint8_t>(mInitialValue), data, length);
+}
+
 std::array<os::Mutex, Crc::Description::__ENUM__SIZE> Crc::CrcUnitAvailableMutex;
 constexpr std::array<const Crc, Crc::__ENUM__SIZE> Factory<Crc>::Container;
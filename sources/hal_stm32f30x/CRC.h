@@ -12,6 +12,7 @@
 #include "stm32f30x_rcc.h"
 #include "Mutex.h"
 #include "hal_Factory.h"
+#include "SoftwareCrc8.h"
 
 namespace hal
 {
@@ -26,6 +27,9 @@ struct Crc {
 
     uint8_t getCrc(uint8_t const* const data, const size_t length) const;
 
+    // Software CRC with the same result, for interrupts which can't wait for the CRC unit
+    uint8_t getCrcFromISR(uint8_t const* const data, const size_t length) const;
+
 private:
     constexpr Crc(const enum Description desc,
                   const uint32_t         polynomialSize,
@@ -39,7 +43,8 @@ private:
         mReverseOutputSelection(reverseOutputSelection ==
                                 true ? ENABLE : DISABLE),
         mInitialValue(std::move(initialValue)),
-        mPolynomial(std::move(polynomial)) {}
+        mPolynomial(std::move(polynomial)),
+        mSoftwareCrc(static_cast<uint8_t>(polynomial)) {}
 
     const enum Description mDescription;
     const uint32_t mPolynomialSize;
@@ -47,6 +52,10 @@ private:
     const FunctionalState mReverseOutputSelection;
     const uint32_t mInitialValue;
     const uint32_t mPolynomial;
+    const SoftwareCrc8<4> mSoftwareCrc;
+
+    // Shorter blocks are fed word by word, the context switch costs more than the transfer
+    static constexpr size_t MIN_LENGTH_FOR_DMA_TRANSFER = 256;
 
     void initialize(void) const;
 
@@ -255,6 +255,32 @@ void Dma::memcpy(void const* const dest, void const* const src, const size_t len
     DMA_Cmd(reinterpret_cast<DMA_Channel_TypeDef*>(mPeripherie), ENABLE);
 }
 
+void Dma::memcpyToRegister(volatile void* const dest, void const* const src, const size_t length) const
+{
+    if ((dest == nullptr) || (src == nullptr) || (length == 0) || (mDescription != MEMORY)) {
+        return;
+    }
+
+    disable();
+
+    const DMA_InitTypeDef initStruct {
+        reinterpret_cast<uint32_t>(src),
+        reinterpret_cast<uint32_t>(dest),
+        DMA_DIR_PeripheralSRC,
+        static_cast<uint16_t>(length),
+        DMA_PeripheralInc_Enable,
+        DMA_MemoryInc_Disable,
+        DMA_PeripheralDataSize_Byte,
+        DMA_MemoryDataSize_Byte,
+        DMA_Mode_Normal,
+        DMA_Priority_Low,
+        DMA_M2M_Enable
+    };
+
+    DMA_Init(reinterpret_cast<DMA_Channel_TypeDef*>(mPeripherie), &initStruct);
+    DMA_Cmd(reinterpret_cast<DMA_Channel_TypeDef*>(mPeripherie), ENABLE);
+}
+
 void Dma::setupSendSingleCharMultipleTimes(uint8_t const* const data, const size_t length) const
 {
     disable();
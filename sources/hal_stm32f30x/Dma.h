@@ -63,6 +63,8 @@ struct Dma {
     void setCurrentDataCounter(const uint16_t) const;
 
     void memcpy(void const* const dest, void const* const src, const size_t length) const;
+    // Writes length bytes one after the other into a single register, e.g. a data register of a peripheral
+    void memcpyToRegister(volatile void* const dest, void const* const src, const size_t length) const;
 
     inline static void DMA_IRQHandler(const Dma&     peripherie,
                                       const uint32_t TCFlag,
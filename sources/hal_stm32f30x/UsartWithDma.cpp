@@ -186,4 +186,40 @@ void UsartWithDma::stopNonBlockingReceive(void) const
     }
 }
 
+void UsartWithDma::startCircularReceive(uint8_t* const data, const size_t length,
+                                        const size_t bitsUntilTimeout) const
+{
+    if ((mRxDma == nullptr) || !(mDmaCmd & USART_DMAReq_Rx)) {
+        Trace(ZONE_ERROR, "Circular receive needs a Rx Dma\r\n");
+        return;
+    }
+
+    // The task is woken at the half of the buffer, too, so it never overtakes the reader
+    mRxDma->registerInterruptSemaphore(&DmaReceiveCompleteSemaphores.at(mUsart.mDescription),
+                                       Dma::InterruptSource::HT);
+    DmaReceiveCompleteSemaphores.at(mUsart.mDescription).take(std::chrono::milliseconds(0));
+    enableReceiveTimeout(bitsUntilTimeout);
+    receiveNonBlocking(data, length, true);
+}
+
+size_t UsartWithDma::waitForCircularReceive(const size_t length, const uint32_t ticksToWait) const
+{
+    DmaReceiveCompleteSemaphores.at(mUsart.mDescription).take(std::chrono::milliseconds(ticksToWait));
+
+    if (mUsart.hasOverRunError()) {
+        mUsart.clearOverRunError();
+    }
+    // The counter is reloaded with length when the DMA wraps around
+    return (length - mRxDma->getCurrentDataCounter()) % length;
+}
+
+void UsartWithDma::stopCircularReceive(void) const
+{
+    stopNonBlockingReceive();
+    disableReceiveTimeout();
+    if (mRxDma != nullptr) {
+        mRxDma->unregisterInterruptSemaphore(Dma::InterruptSource::HT);
+    }
+}
+
 constexpr const std::array<const UsartWithDma, 1> Factory<UsartWithDma>::Container;
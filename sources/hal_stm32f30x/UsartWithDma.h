@@ -50,6 +50,16 @@ struct UsartWithDma {
     void enableReceiveTimeout(const size_t bitsUntilTimeout) const;
     void disableReceiveTimeout(void) const;
 
+    /**
+     * Receives continuously into a ring buffer. waitForCircularReceive returns
+     * the position the DMA writes next, after the line was idle for
+     * bitsUntilTimeout, at the half and at the end of the buffer, or after
+     * ticksToWait.
+     */
+    void startCircularReceive(uint8_t* const data, const size_t length, const size_t bitsUntilTimeout) const;
+    size_t waitForCircularReceive(const size_t length, const uint32_t ticksToWait = portMAX_DELAY) const;
+    void stopCircularReceive(void) const;
+
     const Usart& mUsart;
 
 private:
@@ -14,6 +14,14 @@ CountingSemaphore::CountingSemaphore(uint32_t maximalCount,
                                               initalCount))
 {}
 
+#if OS_STATIC_ALLOCATION
+CountingSemaphore::CountingSemaphore(uint32_t         maximalCount,
+                                     uint32_t         initalCount,
+                                     SemaphoreStorage& storage) :
+    mSemaphoreHandle(xSemaphoreCreateCountingStatic(maximalCount, initalCount, &storage))
+{}
+#endif
+
 CountingSemaphore::CountingSemaphore(CountingSemaphore&& rhs) :
     mSemaphoreHandle(rhs.mSemaphoreHandle)
 {
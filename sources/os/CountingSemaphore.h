@@ -8,6 +8,7 @@
 #include "FreeRTOS.h"
 #include "semphr.h"
 #include "os_Task.h"
+#include "os_StaticStorage.h"
 
 namespace os
 {
@@ -17,6 +18,9 @@ class CountingSemaphore
 
 public:
     CountingSemaphore(uint32_t maximalCount, uint32_t initalCount);
+#if OS_STATIC_ALLOCATION
+    CountingSemaphore(uint32_t maximalCount, uint32_t initalCount, SemaphoreStorage& storage);
+#endif
     CountingSemaphore(const CountingSemaphore&) = delete;
     CountingSemaphore(CountingSemaphore&&);
     CountingSemaphore& operator=(const CountingSemaphore&) = delete;
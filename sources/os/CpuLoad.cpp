@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include "CpuLoad.h"
+#include "LockGuard.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifndef MEASURE_CPU_LOAD
+#error "Build with -DMEASURE_CPU_LOAD"
+#endif
+
+static const int __attribute__((used)) g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_VERBOSE | ZONE_INFO;
+
+using os::CpuLoad;
+
+constexpr size_t CpuLoad::MAXTASKS;
+constexpr size_t CpuLoad::WINDOW;
+constexpr uint32_t CpuLoad::PERMILLE;
+
+CpuLoad::CpuLoad(const std::chrono::milliseconds period) :
+    mPeriod(period),
+    mSampleTask("CpuLoad", CpuLoad::STACKSIZE, os::Task::Priority::HIGH, [this](const bool&){
+    while (true) {
+        sample();
+        os::ThisTask::sleep(mPeriod);
+    }
+}) {}
+
+CpuLoad::Entry* CpuLoad::find(const UBaseType_t number)
+{
+    for (size_t i = 0; i < mNumberOfEntries; i++) {
+        if (mEntries[i].number == number) {
+            return &mEntries[i];
+        }
+    }
+    return nullptr;
+}
+
+void CpuLoad::sample(void)
+{
+    const uint32_t start = os::Task::getMicroseconds();
+    uint32_t counter;
+    const size_t count = uxTaskGetSystemState(mStatus.data(), mStatus.size(), &counter);
+    if (count == 0) {
+        Trace(ZONE_WARNING, "More than %d tasks\r\n", static_cast<int>(MAXTASKS));
+        return;
+    }
+
+    LockGuard<Mutex> lock(mMutex);
+
+    // Entries of deleted tasks make room for new ones
+    for (size_t i = 0; i < mNumberOfEntries; i++) {
+        mEntries[i].isAlive = false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        Entry* const entry = find(mStatus[i].xTaskNumber);
+        if (entry != nullptr) {
+            entry->isAlive = true;
+        }
+    }
+    mNumberOfEntries = std::remove_if(mEntries.begin(), mEntries.begin() + mNumberOfEntries, [](const Entry& entry){
+        return !entry.isAlive;
+    }) - mEntries.begin();
+
+    // Differences of the 32 bit counters are right across a wrap
+    const size_t slot = mSamples % WINDOW;
+    mElapsed[slot] = counter - mLastCounter;
+    mLastCounter = counter;
+
+    for (size_t i = 0; i < count; i++) {
+        const TaskStatus_t& status = mStatus[i];
+        Entry* entry = find(status.xTaskNumber);
+        if (entry == nullptr) {
+            // The run time counter of a new task starts at zero
+            entry = &mEntries[mNumberOfEntries++];
+            entry->number = status.xTaskNumber;
+            std::strncpy(entry->name, status.pcTaskName, sizeof(entry->name) - 1);
+            entry->name[sizeof(entry->name) - 1] = '\0';
+            entry->lastCounter = 0;
+            entry->cycles = 0;
+            entry->window.fill(0);
+        }
+
+        const uint32_t cycles = status.ulRunTimeCounter - entry->lastCounter;
+        entry->lastCounter = status.ulRunTimeCounter;
+        entry->cycles += cycles;
+        entry->window[slot] = cycles;
+        entry->isAlive = true;
+    }
+
+    mSamples++;
+    mSampleMicroseconds = os::Task::getMicroseconds() - start;
+}
+
+uint32_t CpuLoad::getLoad(const Entry& entry) const
+{
+    uint64_t cycles = 0;
+    uint64_t elapsed = 0;
+    for (size_t i = 0; i < WINDOW; i++) {
+        cycles += entry.window[i];
+        elapsed += mElapsed[i];
+    }
+    return elapsed == 0 ? 0 : static_cast<uint32_t>(cycles * PERMILLE / elapsed);
+}
+
+size_t CpuLoad::getNumberOfTasks(void) const
+{
+    LockGuard<Mutex> lock(mMutex);
+    return mNumberOfEntries;
+}
+
+CpuLoad::TaskLoad CpuLoad::getTaskLoad(const size_t index) const
+{
+    LockGuard<Mutex> lock(mMutex);
+    if (index >= mNumberOfEntries) {
+        return TaskLoad {"", 0, 0};
+    }
+    const Entry& entry = mEntries[index];
+    return TaskLoad {entry.name, getLoad(entry), entry.cycles};
+}
+
+uint32_t CpuLoad::getTotalLoad(void) const
+{
+    LockGuard<Mutex> lock(mMutex);
+    for (size_t i = 0; i < mNumberOfEntries; i++) {
+        if (std::strcmp(mEntries[i].name, "IDLE") == 0) {
+            return PERMILLE - std::min(PERMILLE, getLoad(mEntries[i]));
+        }
+    }
+    return 0;
+}
+
+uint32_t CpuLoad::getSampleMicroseconds(void) const
+{
+    return mSampleMicroseconds;
+}
+
+void CpuLoad::dump(const std::function<void(std::string_view)>& send) const
+{
+    const uint32_t total = getTotalLoad();
+    std::array<char, 64> line;
+
+    LockGuard<Mutex> lock(mMutex);
+    int length = std::snprintf(line.data(), line.size(), "total %3u.%u%% sample %u us\r\n",
+                               static_cast<unsigned>(total / 10), static_cast<unsigned>(total % 10),
+                               static_cast<unsigned>(mSampleMicroseconds));
+    send(std::string_view(line.data(), std::min(static_cast<size_t>(length), line.size() - 1)));
+
+    for (size_t i = 0; i < mNumberOfEntries; i++) {
+        const Entry& entry = mEntries[i];
+        const uint32_t load = getLoad(entry);
+        length = std::snprintf(line.data(), line.size(), "%-*s %3u.%u%% %u Mcycles\r\n",
+                               configMAX_TASK_NAME_LEN - 1, entry.name,
+                               static_cast<unsigned>(load / 10), static_cast<unsigned>(load % 10),
+                               static_cast<unsigned>(entry.cycles / 1000000));
+        send(std::string_view(line.data(), std::min(static_cast<size_t>(length), line.size() - 1)));
+    }
+}
@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "TaskEndless.h"
+#include "Mutex.h"
+
+namespace os
+{
+/**
+ * Load of each task over a sliding window of samples. Built with
+ * MEASURE_CPU_LOAD, the kernel adds the DWT cycles since a task was switched
+ * in to its run time counter whenever it is switched out.
+ *
+ * These counters are 32 bit and wrap after a minute at 72 MHz. They are
+ * extended to 64 bit here from the difference to the last sample, so the
+ * sample period has to be shorter than a wrap. The kernel drops the time
+ * slice in which the cycle counter itself wraps, which is one slice per wrap.
+ */
+class CpuLoad final
+{
+public:
+    static constexpr size_t MAXTASKS = 12;
+    static constexpr size_t WINDOW = 8;
+
+    struct TaskLoad {
+        const char* name;
+        // Share of the cycles in the window in 1/1000
+        uint32_t permille;
+        // Since the task was seen first
+        uint64_t cycles;
+    };
+
+    CpuLoad(const std::chrono::milliseconds period = std::chrono::seconds(1));
+
+    CpuLoad(const CpuLoad&) = delete;
+    CpuLoad(CpuLoad&&) = delete;
+    CpuLoad& operator=(const CpuLoad&) = delete;
+    CpuLoad& operator=(CpuLoad&&) = delete;
+
+    // Called by the task of CpuLoad every period
+    void sample(void);
+
+    size_t getNumberOfTasks(void) const;
+    // The name is valid until the next sample
+    TaskLoad getTaskLoad(const size_t index) const;
+    // Everything but the idle task in 1/1000
+    uint32_t getTotalLoad(void) const;
+    // Time which the last sample took, that's the cost of the measurement besides the context switches
+    uint32_t getSampleMicroseconds(void) const;
+
+    void dump(const std::function<void(std::string_view)>& send) const;
+
+private:
+    static constexpr uint32_t STACKSIZE = 512;
+    static constexpr uint32_t PERMILLE = 1000;
+
+    struct Entry {
+        UBaseType_t number;
+        char name[configMAX_TASK_NAME_LEN];
+        bool isAlive;
+        uint32_t lastCounter;
+        uint64_t cycles;
+        std::array<uint32_t, WINDOW> window;
+    };
+
+    std::array<TaskStatus_t, MAXTASKS> mStatus;
+    std::array<Entry, MAXTASKS> mEntries;
+    size_t mNumberOfEntries = 0;
+    std::array<uint32_t, WINDOW> mElapsed {};
+    uint32_t mLastCounter = 0;
+    uint32_t mSamples = 0;
+    uint32_t mSampleMicroseconds = 0;
+    const std::chrono::milliseconds mPeriod;
+    Mutex mMutex;
+    TaskEndless mSampleTask;
+
+    Entry* find(const UBaseType_t number);
+    uint32_t getLoad(const Entry& entry) const;
+};
+}
@@ -0,0 +1,258 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "CpuLoad.h"
+#include "unittest.h"
+
+//--------------------------MOCKING--------------------------
+// The kernel is emulated by a list of tasks and the cycle counter
+struct KernelTask {
+    UBaseType_t number;
+    std::string name;
+    uint32_t counter;
+};
+static std::vector<KernelTask> g_tasks;
+static uint32_t g_counter = 0;
+
+os::Task::Task(char const* name, unsigned short stack, os::Task::Priority prio,
+               std::function<void(bool const&)> func) {}
+
+os::Task::~Task(void) {}
+
+void os::Task::taskFunction(void) {}
+
+void os::ThisTask::sleep(const std::chrono::milliseconds ms) {}
+
+uint32_t os::Task::getMicroseconds(void)
+{
+    return 0;
+}
+
+os::Mutex::Mutex(void) {}
+
+os::Mutex::~Mutex(void) {}
+
+bool os::Mutex::take(uint32_t ticksToWait) const
+{
+    return true;
+}
+
+bool os::Mutex::give(void) const
+{
+    return true;
+}
+
+os::Mutex::operator bool() const
+{
+    return true;
+}
+
+extern "C" UBaseType_t uxTaskGetSystemState(TaskStatus_t* const pxTaskStatusArray, const UBaseType_t uxArraySize,
+                                            uint32_t* const pulTotalRunTime)
+{
+    if (g_tasks.size() > uxArraySize) {
+        return 0;
+    }
+    for (size_t i = 0; i < g_tasks.size(); i++) {
+        pxTaskStatusArray[i] = TaskStatus_t {};
+        pxTaskStatusArray[i].xTaskNumber = g_tasks[i].number;
+        pxTaskStatusArray[i].pcTaskName = g_tasks[i].name.c_str();
+        pxTaskStatusArray[i].ulRunTimeCounter = g_tasks[i].counter;
+    }
+    *pulTotalRunTime = g_counter;
+    return g_tasks.size();
+}
+
+//--------------------------HELPERS--------------------------
+
+static void run(const size_t index, const uint32_t cycles)
+{
+    g_tasks[index].counter += cycles;
+    g_counter += cycles;
+}
+
+static void startKernel(void)
+{
+    g_counter = 0;
+    g_tasks = {{1, "IDLE", 0}, {2, "Modem", 0}, {3, "CommandMultiple", 0}};
+}
+
+static bool isTaskLoad(const os::CpuLoad& load, const char* name, const uint32_t permille)
+{
+    for (size_t i = 0; i < load.getNumberOfTasks(); i++) {
+        const auto task = load.getTaskLoad(i);
+        if (std::string(task.name) == name) {
+            return task.permille == permille;
+        }
+    }
+    return false;
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_Load(void)
+{
+    TestCaseBegin();
+
+    startKernel();
+    os::CpuLoad load;
+    CHECK(load.getTotalLoad() == 0);
+
+    run(0, 250);
+    run(1, 500);
+    run(2, 250);
+    load.sample();
+
+    CHECK(load.getNumberOfTasks() == 3);
+    CHECK(isTaskLoad(load, "IDLE", 250));
+    CHECK(isTaskLoad(load, "Modem", 500));
+    CHECK(isTaskLoad(load, "CommandMultiple", 250));
+    CHECK(load.getTotalLoad() == 750);
+
+    std::string text;
+    load.dump([&](const std::string_view chunk){
+        text += chunk;
+    });
+    // CHECK prints its expression as format string, so the lines are searched outside of it
+    const bool hasTotalLine = text.find("total  75.0%") != std::string::npos;
+    const bool hasModemLine = text.find("Modem            50.0%") != std::string::npos;
+    CHECK(hasTotalLine);
+    CHECK(hasModemLine);
+
+    TestCaseEnd();
+}
+
+int ut_SlidingWindow(void)
+{
+    TestCaseBegin();
+
+    startKernel();
+    os::CpuLoad load;
+
+    for (size_t i = 0; i < os::CpuLoad::WINDOW; i++) {
+        run(1, 1000);
+        load.sample();
+    }
+    CHECK(isTaskLoad(load, "Modem", 1000));
+
+    // The busy samples leave the window one by one
+    for (size_t i = 0; i < os::CpuLoad::WINDOW / 2; i++) {
+        run(0, 1000);
+        load.sample();
+    }
+    CHECK(isTaskLoad(load, "Modem", 500));
+    CHECK(load.getTotalLoad() == 500);
+
+    for (size_t i = 0; i < os::CpuLoad::WINDOW / 2; i++) {
+        run(0, 1000);
+        load.sample();
+    }
+    CHECK(isTaskLoad(load, "Modem", 0));
+    CHECK(load.getTotalLoad() == 0);
+
+    // The total since the first sample remains
+    CHECK(load.getTaskLoad(1).cycles == os::CpuLoad::WINDOW * 1000);
+
+    TestCaseEnd();
+}
+
+int ut_Overflow(void)
+{
+    TestCaseBegin();
+
+    // The cycle counter and the run time counters wrap between the samples
+    startKernel();
+    os::CpuLoad load;
+
+    static constexpr uint32_t CYCLES = 3000000000;
+    static constexpr size_t SAMPLES = 4;
+    for (size_t i = 0; i < SAMPLES; i++) {
+        run(1, CYCLES / 3 * 2);
+        run(0, CYCLES / 3);
+        load.sample();
+    }
+
+    CHECK(isTaskLoad(load, "Modem", 666));
+    CHECK(load.getTaskLoad(1).cycles == static_cast<uint64_t>(SAMPLES) * (CYCLES / 3 * 2));
+    CHECK(load.getTaskLoad(0).cycles == static_cast<uint64_t>(SAMPLES) * (CYCLES / 3));
+
+    TestCaseEnd();
+}
+
+int ut_TaskLifecycle(void)
+{
+    TestCaseBegin();
+
+    startKernel();
+    os::CpuLoad load;
+    run(1, 1000);
+    load.sample();
+
+    // A joined and restarted task is a new task with the same name
+    g_tasks[1] = KernelTask {4, "Modem", 0};
+    run(1, 500);
+    run(0, 500);
+    load.sample();
+    CHECK(load.getNumberOfTasks() == 3);
+    CHECK(load.getTaskLoad(2).cycles == 500);
+    CHECK(isTaskLoad(load, "Modem", 250));
+
+    // Deleted tasks make room for new ones
+    g_tasks.erase(g_tasks.begin() + 2);
+    while (g_tasks.size() < os::CpuLoad::MAXTASKS) {
+        g_tasks.push_back(KernelTask {static_cast<UBaseType_t>(g_tasks.size() + 10), "Task", 0});
+    }
+    load.sample();
+    CHECK(load.getNumberOfTasks() == os::CpuLoad::MAXTASKS);
+
+    // Too many tasks are reported and the sample is skipped
+    g_tasks.push_back(KernelTask {100, "Task", 0});
+    load.sample();
+    CHECK(load.getNumberOfTasks() == os::CpuLoad::MAXTASKS);
+
+    TestCaseEnd();
+}
+
+int ut_SampleCost(void)
+{
+    TestCaseBegin();
+
+    startKernel();
+    while (g_tasks.size() < os::CpuLoad::MAXTASKS) {
+        g_tasks.push_back(KernelTask {static_cast<UBaseType_t>(g_tasks.size() + 10), "Task", 0});
+    }
+    os::CpuLoad load;
+
+    static constexpr size_t SAMPLES = 100000;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < SAMPLES; i++) {
+        for (size_t task = 0; task < g_tasks.size(); task++) {
+            run(task, 1000);
+        }
+        load.sample();
+    }
+    const auto duration = std::chrono::steady_clock::now() - start;
+
+    printf("%.0f ns per sample of %zu tasks\n", std::chrono::duration<double, std::nano>(duration).count() / SAMPLES,
+           os::CpuLoad::MAXTASKS);
+    CHECK(load.getTotalLoad() == 1000 - 1000 / os::CpuLoad::MAXTASKS);
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_Load);
+    RunTest(true, ut_SlidingWindow);
+    RunTest(true, ut_Overflow);
+    RunTest(true, ut_TaskLifecycle);
+    RunTest(true, ut_SampleCost);
+    UnitTestMainEnd();
+}
@@ -27,6 +27,11 @@ protected:
     virtual void enterDeepSleep(void) {while (true) {}}
     virtual void exitDeepSleep(void) {while (true) {}}
 
+    // Asked by the idle task with the scheduler suspended and interrupts disabled,
+    // so it mustn't block. Return false while a peripheral is in use, which
+    // doesn't keep running in stop mode.
+    virtual bool isStopModeAllowed(void) const {return true;}
+
     friend class DeepSleepController;
 };
 
@@ -49,5 +54,16 @@ public:
             module->exitDeepSleep();
         }
     }
+    static bool isStopModeAllowed(void)
+    {
+        for (const DeepSleepModule* module :
+             DeepSleepModule::Modules)
+        {
+            if (!module->isStopModeAllowed()) {
+                return false;
+            }
+        }
+        return true;
+    }
 };
 }
@@ -84,7 +84,9 @@
 
 /* Ensure stdint is only used by the compiler, and not the assembler. */
 #include <stdint.h>
+#ifndef SIMULATION
 #include "SEGGER_SYSVIEW_FreeRTOS.h"
+#endif
 extern uint32_t SystemCoreClock;
 
 #define configUSE_PREEMPTION 1
@@ -95,8 +97,10 @@ extern uint32_t SystemCoreClock;
 #define configMAX_PRIORITIES (15)
 #define configMINIMAL_STACK_SIZE ((unsigned short)128)
 #define configTOTAL_HEAP_SIZE ((size_t)(32 * 1024))
+#define configSUPPORT_STATIC_ALLOCATION 1
+#define configSUPPORT_DYNAMIC_ALLOCATION 1
 #define configMAX_TASK_NAME_LEN (16)
-#ifdef SYSVIEW
+#if defined(SYSVIEW) || defined(MEASURE_CPU_LOAD)
 #define configUSE_TRACE_FACILITY 1
 #else
 #define configUSE_TRACE_FACILITY 0
@@ -110,15 +114,41 @@ extern uint32_t SystemCoreClock;
 #define configUSE_MALLOC_FAILED_HOOK 1
 #define configUSE_APPLICATION_TASK_TAG 0
 #define configUSE_COUNTING_SEMAPHORES 1
+#ifdef MEASURE_CPU_LOAD
+/* The run time of the tasks is counted in cycles of the DWT cycle counter,
+   which restarts with the scheduler. See os::CpuLoad. */
+#define configGENERATE_RUN_TIME_STATS 1
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() do { \
+        (*(volatile uint32_t*)0xE000EDFC) |= (1UL << 24); /* DEMCR.TRCENA */ \
+        (*(volatile uint32_t*)0xE0001004) = 0;            /* DWT->CYCCNT */ \
+        (*(volatile uint32_t*)0xE0001000) |= 1UL;         /* DWT->CTRL.CYCCNTENA */ \
+} while (0)
+#define portGET_RUN_TIME_COUNTER_VALUE() (*(volatile uint32_t*)0xE0001004)
+#else
 #define configGENERATE_RUN_TIME_STATS 0
+#endif
+#ifdef TICKLESS_IDLE
+/* The idle task stops the MCU or sleeps with the SysTick suppressed. Any
+   os::DeepSleepModule can veto the stop mode. See os::TicklessIdle. */
+#define configUSE_TICKLESS_IDLE 1
+#ifdef __cplusplus
+extern "C"
+#endif
+void vApplicationSuppressTicksAndSleep(uint32_t xExpectedIdleTime);
+#define portSUPPRESS_TICKS_AND_SLEEP(xExpectedIdleTime) vApplicationSuppressTicksAndSleep(xExpectedIdleTime)
+#else
+#define configUSE_TICKLESS_IDLE 0
+#endif
 
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES 0
 #define configMAX_CO_ROUTINE_PRIORITIES (2)
 
 /* Software timer definitions. */
-#define configUSE_TIMERS 0
-#define configTIMER_TASK_PRIORITY (2)
+/* The callbacks of os::Timer run in the timer service task. They replace
+   small periodic tasks, so the priority is that of os::Task::Priority::LOW. */
+#define configUSE_TIMERS 1
+#define configTIMER_TASK_PRIORITY (4)
 #define configTIMER_QUEUE_LENGTH 10
 #define configTIMER_TASK_STACK_DEPTH (configMINIMAL_STACK_SIZE * 2)
 
@@ -132,6 +162,8 @@ extern uint32_t SystemCoreClock;
 #define INCLUDE_vTaskDelayUntil 1
 #define INCLUDE_vTaskDelay 1
 #define INCLUDE_pcTaskGetTaskName 1
+#define INCLUDE_xTaskGetCurrentTaskHandle 1
+#define INCLUDE_uxTaskGetStackHighWaterMark 1
 
 /* Cortex-M specific definitions. */
 #ifdef __NVIC_PRIO_BITS
@@ -160,7 +192,12 @@ extern uint32_t SystemCoreClock;
 
 /* Normal assert() semantics without relying on the provision of an assert.h
    header file. */
+#ifdef SIMULATION
+/* The host doesn't have a debugger attached, so the simulation ends. */
+#define configASSERT(x) if ((x) == 0) { vPortAssertFailed(__FILE__, __LINE__); }
+#else
 #define configASSERT(x) if ((x) == 0) { taskDISABLE_INTERRUPTS(); for ( ; ; ) {  }}
+#endif
 
 /* Definitions that map the FreeRTOS port interrupt handlers to their CMSIS
    standard names. */
@@ -25,7 +25,8 @@ public:
 
     ~LockGuard()
     {
-        if (mLock) {
+        // A lock which wasn't obtained belongs to another task
+        if (mLockObtained) {
             mLock.give();
         }
     }
@@ -11,6 +11,12 @@ Mutex::Mutex(void) :
     mMutexHandle(xSemaphoreCreateMutex())
 {}
 
+#if OS_STATIC_ALLOCATION
+Mutex::Mutex(SemaphoreStorage& storage) :
+    mMutexHandle(xSemaphoreCreateMutexStatic(&storage))
+{}
+#endif
+
 Mutex::Mutex(Mutex&& rhs) :
     mMutexHandle(rhs.mMutexHandle)
 {
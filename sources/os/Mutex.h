@@ -7,6 +7,7 @@
 
 #include "FreeRTOS.h"
 #include "semphr.h"
+#include "os_StaticStorage.h"
 
 namespace os
 {
@@ -16,6 +17,9 @@ class Mutex
 
 public:
     Mutex(void);
+#if OS_STATIC_ALLOCATION
+    explicit Mutex(SemaphoreStorage& storage);
+#endif
     Mutex(const Mutex&) = delete;
     Mutex(Mutex&&);
     Mutex& operator=(const Mutex&) = delete;
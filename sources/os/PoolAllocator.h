@@ -0,0 +1,239 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include "for_each_tuple.h"
+
+namespace os
+{
+struct BlockPoolStatistics {
+    uint32_t allocations;
+    uint32_t inUse;
+    uint32_t peak;
+    uint32_t failures;
+};
+
+/**
+ * Pool of BLOCKS blocks with BLOCKSIZE byte each. Allocating and freeing is
+ * O(1) and lock free, so it's usable from interrupts as well.
+ *
+ * The free blocks are kept in a list which links them by their index. The
+ * head of the list carries a tag which changes with every operation, so a
+ * compare and swap fails if the list was changed in between, even if the
+ * same block is on top again. Blocks which were never handed out aren't on
+ * the list, they are taken from the end of the used range. Therefore a pool
+ * is zero initialised and its storage ends up in .bss.
+ */
+template<size_t BLOCKSIZE, size_t BLOCKS>
+class BlockPool final
+{
+    static_assert(BLOCKSIZE % alignof(std::max_align_t) == 0, "Blocks have to be aligned like malloc");
+    static_assert((BLOCKS > 0) && (BLOCKS < 0xffff), "The index of a block has to fit in 16 bit");
+
+    static constexpr uint32_t INDEX_MASK = 0x0000ffff;
+    static constexpr uint32_t TAG_INCREMENT = 0x00010000;
+
+    alignas(std::max_align_t) uint8_t mStorage[BLOCKS][BLOCKSIZE];
+
+    // Tag in the upper half, index + 1 of the first free block in the lower half or 0 if empty
+    std::atomic<uint32_t> mFree;
+    // Blocks from this index on were never handed out
+    std::atomic<uint32_t> mUnused;
+
+    std::atomic<uint32_t> mAllocations;
+    std::atomic<uint32_t> mInUse;
+    std::atomic<uint32_t> mPeak;
+    std::atomic<uint32_t> mFailures;
+
+    static uint32_t tagged(const uint32_t head, const uint32_t index)
+    {
+        return ((head + TAG_INCREMENT) & ~INDEX_MASK) | index;
+    }
+
+    uint8_t* pop(void)
+    {
+        uint32_t head = mFree.load(std::memory_order_acquire);
+        while ((head & INDEX_MASK) != 0) {
+            uint8_t* const block = mStorage[(head & INDEX_MASK) - 1];
+            // The block may be handed out meanwhile, then the tag changed and the exchange fails
+            uint16_t next;
+            std::memcpy(&next, block, sizeof(next));
+            if (mFree.compare_exchange_weak(head, tagged(head, next),
+                                            std::memory_order_acquire, std::memory_order_acquire))
+            {
+                return block;
+            }
+        }
+
+        uint32_t unused = mUnused.load(std::memory_order_relaxed);
+        while (unused < BLOCKS) {
+            if (mUnused.compare_exchange_weak(unused, unused + 1, std::memory_order_relaxed)) {
+                return mStorage[unused];
+            }
+        }
+        return nullptr;
+    }
+
+public:
+    static constexpr size_t SIZE = BLOCKSIZE;
+    static constexpr size_t COUNT = BLOCKS;
+
+    constexpr BlockPool(void) :
+        mStorage(), mFree(0), mUnused(0), mAllocations(0), mInUse(0), mPeak(0), mFailures(0) {}
+
+    BlockPool(const BlockPool&) = delete;
+    BlockPool(BlockPool&&) = delete;
+    BlockPool& operator=(const BlockPool&) = delete;
+    BlockPool& operator=(BlockPool&&) = delete;
+
+    // Returns nullptr and counts a failure if the pool is exhausted
+    void* allocate(void)
+    {
+        uint8_t* const block = pop();
+        if (block == nullptr) {
+            mFailures.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        mAllocations.fetch_add(1, std::memory_order_relaxed);
+        const uint32_t inUse = mInUse.fetch_add(1, std::memory_order_relaxed) + 1;
+        uint32_t peak = mPeak.load(std::memory_order_relaxed);
+        while ((inUse > peak) && !mPeak.compare_exchange_weak(peak, inUse, std::memory_order_relaxed)) {}
+        return block;
+    }
+
+    // The block has to be owned by this pool
+    void deallocate(void* const block)
+    {
+        const uint32_t index = (static_cast<uint8_t*>(block) - mStorage[0]) / BLOCKSIZE + 1;
+        uint32_t head = mFree.load(std::memory_order_relaxed);
+        do {
+            const uint16_t next = head & INDEX_MASK;
+            std::memcpy(block, &next, sizeof(next));
+        } while (!mFree.compare_exchange_weak(head, tagged(head, index),
+                                              std::memory_order_release, std::memory_order_relaxed));
+        mInUse.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    bool owns(void const* const block) const
+    {
+        const uintptr_t address = reinterpret_cast<uintptr_t>(block);
+        return (address >= reinterpret_cast<uintptr_t>(mStorage[0])) &&
+               (address < reinterpret_cast<uintptr_t>(mStorage[0]) + sizeof(mStorage));
+    }
+
+    BlockPoolStatistics getStatistics(void) const
+    {
+        return BlockPoolStatistics {
+                   mAllocations.load(std::memory_order_relaxed),
+                   mInUse.load(std::memory_order_relaxed),
+                   mPeak.load(std::memory_order_relaxed),
+                   mFailures.load(std::memory_order_relaxed)
+        };
+    }
+};
+
+template<size_t BLOCKSIZE, size_t BLOCKS>
+constexpr size_t BlockPool<BLOCKSIZE, BLOCKS>::SIZE;
+template<size_t BLOCKSIZE, size_t BLOCKS>
+constexpr size_t BlockPool<BLOCKSIZE, BLOCKS>::COUNT;
+
+/**
+ * Serves an allocation from the first pool whose blocks are large enough.
+ * The pools have to be ordered by their block size. Larger allocations and
+ * allocations of an exhausted pool go to the HEAP, which provides
+ *  static void* allocate(size_t size);
+ *  static void deallocate(void* p);
+ * Only the pools are usable from interrupts, the heap usually isn't.
+ */
+template<typename HEAP, typename ... POOLS>
+class PoolAllocator final
+{
+    std::tuple<POOLS ...> mPools;
+    std::atomic<uint32_t> mHeapAllocations;
+
+public:
+    static constexpr size_t CLASSES = sizeof ... (POOLS);
+
+    constexpr PoolAllocator(void) :
+        mPools(), mHeapAllocations(0) {}
+
+    PoolAllocator(const PoolAllocator&) = delete;
+    PoolAllocator(PoolAllocator&&) = delete;
+    PoolAllocator& operator=(const PoolAllocator&) = delete;
+    PoolAllocator& operator=(PoolAllocator&&) = delete;
+
+    void* allocate(const size_t size)
+    {
+        void* block = nullptr;
+        bool isServed = false;
+        for_each(mPools, [&](auto& pool){
+            if (!isServed && (size <= pool.SIZE)) {
+                isServed = true;
+                block = pool.allocate();
+            }
+        });
+
+        if (block == nullptr) {
+            mHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+            block = HEAP::allocate(size);
+        }
+        return block;
+    }
+
+    void deallocate(void* const block)
+    {
+        if (block == nullptr) {
+            return;
+        }
+
+        bool isOwned = false;
+        for_each(mPools, [&](auto& pool){
+            if (!isOwned && pool.owns(block)) {
+                isOwned = true;
+                pool.deallocate(block);
+            }
+        });
+
+        if (!isOwned) {
+            HEAP::deallocate(block);
+        }
+    }
+
+    size_t getBlockSize(const size_t index) const
+    {
+        size_t size = 0;
+        for_each_indexed(mPools, [&](const size_t i, const auto& pool){
+            if (i == index) {
+                size = pool.SIZE;
+            }
+        });
+        return size;
+    }
+
+    BlockPoolStatistics getStatistics(const size_t index) const
+    {
+        BlockPoolStatistics statistics {};
+        for_each_indexed(mPools, [&](const size_t i, const auto& pool){
+            if (i == index) {
+                statistics = pool.getStatistics();
+            }
+        });
+        return statistics;
+    }
+
+    // Allocations which didn't fit in a pool or found it exhausted
+    uint32_t getHeapAllocations(void) const
+    {
+        return mHeapAllocations.load(std::memory_order_relaxed);
+    }
+};
+}
@@ -0,0 +1,417 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "PoolAllocator.h"
+#include "unittest.h"
+
+//--------------------------MOCKING--------------------------
+static size_t g_heapAllocations = 0;
+
+struct MallocHeap {
+    static void* allocate(size_t size)
+    {
+        g_heapAllocations++;
+        return std::malloc(size);
+    }
+
+    static void deallocate(void* p)
+    {
+        std::free(p);
+    }
+};
+
+/**
+ * First fit heap with coalescing like newlib malloc, which is behind
+ * pvPortMalloc with heap_3. Every block carries a header of 8 byte.
+ */
+template<size_t ARENA>
+struct FirstFitHeap {
+    static constexpr size_t HEADER = 8;
+    static std::map<size_t, size_t> freeBlocks;
+    static std::map<size_t, size_t> usedBlocks;
+    static std::vector<uint8_t> arena;
+    static size_t failures;
+
+    static void reset(void)
+    {
+        arena.assign(ARENA, 0);
+        freeBlocks = {{0, ARENA}};
+        usedBlocks.clear();
+        failures = 0;
+    }
+
+    static void* allocate(size_t size)
+    {
+        size = (size + HEADER + 7) & ~size_t(7);
+        for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it) {
+            if (it->second >= size) {
+                const size_t offset = it->first;
+                const size_t remaining = it->second - size;
+                freeBlocks.erase(it);
+                if (remaining > 0) {
+                    freeBlocks[offset + size] = remaining;
+                }
+                usedBlocks[offset] = size;
+                return arena.data() + offset + HEADER;
+            }
+        }
+        failures++;
+        return nullptr;
+    }
+
+    static void deallocate(void* p)
+    {
+        size_t offset = static_cast<uint8_t*>(p) - arena.data() - HEADER;
+        size_t size = usedBlocks[offset];
+        usedBlocks.erase(offset);
+
+        auto next = freeBlocks.find(offset + size);
+        if (next != freeBlocks.end()) {
+            size += next->second;
+            freeBlocks.erase(next);
+        }
+        auto previous = freeBlocks.lower_bound(offset);
+        if ((previous != freeBlocks.begin()) && ((--previous)->first + previous->second == offset)) {
+            offset = previous->first;
+            size += previous->second;
+        }
+        freeBlocks[offset] = size;
+    }
+
+    static size_t largestFree(void)
+    {
+        size_t largest = 0;
+        for (const auto& block : freeBlocks) {
+            largest = std::max(largest, block.second);
+        }
+        return largest;
+    }
+
+    static size_t totalFree(void)
+    {
+        size_t total = 0;
+        for (const auto& block : freeBlocks) {
+            total += block.second;
+        }
+        return total;
+    }
+
+    // Share of the free memory which isn't usable for an allocation as large as possible
+    static double fragmentation(void)
+    {
+        return 1.0 - static_cast<double>(largestFree()) / totalFree();
+    }
+};
+
+template<size_t ARENA>
+std::map<size_t, size_t> FirstFitHeap<ARENA>::freeBlocks;
+template<size_t ARENA>
+std::map<size_t, size_t> FirstFitHeap<ARENA>::usedBlocks;
+template<size_t ARENA>
+std::vector<uint8_t> FirstFitHeap<ARENA>::arena;
+template<size_t ARENA>
+size_t FirstFitHeap<ARENA>::failures;
+
+//--------------------------HELPERS--------------------------
+using TestAllocator = os::PoolAllocator<MallocHeap, os::BlockPool<16, 4>, os::BlockPool<32, 2>, os::BlockPool<64, 2> >;
+
+// The pools of cpp_overrides.h with the heap of the STM32F303VC
+static constexpr size_t HEAP_SIZE = 0x3000;
+using PooledHeap = FirstFitHeap<HEAP_SIZE>;
+using SoakAllocator = os::PoolAllocator<PooledHeap, os::BlockPool<16, 32>, os::BlockPool<32, 24>, os::BlockPool<64, 12>,
+                                        os::BlockPool<128, 6>, os::BlockPool<256, 2> >;
+
+static const size_t POOL_SIZE = 16 * 32 + 32 * 24 + 64 * 12 + 128 * 6 + 256 * 2;
+
+// Without the pools their RAM is left to the heap
+using PlainHeap = FirstFitHeap<HEAP_SIZE + POOL_SIZE>;
+
+struct Allocation {
+    void* p;
+    size_t size;
+    uint32_t expires;
+};
+
+static uint32_t g_seed = 1;
+
+// One allocation every 100 ms
+static constexpr uint32_t EVENTS_PER_HOUR = 60 * 60 * 10;
+
+static uint32_t random(const uint32_t range)
+{
+    g_seed = g_seed * 1103515245 + 12345;
+    return (g_seed >> 8) % range;
+}
+
+/**
+ * Emulates the allocations of the modem and socket handling: callbacks and
+ * shared_ptr control blocks which live long, receive vectors which grow and
+ * short living strings and buffers. The probe is called once per simulated
+ * hour. Returns the failed allocations.
+ */
+template<typename Allocate, typename Deallocate, typename Probe>
+static size_t soak(const uint32_t events, Allocate allocate, Deallocate deallocate, Probe probe)
+{
+    std::vector<Allocation> live;
+    size_t failures = 0;
+    g_seed = 1;
+
+    for (uint32_t now = 0; now < events; now++) {
+        if (now % EVENTS_PER_HOUR == 0) {
+            probe();
+        }
+
+        for (auto it = live.begin(); it != live.end(); ) {
+            if (it->expires <= now) {
+                deallocate(it->p);
+                it = live.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        const uint32_t kind = random(100);
+        size_t size;
+        uint32_t lifetime;
+        if (kind < 40) {
+            size = 12 + random(20);
+            lifetime = 10 + random(5000);
+        } else if (kind < 75) {
+            size = 32 + random(100);
+            lifetime = 1 + random(50);
+        } else if (kind < 95) {
+            size = 100 + random(160);
+            lifetime = 1 + random(200);
+        } else {
+            size = 300 + random(700);
+            lifetime = 1 + random(20);
+        }
+
+        // Keeps the live set at a level the target survives
+        if (live.size() < 80) {
+            void* const p = allocate(size);
+            if (p == nullptr) {
+                failures++;
+            } else {
+                live.push_back({p, size, now + lifetime});
+            }
+        }
+    }
+
+    for (const auto& allocation : live) {
+        deallocate(allocation.p);
+    }
+    return failures;
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_SizeClasses(void)
+{
+    TestCaseBegin();
+
+    static TestAllocator allocator;
+    g_heapAllocations = 0;
+
+    std::vector<void*> blocks;
+    for (size_t i = 0; i < 4; i++) {
+        blocks.push_back(allocator.allocate(1 + i * 5));
+    }
+    CHECK(allocator.getStatistics(0).allocations == 4);
+    CHECK(allocator.getStatistics(0).inUse == 4);
+    CHECK(g_heapAllocations == 0);
+
+    // The pool is exhausted, the next one goes to the heap
+    blocks.push_back(allocator.allocate(16));
+    CHECK(allocator.getStatistics(0).failures == 1);
+    CHECK(g_heapAllocations == 1);
+
+    blocks.push_back(allocator.allocate(17));
+    blocks.push_back(allocator.allocate(64));
+    CHECK(allocator.getStatistics(1).allocations == 1);
+    CHECK(allocator.getStatistics(2).allocations == 1);
+
+    // Too large for every pool
+    blocks.push_back(allocator.allocate(65));
+    CHECK(g_heapAllocations == 2);
+    CHECK(allocator.getHeapAllocations() == 2);
+
+    for (size_t i = 0; i < blocks.size(); i++) {
+        CHECK(blocks[i] != nullptr);
+        for (size_t j = 0; j < i; j++) {
+            CHECK(blocks[i] != blocks[j]);
+        }
+    }
+
+    for (auto p : blocks) {
+        allocator.deallocate(p);
+    }
+    allocator.deallocate(nullptr);
+    CHECK(allocator.getStatistics(0).inUse == 0);
+    CHECK(allocator.getStatistics(0).peak == 4);
+
+    // Freed blocks are used again
+    void* const p = allocator.allocate(8);
+    CHECK(p == blocks[3]);
+    allocator.deallocate(p);
+
+    CHECK(allocator.getBlockSize(0) == 16);
+    CHECK(allocator.getBlockSize(2) == 64);
+    CHECK(TestAllocator::CLASSES == 3);
+
+    TestCaseEnd();
+}
+
+int ut_Concurrency(void)
+{
+    TestCaseBegin();
+
+    static os::BlockPool<16, 64> pool;
+    static constexpr size_t THREADS = 4;
+    static constexpr size_t ROUNDS = 100000;
+    std::atomic<size_t> corrupted(0);
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < THREADS; t++) {
+        threads.emplace_back([&, t]{
+            std::vector<uint8_t*> blocks;
+            for (size_t i = 0; i < ROUNDS; i++) {
+                // Every block handed out has exactly one owner
+                if ((blocks.size() < 8) && (i % 3 != 2)) {
+                    uint8_t* const block = static_cast<uint8_t*>(pool.allocate());
+                    if (block != nullptr) {
+                        std::fill_n(block, 16, static_cast<uint8_t>(t));
+                        blocks.push_back(block);
+                    }
+                } else if (!blocks.empty()) {
+                    uint8_t* const block = blocks.back();
+                    blocks.pop_back();
+                    corrupted += std::count(block, block + 16, static_cast<uint8_t>(t)) != 16;
+                    pool.deallocate(block);
+                }
+            }
+            for (auto block : blocks) {
+                pool.deallocate(block);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    CHECK(corrupted == 0);
+    CHECK(pool.getStatistics().inUse == 0);
+    CHECK(pool.getStatistics().peak <= THREADS * 8);
+
+    // All blocks are on the free list again
+    std::vector<void*> blocks;
+    for (size_t i = 0; i < 64; i++) {
+        blocks.push_back(pool.allocate());
+    }
+    std::sort(blocks.begin(), blocks.end());
+    CHECK(std::unique(blocks.begin(), blocks.end()) == blocks.end());
+    CHECK(blocks.front() != nullptr);
+    CHECK(pool.allocate() == nullptr);
+
+    TestCaseEnd();
+}
+
+int ut_AllocationCost(void)
+{
+    TestCaseBegin();
+
+    static TestAllocator allocator;
+    static constexpr size_t ROUNDS = 1000000;
+    void* blocks[4];
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ROUNDS; i++) {
+        for (auto& p : blocks) {
+            p = allocator.allocate(12);
+        }
+        for (auto& p : blocks) {
+            allocator.deallocate(p);
+        }
+    }
+    const auto pooled = std::chrono::steady_clock::now() - start;
+
+    for (size_t i = 0; i < ROUNDS; i++) {
+        for (auto& p : blocks) {
+            p = std::malloc(12);
+            // Keeps the compiler from removing the pairs
+            asm volatile ("" : : "r" (p) : "memory");
+        }
+        for (auto& p : blocks) {
+            std::free(p);
+        }
+    }
+    const auto heap = std::chrono::steady_clock::now() - start - pooled;
+
+    const double pooledNs = std::chrono::duration<double, std::nano>(pooled).count() / (ROUNDS * 4);
+    const double heapNs = std::chrono::duration<double, std::nano>(heap).count() / (ROUNDS * 4);
+    printf("allocate and free: pool %.2f ns, malloc %.2f ns\n", pooledNs, heapNs);
+    CHECK(allocator.getStatistics(0).allocations == ROUNDS * 4);
+    CHECK(allocator.getHeapAllocations() == 0);
+
+    TestCaseEnd();
+}
+
+int ut_Fragmentation(void)
+{
+    TestCaseBegin();
+
+    static constexpr uint32_t EVENTS = 24 * EVENTS_PER_HOUR;
+
+    double plainFragmentation = 0;
+    size_t plainLargest = HEAP_SIZE + POOL_SIZE;
+    PlainHeap::reset();
+    const size_t plainFailures = soak(EVENTS, PlainHeap::allocate, PlainHeap::deallocate, [&]{
+        plainFragmentation = std::max(plainFragmentation, PlainHeap::fragmentation());
+        plainLargest = std::min(plainLargest, PlainHeap::largestFree());
+    });
+    CHECK(PlainHeap::totalFree() == HEAP_SIZE + POOL_SIZE);
+
+    static SoakAllocator allocator;
+    double pooledFragmentation = 0;
+    size_t pooledLargest = HEAP_SIZE;
+    PooledHeap::reset();
+    const size_t pooledFailures = soak(EVENTS, [](size_t size){ return allocator.allocate(size); },
+                                       [](void* p){ allocator.deallocate(p); }, [&]{
+        pooledFragmentation = std::max(pooledFragmentation, PooledHeap::fragmentation());
+        pooledLargest = std::min(pooledLargest, PooledHeap::largestFree());
+    });
+    CHECK(PooledHeap::totalFree() == HEAP_SIZE);
+
+    // Worst values of the hourly samples
+    printf("heap only:  %zu failures, fragmentation %.1f %%, largest free block %zu byte\n",
+           plainFailures, plainFragmentation * 100, plainLargest);
+    printf("with pools: %zu failures, fragmentation %.1f %%, largest free block %zu byte\n",
+           pooledFailures, pooledFragmentation * 100, pooledLargest);
+    for (size_t i = 0; i < SoakAllocator::CLASSES; i++) {
+        const auto statistics = allocator.getStatistics(i);
+        printf("  %3zu byte: %u allocations, peak %u, %u failures\n", allocator.getBlockSize(i),
+               statistics.allocations, statistics.peak, statistics.failures);
+    }
+    CHECK(pooledFailures <= plainFailures);
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_SizeClasses);
+    RunTest(true, ut_Concurrency);
+    RunTest(true, ut_AllocationCost);
+    RunTest(true, ut_Fragmentation);
+    UnitTestMainEnd();
+}
@@ -11,6 +11,12 @@ RecursiveMutex::RecursiveMutex(void) :
     mMutexHandle(xSemaphoreCreateRecursiveMutex())
 {}
 
+#if OS_STATIC_ALLOCATION
+RecursiveMutex::RecursiveMutex(SemaphoreStorage& storage) :
+    mMutexHandle(xSemaphoreCreateRecursiveMutexStatic(&storage))
+{}
+#endif
+
 RecursiveMutex::RecursiveMutex(RecursiveMutex&& rhs) :
     mMutexHandle(rhs.mMutexHandle)
 {
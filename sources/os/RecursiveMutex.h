@@ -7,6 +7,7 @@
 
 #include "FreeRTOS.h"
 #include "semphr.h"
+#include "os_StaticStorage.h"
 
 namespace os
 {
@@ -16,6 +17,9 @@ class RecursiveMutex
 
 public:
     RecursiveMutex(void);
+#if OS_STATIC_ALLOCATION
+    explicit RecursiveMutex(SemaphoreStorage& storage);
+#endif
     RecursiveMutex(const RecursiveMutex&) = delete;
     RecursiveMutex(RecursiveMutex&&);
     RecursiveMutex& operator=(const RecursiveMutex&) = delete;
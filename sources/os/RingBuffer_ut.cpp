@@ -0,0 +1,233 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "os_RingBuffer.h"
+#include "unittest.h"
+
+//--------------------------MOCKING--------------------------
+// One tick per millisecond, the notification value of the consumer is emulated with a condition variable
+static std::mutex g_notificationMutex;
+static std::condition_variable g_notificationCondition;
+static uint32_t g_notificationValue = 0;
+// The consumer runs after the interrupt returned
+static bool g_isNotificationPending = false;
+static const auto g_start = std::chrono::steady_clock::now();
+
+uint32_t os::Task::getTickCount(void)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - g_start).count();
+}
+
+void os::Task::notifyGiveFromISR(xTaskHandle handle)
+{
+    g_isNotificationPending = true;
+}
+
+static void returnFromInterrupt(void)
+{
+    if (g_isNotificationPending) {
+        g_isNotificationPending = false;
+        std::lock_guard<std::mutex> lock(g_notificationMutex);
+        g_notificationValue++;
+        g_notificationCondition.notify_one();
+    }
+}
+
+uint32_t os::ThisTask::notifyTake(const uint32_t ticksToWait)
+{
+    std::unique_lock<std::mutex> lock(g_notificationMutex);
+    if (ticksToWait == portMAX_DELAY) {
+        g_notificationCondition.wait(lock, []{ return g_notificationValue != 0; });
+    } else {
+        g_notificationCondition.wait_for(lock, std::chrono::milliseconds(ticksToWait),
+                                         []{ return g_notificationValue != 0; });
+    }
+    const uint32_t value = g_notificationValue;
+    g_notificationValue = 0;
+    return value;
+}
+
+xTaskHandle os::ThisTask::getHandle(void)
+{
+    return reinterpret_cast<xTaskHandle>(1);
+}
+
+//--------------------------HELPERS--------------------------
+
+// Emulates an interrupt which receives a burst of bytes each time with a pause between them
+template<typename Buffer>
+static void produce(Buffer& ring, const size_t bytes, const size_t burst, const std::chrono::microseconds pause)
+{
+    for (size_t i = 0; i < bytes; i++) {
+        while (!ring.sendFromISR(static_cast<uint8_t>(i))) {
+            returnFromInterrupt();
+            std::this_thread::yield();
+        }
+        if ((i % burst) == burst - 1) {
+            returnFromInterrupt();
+            std::this_thread::sleep_for(pause);
+        }
+    }
+    returnFromInterrupt();
+}
+
+// Receives like the AT parser with a timeout, returns the number of timeouts and checks the sequence
+template<typename Buffer>
+static size_t consume(Buffer& ring, const size_t bytes, const size_t length, bool& isInSequence)
+{
+    std::vector<uint8_t> data(length);
+    size_t received = 0;
+    size_t timeouts = 0;
+    isInSequence = true;
+
+    while (received < bytes) {
+        const size_t count = ring.receive(data.data(), std::min(length, bytes - received), 1000);
+        timeouts += count == 0;
+        for (size_t i = 0; i < count; i++) {
+            isInSequence = isInSequence && (data[i] == static_cast<uint8_t>(received + i));
+        }
+        received += count;
+    }
+    return timeouts;
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_SendReceive(void)
+{
+    TestCaseBegin();
+
+    os::RingBuffer<uint8_t, 8> ring;
+    CHECK(ring.isEmpty());
+
+    // The indices wrap around the storage many times
+    for (size_t round = 0; round < 100; round++) {
+        for (uint8_t i = 0; i < 8; i++) {
+            CHECK(ring.sendFromISR(round + i));
+        }
+        CHECK(ring.isFull());
+        CHECK(!ring.sendFromISR(0xff));
+
+        uint8_t data[16];
+        CHECK(ring.receive(data, 3, 0) == 3);
+        CHECK(ring.bytesAvailable() == 5);
+        CHECK(ring.receive(data + 3, sizeof(data), 0) == 5);
+        for (uint8_t i = 0; i < 8; i++) {
+            CHECK(data[i] == static_cast<uint8_t>(round + i));
+        }
+        CHECK(ring.isEmpty());
+    }
+    CHECK(ring.getOverruns() == 100);
+
+    uint8_t byte;
+    CHECK(!ring.receive(byte, 0));
+    CHECK(ring.sendFromISR(0x42));
+    CHECK(ring.receive(byte, 0));
+    CHECK(byte == 0x42);
+
+    CHECK(ring.sendFromISR(0x42));
+    ring.reset();
+    CHECK(ring.isEmpty());
+
+    // Nothing waited, so nothing was notified
+    CHECK(ring.getNotifications() == 0);
+
+    TestCaseEnd();
+}
+
+int ut_Timeout(void)
+{
+    TestCaseBegin();
+
+    os::RingBuffer<uint8_t, 8> ring(4);
+    uint8_t data[8];
+
+    auto start = os::Task::getTickCount();
+    CHECK(ring.receive(data, sizeof(data), 20) == 0);
+    CHECK(os::Task::getTickCount() - start >= 20);
+
+    // Less than the trigger level is returned after the timeout
+    ring.sendFromISR(1);
+    start = os::Task::getTickCount();
+    CHECK(ring.receive(data, sizeof(data), 20) == 1);
+    CHECK(os::Task::getTickCount() - start >= 20);
+
+    // Waiting for fewer bytes than the trigger level returns with them
+    ring.sendFromISR(2);
+    start = os::Task::getTickCount();
+    CHECK(ring.receive(data, 1, 20) == 1);
+    CHECK(os::Task::getTickCount() - start < 20);
+
+    TestCaseEnd();
+}
+
+int ut_Notifications(void)
+{
+    TestCaseBegin();
+
+    static constexpr size_t BYTES = 64 * 1024;
+    bool isInSequence = false;
+
+    // Bursts of 16 byte like from the UART FIFO or a modem response wake the consumer once
+    {
+        os::RingBuffer<uint8_t, 1024> ring;
+        std::thread producer([&]{ produce(ring, BYTES, 16, std::chrono::microseconds(100)); });
+        CHECK(consume(ring, BYTES, 64, isInSequence) == 0);
+        producer.join();
+        CHECK(isInSequence);
+        printf("bursts of 16 byte: %.1f wake ups per KiB\n", ring.getNotifications() * 1024.0 / BYTES);
+        CHECK(ring.getNotifications() <= BYTES / 16);
+    }
+
+    // Single bytes wake the consumer for each byte, unless a trigger level collects them
+    for (const size_t triggerLevel : {1, 16}) {
+        os::RingBuffer<uint8_t, 1024> ring(triggerLevel);
+        std::thread producer([&]{ produce(ring, BYTES / 16, 1, std::chrono::microseconds(20)); });
+        CHECK(consume(ring, BYTES / 16, 64, isInSequence) == 0);
+        producer.join();
+        CHECK(isInSequence);
+        printf("single bytes, trigger level %zu: %.1f wake ups per KiB\n", triggerLevel,
+               ring.getNotifications() * 1024.0 / (BYTES / 16));
+        CHECK(ring.getNotifications() <= BYTES / 16 / triggerLevel);
+    }
+
+    TestCaseEnd();
+}
+
+int ut_Throughput(void)
+{
+    TestCaseBegin();
+
+    static constexpr size_t BYTES = 16 * 1024 * 1024;
+    os::RingBuffer<uint8_t, 1024> ring;
+    bool isInSequence = false;
+
+    const auto start = std::chrono::steady_clock::now();
+    std::thread producer([&]{ produce(ring, BYTES, BYTES, std::chrono::microseconds(0)); });
+    CHECK(consume(ring, BYTES, 256, isInSequence) == 0);
+    producer.join();
+    const auto duration = std::chrono::steady_clock::now() - start;
+
+    CHECK(isInSequence);
+    printf("%.2f ns per byte\n", std::chrono::duration<double, std::nano>(duration).count() / BYTES);
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_SendReceive);
+    RunTest(true, ut_Timeout);
+    RunTest(true, ut_Notifications);
+    RunTest(true, ut_Throughput);
+    UnitTestMainEnd();
+}
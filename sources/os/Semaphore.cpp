@@ -11,6 +11,12 @@ Semaphore::Semaphore(void) :
     mSemaphoreHandle(xSemaphoreCreateBinary())
 {}
 
+#if OS_STATIC_ALLOCATION
+Semaphore::Semaphore(SemaphoreStorage& storage) :
+    mSemaphoreHandle(xSemaphoreCreateBinaryStatic(&storage))
+{}
+#endif
+
 Semaphore::Semaphore(Semaphore&& rhs) :
     mSemaphoreHandle(rhs.mSemaphoreHandle)
 {
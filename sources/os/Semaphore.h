@@ -7,6 +7,7 @@
 
 #include "FreeRTOS.h"
 #include "semphr.h"
+#include "os_StaticStorage.h"
 #include "os_Task.h"
 
 namespace os
@@ -18,6 +19,9 @@ class Semaphore
 
 public:
     Semaphore(void);
+#if OS_STATIC_ALLOCATION
+    explicit Semaphore(SemaphoreStorage& storage);
+#endif
     Semaphore(const Semaphore&) = delete;
     Semaphore(Semaphore&&);
     Semaphore& operator=(const Semaphore&) = delete;
@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include "StackMonitor.h"
+#include "trace.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <limits>
+
+static const int __attribute__((used)) g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_INFO;
+
+using os::StackMonitor;
+
+StackMonitor::StackMonitor(const uint32_t threshold, const std::chrono::milliseconds period) :
+    mThreshold(threshold),
+    mMonitorTimer("StackMonitor", period, Timer::Mode::PERIODIC, [this](){
+    sample();
+    dump([](const char* line){
+        Trace(ZONE_VERBOSE, "%s", line);
+    });
+})
+{
+    mMonitorTimer.start();
+}
+
+size_t StackMonitor::sample(void)
+{
+    // Tasks can't be created or destroyed meanwhile
+    Task::suspendAll();
+    const std::vector<Task*>& tasks = Task::getTasks();
+
+    mRecords.erase(std::remove_if(mRecords.begin(), mRecords.end(), [&](const Record& record){
+        return (std::find(tasks.begin(), tasks.end(), record.task) == tasks.end()) ||
+               (record.task->mHandle == nullptr);
+    }), mRecords.end());
+
+    for (const Task* task : tasks) {
+        if (task->mHandle == nullptr) {
+            continue;
+        }
+
+        auto record = std::find_if(mRecords.begin(), mRecords.end(), [&](const Record& r){
+            return r.task == task;
+        });
+        if (record == mRecords.end()) {
+            static constexpr uint32_t NOTHING_REPORTED = std::numeric_limits<uint32_t>::max();
+            const uint32_t size = static_cast<uint32_t>(task->mStackDepth * sizeof(StackType_t));
+            mRecords.push_back(Record {task, Usage {"", size, 0}, NOTHING_REPORTED});
+            record = mRecords.end() - 1;
+        }
+        // The kernel already keeps the minimum since the task was created
+        record->usage.name = pcTaskGetTaskName(task->mHandle);
+        record->usage.minimumFree = uxTaskGetStackHighWaterMark(task->mHandle) * sizeof(StackType_t);
+    }
+    Task::resumeAll();
+
+    size_t below = 0;
+    for (Record& record : mRecords) {
+        if (record.usage.minimumFree < mThreshold) {
+            below++;
+            if (record.usage.minimumFree < record.reportedFree) {
+                record.reportedFree = record.usage.minimumFree;
+                Trace(ZONE_WARNING, "%s has %d of %d byte stack left\r\n", record.usage.name,
+                      static_cast<int>(record.usage.minimumFree), static_cast<int>(record.usage.size));
+            }
+        }
+    }
+    return below;
+}
+
+size_t StackMonitor::getNumberOfTasks(void) const
+{
+    return mRecords.size();
+}
+
+StackMonitor::Usage StackMonitor::getUsage(const size_t index) const
+{
+    return index < mRecords.size() ? mRecords[index].usage : Usage {"", 0, 0};
+}
+
+void StackMonitor::dump(const std::function<void(const char*)>& send) const
+{
+    std::array<char, 64> line;
+    for (const Record& record : mRecords) {
+        const Usage& usage = record.usage;
+        std::snprintf(line.data(), line.size(), "%-*s %5u of %5u byte used\r\n",
+                      configMAX_TASK_NAME_LEN - 1, usage.name,
+                      static_cast<unsigned>(usage.size - usage.minimumFree),
+                      static_cast<unsigned>(usage.size));
+        send(line.data());
+    }
+}
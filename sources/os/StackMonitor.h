@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "os_Task.h"
+#include "Timer.h"
+
+namespace os
+{
+/**
+ * Samples the stack high water mark of every os::Task from a timer.
+ * A task whose unused stack drops below the threshold is reported each time
+ * it reaches a new minimum, while the overflow check of the kernel only
+ * catches a stack which is already exceeded.
+ *
+ * The table of dump() shows how far each stack can be trimmed.
+ */
+class StackMonitor final
+{
+public:
+    struct Usage {
+        const char* name;
+        // In byte
+        uint32_t size;
+        uint32_t minimumFree;
+    };
+
+    StackMonitor(const uint32_t threshold = 128, const std::chrono::milliseconds period = std::chrono::seconds(10));
+
+    StackMonitor(const StackMonitor&) = delete;
+    StackMonitor(StackMonitor&&) = delete;
+    StackMonitor& operator=(const StackMonitor&) = delete;
+    StackMonitor& operator=(StackMonitor&&) = delete;
+
+    // Called by the timer of StackMonitor every period, returns the number of tasks below the threshold.
+    // The other methods aren't synchronised with it and belong to the timer service task.
+    size_t sample(void);
+
+    size_t getNumberOfTasks(void) const;
+    Usage getUsage(const size_t index) const;
+
+    // Sends one line per task
+    void dump(const std::function<void(const char*)>& send) const;
+
+private:
+    struct Record {
+        const Task* task;
+        Usage usage;
+        // Minimum which was reported last
+        uint32_t reportedFree;
+    };
+
+    std::vector<Record> mRecords;
+    const uint32_t mThreshold;
+    Timer mMonitorTimer;
+};
+}
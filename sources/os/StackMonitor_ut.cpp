@@ -0,0 +1,171 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "StackMonitor.h"
+#include "TaskEndless.h"
+#include "unittest.h"
+
+//--------------------------MOCKING--------------------------
+// Unused words of the stack and the name of each task by its handle
+static std::map<xTaskHandle, UBaseType_t> g_highWaterMarks;
+static std::map<xTaskHandle, std::string> g_names;
+static uintptr_t g_nextHandle = 1;
+static bool g_isTimerActive = false;
+
+std::vector<os::Task*>& os::Task::getTasks(void)
+{
+    static std::vector<Task*> tasks;
+    return tasks;
+}
+
+os::Task::Task(char const* name, unsigned short stack, os::Task::Priority prio,
+               std::function<void(bool const&)> func) :
+    mHandle(reinterpret_cast<xTaskHandle>(g_nextHandle++)), mStackDepth(Task::STACKSIZE_IN_BYTE(stack))
+{
+    getTasks().push_back(this);
+    g_names[mHandle] = name;
+    g_highWaterMarks[mHandle] = mStackDepth;
+}
+
+os::Task::~Task(void)
+{
+    std::vector<Task*>& tasks = getTasks();
+    tasks.erase(std::find(tasks.begin(), tasks.end(), this));
+}
+
+void os::Task::taskFunction(void) {}
+
+void os::Task::suspendAll(void) {}
+
+void os::Task::resumeAll(void) {}
+
+void os::ThisTask::sleep(const std::chrono::milliseconds ms) {}
+
+os::Timer::Timer(char const* name, const std::chrono::milliseconds period, const Mode mode,
+                 std::function<void(void)> function) {}
+
+os::Timer::~Timer(void)
+{
+    g_isTimerActive = false;
+}
+
+bool os::Timer::start(uint32_t ticksToWait) const
+{
+    g_isTimerActive = true;
+    return true;
+}
+
+extern "C" char* pcTaskGetTaskName(TaskHandle_t xTaskToQuery)
+{
+    return const_cast<char*>(g_names[xTaskToQuery].c_str());
+}
+
+extern "C" UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask)
+{
+    return g_highWaterMarks[xTask];
+}
+
+//--------------------------HELPERS--------------------------
+
+struct TestTask :
+    public os::TaskEndless {
+    TestTask(const char* name, const uint16_t stackSize) :
+        TaskEndless(name, stackSize, os::Task::Priority::LOW, [](const bool&){}) {}
+
+    void use(const uint32_t bytes)
+    {
+        g_highWaterMarks[mHandle] = mStackDepth - bytes / sizeof(StackType_t);
+    }
+
+    void end(void)
+    {
+        mHandle = nullptr;
+    }
+};
+
+static bool isUsage(const os::StackMonitor& monitor, const char* name, const uint32_t size, const uint32_t free)
+{
+    for (size_t i = 0; i < monitor.getNumberOfTasks(); i++) {
+        const auto usage = monitor.getUsage(i);
+        if (std::string(usage.name) == name) {
+            return (usage.size == size) && (usage.minimumFree == free);
+        }
+    }
+    return false;
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_Usage(void)
+{
+    TestCaseBegin();
+
+    TestTask modem("Modem", 2048);
+    TestTask can("Can", 1024);
+    os::StackMonitor monitor(128);
+    // The monitor runs in the timer service task instead of a task of its own
+    CHECK(g_isTimerActive);
+
+    modem.use(512);
+    can.use(1000);
+    CHECK(monitor.sample() == 1);
+    CHECK(monitor.getNumberOfTasks() == 2);
+    CHECK(isUsage(monitor, "Modem", 2048, 1536));
+    CHECK(isUsage(monitor, "Can", 1024, 24));
+
+    std::string text;
+    monitor.dump([&](const char* line){
+        text += line;
+    });
+    CHECK(text.find("Modem             512 of  2048 byte used\r\n") != std::string::npos);
+    CHECK(text.find("Can              1000 of  1024 byte used\r\n") != std::string::npos);
+
+    // A task below the threshold stays there, the kernel keeps the minimum
+    CHECK(monitor.sample() == 1);
+    modem.use(2000);
+    CHECK(monitor.sample() == 2);
+
+    TestCaseEnd();
+}
+
+int ut_TaskLifecycle(void)
+{
+    TestCaseBegin();
+
+    TestTask modem("Modem", 2048);
+    auto can = std::make_unique<TestTask>("Can", 1024);
+    os::StackMonitor monitor;
+    CHECK(monitor.sample() == 0);
+    CHECK(monitor.getNumberOfTasks() == 2);
+
+    // Tasks created after the monitor are sampled as well
+    TestTask demo("Demo", 512);
+    CHECK(monitor.sample() == 0);
+    CHECK(monitor.getNumberOfTasks() == 3);
+    CHECK(isUsage(monitor, "Demo", 512, 512));
+
+    // Neither destroyed nor ended tasks are sampled
+    can.reset();
+    demo.end();
+    CHECK(monitor.sample() == 0);
+    CHECK(monitor.getNumberOfTasks() == 1);
+    CHECK(!isUsage(monitor, "Can", 1024, 1024));
+    CHECK(!isUsage(monitor, "Demo", 512, 512));
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_Usage);
+    RunTest(true, ut_TaskLifecycle);
+    UnitTestMainEnd();
+}
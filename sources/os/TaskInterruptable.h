@@ -13,12 +13,23 @@ namespace os
 class TaskInterruptable :
     public Task
 {
+#if OS_STATIC_ALLOCATION
+    StaticSemaphore_t mJoinSemaphoreBuffer;
+#endif
     xSemaphoreHandle mJoinSemaphore;
     bool mJoinFlag;
 
 public:
     TaskInterruptable(const char* name, uint16_t stackSize, os::Task::Priority priority,
                       std::function<void(const bool&)> function);
+#if OS_STATIC_ALLOCATION
+    template<size_t STACKSIZE>
+    TaskInterruptable(const char* name, TaskStorage<STACKSIZE>& storage, os::Task::Priority priority,
+                      std::function<void(const bool&)> function) :
+        Task(name, storage, priority, function),
+        mJoinSemaphore(xSemaphoreCreateBinaryStatic(&mJoinSemaphoreBuffer)),
+        mJoinFlag(false) {}
+#endif
     virtual ~TaskInterruptable(void) override;
     using Task::Task;
 
@@ -0,0 +1,203 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include "TicklessIdle.h"
+#include "DeepSleepInterface.h"
+#include "task.h"
+#include "stm32f30x.h"
+#include "stm32f30x_exti.h"
+#include "stm32f30x_misc.h"
+#include "stm32f30x_pwr.h"
+#include "stm32f30x_rcc.h"
+#include "stm32f30x_rtc.h"
+#include <algorithm>
+
+#ifndef TICKLESS_IDLE
+#error "Build with -DTICKLESS_IDLE"
+#endif
+
+using os::TicklessIdle;
+
+// Sleep mode implementation of the port
+extern "C" void vPortSuppressTicksAndSleep(TickType_t xExpectedIdleTime);
+
+static TicklessIdle::Statistics g_statistics {};
+static bool g_isWakeupTimerConfigured = false;
+
+static bool isRtcRunningOnLse(void)
+{
+    return (RCC->BDCR & RCC_BDCR_RTCEN) && ((RCC->BDCR & RCC_BDCR_RTCSEL) == RCC_BDCR_RTCSEL_LSE);
+}
+
+static void configureWakeupTimer(void)
+{
+    RCC_APB1PeriphClockCmd(RCC_APB1Periph_PWR, ENABLE);
+    PWR_BackupAccessCmd(ENABLE);
+
+    EXTI_InitTypeDef exti {EXTI_Line20, EXTI_Mode_Interrupt, EXTI_Trigger_Rising, ENABLE};
+    EXTI_Init(&exti);
+    NVIC_InitTypeDef nvic {RTC_WKUP_IRQn, configLIBRARY_LOWEST_INTERRUPT_PRIORITY, 0, ENABLE};
+    NVIC_Init(&nvic);
+
+    RTC_WriteProtectionCmd(DISABLE);
+    RTC_WakeUpCmd(DISABLE);
+    RTC_WakeUpClockConfig(RTC_WakeUpClock_RTCCLK_Div16);
+    RTC_ITConfig(RTC_IT_WUT, ENABLE);
+    RTC_WriteProtectionCmd(ENABLE);
+
+    // Wake up latency
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static uint32_t fromBcd(const uint32_t value)
+{
+    return (value >> 4) * 10 + (value & 0xf);
+}
+
+// Time of the day in periods of the asynchronous prescaler output
+static uint32_t getRtcSubseconds(void)
+{
+    const uint32_t synchronous = (RTC->PRER & RTC_PRER_PREDIV_S) + 1;
+    // Reading SSR locks TR until DR is read
+    const uint32_t ssr = RTC->SSR;
+    const uint32_t tr = RTC->TR;
+    (void)RTC->DR;
+
+    const uint32_t seconds = (fromBcd((tr >> 16) & 0x3f) * 60 + fromBcd((tr >> 8) & 0x7f)) * 60 + fromBcd(tr & 0x7f);
+    return seconds * synchronous + (synchronous - 1 - ssr);
+}
+
+static uint32_t getRtcMicroseconds(const uint32_t start, const uint32_t stop)
+{
+    static constexpr uint32_t SECONDS_PER_DAY = 24 * 60 * 60;
+    const uint32_t asynchronous = ((RTC->PRER & RTC_PRER_PREDIV_A) >> 16) + 1;
+    const uint32_t synchronous = (RTC->PRER & RTC_PRER_PREDIV_S) + 1;
+    const uint32_t day = SECONDS_PER_DAY * synchronous;
+
+    const uint32_t periods = (stop + day - start) % day;
+    return static_cast<uint64_t>(periods) * asynchronous * 1000000 / LSE_VALUE;
+}
+
+static void stop(const TickType_t expectedIdleTime)
+{
+    const uint32_t cyclesPerTick = configCPU_CLOCK_HZ / configTICK_RATE_HZ;
+
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+    if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+        // The tick is already due
+        SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+        return;
+    }
+    const uint32_t cyclesSinceTick = cyclesPerTick - SysTick->VAL;
+
+    const TickType_t ticks = expectedIdleTime - 1;
+    const uint32_t counts = TicklessIdle::getWakeupCounts(ticks);
+
+    RTC_WriteProtectionCmd(DISABLE);
+    RTC_WakeUpCmd(DISABLE);
+    RTC_SetWakeUpCounter(counts - 1);
+    RTC_ClearITPendingBit(RTC_IT_WUT);
+    EXTI_ClearITPendingBit(EXTI_Line20);
+    const uint32_t start = getRtcSubseconds();
+    RTC_WakeUpCmd(ENABLE);
+    RTC_WriteProtectionCmd(ENABLE);
+
+    // Stop mode disables the HSE and the PLL and wakes up with the HSI
+    const uint32_t clockSource = RCC_GetSYSCLKSource();
+    const bool hse = RCC->CR & RCC_CR_HSEON;
+    const bool pll = RCC->CR & RCC_CR_PLLON;
+
+    PWR_EnterSTOPMode(PWR_Regulator_LowPower, PWR_STOPEntry_WFI);
+
+    const uint32_t wakeup = DWT->CYCCNT;
+    if (hse) {
+        RCC_HSEConfig(RCC_HSE_ON);
+        while (RCC_GetFlagStatus(RCC_FLAG_HSERDY) == RESET) {}
+    }
+    if (pll) {
+        RCC_PLLCmd(ENABLE);
+        while (RCC_GetFlagStatus(RCC_FLAG_PLLRDY) == RESET) {}
+    }
+    RCC_SYSCLKConfig(clockSource >> 2);
+    while (RCC_GetSYSCLKSource() != clockSource) {}
+    // All of it ran with the HSI
+    const uint32_t wakeupMicroseconds = (DWT->CYCCNT - wakeup) / (HSI_VALUE / 1000000);
+
+    const bool isWakeupTimerExpired = RTC_GetFlagStatus(RTC_FLAG_WUTF) == SET;
+    RTC_WriteProtectionCmd(DISABLE);
+    RTC_WakeUpCmd(DISABLE);
+    RTC_WriteProtectionCmd(ENABLE);
+
+    uint32_t sleptMicroseconds = TicklessIdle::getWakeupMicroseconds(counts);
+    if (!isWakeupTimerExpired) {
+        // The calendar registers are outdated after the stop mode
+        RTC_WaitForSynchro();
+        sleptMicroseconds = std::min(sleptMicroseconds, getRtcMicroseconds(start, getRtcSubseconds()));
+    }
+
+    const TicklessIdle::Step step = TicklessIdle::getStep(cyclesSinceTick, sleptMicroseconds, cyclesPerTick,
+                                                          expectedIdleTime);
+    SysTick->LOAD = step.cyclesToNextTick - 1;
+    SysTick->VAL = 0;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+    SysTick->LOAD = cyclesPerTick - 1;
+    vTaskStepTick(step.ticks);
+
+    g_statistics.stops++;
+    g_statistics.stoppedTicks += step.ticks;
+    g_statistics.lastWakeupMicroseconds = wakeupMicroseconds;
+    g_statistics.maxWakeupMicroseconds = std::max(g_statistics.maxWakeupMicroseconds, wakeupMicroseconds);
+}
+
+void TicklessIdle::suppressTicksAndSleep(const TickType_t expectedIdleTime)
+{
+    // Interrupts still end the stop mode, but are handled when the ticks are stepped
+    __disable_irq();
+    __DSB();
+    __ISB();
+
+    if (eTaskConfirmSleepModeStatus() == eAbortSleep) {
+        __enable_irq();
+        return;
+    }
+
+    if ((expectedIdleTime < MIN_STOP_TICKS) || !isRtcRunningOnLse()) {
+        g_statistics.sleeps++;
+    } else if (!os::DeepSleepController::isStopModeAllowed()) {
+        g_statistics.vetoes++;
+    } else {
+        if (!g_isWakeupTimerConfigured) {
+            configureWakeupTimer();
+            g_isWakeupTimerConfigured = true;
+        }
+        // The kernel sleeps again for the rest
+        stop(expectedIdleTime < MAX_STOP_TICKS ? expectedIdleTime : MAX_STOP_TICKS);
+        __enable_irq();
+        return;
+    }
+
+    __enable_irq();
+    vPortSuppressTicksAndSleep(expectedIdleTime);
+}
+
+TicklessIdle::Statistics TicklessIdle::getStatistics(void)
+{
+    taskENTER_CRITICAL();
+    const Statistics statistics = g_statistics;
+    taskEXIT_CRITICAL();
+    return statistics;
+}
+
+extern "C" void RTC_WKUP_IRQHandler(void)
+{
+    RTC_ClearITPendingBit(RTC_IT_WUT);
+    EXTI_ClearITPendingBit(EXTI_Line20);
+}
+
+extern "C" void vApplicationSuppressTicksAndSleep(TickType_t xExpectedIdleTime)
+{
+    TicklessIdle::suppressTicksAndSleep(xExpectedIdleTime);
+}
@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "FreeRTOS.h"
+
+namespace os
+{
+/**
+ * portSUPPRESS_TICKS_AND_SLEEP of the kernel when built with TICKLESS_IDLE.
+ * If no task is ready for a while, the idle task stops the MCU until the RTC
+ * wakeup timer or any other interrupt ends the stop mode. The SysTick doesn't
+ * run meanwhile, so the ticks are stepped by the slept time afterwards.
+ *
+ * Every os::DeepSleepModule can veto the stop mode. Then, as for short idle
+ * times, the kernel sleeps with the SysTick suppressed and the peripherals
+ * keep running.
+ */
+class TicklessIdle final
+{
+public:
+    struct Statistics {
+        uint32_t stops;
+        // Sleep mode instead of stop mode, as the idle time was too short
+        uint32_t sleeps;
+        uint32_t vetoes;
+        uint32_t stoppedTicks;
+        // From the end of the stop mode until the PLL runs again
+        uint32_t lastWakeupMicroseconds;
+        uint32_t maxWakeupMicroseconds;
+    };
+
+    struct Step {
+        TickType_t ticks;
+        uint32_t cyclesToNextTick;
+    };
+
+    // RTCCLK / 16 of the LSE
+    static constexpr uint32_t WAKEUP_CLOCK_HZ = 32768 / 16;
+    static constexpr uint32_t MAX_WAKEUP_COUNTS = 0x10000;
+    static constexpr TickType_t MAX_STOP_TICKS = static_cast<uint64_t>(MAX_WAKEUP_COUNTS) * configTICK_RATE_HZ /
+                                                 WAKEUP_CLOCK_HZ;
+    // Restarting the PLL isn't worth it for shorter idle times
+    static constexpr TickType_t MIN_STOP_TICKS = 5;
+
+    TicklessIdle(void) = delete;
+
+    static void suppressTicksAndSleep(const TickType_t expectedIdleTime);
+
+    static Statistics getStatistics(void);
+
+    // Rounded down, so the wakeup timer never expires after the idle time
+    static constexpr uint32_t getWakeupCounts(const TickType_t ticks)
+    {
+        const uint64_t counts = static_cast<uint64_t>(ticks) * WAKEUP_CLOCK_HZ / configTICK_RATE_HZ;
+        return counts < MAX_WAKEUP_COUNTS ? counts : MAX_WAKEUP_COUNTS;
+    }
+
+    static constexpr uint32_t getWakeupMicroseconds(const uint32_t counts)
+    {
+        return static_cast<uint64_t>(counts) * 1000000 / WAKEUP_CLOCK_HZ;
+    }
+
+    // The tick period which was running when the SysTick was stopped continues
+    // after the stop mode, so no fraction of a tick gets lost. The kernel must
+    // not step beyond the expected idle time, the SysTick counts the last tick.
+    static constexpr Step getStep(const uint32_t   cyclesSinceTick,
+                                  const uint32_t   sleptMicroseconds,
+                                  const uint32_t   cyclesPerTick,
+                                  const TickType_t expectedIdleTime)
+    {
+        const uint64_t cycles = cyclesSinceTick +
+                                static_cast<uint64_t>(sleptMicroseconds) * cyclesPerTick * configTICK_RATE_HZ / 1000000;
+        const uint64_t ticks = cycles / cyclesPerTick;
+
+        if (ticks >= expectedIdleTime) {
+            return Step {expectedIdleTime - 1, 1};
+        }
+        return Step {static_cast<TickType_t>(ticks), static_cast<uint32_t>(cyclesPerTick - cycles % cyclesPerTick)};
+    }
+};
+}
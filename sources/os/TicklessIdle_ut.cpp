@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include "TicklessIdle.h"
+#include "DeepSleepInterface.h"
+#include "unittest.h"
+
+using os::TicklessIdle;
+
+//--------------------------MOCKING--------------------------
+struct Peripheral final :
+    private os::DeepSleepModule {
+    bool isBusy = false;
+
+private:
+    virtual bool isStopModeAllowed(void) const override
+    {
+        return !isBusy;
+    }
+};
+
+static constexpr uint32_t CYCLES_PER_TICK = 72000000 / configTICK_RATE_HZ;
+
+//-------------------------TESTCASES-------------------------
+
+int ut_WakeupCounts(void)
+{
+    TestCaseBegin();
+
+    CHECK(TicklessIdle::getWakeupCounts(1000) == TicklessIdle::WAKEUP_CLOCK_HZ);
+    CHECK(TicklessIdle::getWakeupCounts(3) == 6);
+    CHECK(TicklessIdle::getWakeupMicroseconds(6) == 2929);
+
+    // The wakeup timer never expires after the idle time
+    for (TickType_t ticks = 1; ticks <= TicklessIdle::MAX_STOP_TICKS; ticks++) {
+        const uint32_t counts = TicklessIdle::getWakeupCounts(ticks);
+        CHECK(counts <= TicklessIdle::MAX_WAKEUP_COUNTS);
+        CHECK(TicklessIdle::getWakeupMicroseconds(counts) <= ticks * 1000);
+    }
+    CHECK(TicklessIdle::getWakeupCounts(TicklessIdle::MAX_STOP_TICKS) == TicklessIdle::MAX_WAKEUP_COUNTS);
+    CHECK(TicklessIdle::getWakeupCounts(2 * TicklessIdle::MAX_STOP_TICKS) == TicklessIdle::MAX_WAKEUP_COUNTS);
+
+    TestCaseEnd();
+}
+
+int ut_Step(void)
+{
+    TestCaseBegin();
+
+    // Half of a tick passed before the stop mode
+    auto step = TicklessIdle::getStep(CYCLES_PER_TICK / 2, 10250, CYCLES_PER_TICK, 20);
+    CHECK(step.ticks == 10);
+    CHECK(step.cyclesToNextTick == CYCLES_PER_TICK / 4);
+
+    // Woken up early by another interrupt
+    step = TicklessIdle::getStep(0, 100, CYCLES_PER_TICK, 20);
+    CHECK(step.ticks == 0);
+    CHECK(step.cyclesToNextTick == CYCLES_PER_TICK - CYCLES_PER_TICK / 10);
+
+    // The SysTick counts the last tick of the idle time
+    step = TicklessIdle::getStep(CYCLES_PER_TICK / 2, 19500, CYCLES_PER_TICK, 20);
+    CHECK(step.ticks == 19);
+    CHECK(step.cyclesToNextTick == 1);
+
+    step = TicklessIdle::getStep(0, 30000, CYCLES_PER_TICK, 20);
+    CHECK(step.ticks == 19);
+    CHECK(step.cyclesToNextTick == 1);
+
+    TestCaseEnd();
+}
+
+int ut_Veto(void)
+{
+    TestCaseBegin();
+
+    CHECK(os::DeepSleepController::isStopModeAllowed());
+    {
+        Peripheral usart;
+        Peripheral can;
+        CHECK(os::DeepSleepController::isStopModeAllowed());
+
+        can.isBusy = true;
+        CHECK(!os::DeepSleepController::isStopModeAllowed());
+        usart.isBusy = true;
+        can.isBusy = false;
+        CHECK(!os::DeepSleepController::isStopModeAllowed());
+        usart.isBusy = false;
+        CHECK(os::DeepSleepController::isStopModeAllowed());
+
+        usart.isBusy = true;
+    }
+    // Destroyed modules don't veto anymore
+    CHECK(os::DeepSleepController::isStopModeAllowed());
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_WakeupCounts);
+    RunTest(true, ut_Step);
+    RunTest(true, ut_Veto);
+    UnitTestMainEnd();
+}
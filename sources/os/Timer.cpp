@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include "Timer.h"
+#include "os_Task.h"
+
+using os::Timer;
+
+static TickType_t toTicks(const std::chrono::milliseconds period)
+{
+    // The kernel rejects a period of zero ticks
+    const TickType_t ticks = period.count() / portTICK_RATE_MS;
+    return ticks ? ticks : 1;
+}
+
+Timer::Timer(const char*                     name,
+             const std::chrono::milliseconds period,
+             const Mode                      mode,
+             std::function<void(void)>       function) :
+    mTimerHandle(xTimerCreate(name, toTicks(period), mode == Mode::PERIODIC, this, Timer::callback)),
+    mFunction(function)
+{}
+
+#if OS_STATIC_ALLOCATION
+Timer::Timer(const char*                     name,
+             TimerStorage&                   storage,
+             const std::chrono::milliseconds period,
+             const Mode                      mode,
+             std::function<void(void)>       function) :
+    mTimerHandle(xTimerCreateStatic(name, toTicks(period), mode == Mode::PERIODIC, this, Timer::callback, &storage)),
+    mFunction(function)
+{}
+#endif
+
+Timer::~Timer(void)
+{
+    if (*this) {
+        // An expiry which is processed before the delete command must not call into the destroyed object
+        vTimerSetTimerID(mTimerHandle, nullptr);
+        xTimerDelete(mTimerHandle, portMAX_DELAY);
+    }
+}
+
+void Timer::callback(TimerHandle_t handle)
+{
+    Timer* const timer = static_cast<Timer*>(pvTimerGetTimerID(handle));
+    if ((timer != nullptr) && timer->mFunction) {
+        timer->mFunction();
+    }
+}
+
+bool Timer::start(uint32_t ticksToWait) const
+{
+    return *this ? xTimerStart(mTimerHandle, ticksToWait) : false;
+}
+
+bool Timer::stop(uint32_t ticksToWait) const
+{
+    return *this ? xTimerStop(mTimerHandle, ticksToWait) : false;
+}
+
+bool Timer::changePeriod(const std::chrono::milliseconds period, uint32_t ticksToWait) const
+{
+    return *this ? xTimerChangePeriod(mTimerHandle, toTicks(period), ticksToWait) : false;
+}
+
+bool Timer::startFromISR(void) const
+{
+    BaseType_t highPriorityTaskWoken = 0;
+    bool retVal = *this ? xTimerStartFromISR(mTimerHandle, &highPriorityTaskWoken) : false;
+    if (highPriorityTaskWoken) {
+        ThisTask::yield();
+    }
+    return retVal;
+}
+
+bool Timer::stopFromISR(void) const
+{
+    BaseType_t highPriorityTaskWoken = 0;
+    bool retVal = *this ? xTimerStopFromISR(mTimerHandle, &highPriorityTaskWoken) : false;
+    if (highPriorityTaskWoken) {
+        ThisTask::yield();
+    }
+    return retVal;
+}
+
+bool Timer::isActive(void) const
+{
+    return *this ? xTimerIsTimerActive(mTimerHandle) : false;
+}
+
+Timer::operator bool() const
+{
+    return mTimerHandle != nullptr;
+}
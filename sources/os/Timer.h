@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include "FreeRTOS.h"
+#include "timers.h"
+#include "os_StaticStorage.h"
+
+namespace os
+{
+/**
+ * Software timer of the kernel. The function runs in the timer service task,
+ * so periodic work doesn't need a task, a stack and a TCB of its own. It
+ * shares the stack of configTIMER_TASK_STACK_DEPTH with all other timers and
+ * delays them while it runs, so it must not block.
+ *
+ * The commands are queued to the timer service task without waiting by
+ * default. That works before the scheduler is started and inside the
+ * function of a timer, where waiting for the queue would never end.
+ */
+class Timer
+{
+    TimerHandle_t mTimerHandle = nullptr;
+    const std::function<void(void)> mFunction;
+
+    static void callback(TimerHandle_t handle);
+
+public:
+    enum class Mode {
+        ONE_SHOT,
+        PERIODIC
+    };
+
+    // The timer is created stopped
+    Timer(const char* name, const std::chrono::milliseconds period, const Mode mode,
+          std::function<void(void)> function);
+#if OS_STATIC_ALLOCATION
+    Timer(const char* name, TimerStorage& storage, const std::chrono::milliseconds period, const Mode mode,
+          std::function<void(void)> function);
+#endif
+    // The kernel keeps a pointer to the object
+    Timer(const Timer&) = delete;
+    Timer(Timer&&) = delete;
+    Timer& operator=(const Timer&) = delete;
+    Timer& operator=(Timer&&) = delete;
+    // Waits for room in the command queue, so a timer must not be destroyed by the function of a timer
+    ~Timer(void);
+
+    // Starts the period anew if the timer is already running
+    bool start(uint32_t ticksToWait = 0) const;
+    bool stop(uint32_t ticksToWait = 0) const;
+    // Also starts a stopped timer
+    bool changePeriod(const std::chrono::milliseconds period, uint32_t ticksToWait = 0) const;
+    bool startFromISR(void) const;
+    bool stopFromISR(void) const;
+
+    bool isActive(void) const;
+
+    operator bool() const;
+};
+}
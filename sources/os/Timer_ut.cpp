@@ -0,0 +1,250 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include <memory>
+#include <vector>
+
+#include "Timer.h"
+#include "os_Task.h"
+#include "unittest.h"
+
+//--------------------------MOCKING--------------------------
+// The timers of the kernel, they are never freed so a deleted one can still be inspected
+struct KernelTimer {
+    TickType_t period;
+    bool autoReload;
+    void* id;
+    TimerCallbackFunction_t callback;
+    bool isActive = false;
+    bool isDeleted = false;
+};
+
+static std::vector<std::unique_ptr<KernelTimer> > g_timers;
+static bool g_isOutOfMemory = false;
+static TickType_t g_ticksToWait = 0;
+static size_t g_yields = 0;
+
+static KernelTimer& getTimer(TimerHandle_t handle)
+{
+    return *reinterpret_cast<KernelTimer*>(handle);
+}
+
+// The timer service task processes an expiry
+static void expire(TimerHandle_t handle)
+{
+    KernelTimer& timer = getTimer(handle);
+    if (timer.isActive && !timer.isDeleted) {
+        timer.isActive = timer.autoReload;
+        timer.callback(handle);
+    }
+}
+
+static TimerHandle_t lastTimer(void)
+{
+    return g_timers.empty() ? nullptr : reinterpret_cast<TimerHandle_t>(g_timers.back().get());
+}
+
+extern "C" TimerHandle_t xTimerCreate(const char* const pcTimerName, const TickType_t xTimerPeriodInTicks,
+                                      const UBaseType_t uxAutoReload, void* const pvTimerID,
+                                      TimerCallbackFunction_t pxCallbackFunction)
+{
+    if (g_isOutOfMemory) {
+        return nullptr;
+    }
+    g_timers.emplace_back(new KernelTimer {xTimerPeriodInTicks, uxAutoReload != 0, pvTimerID, pxCallbackFunction});
+    return lastTimer();
+}
+
+extern "C" BaseType_t xTimerGenericCommand(TimerHandle_t xTimer, const BaseType_t xCommandID,
+                                           const TickType_t xOptionalValue,
+                                           BaseType_t* const pxHigherPriorityTaskWoken,
+                                           const TickType_t xTicksToWait)
+{
+    KernelTimer& timer = getTimer(xTimer);
+    g_ticksToWait = xTicksToWait;
+
+    switch (xCommandID) {
+    case tmrCOMMAND_START:
+        timer.isActive = true;
+        break;
+
+    case tmrCOMMAND_START_FROM_ISR:
+        timer.isActive = true;
+        // The timer service task has a higher priority than the interrupted task
+        *pxHigherPriorityTaskWoken = pdTRUE;
+        break;
+
+    case tmrCOMMAND_STOP:
+        timer.isActive = false;
+        break;
+
+    case tmrCOMMAND_STOP_FROM_ISR:
+        timer.isActive = false;
+        break;
+
+    case tmrCOMMAND_CHANGE_PERIOD:
+        timer.period = xOptionalValue;
+        timer.isActive = true;
+        break;
+
+    case tmrCOMMAND_DELETE:
+        timer.isDeleted = true;
+        break;
+
+    default:
+        return pdFAIL;
+    }
+    return pdPASS;
+}
+
+extern "C" void* pvTimerGetTimerID(const TimerHandle_t xTimer)
+{
+    return getTimer(xTimer).id;
+}
+
+extern "C" void vTimerSetTimerID(TimerHandle_t xTimer, void* pvNewID)
+{
+    getTimer(xTimer).id = pvNewID;
+}
+
+extern "C" BaseType_t xTimerIsTimerActive(TimerHandle_t xTimer)
+{
+    return getTimer(xTimer).isActive;
+}
+
+extern "C" TickType_t xTaskGetTickCount(void)
+{
+    return 0;
+}
+
+extern "C" TickType_t xTaskGetTickCountFromISR(void)
+{
+    return 0;
+}
+
+void os::ThisTask::yield(void)
+{
+    g_yields++;
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_Periodic(void)
+{
+    TestCaseBegin();
+
+    size_t calls = 0;
+    os::Timer timer("Periodic", std::chrono::milliseconds(100), os::Timer::Mode::PERIODIC, [&](){
+        calls++;
+    });
+    const TimerHandle_t handle = lastTimer();
+    CHECK(timer);
+    CHECK(getTimer(handle).period == 100 / portTICK_RATE_MS);
+    CHECK(getTimer(handle).autoReload);
+
+    // Created stopped
+    CHECK(!timer.isActive());
+    expire(handle);
+    CHECK(calls == 0);
+
+    CHECK(timer.start());
+    CHECK(g_ticksToWait == 0);
+    CHECK(timer.isActive());
+    expire(handle);
+    expire(handle);
+    CHECK(calls == 2);
+    CHECK(timer.isActive());
+
+    CHECK(timer.stop(portMAX_DELAY));
+    CHECK(g_ticksToWait == portMAX_DELAY);
+    expire(handle);
+    CHECK(calls == 2);
+
+    TestCaseEnd();
+}
+
+int ut_OneShot(void)
+{
+    TestCaseBegin();
+
+    size_t calls = 0;
+    os::Timer timer("OneShot", std::chrono::seconds(2), os::Timer::Mode::ONE_SHOT, [&](){
+        calls++;
+    });
+    const TimerHandle_t handle = lastTimer();
+    CHECK(!getTimer(handle).autoReload);
+
+    CHECK(timer.start());
+    expire(handle);
+    CHECK(calls == 1);
+    CHECK(!timer.isActive());
+    expire(handle);
+    CHECK(calls == 1);
+
+    // Changing the period starts it again, the kernel rejects zero ticks
+    CHECK(timer.changePeriod(std::chrono::milliseconds(0)));
+    CHECK(getTimer(handle).period == 1);
+    CHECK(timer.isActive());
+    expire(handle);
+    CHECK(calls == 2);
+
+    g_yields = 0;
+    CHECK(timer.startFromISR());
+    CHECK(g_yields == 1);
+    CHECK(timer.stopFromISR());
+    CHECK(!timer.isActive());
+
+    TestCaseEnd();
+}
+
+int ut_Destruction(void)
+{
+    TestCaseBegin();
+
+    size_t calls = 0;
+    auto timer = std::make_unique<os::Timer>("Destroyed", std::chrono::milliseconds(10),
+                                             os::Timer::Mode::PERIODIC, [&](){
+        calls++;
+    });
+    const TimerHandle_t handle = lastTimer();
+    CHECK(timer->start());
+    timer.reset();
+    CHECK(getTimer(handle).isDeleted);
+    CHECK(g_ticksToWait == portMAX_DELAY);
+
+    // An expiry which the timer service task processes before the delete command
+    getTimer(handle).isDeleted = false;
+    expire(handle);
+    CHECK(calls == 0);
+
+    TestCaseEnd();
+}
+
+int ut_OutOfMemory(void)
+{
+    TestCaseBegin();
+
+    g_isOutOfMemory = true;
+    os::Timer timer("Failed", std::chrono::milliseconds(10), os::Timer::Mode::PERIODIC, [](){});
+    g_isOutOfMemory = false;
+
+    CHECK(!timer);
+    CHECK(!timer.start());
+    CHECK(!timer.stop());
+    CHECK(!timer.changePeriod(std::chrono::milliseconds(10)));
+    CHECK(!timer.isActive());
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_Periodic);
+    RunTest(true, ut_OneShot);
+    RunTest(true, ut_Destruction);
+    RunTest(true, ut_OutOfMemory);
+    UnitTestMainEnd();
+}
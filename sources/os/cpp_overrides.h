@@ -8,27 +8,49 @@
 #if  defined(USE_FREERTOS) && defined(__cplusplus)
 
 #include "FreeRTOS.h"
+#include "PoolAllocator.h"
 #include "trace.h"
 
+struct PortHeap {
+    static void* allocate(size_t size)
+    {
+        return pvPortMalloc(size);
+    }
+
+    static void deallocate(void* p)
+    {
+        vPortFree(p);
+    }
+};
+
+// Small objects like std::function targets and shared_ptr control blocks come from
+// the pools, so they don't fragment the heap. A project may define its own pools.
+#ifndef POOL_ALLOCATOR_POOLS
+#define POOL_ALLOCATOR_POOLS os::BlockPool<16, 32>, os::BlockPool<32, 24>, os::BlockPool<64, 12>, \
+    os::BlockPool<128, 6>, os::BlockPool<256, 2>
+#endif
+
+os::PoolAllocator<PortHeap, POOL_ALLOCATOR_POOLS> g_PoolAllocator;
+
 //Override C++ new/delete operators to reduce memory footprint
 void* operator new(size_t size)
 {
-    return pvPortMalloc(size);
+    return g_PoolAllocator.allocate(size);
 }
 
 void* operator new[](size_t size)
 {
-    return pvPortMalloc(size);
+    return g_PoolAllocator.allocate(size);
 }
 
 void operator delete(void* p)
 {
-    vPortFree(p);
+    g_PoolAllocator.deallocate(p);
 }
 
 void operator delete[](void* p)
 {
-    vPortFree(p);
+    g_PoolAllocator.deallocate(p);
 }
 
 extern "C" void abort(void)
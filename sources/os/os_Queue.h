@@ -7,6 +7,8 @@
 
 #include "FreeRTOS.h"
 #include "queue.h"
+#include "os_Task.h"
+#include "os_StaticStorage.h"
 #include <chrono>
 
 namespace os
@@ -18,6 +20,9 @@ class Queue
 
 public:
     Queue(void);
+#if OS_STATIC_ALLOCATION
+    explicit Queue(QueueStorage<T, n>& storage);
+#endif
     Queue(const Queue&) = delete;
     Queue(Queue&&);
     Queue& operator=(const Queue&) = delete;
@@ -48,6 +53,9 @@ class Queue<T, 1>
 
 public:
     Queue(void);
+#if OS_STATIC_ALLOCATION
+    explicit Queue(QueueStorage<T, 1>& storage);
+#endif
     Queue(const Queue&) = delete;
     Queue(Queue&&);
     Queue& operator=(const Queue&) = delete;
@@ -68,6 +76,12 @@ template<typename T, size_t n>
 Queue<T, n>::Queue(void) :
     mQueueHandle(xQueueCreate(n, sizeof(T))) {}
 
+#if OS_STATIC_ALLOCATION
+template<typename T, size_t n>
+Queue<T, n>::Queue(QueueStorage<T, n>& storage) :
+    mQueueHandle(xQueueCreateStatic(n, sizeof(T), storage.data, &storage.queue)) {}
+#endif
+
 template<typename T, size_t n>
 Queue<T, n>::Queue(Queue&& rhs) :
     mQueueHandle(rhs.mQueueHandle)
@@ -203,6 +217,13 @@ Queue<T, 1>::Queue(void) :
     mQueueHandle(xQueueCreate(1, sizeof(T)))
 {}
 
+#if OS_STATIC_ALLOCATION
+template<typename T>
+Queue<T, 1>::Queue(QueueStorage<T, 1>& storage) :
+    mQueueHandle(xQueueCreateStatic(1, sizeof(T), storage.data, &storage.queue))
+{}
+#endif
+
 template<typename T>
 Queue<T, 1>::Queue(Queue<T, 1>&& rhs) :
     mQueueHandle(rhs.mQueueHandle)
@@ -0,0 +1,177 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "os_Task.h"
+
+namespace os
+{
+/**
+ * Lock free ring buffer for a single producer, usually an interrupt, and a
+ * single consumer task. Other than StreamBuffer::sendFromISR, sending doesn't
+ * enter the kernel. The consumer is only notified if it waits for data and
+ * the ring reaches its trigger level, so a burst of bytes wakes it once.
+ *
+ * Head and tail run freely and are masked on access, therefore n has to be a
+ * power of two and all n elements are usable.
+ */
+template<typename T, size_t n>
+class RingBuffer
+{
+    static_assert((n > 0) && ((n & (n - 1)) == 0), "The capacity has to be a power of two");
+    static constexpr size_t MASK = n - 1;
+
+    T mData[n];
+    // Only written by the producer
+    std::atomic<uint32_t> mHead;
+    // Only written by the consumer
+    std::atomic<uint32_t> mTail;
+    std::atomic<bool> mIsWaiting;
+    // Set by the consumer before it waits
+    xTaskHandle mConsumer;
+    size_t mNeeded;
+    size_t mTriggerLevel;
+    std::atomic<uint32_t> mOverruns;
+    std::atomic<uint32_t> mNotifications;
+
+    size_t available(void) const
+    {
+        return mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_relaxed);
+    }
+
+    // Returns when at least needed elements are available or the time is up
+    void wait(const size_t needed, const uint32_t ticksToWait);
+
+public:
+    RingBuffer(const size_t triggerLevel = 1) :
+        mHead(0), mTail(0), mIsWaiting(false), mConsumer(nullptr), mNeeded(0), mTriggerLevel(triggerLevel),
+        mOverruns(0), mNotifications(0) {}
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer(RingBuffer&&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+    RingBuffer& operator=(RingBuffer&&) = delete;
+
+    // Producer side. Returns false and counts an overrun if the ring is full.
+    bool sendFromISR(const T message);
+
+    // Consumer side. Waits until the trigger level or length elements are available and takes up to length elements.
+    size_t receive(T* message, const size_t length, const uint32_t ticksToWait = portMAX_DELAY);
+    bool receive(T& message, const uint32_t ticksToWait = portMAX_DELAY);
+
+    // Drops the content. Another task than the consumer may only reset while the consumer doesn't receive.
+    void reset(void)
+    {
+        mTail.store(mHead.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    size_t bytesAvailable(void) const
+    {
+        return available() * sizeof(T);
+    }
+
+    bool isEmpty(void) const
+    {
+        return available() == 0;
+    }
+
+    bool isFull(void) const
+    {
+        return available() == n;
+    }
+
+    void setTriggerLevel(const size_t triggerLevel)
+    {
+        mTriggerLevel = triggerLevel;
+    }
+
+    // Elements dropped because the ring was full
+    uint32_t getOverruns(void) const
+    {
+        return mOverruns.load(std::memory_order_relaxed);
+    }
+
+    // Wake ups of the consumer, each one is a context switch
+    uint32_t getNotifications(void) const
+    {
+        return mNotifications.load(std::memory_order_relaxed);
+    }
+};
+
+template<typename T, size_t n>
+bool RingBuffer<T, n>::sendFromISR(const T message)
+{
+    const uint32_t head = mHead.load(std::memory_order_relaxed);
+    if (head - mTail.load(std::memory_order_acquire) >= n) {
+        mOverruns.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    mData[head & MASK] = message;
+    mHead.store(head + 1, std::memory_order_release);
+
+    // Pairs with the fence of the consumer, so either it sees the element or we see it waiting
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mIsWaiting.load(std::memory_order_acquire) &&
+        (head + 1 - mTail.load(std::memory_order_relaxed) >= mNeeded) &&
+        mIsWaiting.exchange(false, std::memory_order_acquire))
+    {
+        mNotifications.fetch_add(1, std::memory_order_relaxed);
+        Task::notifyGiveFromISR(mConsumer);
+    }
+    return true;
+}
+
+template<typename T, size_t n>
+void RingBuffer<T, n>::wait(const size_t needed, const uint32_t ticksToWait)
+{
+    const uint32_t start = Task::getTickCount();
+    mConsumer = ThisTask::getHandle();
+    mNeeded = needed;
+
+    while (available() < needed) {
+        mIsWaiting.store(true, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (available() >= needed) {
+            break;
+        }
+
+        const uint32_t elapsed = Task::getTickCount() - start;
+        if (elapsed >= ticksToWait) {
+            break;
+        }
+        // A notification left over from an earlier wait only costs another round
+        ThisTask::notifyTake(ticksToWait == portMAX_DELAY ? portMAX_DELAY : ticksToWait - elapsed);
+    }
+    mIsWaiting.store(false, std::memory_order_relaxed);
+}
+
+template<typename T, size_t n>
+size_t RingBuffer<T, n>::receive(T* message, const size_t length, const uint32_t ticksToWait)
+{
+    if (ticksToWait != 0) {
+        wait(std::max<size_t>(1, std::min(mTriggerLevel, length)), ticksToWait);
+    }
+
+    const uint32_t tail = mTail.load(std::memory_order_relaxed);
+    const size_t count = std::min(length, available());
+    for (size_t i = 0; i < count; i++) {
+        message[i] = mData[(tail + i) & MASK];
+    }
+    mTail.store(tail + count, std::memory_order_release);
+    return count;
+}
+
+template<typename T, size_t n>
+bool RingBuffer<T, n>::receive(T& message, const uint32_t ticksToWait)
+{
+    return receive(&message, 1, ticksToWait) == 1;
+}
+}
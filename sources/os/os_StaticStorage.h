@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "FreeRTOS.h"
+#include "task.h"
+
+// The static allocation API exists since FreeRTOS 9, older kernels ignore the configuration
+#if (tskKERNEL_VERSION_MAJOR >= 9) && configSUPPORT_STATIC_ALLOCATION
+#define OS_STATIC_ALLOCATION 1
+#else
+#define OS_STATIC_ALLOCATION 0
+#endif
+
+/**
+ * Places a storage object in the core coupled memory. The startup doesn't
+ * initialise it and the DMA can't access it, so it's only suitable for the
+ * storage of kernel objects whose buffers aren't transferred by DMA. Local
+ * buffers of a task live on its stack.
+ */
+#define OS_CCM_RAM __attribute__((section(".ccmram")))
+
+#if OS_STATIC_ALLOCATION
+namespace os
+{
+/**
+ * Memory for the kernel objects which are created with the static
+ * allocation API. Global or static storage objects end up in .bss, so the
+ * RAM they take is known at link time and nothing is taken from the heap.
+ *  static os::TaskStorage<1024> storage OS_CCM_RAM;
+ *  const os::TaskEndless task("Task", storage, os::Task::Priority::LOW, function);
+ * The storage has to outlive the object which uses it.
+ */
+template<size_t STACKSIZE>
+struct TaskStorage {
+    // In byte like the stack size of os::Task
+    static constexpr size_t SIZE = STACKSIZE;
+
+    StackType_t stack[STACKSIZE / sizeof(StackType_t)];
+    StaticTask_t task;
+};
+
+using SemaphoreStorage = StaticSemaphore_t;
+
+using TimerStorage = StaticTimer_t;
+
+template<typename T, size_t n>
+struct QueueStorage {
+    uint8_t data[n * sizeof(T)];
+    StaticQueue_t queue;
+};
+
+template<typename T, size_t n>
+struct StreamBufferStorage {
+    // A stream buffer keeps one byte free to tell full from empty
+    uint8_t data[n * sizeof(T) + 1];
+    StaticStreamBuffer_t streamBuffer;
+};
+}
+#endif
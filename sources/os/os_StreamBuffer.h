@@ -8,6 +8,7 @@
 #include "FreeRTOS.h"
 #include "stream_buffer.h"
 #include "os_Task.h"
+#include "os_StaticStorage.h"
 
 namespace os
 {
@@ -18,6 +19,9 @@ class StreamBuffer
 
 public:
     StreamBuffer(const size_t triggerLevel = 1);
+#if OS_STATIC_ALLOCATION
+    explicit StreamBuffer(StreamBufferStorage<T, n>& storage, const size_t triggerLevel = 1);
+#endif
     StreamBuffer(const StreamBuffer&) = delete;
     StreamBuffer(StreamBuffer&&);
     StreamBuffer& operator=(const StreamBuffer&) = delete;
@@ -48,6 +52,13 @@ template<typename T, size_t n>
 StreamBuffer<T, n>::StreamBuffer(const size_t triggerLevel) :
     mStreamBufferHandle(xStreamBufferCreate(n * sizeof(T), triggerLevel)) {}
 
+#if OS_STATIC_ALLOCATION
+template<typename T, size_t n>
+StreamBuffer<T, n>::StreamBuffer(StreamBufferStorage<T, n>& storage, const size_t triggerLevel) :
+    mStreamBufferHandle(xStreamBufferCreateStatic(sizeof(storage.data), triggerLevel, storage.data,
+                                                  &storage.streamBuffer)) {}
+#endif
+
 template<typename T, size_t n>
 StreamBuffer<T, n>::StreamBuffer(StreamBuffer&& rhs) :
     mStreamBufferHandle(rhs.mStreamBufferHandle)
@@ -24,12 +24,19 @@ using os::Task;
 
 bool Task::schedulerRunning = false;
 
+std::vector<Task*>& Task::getTasks(void)
+{
+    static std::vector<Task*> tasks;
+    return tasks;
+}
+
 Task::Task(const char*                      name,
            uint16_t                         stackSize,
            os::Task::Priority               priority,
            std::function<void(const bool&)> function) :
-    mTaskFunction(function)
+    mTaskFunction(function), mStackDepth(Task::STACKSIZE_IN_BYTE(stackSize))
 {
+    getTasks().emplace_back(this);
     xTaskCreate(Task::task,
                 name,
                 Task::STACKSIZE_IN_BYTE(stackSize),
@@ -38,11 +45,38 @@ Task::Task(const char*                      name,
                 &this->mHandle);
 }
 
+#if OS_STATIC_ALLOCATION
+Task::Task(const char*                      name,
+           StackType_t* const               stack,
+           const uint32_t                   stackDepth,
+           StaticTask_t&                    buffer,
+           os::Task::Priority               priority,
+           std::function<void(const bool&)> function) :
+    mTaskFunction(function), mStackDepth(stackDepth)
+{
+    getTasks().emplace_back(this);
+    this->mHandle = xTaskCreateStatic(Task::task,
+                                      name,
+                                      stackDepth,
+                                      this,
+                                      static_cast<uint16_t>(priority),
+                                      stack,
+                                      &buffer);
+}
+#endif
+
 Task::~Task(void)
 {
     if (this->mHandle) {
         vTaskDelete(this->mHandle);
     }
+    std::vector<Task*>& tasks = getTasks();
+    for (auto it = tasks.begin(); it != tasks.end(); ++it) {
+        if (*it == this) {
+            tasks.erase(it);
+            break;
+        }
+    }
 }
 
 void Task::task(void* pvParameters)
@@ -53,8 +87,9 @@ void Task::task(void* pvParameters)
 void Task::taskFunction(void)
 {
     mTaskFunction(false);
-    vTaskDelete(nullptr);
+    // Deleting the running task doesn't return
     this->mHandle = 0;
+    vTaskDelete(nullptr);
 }
 
 void Task::suspend(void) const
@@ -137,6 +172,47 @@ uint32_t Task::getTickCountFromISR(void)
     return xTaskGetTickCountFromISR();
 }
 
+uint32_t Task::getMicroseconds(void)
+{
+#ifdef SIMULATION
+    return ulPortGetMicroseconds();
+#else
+    static constexpr uint32_t US_PER_TICK = 1000000 / configTICK_RATE_HZ;
+    uint32_t tick;
+    uint32_t counter;
+    bool isTickPending;
+
+    do {
+        tick = xTaskGetTickCount();
+        counter = SysTick->VAL;
+        isTickPending = (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0;
+    } while (tick != xTaskGetTickCount());
+
+    // The counter wrapped, but the tick interrupt is still masked
+    const uint32_t load = SysTick->LOAD + 1;
+    if (isTickPending && (counter > load / 2)) {
+        tick++;
+    }
+    // The SysTick counts down
+    return tick * US_PER_TICK + (load - 1 - counter) * US_PER_TICK / load;
+#endif
+}
+
+void Task::notifyGive(xTaskHandle handle)
+{
+    xTaskNotifyGive(handle);
+}
+
+void Task::notifyGiveFromISR(xTaskHandle handle)
+{
+    BaseType_t highPriorityTaskWoken = pdFALSE;
+
+    vTaskNotifyGiveFromISR(handle, &highPriorityTaskWoken);
+    if (highPriorityTaskWoken) {
+        ThisTask::yield();
+    }
+}
+
 void os::ThisTask::sleep(const std::chrono::milliseconds ms)
 {
     if (os::Task::isSchedulerRunning()) {
@@ -149,28 +225,107 @@ void os::ThisTask::sleep(const std::chrono::milliseconds ms)
     }
 }
 
+void os::ThisTask::sleepUntil(uint32_t& previousWakeTick, const std::chrono::milliseconds increment)
+{
+    TickType_t tick = previousWakeTick;
+    vTaskDelayUntil(&tick, increment.count() / portTICK_RATE_MS);
+    previousWakeTick = tick;
+}
+
 void os::ThisTask::yield(void)
 {
     portYIELD();
 }
 
+uint32_t os::ThisTask::notifyTake(const uint32_t ticksToWait)
+{
+    return ulTaskNotifyTake(pdTRUE, ticksToWait);
+}
+
+xTaskHandle os::ThisTask::getHandle(void)
+{
+    return xTaskGetCurrentTaskHandle();
+}
+
 char* os::ThisTask::getName(void)
 {
     return pcTaskGetTaskName(nullptr);
 }
 
+#ifdef MEASURE_CRITICAL_SECTIONS
+// Only changed with masked interrupts
+static uint32_t g_criticalNesting = 0;
+static uint32_t g_criticalSectionStart = 0;
+static uint32_t g_maxCriticalSectionCycles = 0;
+
+uint32_t os::ThisTask::getMaxCriticalSectionCycles(void)
+{
+    return g_maxCriticalSectionCycles;
+}
+
+void os::ThisTask::resetMaxCriticalSectionCycles(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    g_maxCriticalSectionCycles = 0;
+}
+#endif
+
 void os::ThisTask::enterCriticalSection(void)
 {
     taskENTER_CRITICAL();
+#ifdef MEASURE_CRITICAL_SECTIONS
+    if (g_criticalNesting++ == 0) {
+        g_criticalSectionStart = DWT->CYCCNT;
+    }
+#endif
 }
 
 void os::ThisTask::exitCriticalSection(void)
 {
+#ifdef MEASURE_CRITICAL_SECTIONS
+    if (--g_criticalNesting == 0) {
+        const uint32_t cycles = DWT->CYCCNT - g_criticalSectionStart;
+        g_maxCriticalSectionCycles = cycles > g_maxCriticalSectionCycles ? cycles : g_maxCriticalSectionCycles;
+    }
+#endif
     taskEXIT_CRITICAL();
 }
 
 extern "C" void vApplicationTickHook(void) {}
 
+#if OS_STATIC_ALLOCATION
+/*-----------------------------------------------------------*/
+extern "C" void vApplicationGetIdleTaskMemory(StaticTask_t** ppxIdleTaskTCBBuffer,
+                                              StackType_t**  ppxIdleTaskStackBuffer,
+                                              uint32_t*      pulIdleTaskStackSize)
+{
+    /* With configSUPPORT_STATIC_ALLOCATION the kernel takes the memory of the
+       idle task from the application instead of the heap. */
+    static StaticTask_t idleTask;
+    static StackType_t idleTaskStack[configMINIMAL_STACK_SIZE];
+
+    *ppxIdleTaskTCBBuffer = &idleTask;
+    *ppxIdleTaskStackBuffer = idleTaskStack;
+    *pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+#endif
+
+#if OS_STATIC_ALLOCATION && configUSE_TIMERS
+/*-----------------------------------------------------------*/
+extern "C" void vApplicationGetTimerTaskMemory(StaticTask_t** ppxTimerTaskTCBBuffer,
+                                               StackType_t**  ppxTimerTaskStackBuffer,
+                                               uint32_t*      pulTimerTaskStackSize)
+{
+    static StaticTask_t timerTask;
+    static StackType_t timerTaskStack[configTIMER_TASK_STACK_DEPTH];
+
+    *ppxTimerTaskTCBBuffer = &timerTask;
+    *ppxTimerTaskStackBuffer = timerTaskStack;
+    *pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
+#endif
+
 /*-----------------------------------------------------------*/
 extern "C" void vApplicationMallocFailedHook(void)
 {
@@ -202,6 +357,10 @@ extern "C" void vApplicationIdleHook(void)
        important that vApplicationIdleHook() is permitted to return to its calling
        function, because it is the responsibility of the idle task to clean up
        memory allocated by the kernel to any task that has since been deleted. */
+#ifdef SIMULATION
+    // Don't spin on the host
+    vPortWaitForInterrupt();
+#endif
 }
 
 /*-----------------------------------------------------------*/
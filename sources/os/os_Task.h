@@ -8,8 +8,10 @@
 #include <cstdint>
 #include "FreeRTOS.h"
 #include "task.h"
+#include "os_StaticStorage.h"
 #include <functional>
 #include <chrono>
+#include <vector>
 
 namespace os
 {
@@ -17,12 +19,16 @@ class Task
 {
     static void task(void* pvParameters);
     static bool schedulerRunning;
+    // All tasks, also those which are created during the static initialisation
+    static std::vector<Task*>& getTasks(void);
 
 protected:
     virtual void taskFunction(void);
 
     xTaskHandle mHandle;
     std::function<void(const bool&)> mTaskFunction;
+    // In words of the stack
+    uint32_t mStackDepth;
 
 public:
     enum Priority {
@@ -37,6 +43,13 @@ public:
 
     Task(const char* name, uint16_t stackSize, os::Task::Priority priority,
          std::function<void(const bool&)> function);
+#if OS_STATIC_ALLOCATION
+    // The stack and the task control block are taken from the storage instead of the heap
+    template<size_t STACKSIZE>
+    Task(const char* name, TaskStorage<STACKSIZE>& storage, os::Task::Priority priority,
+         std::function<void(const bool&)> function) :
+        Task(name, storage.stack, sizeof(storage.stack) / sizeof(StackType_t), storage.task, priority, function) {}
+#endif
     Task(const Task&) = delete;
     Task(Task&&) = delete;
     Task& operator=(const Task&) = delete;
@@ -68,8 +81,20 @@ public:
     static uint32_t getNumberOfTasks(void);
     static uint32_t getTickCount(void);
     static uint32_t getTickCountFromISR(void);
+    // Time since the start of the scheduler with the resolution of the SysTick counter, wraps after 71 minutes
+    static uint32_t getMicroseconds(void);
+    // Increments the notification value of the task and yields if it has a higher priority
+    static void notifyGive(xTaskHandle handle);
+    static void notifyGiveFromISR(xTaskHandle handle);
 
     friend struct ThisTask;
+    friend class StackMonitor;
+
+#if OS_STATIC_ALLOCATION
+private:
+    Task(const char* name, StackType_t* const stack, const uint32_t stackDepth, StaticTask_t& buffer,
+         os::Task::Priority priority, std::function<void(const bool&)> function);
+#endif
 };
 
 struct ThisTask {
@@ -80,11 +105,21 @@ struct ThisTask {
     }
 
     static void sleep(const std::chrono::milliseconds ms);
+    static void sleepUntil(uint32_t& previousWakeTick, const std::chrono::milliseconds increment);
     static void yield(void);
+    // Waits until the notification value is non zero and clears it, returns the value before
+    static uint32_t notifyTake(const uint32_t ticksToWait);
+    static xTaskHandle getHandle(void);
 
     static void enterCriticalSection(void);
     static void exitCriticalSection(void);
 
+#ifdef MEASURE_CRITICAL_SECTIONS
+    // Longest critical section in DWT cycles since the last reset, the reset starts the cycle counter
+    static uint32_t getMaxCriticalSectionCycles(void);
+    static void resetMaxCriticalSectionCycles(void);
+#endif
+
     static char* getName(void);
 };
 }
@@ -0,0 +1,371 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+/*
+ * FreeRTOS port for the simulation of a firmware on a POSIX host.
+ *
+ * Every task is a thread, but only the thread of the running task executes,
+ * all others wait on their semaphore. A context switch resumes the next
+ * thread and suspends the current one, so the kernel keeps the full control
+ * over the scheduling like on the MCU.
+ *
+ * Interrupts are signals. The tick is SIGALRM of an interval timer, the
+ * simulated interrupts of the peripherals share SIGUSR1. Both are masked
+ * for all threads except for the running task outside of critical sections,
+ * therefore the handlers always interrupt the running task and may switch
+ * to another task before they return.
+ *
+ * A task which calls into the C library while it can be preempted may hold
+ * a lock of the library when another task needs it. Code of the simulation
+ * which takes such locks, like stdio, has to run in a critical section.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define portTICK_SIGNAL SIGALRM
+#define portINTERRUPT_SIGNAL SIGUSR1
+
+/* Tasks only run on the MCU stack in the firmware, the thread stack has to
+   hold the C library of the host additionally. */
+#define portTHREAD_STACK_SIZE (256 * 1024)
+
+typedef struct {
+    pthread_t xThread;
+    sem_t xResume;
+    TaskFunction_t pxCode;
+    void* pvParameters;
+} Thread_t;
+
+/* Like on the Cortex-M, critical sections before the scheduler starts don't enable the interrupts again */
+static volatile UBaseType_t uxCriticalNesting = 0xaaaaaaaa;
+
+/* Only changed with all interrupts masked */
+static volatile BaseType_t xInsideInterrupt = pdFALSE;
+static volatile BaseType_t xSwitchRequired = pdFALSE;
+static volatile BaseType_t xSchedulerStarted = pdFALSE;
+
+static sigset_t xInterruptSignals;
+static sem_t xSchedulerEnd;
+static struct timespec xStartTime;
+static uint64_t ullProcessedTicks = 0;
+
+static void (* pvInterruptHandlers[portMAX_INTERRUPTS])(void);
+static atomic_uint_least64_t ullPendingInterrupts = ATOMIC_VAR_INIT(0);
+
+extern PRIVILEGED_DATA void* volatile pxCurrentTCB;
+
+/*-----------------------------------------------------------*/
+
+static Thread_t* prvGetThread(void* pxTCB)
+{
+    /* The first member of the TCB is the top of stack, where pxPortInitialiseStack() left the thread */
+    return *(Thread_t**)*(StackType_t**)pxTCB;
+}
+
+static uint64_t prvGetElapsedNanoseconds(void)
+{
+    struct timespec xNow;
+    clock_gettime(CLOCK_MONOTONIC, &xNow);
+    return (uint64_t)(xNow.tv_sec - xStartTime.tv_sec) * 1000000000ULL + (uint64_t)xNow.tv_nsec -
+           (uint64_t)xStartTime.tv_nsec;
+}
+
+static void prvMaskInterrupts(void)
+{
+    pthread_sigmask(SIG_BLOCK, &xInterruptSignals, NULL);
+}
+
+static void prvUnmaskInterrupts(void)
+{
+    pthread_sigmask(SIG_UNBLOCK, &xInterruptSignals, NULL);
+}
+
+static void prvWaitForResume(Thread_t* const pxThread)
+{
+    while (sem_wait(&pxThread->xResume) != 0) {}
+}
+
+/* Called with all interrupts masked */
+static void prvSwitchContext(void)
+{
+    Thread_t* const pxPrevious = prvGetThread(pxCurrentTCB);
+    vTaskSwitchContext();
+    Thread_t* const pxNext = prvGetThread(pxCurrentTCB);
+
+    if (pxNext != pxPrevious) {
+        /* The thread of a deleted task is never resumed again. Like on the MCU,
+           its stack isn't unwound, so no destructor runs. */
+        const UBaseType_t uxNesting = uxCriticalNesting;
+        sem_post(&pxNext->xResume);
+        prvWaitForResume(pxPrevious);
+        uxCriticalNesting = uxNesting;
+    }
+}
+
+static void* prvTaskThread(void* pvParameters)
+{
+    Thread_t* const pxThread = (Thread_t*)pvParameters;
+
+    prvWaitForResume(pxThread);
+    uxCriticalNesting = 0;
+    prvUnmaskInterrupts();
+
+    pxThread->pxCode(pxThread->pvParameters);
+
+    /* Tasks must not return */
+    vTaskDelete(NULL);
+    return NULL;
+}
+
+static void prvEndInterrupt(void)
+{
+    xInsideInterrupt = pdFALSE;
+    if (xSwitchRequired != pdFALSE) {
+        xSwitchRequired = pdFALSE;
+        prvSwitchContext();
+    }
+}
+
+static void prvTickHandler(int sig)
+{
+    (void)sig;
+    const int iErrno = errno;
+    xInsideInterrupt = pdTRUE;
+
+    /* Signals of the timer get lost while the interrupts are masked or the
+       host doesn't schedule the process, the ticks are caught up. */
+    const uint64_t ullTicks = prvGetElapsedNanoseconds() / (1000000000ULL / configTICK_RATE_HZ);
+
+    while (ullProcessedTicks < ullTicks) {
+        ullProcessedTicks++;
+        if (xTaskIncrementTick() != pdFALSE) {
+            xSwitchRequired = pdTRUE;
+        }
+    }
+
+    prvEndInterrupt();
+    errno = iErrno;
+}
+
+static void prvInterruptHandler(int sig)
+{
+    (void)sig;
+    const int iErrno = errno;
+    xInsideInterrupt = pdTRUE;
+
+    uint64_t ullPending;
+    while ((ullPending = atomic_exchange(&ullPendingInterrupts, 0)) != 0) {
+        for (int32_t i = 0; i < portMAX_INTERRUPTS; i++) {
+            if ((ullPending & (1ULL << i)) && (pvInterruptHandlers[i] != NULL)) {
+                pvInterruptHandlers[i]();
+            }
+        }
+    }
+
+    prvEndInterrupt();
+    errno = iErrno;
+}
+
+static void prvInstallHandler(const int iSignal, void (* pvHandler)(int))
+{
+    struct sigaction xAction;
+    memset(&xAction, 0, sizeof(xAction));
+    xAction.sa_handler = pvHandler;
+    xAction.sa_flags = SA_RESTART;
+    /* Interrupts don't nest */
+    xAction.sa_mask = xInterruptSignals;
+    sigaction(iSignal, &xAction, NULL);
+}
+
+/*-----------------------------------------------------------*/
+
+StackType_t* pxPortInitialiseStack(StackType_t* pxTopOfStack, TaskFunction_t pxCode, void* pvParameters)
+{
+    sigemptyset(&xInterruptSignals);
+    sigaddset(&xInterruptSignals, portTICK_SIGNAL);
+    sigaddset(&xInterruptSignals, portINTERRUPT_SIGNAL);
+
+    /* The new thread inherits the masked interrupts and the creating task can't be preempted meanwhile */
+    sigset_t xPrevious;
+    pthread_sigmask(SIG_BLOCK, &xInterruptSignals, &xPrevious);
+
+    /* The thread outlives the stack memory of a deleted task, so it lives on the heap of the host */
+    Thread_t* const pxThread = (Thread_t*)malloc(sizeof(Thread_t));
+    configASSERT(pxThread != NULL);
+    pxThread->pxCode = pxCode;
+    pxThread->pvParameters = pvParameters;
+    sem_init(&pxThread->xResume, 0, 0);
+
+    pthread_attr_t xAttributes;
+    pthread_attr_init(&xAttributes);
+    pthread_attr_setstacksize(&xAttributes, portTHREAD_STACK_SIZE);
+    pthread_attr_setdetachstate(&xAttributes, PTHREAD_CREATE_DETACHED);
+    const int iResult = pthread_create(&pxThread->xThread, &xAttributes, prvTaskThread, pxThread);
+    pthread_attr_destroy(&xAttributes);
+    configASSERT(iResult == 0);
+
+    pthread_sigmask(SIG_SETMASK, &xPrevious, NULL);
+
+    *(Thread_t**)pxTopOfStack = pxThread;
+    return pxTopOfStack;
+}
+
+BaseType_t xPortStartScheduler(void)
+{
+    /* The thread of main() never runs a task and keeps the interrupts masked */
+    prvMaskInterrupts();
+    sem_init(&xSchedulerEnd, 0, 0);
+    prvInstallHandler(portTICK_SIGNAL, prvTickHandler);
+    prvInstallHandler(portINTERRUPT_SIGNAL, prvInterruptHandler);
+
+    clock_gettime(CLOCK_MONOTONIC, &xStartTime);
+    const struct itimerval xInterval = {
+        {0, 1000000 / configTICK_RATE_HZ},
+        {0, 1000000 / configTICK_RATE_HZ}
+    };
+    setitimer(ITIMER_REAL, &xInterval, NULL);
+
+    xSchedulerStarted = pdTRUE;
+    if (atomic_load(&ullPendingInterrupts) != 0) {
+        kill(getpid(), portINTERRUPT_SIGNAL);
+    }
+
+    sem_post(&prvGetThread(pxCurrentTCB)->xResume);
+    while (sem_wait(&xSchedulerEnd) != 0) {}
+    return pdTRUE;
+}
+
+void vPortEndScheduler(void)
+{
+    const struct itimerval xStop = {{0, 0}, {0, 0}};
+    setitimer(ITIMER_REAL, &xStop, NULL);
+    xSchedulerStarted = pdFALSE;
+
+    /* Returns from vTaskStartScheduler() in main(), the tasks stay suspended */
+    sem_post(&xSchedulerEnd);
+    prvMaskInterrupts();
+    for ( ; ; ) {
+        pause();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void vPortYield(void)
+{
+    if (xInsideInterrupt != pdFALSE) {
+        xSwitchRequired = pdTRUE;
+        return;
+    }
+    vPortEnterCritical();
+    prvSwitchContext();
+    vPortExitCritical();
+}
+
+void vPortYieldFromISR(BaseType_t xSwitch)
+{
+    if (xSwitch != pdFALSE) {
+        vPortYield();
+    }
+}
+
+void vPortDisableInterrupts(void)
+{
+    prvMaskInterrupts();
+}
+
+void vPortEnableInterrupts(void)
+{
+    if (xInsideInterrupt == pdFALSE) {
+        prvUnmaskInterrupts();
+    }
+}
+
+void vPortEnterCritical(void)
+{
+    prvMaskInterrupts();
+    uxCriticalNesting++;
+}
+
+void vPortExitCritical(void)
+{
+    uxCriticalNesting--;
+    if ((uxCriticalNesting == 0) && (xInsideInterrupt == pdFALSE)) {
+        prvUnmaskInterrupts();
+    }
+}
+
+BaseType_t xPortSetInterruptMask(void)
+{
+    sigset_t xPrevious;
+    pthread_sigmask(SIG_BLOCK, &xInterruptSignals, &xPrevious);
+    return sigismember(&xPrevious, portINTERRUPT_SIGNAL) ? pdFALSE : pdTRUE;
+}
+
+void vPortClearInterruptMask(BaseType_t xMask)
+{
+    if (xMask != pdFALSE) {
+        prvUnmaskInterrupts();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void vPortSetInterruptHandler(const int32_t lInterruptNumber, void (* pvHandler)(void))
+{
+    configASSERT((lInterruptNumber >= 0) && (lInterruptNumber < portMAX_INTERRUPTS));
+    vPortEnterCritical();
+    pvInterruptHandlers[lInterruptNumber] = pvHandler;
+    vPortExitCritical();
+}
+
+void vPortGenerateSimulatedInterrupt(const int32_t lInterruptNumber)
+{
+    configASSERT((lInterruptNumber >= 0) && (lInterruptNumber < portMAX_INTERRUPTS));
+    atomic_fetch_or(&ullPendingInterrupts, 1ULL << lInterruptNumber);
+
+    /* Pending interrupts are served when the scheduler starts */
+    if (xSchedulerStarted != pdFALSE) {
+        kill(getpid(), portINTERRUPT_SIGNAL);
+    }
+}
+
+uint32_t ulPortGetMicroseconds(void)
+{
+    return (uint32_t)(prvGetElapsedNanoseconds() / 1000);
+}
+
+void vPortWaitForInterrupt(void)
+{
+    /* A signal between the check of the idle task and pause() only delays it until the next tick */
+    pause();
+}
+
+void vPortAssertFailed(const char* pcFile, const unsigned long ulLine)
+{
+    prvMaskInterrupts();
+    fprintf(stderr, "%s:%lu: assertion failed\n", pcFile, ulLine);
+    fflush(stderr);
+
+    /* abort() belongs to the firmware, see cpp_overrides.h */
+    signal(SIGABRT, SIG_DFL);
+    raise(SIGABRT);
+    _exit(EXIT_FAILURE);
+}
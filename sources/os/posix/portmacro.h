@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#ifndef PORTMACRO_H
+#define PORTMACRO_H
+
+/*
+ * FreeRTOS port for the simulation of a firmware on a POSIX host, see port.c.
+ * Every task runs in its own thread, but only the thread of the running task
+ * executes. Interrupts are signals, so disabling interrupts masks them.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Type definitions. */
+#define portCHAR char
+#define portFLOAT float
+#define portDOUBLE double
+#define portLONG long
+#define portSHORT short
+#define portSTACK_TYPE unsigned long
+#define portBASE_TYPE long
+#define portPOINTER_SIZE_TYPE uintptr_t
+
+typedef portSTACK_TYPE StackType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+#if (configUSE_16_BIT_TICKS == 1)
+typedef uint16_t TickType_t;
+#define portMAX_DELAY (TickType_t)0xffff
+#else
+typedef uint32_t TickType_t;
+#define portMAX_DELAY (TickType_t)0xffffffffUL
+#define portTICK_TYPE_IS_ATOMIC 1
+#endif
+
+/* Architecture specifics. */
+#define portSTACK_GROWTH (-1)
+#define portTICK_PERIOD_MS ((TickType_t)1000 / configTICK_RATE_HZ)
+#define portBYTE_ALIGNMENT 8
+#define portNOP()
+#define portINLINE __inline
+
+/* Scheduler utilities. A yield within an interrupt is deferred until the interrupt returns. */
+void vPortYield(void);
+void vPortYieldFromISR(BaseType_t xSwitchRequired);
+#define portYIELD() vPortYield()
+#define portEND_SWITCHING_ISR(xSwitchRequired) vPortYieldFromISR(xSwitchRequired)
+#define portYIELD_FROM_ISR(x) portEND_SWITCHING_ISR(x)
+
+/* Critical section management. */
+void vPortDisableInterrupts(void);
+void vPortEnableInterrupts(void);
+void vPortEnterCritical(void);
+void vPortExitCritical(void);
+BaseType_t xPortSetInterruptMask(void);
+void vPortClearInterruptMask(BaseType_t xMask);
+#define portSET_INTERRUPT_MASK_FROM_ISR() xPortSetInterruptMask()
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR(x) vPortClearInterruptMask(x)
+#define portDISABLE_INTERRUPTS() vPortDisableInterrupts()
+#define portENABLE_INTERRUPTS() vPortEnableInterrupts()
+#define portENTER_CRITICAL() vPortEnterCritical()
+#define portEXIT_CRITICAL() vPortExitCritical()
+
+/* Task function macros as described on the FreeRTOS.org WEB site. */
+#define portTASK_FUNCTION_PROTO(vFunction, pvParameters) void vFunction(void* pvParameters)
+#define portTASK_FUNCTION(vFunction, pvParameters) void vFunction(void* pvParameters)
+
+/* Simulated interrupts, the numbers are the IRQn of the device. A handler runs
+   with all interrupts masked, like an interrupt of the lowest priority. */
+#define portMAX_INTERRUPTS 64
+void vPortSetInterruptHandler(const int32_t lInterruptNumber, void (* pvHandler)(void));
+/* Can be called by any thread, also by threads which are no tasks. */
+void vPortGenerateSimulatedInterrupt(const int32_t lInterruptNumber);
+
+/* Microseconds since the scheduler started, the ticks follow the same clock. */
+uint32_t ulPortGetMicroseconds(void);
+
+/* Waits for the next interrupt, called by the idle task instead of WFI. */
+void vPortWaitForInterrupt(void);
+
+/* Prints the location of a failed configASSERT and aborts the simulation. */
+void vPortAssertFailed(const char* pcFile, const unsigned long ulLine);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PORTMACRO_H */
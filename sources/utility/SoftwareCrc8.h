@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Table driven CRC-8, MSB first without reflection and final xor, like the
+ * CRC unit of the STM32F30x with an 8 bit polynomial.
+ *
+ * Slicing by 4 or 8 processes a whole word per step with independent table
+ * lookups. Table n holds the CRC of a byte followed by n zero bytes, so the
+ * tables take SLICES * 256 byte of flash. They are generated at compile time.
+ */
+template<size_t SLICES>
+struct SoftwareCrc8 {
+    static_assert((SLICES == 1) || (SLICES == 4) || (SLICES == 8), "Invalid number of slices");
+
+    uint8_t mTable[SLICES][256];
+
+    // Keeps the table indices of the unused paths in range
+    static constexpr size_t slice(const size_t n)
+    {
+        return n < SLICES ? n : 0;
+    }
+
+    constexpr SoftwareCrc8(const uint8_t polynomial) :
+        mTable()
+    {
+        for (size_t i = 0; i < 256; i++) {
+            uint8_t crc = static_cast<uint8_t>(i);
+            for (size_t bit = 0; bit < 8; bit++) {
+                crc = static_cast<uint8_t>((crc & 0x80) ? (crc << 1) ^ polynomial : crc << 1);
+            }
+            mTable[0][i] = crc;
+        }
+        for (size_t n = 1; n < SLICES; n++) {
+            for (size_t i = 0; i < 256; i++) {
+                mTable[n][i] = mTable[0][mTable[n - 1][i]];
+            }
+        }
+    }
+
+    uint8_t calculate(uint8_t crc, uint8_t const* data, size_t length) const
+    {
+        // The words are little endian, so the lowest byte is the first one
+        for ( ; (SLICES >= 8) && (length >= 8); length -= 8, data += 8) {
+            uint32_t low, high;
+            std::memcpy(&low, data, sizeof(low));
+            std::memcpy(&high, data + 4, sizeof(high));
+            low ^= crc;
+            crc = mTable[slice(7)][low & 0xff] ^ mTable[slice(6)][(low >> 8) & 0xff] ^
+                  mTable[slice(5)][(low >> 16) & 0xff] ^ mTable[slice(4)][low >> 24] ^
+                  mTable[slice(3)][high & 0xff] ^ mTable[slice(2)][(high >> 8) & 0xff] ^
+                  mTable[slice(1)][(high >> 16) & 0xff] ^ mTable[0][high >> 24];
+        }
+
+        for ( ; (SLICES >= 4) && (length >= 4); length -= 4, data += 4) {
+            uint32_t word;
+            std::memcpy(&word, data, sizeof(word));
+            word ^= crc;
+            crc = mTable[slice(3)][word & 0xff] ^ mTable[slice(2)][(word >> 8) & 0xff] ^
+                  mTable[slice(1)][(word >> 16) & 0xff] ^ mTable[0][word >> 24];
+        }
+
+        for ( ; length; length--) {
+            crc = mTable[0][crc ^ *data++];
+        }
+        return crc;
+    }
+};
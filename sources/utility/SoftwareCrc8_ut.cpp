@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: GPL-3.0
+/*
+ * Copyright (c) 2014-2018 Nils Weiss
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "SoftwareCrc8.h"
+#include "unittest.h"
+
+static constexpr uint8_t POLYNOMIAL = 0x83;
+
+//--------------------------HELPERS--------------------------
+// Bit by bit, like the CRC unit with CRC_CalcCRC8bits
+static uint8_t bitwiseCrc(uint8_t crc, uint8_t const* data, size_t length)
+{
+    while (length--) {
+        crc ^= *data++;
+        for (size_t bit = 0; bit < 8; bit++) {
+            crc = static_cast<uint8_t>((crc & 0x80) ? (crc << 1) ^ POLYNOMIAL : crc << 1);
+        }
+    }
+    return crc;
+}
+
+static std::vector<uint8_t> randomData(const size_t length)
+{
+    std::vector<uint8_t> data(length);
+    uint32_t seed = 0x1234;
+    for (auto& byte : data) {
+        seed = seed * 1103515245 + 12345;
+        byte = seed >> 16;
+    }
+    return data;
+}
+
+static uint64_t cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+template<typename Function>
+static void benchmark(const char* name, Function f)
+{
+    static constexpr size_t LENGTH = 4096;
+    static constexpr size_t REPETITIONS = 2000;
+    const auto data = randomData(LENGTH);
+    volatile uint8_t sink = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t startCycles = cycles();
+    for (size_t i = 0; i < REPETITIONS; i++) {
+        sink = f(sink, data.data(), data.size());
+    }
+    const uint64_t stopCycles = cycles();
+    const auto duration = std::chrono::steady_clock::now() - start;
+
+    const double bytes = LENGTH * REPETITIONS;
+    printf("%-10s %6.2f ns/byte %6.2f cycles/byte\n", name,
+           std::chrono::duration<double, std::nano>(duration).count() / bytes,
+           (stopCycles - startCycles) / bytes);
+}
+
+//-------------------------TESTCASES-------------------------
+
+int ut_MatchesBitwise(void)
+{
+    TestCaseBegin();
+
+    static constexpr SoftwareCrc8<1> slice1(POLYNOMIAL);
+    static constexpr SoftwareCrc8<4> slice4(POLYNOMIAL);
+    static constexpr SoftwareCrc8<8> slice8(POLYNOMIAL);
+    const auto data = randomData(100);
+
+    // All lengths and misalignments hit every loop of the sliced paths
+    for (size_t offset = 0; offset < 8; offset++) {
+        for (size_t length = 0; length + offset <= data.size(); length++) {
+            const uint8_t expected = bitwiseCrc(0, data.data() + offset, length);
+            CHECK(slice1.calculate(0, data.data() + offset, length) == expected);
+            CHECK(slice4.calculate(0, data.data() + offset, length) == expected);
+            CHECK(slice8.calculate(0, data.data() + offset, length) == expected);
+        }
+    }
+
+    // Continuing a calculation is the same as calculating at once
+    const uint8_t first = slice8.calculate(0x5a, data.data(), 37);
+    CHECK(slice4.calculate(first, data.data() + 37, 63) == bitwiseCrc(0x5a, data.data(), 100));
+
+    TestCaseEnd();
+}
+
+int ut_Residue(void)
+{
+    TestCaseBegin();
+
+    static constexpr SoftwareCrc8<4> crc(POLYNOMIAL);
+    auto data = randomData(33);
+
+    // The transfer objects append the CRC, so a valid frame has the CRC 0
+    data.back() = crc.calculate(0, data.data(), data.size() - 1);
+    CHECK(crc.calculate(0, data.data(), data.size()) == 0);
+    data[5] ^= 0x10;
+    CHECK(crc.calculate(0, data.data(), data.size()) != 0);
+
+    TestCaseEnd();
+}
+
+int ut_Benchmark(void)
+{
+    TestCaseBegin();
+
+    static constexpr SoftwareCrc8<1> slice1(POLYNOMIAL);
+    static constexpr SoftwareCrc8<4> slice4(POLYNOMIAL);
+    static constexpr SoftwareCrc8<8> slice8(POLYNOMIAL);
+
+    benchmark("bitwise", bitwiseCrc);
+    benchmark("slice by 1", [](uint8_t crc, uint8_t const* data, size_t length) {
+        return slice1.calculate(crc, data, length);
+    });
+    benchmark("slice by 4", [](uint8_t crc, uint8_t const* data, size_t length) {
+        return slice4.calculate(crc, data, length);
+    });
+    benchmark("slice by 8", [](uint8_t crc, uint8_t const* data, size_t length) {
+        return slice8.calculate(crc, data, length);
+    });
+
+    TestCaseEnd();
+}
+
+int main(int argc, const char* argv[])
+{
+    UnitTestMainBegin();
+    RunTest(true, ut_MatchesBitwise);
+    RunTest(true, ut_Residue);
+    RunTest(true, ut_Benchmark);
+    UnitTestMainEnd();
+}
@@ -27,6 +27,24 @@ void for_each(Tuple&& tuple, F&& f)
                   std::make_index_sequence<N> {});
 }
 
+template<typename Tuple, typename F, std::size_t ... Indices>
+void for_each_indexed_impl(Tuple&& tuple, F&& f, std::index_sequence<Indices ...> )
+{
+    using swallow = int[];
+    (void)swallow {
+        1,
+        (f(Indices, std::get<Indices>(std::forward<Tuple>(tuple))), void(), int {}) ...
+    };
+}
+
+template<typename Tuple, typename F>
+void for_each_indexed(Tuple&& tuple, F&& f)
+{
+    constexpr std::size_t N = std::tuple_size<std::remove_reference_t<Tuple> >::value;
+    for_each_indexed_impl(std::forward<Tuple>(tuple), std::forward<F>(f),
+                          std::make_index_sequence<N> {});
+}
+
 template<size_t index, typename ... args>
 struct pack_size_index;
 
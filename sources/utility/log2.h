@@ -5,9 +5,20 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 template<size_t n>
 constexpr size_t constexpr_log2(void)
 {
     static_assert(n % 2 == 0 || n < 2, "Can not apply compile time log2");
     return (n < 2) ? 0 : 1 + constexpr_log2<n / 2>();
 }
+
+// Bucket of a log2 histogram: 0 for 0, n for 2^(n-1) to 2^n - 1, the last bucket takes all larger values
+template<size_t BUCKETS>
+inline size_t log2_bucket(const uint32_t value)
+{
+    const size_t n = (value == 0) ? 0 : 32 - __builtin_clz(value);
+    return (n < BUCKETS) ? n : BUCKETS - 1;
+}
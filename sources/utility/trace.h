@@ -11,11 +11,29 @@
 #define ZONE_VERBOSE 0x00000008
 
 #if defined(UNITTEST)
+#include <cstdio>
+
+#define Trace(ZONE, ...) do { \
+        if (g_DebugZones & (ZONE)) { \
+            printf("%s:%u: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            fflush(stdout); \
+        } \
+} while (0)
+#define TraceInit()
+#elif defined(SIMULATION)
+#include <cstdio>
+#include "FreeRTOS.h"
+#include "task.h"
+
+// A task preempted within printf would keep stdout locked, see sources/os/posix/port.c
 #define Trace(ZONE, ...) do { \
         if (g_DebugZones & (ZONE)) { \
+            taskENTER_CRITICAL(); \
             printf("%s:%u: ", __FILE__, __LINE__); \
             printf(__VA_ARGS__); \
             fflush(stdout); \
+            taskEXIT_CRITICAL(); \
         } \
 } while (0)
 #define TraceInit()